@@ -10,6 +10,13 @@ The instrument class is an abstract base class defining the interface for musica
 instruments in the sequencer. It includes a pure virtual function playSound(int
 whichInstrument) that derived classes must implement to produce sound. The class also
 provides a virtual destructor to ensure proper cleanup of derived objects.
+
+process() is the batched interface: it is called once per audio buffer with every event
+routed to the instrument during that buffer, sorted by frame offset, and with the output
+buses, so instruments that make sound themselves can render sample-accurately into the
+channels of each event's track (see outputBuses::getTrackChannel()).
+That is one virtual call per instrument per buffer instead of one per hit. The default
+implementation plays the events one by one through playSound() and renders nothing.
 */
 
 // These directives are used to prevent multiple inclusions of the same header file, which
@@ -17,23 +24,59 @@ provides a virtual destructor to ensure proper cleanup of derived objects.
 #ifndef Instrument_h
 #define Instrument_h
 
+#include <array>   // Include this to use std::array
+#include <cstddef> // Include this to use size_t
 #include <string> // Include this to use std::string
 
+class outputBuses;
+
+// A hit routed to an instrument, placed inside the current audio buffer
+struct noteEvent {
+    static constexpr int numParams = 4;  // Free parameters per event
+
+    int track = 0;            // Track the hit comes from
+    int frameOffset = 0;      // Frame inside the buffer the hit is due at
+    float velocity = 0.5f;    // Strength of the hit (0-1)
+    int note = 0;             // Sound to play: sample index or MIDI note, depending on the instrument
+    int channel = 1;          // MIDI channel (1-16); ignored by instruments without channels
+    std::array<float, numParams> params{}; // Instrument-specific parameters (e.g. tune, decay)
+};
+
 // Instrument-interface
 
 class instrument {
 
 protected:
     std::string description; // Protected member to hold the description
+    int source = -1;         // What the instrument was loaded from, -1 if not known
 
 public:
     virtual void playSound(int whichInstrument) = 0; // Pure virtual function
+    
+    // Plays the events of one buffer and adds the instrument's sound to the output buses.
+    // Called once per buffer from the audio thread, also when there are no events.
+    virtual void process(const noteEvent* events, size_t count, outputBuses& output) {
+        for (size_t i = 0; i < count; i++) {
+            playSound(events[i].note);
+        }
+    }
     virtual ~instrument() = default; // Virtual destructor for proper cleanup
     
     // Function to get the description of the instrument
     std::string getDescription() {
         return description;
     }
+    
+    // Tags the instrument with what it was loaded from, as a name id of the session trace
+    // (see sessionTrace::addName()), so the kit swapped in can be recorded
+    void setSource(int name) {
+        source = name;
+    }
+    
+    // Function to get what the instrument was loaded from
+    int getSource() const {
+        return source;
+    }
 };
 
 #endif /* Instrument_h */
@@ -0,0 +1,43 @@
+//
+//  instrumentVariant.cpp
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+#include "instrumentVariant.h"
+#include "synthInstrument.h"
+#include "sampleInstrument.h"
+#include "midiInstrument.h"
+#include <type_traits> // For telling the alternatives apart
+#include <typeinfo>    // For the exact type of an instrument
+
+instrumentVariant toInstrumentVariant(instrument* instr) {
+    // typeid rather than dynamic_cast: a derived class must keep its own overrides
+    if (instr) {
+        const std::type_info& type = typeid(*instr);
+        if (type == typeid(synthInstrument)) {
+            return static_cast<synthInstrument*>(instr);
+        }
+        if (type == typeid(sampleInstrument)) {
+            return static_cast<sampleInstrument*>(instr);
+        }
+        if (type == typeid(midiInstrument)) {
+            return static_cast<midiInstrument*>(instr);
+        }
+    }
+    return instr;
+}
+
+//--------------------------------------------------------------
+
+void processInstrument(const instrumentVariant& instr, const noteEvent* events, size_t count, outputBuses& output) {
+    std::visit([&](auto* exact) {
+        using exactType = std::remove_pointer_t<decltype(exact)>;
+        if constexpr (std::is_same_v<exactType, instrument>) {
+            exact->process(events, count, output); // Not known when building: through the interface
+        } else {
+            exact->exactType::process(events, count, output); // The qualified call binds statically
+        }
+    }, instr);
+}
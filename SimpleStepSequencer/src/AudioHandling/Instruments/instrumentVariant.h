@@ -0,0 +1,47 @@
+//
+//  instrumentVariant.h
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+/*
+An instrumentVariant holds an instrument by its exact type, so it can be called without
+virtual dispatch. It is the compile-time path of musicPlayer: built with STATIC_INSTRUMENTS
+defined (add it to PROJECT_DEFINES in config.make, or to the preprocessor macros in Xcode),
+musicPlayer keeps every destination as a variant and visits it once per buffer, so each
+instrument's process() is bound at compile time and, with link-time optimization, can be
+inlined into the loop over the destinations. Without the flag musicPlayer calls process()
+through the instrument interface, one virtual call per instrument per buffer.
+
+The instruments of the sequencer are known when building. Any other instrument is held as
+instrument* and still called through the interface, so instruments can be added and
+swapped in either build.
+
+musicPlayer::measureDispatch() compares both paths on the same instruments (headless:
+selftest dispatch).
+*/
+
+// These directives are used to prevent multiple inclusions of the same header file, which
+// helps avoid redefinition errors and improves compilation efficiency:
+#ifndef instrumentVariant_h
+#define instrumentVariant_h
+
+#include "instrument.h"
+#include <variant> // For holding an instrument by its exact type
+
+class synthInstrument;
+class sampleInstrument;
+class midiInstrument;
+
+// An instrument by its exact type; the last alternative is every other instrument
+using instrumentVariant = std::variant<synthInstrument*, sampleInstrument*, midiInstrument*, instrument*>;
+
+// Returns the instrument as its exact type. A class derived from one of the known
+// instruments is held as instrument*, so its overrides are still called.
+instrumentVariant toInstrumentVariant(instrument* instr);
+
+// Calls process() of the instrument by its exact type (audio thread)
+void processInstrument(const instrumentVariant& instr, const noteEvent* events, size_t count, outputBuses& output);
+
+#endif /* instrumentVariant_h */
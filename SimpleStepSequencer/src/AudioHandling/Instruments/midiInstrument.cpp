@@ -6,11 +6,21 @@
 //
 
 #include <stdio.h>
+#include <algorithm>
+#include <cmath>
 #include "midiInstrument.h"
+#include "musicPlayer.h"
+#include "rtLogger.h"
+#include "threadTuning.h"
+#include "timelineTrace.h"
 #include "ofLog.h"
 
 // Constructor for the midiInstrument class
 midiInstrument::midiInstrument() : m_midiChannel(1) {
+    // Reserve room for raw messages so sending them never allocates on the audio thread:
+    // at most one status byte and two data bytes for every Note On and Note Off of a buffer
+    m_rawBytes.reserve(musicPlayer::maxEventsPerBuffer * 6);
+    
     // List available MIDI ports for debugging purposes
     m_midiOut.listOutPorts();
     
@@ -30,10 +40,23 @@ midiInstrument::midiInstrument() : m_midiChannel(1) {
             ofLog() << "Failed to open MIDI port!";
             description = "Failed to open MIDI port.";
         }
+    
+    // Messages from the audio thread are written to the port by a thread of its own
+    m_pending.reserve(sendCapacity);
+    m_sendBytes.reserve(sendCapacity * chunkBytes);
+    m_running = true;
+    m_sender = std::thread(&midiInstrument::run, this);
 }
 
 // Destructor for the midiInstrument class
 midiInstrument::~midiInstrument() {
+    // Stop sending before the port goes away
+    m_running = false;
+    m_wake.signal();
+    if (m_sender.joinable()) {
+        m_sender.join();
+    }
+    
     // Close the MIDI port when the midiInstrument instance is destroyed
     m_midiOut.closePort();
 }
@@ -42,16 +65,163 @@ midiInstrument::~midiInstrument() {
 void midiInstrument::playSound(int whichInstrument) {
     // Determine the MIDI note to play based on the whichInstrument parameter
     // Note values typically range from 0 to 127; this example uses a base note of 60 (Middle C)
-    int note = 60 + whichInstrument;
     int velocity = 64; // Default velocity for the note (range 0 to 127)
+    sendNote(m_midiChannel, 60 + whichInstrument, velocity);
+}
 
-    // Send a Note On message to the specified MIDI channel with the calculated note and velocity
-    m_midiOut.sendNoteOn(m_midiChannel, note, velocity);
-    // Log the note and channel information for debugging
-    ofLog() << "Sent MIDI Note On: " << note << " on channel " << m_midiChannel;
+// Method to play the events of one buffer
+void midiInstrument::process(const noteEvent* events, size_t count, outputBuses& output) {
+    // Events due at the same frame are sent in one write. Within a write, running status
+    // leaves out repeated status bytes, and Note Offs are sent as Note On with velocity 0
+    // so they can share the status byte of the Note Ons.
+    size_t first = 0;
+    while (first < count) {
+        size_t last = first;
+        while (last < count && events[last].frameOffset == events[first].frameOffset) {
+            last++;
+        }
+        
+        m_rawBytes.clear();
+        int runningStatus = -1;
+        for (int noteOff = 0; noteOff < 2; noteOff++) {
+            for (size_t i = first; i < last; i++) {
+                // The routing table decides note and channel of each track
+                int channel = std::max(1, std::min(16, events[i].channel));
+                int status = 0x90 | (channel - 1);
+                int velocity = std::max(1, std::min(127, (int)std::lround(events[i].velocity * 127.0f)));
+                if (status != runningStatus) {
+                    m_rawBytes.push_back((unsigned char)status);
+                    runningStatus = status;
+                }
+                m_rawBytes.push_back((unsigned char)(events[i].note & 0x7f));
+                m_rawBytes.push_back((unsigned char)(noteOff ? 0 : velocity));
+            }
+        }
+        queueBytes(m_rawBytes.data(), m_rawBytes.size(), m_bufferFrame + events[first].frameOffset);
+        
+        // Logged off the audio thread, and rate-limited
+        rtLogger::instance().log("midiInstrument", "Sent %d MIDI notes in %d bytes at frame %d",
+                                 (int)(last - first), (int)m_rawBytes.size(), events[first].frameOffset);
+        first = last;
+    }
+}
 
-    // Optionally send a Note Off message to stop the note after a short delay
-    m_midiOut.sendNoteOff(m_midiChannel, note, velocity);
+// Method to send a note
+void midiInstrument::sendNote(int channel, int note, int velocity) {
+    TIMELINE_SCOPE_VALUE("midi note", note);
+    // The sender thread owns the port, so the note goes through the ring like the events of
+    // process(): a Note On, then a Note Off as Note On with velocity 0 under running status
+    unsigned char bytes[5] = {
+        (unsigned char)(0x90 | ((std::max(1, std::min(16, channel)) - 1))),
+        (unsigned char)(note & 0x7f),
+        (unsigned char)std::max(1, std::min(127, velocity)),
+        (unsigned char)(note & 0x7f),
+        0
+    };
+    queueBytes(bytes, sizeof(bytes), m_bufferFrame);
+    // Log the note and channel information for debugging, off the audio thread
+    rtLogger::instance().log("midiInstrument", "Sent MIDI Note On: %d on channel %d", note, channel);
+}
+
+// Method to send raw MIDI bytes such as clock pulses
+void midiInstrument::sendMidiBytes(const unsigned char* bytes, size_t count, int64_t sampleTime) {
+    // Every write starts with a status byte, so running status never spans writes
+    queueBytes(bytes, count, sampleTime);
+}
+
+// Method to learn when the frames of the stream are due
+void midiInstrument::setStreamTime(int64_t frame, double seconds, int sampleRate) {
+    m_bufferFrame = frame;
+    if (sampleRate > 0) {
+        m_secondsAtFrameZero.store(seconds - double(frame) / sampleRate, std::memory_order_relaxed);
+        m_sampleRate.store(sampleRate, std::memory_order_relaxed);
+    }
+}
+
+// Method to report messages that were dropped
+uint64_t midiInstrument::getDropped() const {
+    return m_dropped;
+}
+
+// Method to queue a write for the sender thread
+void midiInstrument::queueBytes(const unsigned char* bytes, size_t count, int64_t sampleTime) {
+    size_t chunks = (count + chunkBytes - 1) / chunkBytes;
+    size_t write = m_writeIndex.load(std::memory_order_relaxed);
+    if (chunks == 0) {
+        return;
+    }
+    if (sendCapacity - (write - m_readIndex.load(std::memory_order_acquire)) < chunks) {
+        m_dropped++;
+        rtLogger::instance().log("midiInstrument", "Dropped a MIDI message of %d bytes: the sender is behind", (int)count);
+        return; // Half a write would leave a message cut off
+    }
+    for (size_t i = 0; i < chunks; i++) {
+        timedChunk& chunk = m_ring[(write + i) & (sendCapacity - 1)];
+        chunk.sampleTime = sampleTime;
+        chunk.count = (uint8_t)std::min(chunkBytes, count - i * chunkBytes);
+        std::copy(bytes + i * chunkBytes, bytes + i * chunkBytes + chunk.count, chunk.bytes);
+    }
+    m_writeIndex.store(write + chunks, std::memory_order_release);
+    m_wake.signal(); // Never blocks; the sender may need to wake earlier than it planned
+}
+
+// Method to turn a frame of the sample clock into a time on the steady clock
+double midiInstrument::dueSeconds(int64_t sampleTime) const {
+    int sampleRate = m_sampleRate.load(std::memory_order_relaxed);
+    if (sampleRate <= 0) {
+        return 0.0;
+    }
+    return m_secondsAtFrameZero.load(std::memory_order_relaxed) + double(sampleTime) / sampleRate;
+}
+
+// Method run by the sender thread
+void midiInstrument::run() {
+    threadTuning::applyWorkerAffinity(); // Keep off the audio thread's cores, if configured
+    TIMELINE_THREAD("midi");
+    
+    // Messages further ahead than this are sent at once: the stream clock has jumped, or
+    // the engine is rendering faster than real time
+    const double maxWait = 0.5;
+    while (m_running) {
+        // Take what the audio thread queued; clock pulses of a buffer are queued before its
+        // notes, so the chunks are put in order of their frames
+        size_t read = m_readIndex.load(std::memory_order_relaxed);
+        size_t write = m_writeIndex.load(std::memory_order_acquire);
+        if (read != write) {
+            for (; read != write; read++) {
+                m_pending.push_back(m_ring[read & (sendCapacity - 1)]);
+            }
+            m_readIndex.store(read, std::memory_order_release);
+            std::stable_sort(m_pending.begin(), m_pending.end(), [](const timedChunk& a, const timedChunk& b) {
+                return a.sampleTime < b.sampleTime;
+            });
+        }
+        if (m_pending.empty()) {
+            // Nothing to send: sleep until the audio thread queues something
+            m_wake.wait();
+            continue;
+        }
+        
+        // Sleep until the earliest is due; a chunk queued meanwhile wakes the thread early,
+        // as it may be due sooner
+        double wait = dueSeconds(m_pending.front().sampleTime) - midiClockSlave::now();
+        if (wait > 0.0 && wait < maxWait) {
+            m_wake.waitFor(wait);
+            continue;
+        }
+        
+        // Every chunk due at the same frame goes out in one write
+        int64_t sampleTime = m_pending.front().sampleTime;
+        size_t chunks = 0;
+        m_sendBytes.clear();
+        while (chunks < m_pending.size() && m_pending[chunks].sampleTime == sampleTime) {
+            m_sendBytes.insert(m_sendBytes.end(), m_pending[chunks].bytes, m_pending[chunks].bytes + m_pending[chunks].count);
+            chunks++;
+        }
+        m_pending.erase(m_pending.begin(), m_pending.begin() + chunks);
+        TIMELINE_SCOPE_VALUE("midi send", m_sendBytes.size());
+        m_midiOut.sendMidiBytes(m_sendBytes);
+    }
 }
 
 
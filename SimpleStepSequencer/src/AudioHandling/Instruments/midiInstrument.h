@@ -7,7 +7,15 @@
 
 /*
 The midiInstrument class implements the instrument interface and provides functionality for
-sending MIDI messages to control external MIDI devices.
+sending MIDI messages to control external MIDI devices. It also implements midiTransport, so
+the metronome can send MIDI clock and transport messages through the same port.
+
+The port sends as soon as it is written to, so the audio thread does not write to it. Notes,
+clock and transport messages go into a lock-free ring stamped with their frame of the sample
+clock, and a sender thread writes each one when the audio of its frame starts playing (see
+setStreamTime()). Pulses and notes thus leave spread out as they are in the audio, instead of
+in a burst at every callback, and the audio thread never waits for the MIDI driver. The
+sender thread sleeps until the next message is due, or until the audio thread queues one.
 */
 
 // These directives are used to prevent multiple inclusions of the same header file, which
@@ -16,9 +24,15 @@ sending MIDI messages to control external MIDI devices.
 #define midiInstrument_h
 
 #include "instrument.h"
+#include "midiClock.h"
 #include "ofxMidi.h"
+#include "wakeSignal.h"
+#include <array>
+#include <atomic>
+#include <thread>
+#include <vector>
 
-class midiInstrument : public instrument {
+class midiInstrument : public instrument, public midiTransport {
 public:
     // Constructor for the midiInstrument class
     midiInstrument();
@@ -27,12 +41,65 @@ public:
     ~midiInstrument() override;
 
     // Overrides the pure virtual function from the instrument interface
-    // to send a MIDI message to play a specific sound.
+    // to send a MIDI message to play a specific sound (audio thread, like process()).
     void playSound(int whichInstrument) override;
 
+    // Sends a note on/off for every event, with the event's note, channel and velocity.
+    // Events at the same frame offset go out in one write, using running status, when the
+    // audio of that frame starts playing.
+    void process(const noteEvent* events, size_t count, outputBuses& output) override;
+
+    // Sends raw bytes (clock and transport messages) through the MIDI port when the audio of
+    // sampleTime starts playing
+    void sendMidiBytes(const unsigned char* bytes, size_t count, int64_t sampleTime) override;
+
+    // Remembers when the frames of the sample clock are due (audio thread, every buffer)
+    void setStreamTime(int64_t frame, double seconds, int sampleRate) override;
+
+    // Returns the number of messages dropped because the sender thread fell behind
+    uint64_t getDropped() const;
+
 private:
+    static constexpr size_t sendCapacity = 1024;    // Chunks waiting to be sent (power of two)
+    static constexpr size_t chunkBytes = 48;        // Bytes per chunk; longer writes take several
+
+    // Part of a write, due at a frame of the sample clock. Consecutive chunks due at the same
+    // frame are sent as one write, so running status may span chunks.
+    struct timedChunk {
+        int64_t sampleTime = 0;
+        uint8_t count = 0;
+        unsigned char bytes[chunkBytes];
+    };
+
+    // Puts a write into the ring, whole or not at all (audio thread)
+    void queueBytes(const unsigned char* bytes, size_t count, int64_t sampleTime);
+
+    // Sends every chunk when it is due (sender thread)
+    void run();
+
+    // Steady-clock time a frame is due at; 0 until the stream time is known
+    double dueSeconds(int64_t sampleTime) const;
+
+    // Queues a Note On followed by a Note Off at the start of the current buffer
+    void sendNote(int channel, int note, int velocity);
+
     ofxMidiOut m_midiOut;   // MIDI output object for sending MIDI messages
     int m_midiChannel;      // MIDI channel used to send messages (typically 1-16)
+    std::vector<unsigned char> m_rawBytes; // Reused buffer for raw messages, avoids allocations
+    int64_t m_bufferFrame = 0;      // First frame of the buffer being processed (audio thread)
+
+    std::array<timedChunk, sendCapacity> m_ring;    // Chunks from the audio thread
+    std::atomic<size_t> m_writeIndex{0};            // Advanced by the audio thread
+    std::atomic<size_t> m_readIndex{0};             // Advanced by the sender thread
+    std::atomic<uint64_t> m_dropped{0};             // Writes that did not fit
+    std::atomic<double> m_secondsAtFrameZero{0.0};  // Steady-clock time of frame 0 of the stream
+    std::atomic<int> m_sampleRate{0};               // Sample rate of the stream, 0 until known
+
+    std::vector<timedChunk> m_pending;              // Chunks taken from the ring, by due time (sender thread)
+    std::vector<unsigned char> m_sendBytes;         // Bytes of one write (sender thread)
+    std::atomic<bool> m_running{false};             // Keeps the sender thread going
+    wakeSignal m_wake;                              // Wakes the sender thread for new chunks or to stop
+    std::thread m_sender;                           // Writes to the port
 };
 
 #endif /* midiInstrument_h */
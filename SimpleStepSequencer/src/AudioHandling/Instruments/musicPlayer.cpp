@@ -6,23 +6,312 @@
 //
 
 #include "musicPlayer.h"
+#include "outputBuses.h"      // For the buses of measureDispatch()
+#include "sampleInstrument.h" // For measureDispatch()
+#include "synthInstrument.h"  // For measureDispatch()
+#include <algorithm>          // For std::max
+#include <chrono>             // For timing measureDispatch()
+#include <vector>             // For the instruments of measureDispatch()
 
 // Constructor implementation
 // The constructor takes a unique pointer to an instrument and initializes the musicPlayer
-// with it. The unique pointer ensures that the musicPlayer class owns the instrument
-// and that it will be automatically cleaned up when the musicPlayer is destroyed.
-musicPlayer::musicPlayer(std::unique_ptr<instrument> instr)
-: m_instrument(std::move(instr)) {
-    // The unique pointer is moved to m_instrument, transferring ownership
-    // from the caller to the musicPlayer instance.
+// with it. The musicPlayer owns the instrument and destroys it when it is destroyed itself.
+musicPlayer::musicPlayer(std::unique_ptr<instrument> instr) {
+    addInstrument(std::move(instr));
+    
+    // By default every track plays its own voice on the first instrument
+    for (int track = 0; track < maxTracks; track++) {
+        route trackRoute;
+        trackRoute.voice = track;
+        m_routes[track].store(packRoute(trackRoute));
+    }
+}
+
+//--------------------------------------------------------------
+
+// Destructor implementation
+musicPlayer::~musicPlayer() {
+    collectRetired();
+    for (int destination = 0; destination < maxDestinations; destination++) {
+        delete m_instruments[destination].load();
+        delete m_staged[destination].load();
+    }
+}
+
+//--------------------------------------------------------------
+
+int musicPlayer::addInstrument(std::unique_ptr<instrument> instr) {
+    int destination = m_numInstruments;
+    if (!instr || destination == maxDestinations) {
+        return -1;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_descriptionMutex);
+        m_descriptions[destination] = instr->getDescription();
+    }
+    m_descriptionVersion++;
+#if defined(STATIC_INSTRUMENTS)
+    m_exact[destination] = toInstrumentVariant(instr.get());
+#endif
+    m_instruments[destination].store(instr.release());
+    m_numInstruments = destination + 1;
+    return destination;
+}
+
+//--------------------------------------------------------------
+
+int musicPlayer::getNumInstruments() const {
+    return m_numInstruments;
+}
+
+//--------------------------------------------------------------
+
+std::string musicPlayer::getDescription(int destination) const {
+    if (destination < 0 || destination >= m_numInstruments) {
+        return "";
+    }
+    std::lock_guard<std::mutex> lock(m_descriptionMutex);
+    return m_descriptions[destination];
 }
 
-// Method to play a sound using the specified instrument.
-// This method calls the playSound function on the instrument, passing the
-// whichInstrument parameter to select the appropriate sound or functionality.
+//--------------------------------------------------------------
+
+uint32_t musicPlayer::getDescriptionVersion() const {
+    return m_descriptionVersion;
+}
+
+//--------------------------------------------------------------
+
+bool musicPlayer::stageInstrument(int destination, std::unique_ptr<instrument> instr) {
+    if (!instr || destination < 0 || destination >= m_numInstruments) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_descriptionMutex);
+        m_descriptions[destination] = instr->getDescription();
+    }
+    m_descriptionVersion++;
+    
+    // An earlier staged instrument that was never swapped in is destroyed here
+    delete m_staged[destination].exchange(instr.release(), std::memory_order_acq_rel);
+    m_swapStaged.store(true, std::memory_order_release);
+    return true;
+}
+
+//--------------------------------------------------------------
+
+bool musicPlayer::hasStagedInstruments() const {
+    return m_swapStaged.load(std::memory_order_acquire);
+}
+
+//--------------------------------------------------------------
+
+uint32_t musicPlayer::commitSwaps(int frameOffset) {
+    if (!m_swapStaged.exchange(false, std::memory_order_acq_rel)) {
+        return 0;
+    }
+    uint32_t swapped = 0;
+    for (int destination = 0; destination < m_numInstruments; destination++) {
+        bool retireFull = m_retiredWrite.load(std::memory_order_relaxed) - m_retiredRead.load(std::memory_order_acquire) == maxRetired;
+        if (m_outgoing[destination] || retireFull) {
+            // Already swapped in this buffer, or nowhere to put the old one: try again later
+            if (m_staged[destination].load(std::memory_order_relaxed)) {
+                m_swapStaged.store(true, std::memory_order_relaxed);
+            }
+            continue;
+        }
+        instrument* incoming = m_staged[destination].exchange(nullptr, std::memory_order_acq_rel);
+        if (incoming) {
+            // The old instrument still plays the hits before the swap in this buffer
+            m_outgoing[destination] = m_instruments[destination].exchange(incoming, std::memory_order_acq_rel);
+            m_swapFrames[destination] = frameOffset;
+#if defined(STATIC_INSTRUMENTS)
+            m_outgoingExact[destination] = m_exact[destination];
+            m_exact[destination] = toInstrumentVariant(incoming); // typeid neither locks nor allocates
+#endif
+            swapped |= uint32_t(1) << destination;
+        }
+    }
+    return swapped;
+}
+
+//--------------------------------------------------------------
+
+int musicPlayer::getSource(int destination) const {
+    if (destination < 0 || destination >= m_numInstruments) {
+        return -1;
+    }
+    instrument* current = m_instruments[destination].load(std::memory_order_relaxed);
+    return current ? current->getSource() : -1;
+}
+
+//--------------------------------------------------------------
+
+void musicPlayer::collectRetired() {
+    size_t read = m_retiredRead.load(std::memory_order_relaxed);
+    size_t write = m_retiredWrite.load(std::memory_order_acquire);
+    for (; read != write; read++) {
+        delete m_retired[read % maxRetired]; // May close files or ports, so never on the audio thread
+        m_retiredRead.store(read + 1, std::memory_order_release);
+    }
+}
+
+//--------------------------------------------------------------
+
+void musicPlayer::setRoute(int track, const route& trackRoute) {
+    if (track < 0 || track >= maxTracks
+        || trackRoute.destination < 0 || trackRoute.destination >= m_numInstruments) {
+        return;
+    }
+    m_routes[track].store(packRoute(trackRoute), std::memory_order_relaxed);
+}
+
+//--------------------------------------------------------------
+
+musicPlayer::route musicPlayer::getRoute(int track) const {
+    if (track < 0 || track >= maxTracks) {
+        return route();
+    }
+    return unpackRoute(m_routes[track].load(std::memory_order_relaxed));
+}
+
+//--------------------------------------------------------------
+
+// Method to queue a sound for the instrument the track is routed to.
 void musicPlayer::play(int whichInstrument) {
-    // Delegates the sound playback to the instrument
-    m_instrument->playSound(whichInstrument);
+    noteEvent event;
+    event.track = whichInstrument;
+    play(event);
+}
+
+//--------------------------------------------------------------
+
+void musicPlayer::play(const noteEvent& event) {
+    route trackRoute = getRoute(event.track);
+    size_t& size = m_batchSizes[trackRoute.destination];
+    if (size == maxEventsPerBuffer) {
+        return; // More hits in one buffer than any instrument can make sense of
+    }
+    noteEvent& routed = m_batches[trackRoute.destination][size++];
+    routed = event;
+    routed.note = trackRoute.voice;
+    routed.channel = trackRoute.channel;
+}
+
+//--------------------------------------------------------------
+
+// Method to play the queued sounds.
+// Each instrument gets everything routed to it, and the buses, in one call.
+void musicPlayer::process(outputBuses& buses) {
+    for (int destination = 0; destination < m_numInstruments; destination++) {
+        const noteEvent* events = m_batches[destination].data();
+        size_t count = m_batchSizes[destination];
+        
+        if (instrument* outgoing = m_outgoing[destination]) {
+            // Swapped during this buffer: hits before the swap frame go to the old instrument,
+            // which then renders its last buffer and is passed on to be destroyed
+            size_t split = 0;
+            while (split < count && events[split].frameOffset < m_swapFrames[destination]) {
+                split++;
+            }
+#if defined(STATIC_INSTRUMENTS)
+            processInstrument(m_outgoingExact[destination], events, split, buses);
+#else
+            outgoing->process(events, split, buses);
+#endif
+            events += split;
+            count -= split;
+            
+            size_t write = m_retiredWrite.load(std::memory_order_relaxed);
+            m_retired[write % maxRetired] = outgoing;
+            m_retiredWrite.store(write + 1, std::memory_order_release);
+            m_outgoing[destination] = nullptr;
+        }
+        
+#if defined(STATIC_INSTRUMENTS)
+        processInstrument(m_exact[destination], events, count, buses);
+#else
+        m_instruments[destination].load(std::memory_order_acquire)->process(events, count, buses);
+#endif
+        m_batchSizes[destination] = 0;
+    }
+}
+
+//--------------------------------------------------------------
+
+musicPlayer::dispatchReport musicPlayer::measureDispatch(int buffers, int bufferSize, int hitsPerBuffer) {
+    const int sampleRate = 44100;
+    const int numTracks = 3;
+    dispatchReport report;
+#if defined(STATIC_INSTRUMENTS)
+    report.staticBuild = true;
+#endif
+    if (buffers <= 0 || bufferSize <= 0) {
+        return report;
+    }
+    
+    std::vector<std::unique_ptr<instrument>> instruments;
+    instruments.push_back(std::make_unique<synthInstrument>());
+    instruments.push_back(std::make_unique<sampleInstrument>());
+    std::vector<instrumentVariant> exact;
+    for (const std::unique_ptr<instrument>& instr : instruments) {
+        exact.push_back(toInstrumentVariant(instr.get()));
+    }
+    outputBuses buses;
+    buses.prepare(bufferSize, 2, numTracks);
+    
+    // The same hits every buffer, spread evenly over it and over the tracks
+    std::vector<noteEvent> events(std::max(hitsPerBuffer, 0));
+    for (size_t i = 0; i < events.size(); i++) {
+        events[i].track = int(i % numTracks);
+        events[i].note = int(i % numTracks);
+        events[i].frameOffset = int(i * bufferSize / events.size());
+        events[i].velocity = 0.8f;
+    }
+    
+    // Alternating rounds, so both paths see the same caches and clock speeds
+    const int rounds = 10;
+    std::chrono::steady_clock::duration virtualTime{}, variantTime{};
+    for (int round = 0; round < rounds; round++) {
+        int roundBuffers = buffers / rounds + (round < buffers % rounds ? 1 : 0);
+        for (int path = 0; path < 2; path++) {
+            auto start = std::chrono::steady_clock::now();
+            for (int buffer = 0; buffer < roundBuffers; buffer++) {
+                buses.begin(bufferSize, sampleRate);
+                for (size_t i = 0; i < instruments.size(); i++) {
+                    if (path == 0) {
+                        instruments[i]->process(events.data(), events.size(), buses);
+                    } else {
+                        processInstrument(exact[i], events.data(), events.size(), buses);
+                    }
+                }
+            }
+            (path == 0 ? virtualTime : variantTime) += std::chrono::steady_clock::now() - start;
+        }
+    }
+    report.virtualMicros = std::chrono::duration<double, std::micro>(virtualTime).count() / buffers;
+    report.variantMicros = std::chrono::duration<double, std::micro>(variantTime).count() / buffers;
+    return report;
+}
+
+//--------------------------------------------------------------
+
+uint64_t musicPlayer::packRoute(const route& trackRoute) {
+    return uint64_t(uint16_t(trackRoute.destination))
+         | uint64_t(uint16_t(trackRoute.voice)) << 16
+         | uint64_t(uint16_t(trackRoute.channel)) << 32
+         | uint64_t(uint16_t(trackRoute.bus)) << 48;
+}
+
+//--------------------------------------------------------------
+
+musicPlayer::route musicPlayer::unpackRoute(uint64_t packed) {
+    route trackRoute;
+    trackRoute.destination = int16_t(packed & 0xffff);
+    trackRoute.voice = int16_t((packed >> 16) & 0xffff);
+    trackRoute.channel = int16_t((packed >> 32) & 0xffff);
+    trackRoute.bus = int16_t((packed >> 48) & 0xffff);
+    return trackRoute;
 }
 
 
@@ -8,6 +8,22 @@
 /*
 The musicPlayer class is responsible for managing and playing sounds using a specific
 instrument.
+
+It owns every instrument the sequencer can play (destinations) and a routing table that
+maps each track to a destination, a voice on it (sample index or MIDI note), a MIDI
+channel and the output bus the track is mixed into. Routes can be changed at any time from any thread. Hits are collected per
+destination during a buffer and handed over by process(), so each instrument receives one
+batch per buffer, together with the output buses to render into.
+
+Instruments can be replaced while playing. A new instrument is built completely on another
+thread and handed over with stageInstrument(). The audio thread swaps it in at the next
+commitSwaps(), which the metronome calls on a step or bar boundary. From that frame on, the
+hits go to the new instrument. The old one is passed back to be destroyed by
+collectRetired(), so no memory is freed on the audio thread.
+
+Built with STATIC_INSTRUMENTS defined, process() calls the instruments by their exact type,
+held in an instrumentVariant, instead of through the instrument interface (see
+instrumentVariant.h). Routing, swaps and everything else work the same in both builds.
 */
 
 // These directives are used to prevent multiple inclusions of the same header file, which
@@ -16,22 +32,142 @@ instrument.
 #define musicPlayer_h
 
 #include "instrument.h"
+#include "instrumentVariant.h" // For the compile-time dispatch (STATIC_INSTRUMENTS builds)
+#include <array>  // For the fixed-size routing table and batches
+#include <atomic> // For routes that can be changed while playing
 #include <memory> // For using smart pointers
+#include <mutex>  // For the descriptions
+#include <string> // For the descriptions
 
 
 class musicPlayer {
 public:
+    static constexpr int maxTracks = 16;          // Tracks that can be routed
+    static constexpr int maxDestinations = 8;     // Instruments that can be added
+    static constexpr int maxEventsPerBuffer = 256; // Hits per destination per buffer
+    static constexpr size_t maxRetired = 32;       // Replaced instruments waiting to be destroyed
+    
+    // Where a track is played
+    struct route {
+        int destination = 0;  // Index returned by addInstrument()
+        int voice = 0;        // Sample index or MIDI note
+        int channel = 1;      // MIDI channel (1-16)
+        int bus = 0;          // Output bus (see outputBuses)
+    };
+    
+    // Result of measureDispatch(): the time per buffer of each path, in microseconds
+    struct dispatchReport {
+        double virtualMicros = 0.0;  // Through unique_ptr<instrument>, one virtual call per instrument
+        double variantMicros = 0.0;  // Through instrumentVariant, bound at compile time
+        bool staticBuild = false;    // True if process() uses the variant (STATIC_INSTRUMENTS)
+    };
+    
+    // Plays the same hits on a drum synthesizer and a sampler with the default kit through
+    // both paths, in alternating rounds, and returns the average time per buffer of each.
+    // Loads the kit from bin/data, so call it off the audio thread.
+    static dispatchReport measureDispatch(int buffers, int bufferSize, int hitsPerBuffer);
+    
     // Constructor that initializes the musicPlayer with a given instrument.
     // The instrument is managed using a unique_ptr to ensure proper resource management and ownership.
+    // It becomes destination 0, and every track is routed to it with voice = track.
     musicPlayer(std::unique_ptr<instrument> instr);
 
+    // Destructor that destroys every instrument, including staged and retired ones
+    ~musicPlayer();
+
+    // Adds another instrument and returns its destination index (-1 if there is no room).
+    // Call this before the audio stream starts.
+    int addInstrument(std::unique_ptr<instrument> instr);
+
+    // Returns the number of destinations
+    int getNumInstruments() const;
+
+    // Hands over an instrument to replace a destination at the next commitSwaps(). A staged
+    // instrument that was not swapped in yet is replaced. Returns false if the destination
+    // does not exist. Never call from the audio thread: it may destroy an instrument.
+    bool stageInstrument(int destination, std::unique_ptr<instrument> instr);
+
+    // Swaps in the staged instruments from a frame of the current buffer (audio thread).
+    // Returns a mask with bit n set if destination n was swapped.
+    uint32_t commitSwaps(int frameOffset);
+
+    // Returns what the instrument at a destination was loaded from (see
+    // instrument::getSource()), or -1 (audio thread)
+    int getSource(int destination) const;
+
+    // Returns true while an instrument is waiting to be swapped in
+    bool hasStagedInstruments() const;
+
+    // Destroys the instruments that were swapped out; call regularly from a non-audio thread
+    void collectRetired();
+
+    // Returns the description of a destination
+    std::string getDescription(int destination) const;
+
+    // Returns a number that changes whenever a description changes, so the GUI only redraws
+    // the descriptions when they changed
+    uint32_t getDescriptionVersion() const;
+
+    // Routes a track; safe to call while playing
+    void setRoute(int track, const route& trackRoute);
+
+    // Returns the route of a track
+    route getRoute(int track) const;
+
     // Method to trigger the playback of a sound on the specified instrument.
-    // The 'whichInstrument' parameter allows selecting which sound or instrument to use.
+    // The 'whichInstrument' parameter is the track; the hit is played at the start of the
+    // next buffer processed.
     void play(int whichInstrument);
 
+    // Queues a hit at a frame of the buffer being processed. Note and channel are filled
+    // in from the route of event.track.
+    void play(const noteEvent& event);
+
+    // Sends the hits collected for this buffer to their instruments, one batch each, and
+    // lets every instrument render into the buses (audio thread)
+    void process(outputBuses& buses);
+
 private:
-    // A unique_ptr to an instrument instance, ensuring exclusive ownership and automatic resource management.
-    std::unique_ptr<instrument> m_instrument;
+    // Routes are packed into one word so they can be read and written atomically
+    static uint64_t packRoute(const route& trackRoute);
+    static route unpackRoute(uint64_t packed);
+
+    // The instruments, with their index as destination (owned)
+    std::array<std::atomic<instrument*>, maxDestinations> m_instruments{};
+    std::atomic<int> m_numInstruments{0};
+
+    // Descriptions of the destinations, kept here so the GUI never touches an instrument
+    // the audio thread may be swapping out
+    std::array<std::string, maxDestinations> m_descriptions;
+    mutable std::mutex m_descriptionMutex;
+    std::atomic<uint32_t> m_descriptionVersion{0};
+
+    // Instruments waiting to be swapped in (owned)
+    std::array<std::atomic<instrument*>, maxDestinations> m_staged{};
+    std::atomic<bool> m_swapStaged{false};
+
+    // Instruments swapped out during the current buffer, and the frame they stop at (audio thread)
+    std::array<instrument*, maxDestinations> m_outgoing{};
+    std::array<int, maxDestinations> m_swapFrames{};
+
+#if defined(STATIC_INSTRUMENTS)
+    // The instruments and the swapped-out ones by their exact type, set when they are added
+    // or swapped in (audio thread after the stream starts)
+    std::array<instrumentVariant, maxDestinations> m_exact{};
+    std::array<instrumentVariant, maxDestinations> m_outgoingExact{};
+#endif
+
+    // Swapped-out instruments waiting for collectRetired() (owned)
+    std::array<instrument*, maxRetired> m_retired{};
+    std::atomic<size_t> m_retiredWrite{0};
+    std::atomic<size_t> m_retiredRead{0};
+
+    // Route of every track
+    std::array<std::atomic<uint64_t>, maxTracks> m_routes;
+
+    // Hits collected during the current buffer, per destination (audio thread only)
+    std::array<std::array<noteEvent, maxEventsPerBuffer>, maxDestinations> m_batches;
+    std::array<size_t, maxDestinations> m_batchSizes{};
 };
 
 #endif /* musicPlayer_h */
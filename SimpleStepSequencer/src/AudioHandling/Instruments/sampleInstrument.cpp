@@ -6,38 +6,119 @@
 //
 
 #include <stdio.h>
+#include "ofMain.h"
 #include "sampleInstrument.h"
+#include "wavFile.h"
+#include "outputBuses.h"
+
+const std::vector<std::string> sampleInstrument::defaultKit = {"hihat.wav", "snare.wav", "kick.wav"};
 
 // Constructor for the sampleInstrument class
-sampleInstrument::sampleInstrument() {
+sampleInstrument::sampleInstrument() : sampleInstrument(defaultKit) {
+}
+
+// Constructor for the sampleInstrument class with a kit
+sampleInstrument::sampleInstrument(const std::vector<std::string>& files) {
     
-    description = "This is a sample instrument that plays kick, snare, and hi-hat sounds.";
-        // Initialize ofSoundPlayer objects here if needed
+    description = files.empty() ? "This is a sample instrument without a kit yet" : "This is a sample instrument that plays";
+    for (const std::string& file : files) {
+        description += " " + file;
+    }
     
-    // Load sound files into the ofSoundPlayer instances
-    m_kick.load("kick.wav");    // Load kick drum sound file
-    m_snare.load("snare.wav");  // Load snare drum sound file
-    m_hihat.load("hihat.wav");  // Load hi-hat sound file
+    // Load sound files into memory
+    loadKit(files);
 }
 
 // Destructor for the sampleInstrument class
 sampleInstrument::~sampleInstrument() {
     // Perform cleanup if necessary (e.g., releasing resources)
-    // Currently empty as ofSoundPlayer handles its own resources
+    // Currently empty as the samples are released by their vectors
+}
+
+// Loads the samples of the kit
+void sampleInstrument::loadKit(const std::vector<std::string>& files) {
+    m_kit.resize(files.size());
+    for (size_t i = 0; i < files.size(); i++) {
+        wavFile file;
+        if (file.load(ofToDataPath(files[i]))) {
+            m_kit[i].frames = file.getMono();
+            m_kit[i].sampleRate = file.getSampleRate();
+        }
+    }
 }
 
 // Implementation of the playSound method from the instrument interface
 void sampleInstrument::playSound(int whichInstrument) {
     // Play the sound based on the value of whichInstrument
-    // 0 - play hi-hat sound
-    // 1 - play snare drum sound
-    // other values - play kick drum sound
-    if (whichInstrument == 0) {
-        m_hihat.play();  // Play the hi-hat sound
-    } else if (whichInstrument == 1) {
-        m_snare.play();  // Play the snare drum sound
-    } else {
-        m_kick.play();   // Play the kick drum sound
+    // 0 - hi-hat, 1 - snare drum, 2 - kick drum in the default kit
+    startVoice(whichInstrument, 0.5f, 0);
+}
+
+// Plays the events of one buffer, each from its own frame
+void sampleInstrument::process(const noteEvent* events, size_t count, outputBuses& output) {
+    size_t frames = output.getNumFrames();
+    size_t rendered = 0;
+    for (size_t i = 0; i < count; i++) {
+        // Render up to the frame of the event, then start its voice
+        size_t due = std::min((size_t)std::max(0, events[i].frameOffset), frames);
+        render(output, rendered, due);
+        rendered = due;
+        startVoice(events[i].note, events[i].velocity, events[i].track);
+    }
+    render(output, rendered, frames);
+}
+
+// Starts a voice
+void sampleInstrument::startVoice(int which, float gain, int track) {
+    if (which < 0 || which >= (int)m_kit.size() || m_kit[which].frames.empty()) {
+        return; // Nothing to play for this voice
+    }
+    
+    // Use a free voice, or take over the one started longest ago
+    int chosen = m_nextVoice;
+    for (int i = 0; i < maxVoices; i++) {
+        if (!m_voices[i].source) {
+            chosen = i;
+            break;
+        }
+    }
+    m_voices[chosen].source = &m_kit[which];
+    m_voices[chosen].position = 0.0;
+    m_voices[chosen].gain = gain * 2.0f; // Velocity 0.5 plays the sample at its own level
+    m_voices[chosen].track = track;
+    m_nextVoice = (chosen + 1) % maxVoices;
+}
+
+// Mixes the voices into a part of the buffer
+void sampleInstrument::render(outputBuses& output, size_t begin, size_t end) {
+    if (begin >= end) {
+        return;
+    }
+    
+    for (voice& playing : m_voices) {
+        if (!playing.source) {
+            continue;
+        }
+        // The samples are mono, so both sides of the track get the same signal
+        float* left = output.getTrackChannel(playing.track, 0);
+        float* right = output.getTrackChannel(playing.track, 1);
+        // Step through the sample at its own rate, so kits play at the right pitch at any
+        // stream sample rate
+        const std::vector<float>& frames = playing.source->frames;
+        double step = double(playing.source->sampleRate) / output.getSampleRate();
+        size_t last = frames.size() - 1;
+        for (size_t frame = begin; frame < end; frame++) {
+            size_t index = (size_t)playing.position;
+            if (index >= last) {
+                playing.source = nullptr; // The sample has ended
+                break;
+            }
+            float fraction = float(playing.position - index);
+            float value = (frames[index] + (frames[index + 1] - frames[index]) * fraction) * playing.gain;
+            left[frame] += value;
+            right[frame] += value;
+            playing.position += step;
+        }
     }
 }
 
@@ -7,7 +7,11 @@
 
 /*
 The sampleInstrument class implements the instrument interface.
-It uses ofSoundPlayer to play different types of sounds, such as kick, snare, and hi-hat.
+It plays a kit of samples, such as kick, snare, and hi-hat. The samples are loaded into
+memory when the instrument is created and mixed into the channels of each hit's track by
+process(), each hit starting on the frame it is due. Because all file I/O and allocation happen in the
+constructor, a new kit is built on a background thread and swapped in while playing (see
+musicPlayer::stageInstrument()).
 */
 
 // These directives are used to prevent multiple inclusions of the same header file, which
@@ -16,25 +20,60 @@ It uses ofSoundPlayer to play different types of sounds, such as kick, snare, an
 #define sampleInstrument_h
 
 #include "instrument.h"
-#include "ofSoundPlayer.h"
+#include <array>   // For the voices
+#include <string>  // For file names
+#include <vector>  // For the samples
 
 class sampleInstrument : public instrument {
 public:
-    // Constructor for sampleInstrument
+    static constexpr int maxVoices = 16;   // Hits that can sound at the same time
+    static const std::vector<std::string> defaultKit;  // Hi-hat, snare and kick
+
+    // Constructor for sampleInstrument with the default kit (hi-hat, snare, kick)
     sampleInstrument();
 
+    // Constructor for sampleInstrument with a kit of files in bin/data; voice n plays file n.
+    // Without files it is silent, e.g. until the loader has read a kit.
+    sampleInstrument(const std::vector<std::string>& files);
+
     // Destructor for sampleInstrument
     ~sampleInstrument() override;
 
     // Overrides the pure virtual function from the instrument interface
     // to play a specific sound based on the whichInstrument parameter.
+    // The sound starts at the beginning of the next buffer.
     void playSound(int whichInstrument) override;
 
+    // Starts a voice for every event at its frame and mixes all voices into their tracks
+    void process(const noteEvent* events, size_t count, outputBuses& output) override;
+
 private:
-    // ofSoundPlayer instances for different sounds
-    ofSoundPlayer m_kick;    // Player for kick drum sound
-    ofSoundPlayer m_snare;   // Player for snare drum sound
-    ofSoundPlayer m_hihat;   // Player for hi-hat sound
+    // A sample of the kit
+    struct sample {
+        std::vector<float> frames;   // Mono samples
+        int sampleRate = 44100;      // Rate the sample was recorded at
+    };
+
+    // A sounding hit
+    struct voice {
+        const sample* source = nullptr; // Sample being played, nullptr when free
+        double position = 0.0;          // Read position in frames of the sample
+        float gain = 1.0f;              // Velocity of the hit
+        int track = 0;                  // Track of the hit
+    };
+
+    // Loads the kit; every file that cannot be read becomes a silent sample
+    void loadKit(const std::vector<std::string>& files);
+
+    // Starts a voice, taking over the oldest one if all are busy
+    void startVoice(int which, float gain, int track);
+
+    // Mixes the voices into frames [begin, end) of their tracks
+    void render(outputBuses& output, size_t begin, size_t end);
+
+    std::vector<sample> m_kit;                 // Samples, indexed by voice number of the route
+    std::array<voice, maxVoices> m_voices;     // Voices that may be sounding
+    int m_nextVoice = 0;                       // Voice taken over when all are busy
 };
 
 #endif /* sampleInstrument_h */
@@ -0,0 +1,242 @@
+//
+//  synthInstrument.cpp
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+#include <algorithm>
+#include <cmath>
+#include "synthInstrument.h"
+#include "outputBuses.h"
+
+namespace {
+    // Settings of a sound before a hit's params are applied; times in seconds
+    struct sound {
+        float endFrequency;     // Oscillator frequency the pitch settles on
+        float startFrequency;   // Oscillator frequency at the hit
+        float pitchTime;        // Time constant of the pitch sweep
+        float ratio;            // Second oscillator, relative to the first
+        float ring;             // Ring modulation (0-1)
+        float toneLevel;        // Oscillator level
+        float toneTime;         // Time the oscillator takes to fall by 60 dB
+        float noiseLevel;       // Noise level
+        float noiseTime;        // Time the noise takes to fall by 60 dB
+        float cutoff;           // Noise filter frequency
+        float resonance;        // Noise filter Q
+        float low, band, high;  // Noise filter outputs
+        float burstRate;        // Clap bursts per second
+        float burstTime;        // How long the bursts go on
+    };
+
+    //                  end    start  pitch   ratio   ring  tone  time   noise time   cutoff  Q     low   band  high  bursts
+    const sound sounds[synthInstrument::numSounds] = {
+        /* hi-hat */ {3360.0f, 3360.0f, 0.01f, 1.4471f, 1.0f, 0.25f, 0.04f, 0.8f, 0.05f, 7000.0f, 0.7f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f},
+        /* snare  */ {180.0f,  260.0f, 0.012f, 1.0f,    0.0f, 0.7f,  0.12f, 0.6f, 0.18f, 3000.0f, 0.8f, 0.0f, 1.0f, 0.3f, 0.0f, 0.0f},
+        /* kick   */ {48.0f,   160.0f, 0.035f, 1.0f,    0.0f, 1.0f,  0.40f, 0.35f, 0.006f, 3000.0f, 0.7f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f},
+        /* clap   */ {1000.0f, 1000.0f, 0.01f, 1.0f,    0.0f, 0.0f,  0.05f, 0.9f, 0.20f, 1100.0f, 1.5f, 0.0f, 1.0f, 0.0f, 100.0f, 0.03f},
+        /* tom    */ {105.0f,  150.0f, 0.05f,  1.0f,    0.0f, 0.9f,  0.30f, 0.08f, 0.06f, 2000.0f, 0.7f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f}
+    };
+
+    constexpr float silence = 1e-4f;    // Voices below -80 dB have ended
+
+    // Per-frame factor of an envelope that falls by 60 dB in the given time
+    float decayCoefficient(float seconds, int sampleRate) {
+        return (float)std::exp(-std::log(1000.0) / (std::max(seconds, 0.001f) * sampleRate));
+    }
+
+    // sin(2 pi phase) for a phase between 0 and 1, without branches: a parabola per half
+    // wave, corrected towards the sine (error below 0.1%)
+    inline float sine(float phase) {
+        float x = 0.5f - phase;                             // -0.5 to 0.5, sin(2 pi phase) = sin(2 pi x)
+        float parabola = 8.0f * x * (1.0f - 2.0f * std::fabs(x));
+        return parabola + 0.225f * (parabola * std::fabs(parabola) - parabola);
+    }
+
+    // Keeps a phase between 0 and 1
+    inline float wrap(float phase) {
+        return phase - (float)(int)phase;
+    }
+
+    // Start of the noise generator of a lane
+    inline uint32_t laneSeed(int lane) {
+        return 22222u + 7919u * (uint32_t)lane;
+    }
+
+    // Clamps to 0-1 without comparisons, which would keep the lane loop from vectorizing
+    inline float clamp01(float value) {
+        return 0.5f * (std::fabs(value) - std::fabs(value - 1.0f) + 1.0f);
+    }
+}
+
+// Constructor for the synthInstrument class
+synthInstrument::synthInstrument() {
+    description = "This is a drum synthesizer that plays hi-hat, snare, kick, clap and tom";
+    for (int lane = 0; lane < maxVoices; lane++) {
+        m_seed[lane] = laneSeed(lane); // Every lane gets noise of its own
+        m_pitchCoef[lane] = m_toneCoef[lane] = m_noiseCoef[lane] = 1.0f;
+        m_normalize[lane] = 1.0f;
+    }
+}
+
+// Implementation of the playSound method from the instrument interface
+void synthInstrument::playSound(int whichInstrument) {
+    noteEvent event;
+    event.note = whichInstrument;
+    startVoice(event);
+}
+
+// Plays the events of one buffer, each from its own frame
+void synthInstrument::process(const noteEvent* events, size_t count, outputBuses& output) {
+    m_sampleRate = output.getSampleRate();
+    size_t frames = output.getNumFrames();
+    size_t rendered = 0;
+    for (size_t i = 0; i < count; i++) {
+        // Render up to the frame of the event, then start its voice
+        size_t due = std::min((size_t)std::max(0, events[i].frameOffset), frames);
+        render(output, rendered, due);
+        rendered = due;
+        startVoice(events[i]);
+    }
+    render(output, rendered, frames);
+}
+
+// Starts a voice
+void synthInstrument::startVoice(const noteEvent& event) {
+    if (event.note < 0 || event.note >= numSounds) {
+        return; // No such sound
+    }
+    const sound& base = sounds[event.note];
+
+    // Use a free voice, or take over the one started longest ago
+    int lane = m_nextVoice;
+    for (int i = 0; i < maxVoices; i++) {
+        if (!m_active[i]) {
+            lane = i;
+            break;
+        }
+    }
+    m_nextVoice = (lane + 1) % maxVoices;
+
+    // The hit's params, each -1 to 1
+    auto param = [&](int index) { return std::min(std::max(event.params[index], -1.0f), 1.0f); };
+    float tune = std::exp2(param(0));
+    float length = std::exp2(2.0f * param(1));
+    float tone = std::exp2(param(2));
+    float noise = std::exp2(2.0f * param(3));
+    float gain = event.velocity * 2.0f; // Velocity 0.5 plays the voice at its own level
+
+    float rate = (float)m_sampleRate;
+    m_increment[lane] = base.endFrequency * tune / rate;
+    m_sweep[lane] = (base.startFrequency * tone - base.endFrequency) * tune / rate;
+    m_pitchCoef[lane] = (float)std::exp(-1.0 / (base.pitchTime * m_sampleRate));
+    m_ratio[lane] = base.ratio;
+    m_ring[lane] = base.ring;
+    m_toneCoef[lane] = decayCoefficient(base.toneTime * length, m_sampleRate);
+    m_noiseCoef[lane] = decayCoefficient(base.noiseTime * length, m_sampleRate);
+
+    // Topology-preserving state-variable filter (V. Zavalishin)
+    float cutoff = std::min(base.cutoff * tune * tone, 0.45f * rate);
+    float g = (float)std::tan(M_PI * cutoff / rate);
+    float k = 1.0f / base.resonance;
+    m_cutoff[lane] = g;
+    m_damping[lane] = k;
+    m_normalize[lane] = 1.0f / (1.0f + g * (g + k));
+    m_lowMix[lane] = base.low;
+    m_bandMix[lane] = base.band;
+    m_highMix[lane] = base.high;
+    m_burstStep[lane] = base.burstRate / rate;
+    m_burstDepth[lane] = base.burstRate > 0.0f ? 1.0f : 0.0f;
+
+    m_phase[lane] = m_phase2[lane] = 0.0f;
+    m_seed[lane] = laneSeed(lane);  // A hit sounds the same however long the engine has run, so replays match
+    m_pitch[lane] = 1.0f;
+    m_toneLevel[lane] = base.toneLevel * gain;
+    m_noiseLevel[lane] = base.noiseLevel * noise * gain;
+    m_low[lane] = m_band[lane] = 0.0f;
+    m_burstPhase[lane] = 0.0f;
+    m_burstLeft[lane] = base.burstTime * rate;
+    m_track[lane] = event.track;
+    m_active[lane] = true;
+}
+
+// Renders a part of the buffer in blocks and mixes every sounding voice into its track
+void synthInstrument::render(outputBuses& output, size_t begin, size_t end) {
+    for (size_t start = begin; start < end; start += blockFrames) {
+        size_t frames = std::min((size_t)blockFrames, end - start);
+        renderBlock(frames);
+
+        for (int lane = 0; lane < maxVoices; lane++) {
+            if (!m_active[lane]) {
+                continue;
+            }
+            // The voices are mono, so both sides of the track get the same signal
+            float* left = output.getTrackChannel(m_track[lane], 0) + start;
+            float* right = output.getTrackChannel(m_track[lane], 1) + start;
+            for (size_t frame = 0; frame < frames; frame++) {
+                left[frame] += m_block[frame][lane];
+                right[frame] += m_block[frame][lane];
+            }
+
+            // A voice that has died away is silenced for good, so its lane computes zeros
+            // (and no denormals) until it is used again
+            if (m_toneLevel[lane] + m_noiseLevel[lane] < silence) {
+                m_active[lane] = false;
+                m_toneLevel[lane] = m_noiseLevel[lane] = 0.0f;
+                m_low[lane] = m_band[lane] = 0.0f;
+            }
+        }
+    }
+}
+
+// Renders one block of every lane, free ones included, so the loop has no branches
+void synthInstrument::renderBlock(size_t numFrames) {
+    // Local copies of the state, so the compiler knows the loop is all that changes it
+    lanes phase = m_phase, phase2 = m_phase2, pitch = m_pitch;
+    lanes toneLevel = m_toneLevel, noiseLevel = m_noiseLevel;
+    lanes low = m_low, band = m_band, burstPhase = m_burstPhase, burstLeft = m_burstLeft;
+    std::array<uint32_t, maxVoices> seed = m_seed;
+
+    for (size_t frame = 0; frame < numFrames; frame++) {
+        float* out = m_block[frame];
+        for (int lane = 0; lane < maxVoices; lane++) {
+            // Oscillators: the pitch glides from the start to the end frequency
+            float increment = m_increment[lane] + m_sweep[lane] * pitch[lane];
+            pitch[lane] *= m_pitchCoef[lane];
+            phase[lane] = wrap(phase[lane] + increment);
+            phase2[lane] = wrap(phase2[lane] + increment * m_ratio[lane]);
+            float tone = sine(phase[lane]) * (1.0f - m_ring[lane] + m_ring[lane] * sine(phase2[lane]));
+
+            // White noise from a linear congruential generator, through the filter
+            seed[lane] = seed[lane] * 1664525u + 1013904223u;
+            float white = (float)(int32_t)seed[lane] * (1.0f / 2147483648.0f);
+            float g = m_cutoff[lane];
+            float high = (white - (g + m_damping[lane]) * band[lane] - low[lane]) * m_normalize[lane];
+            float bandOut = g * high + band[lane];
+            band[lane] = g * high + bandOut;
+            float lowOut = g * bandOut + low[lane];
+            low[lane] = g * bandOut + lowOut;
+            float noise = m_lowMix[lane] * lowOut + m_bandMix[lane] * bandOut + m_highMix[lane] * high;
+
+            // Clap: the noise restarts every burst while there are bursts left
+            float burst = 1.0f - m_burstDepth[lane] * clamp01(burstLeft[lane]) * burstPhase[lane];
+            burstPhase[lane] = wrap(burstPhase[lane] + m_burstStep[lane]);
+            burstLeft[lane] -= 1.0f;
+
+            out[lane] = toneLevel[lane] * tone + noiseLevel[lane] * burst * noise;
+            toneLevel[lane] *= m_toneCoef[lane];
+            noiseLevel[lane] *= m_noiseCoef[lane];
+        }
+    }
+
+    m_phase = phase;
+    m_phase2 = phase2;
+    m_pitch = pitch;
+    m_toneLevel = toneLevel;
+    m_noiseLevel = noiseLevel;
+    m_low = low;
+    m_band = band;
+    m_burstPhase = burstPhase;
+    m_burstLeft = burstLeft;
+    m_seed = seed;
+}
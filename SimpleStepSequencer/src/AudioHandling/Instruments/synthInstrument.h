@@ -0,0 +1,102 @@
+//
+//  synthInstrument.h
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+/*
+The synthInstrument class implements the instrument interface with a drum synthesizer, so
+the sequencer can make sound without samples and without the Pure Data patch it used to
+drive over MIDI. Its voices are 0 hi-hat, 1 snare, 2 kick, 3 clap and 4 tom (the same
+numbers as the default sample kit).
+
+Every voice is built from the same parts: a sine oscillator whose pitch falls from a start
+to an end frequency, ring-modulated by a second sine for metallic sounds, and white noise
+through a state-variable filter, shaped into bursts for the clap. The oscillator and the
+noise have decaying envelopes of their own. The voices differ only in their settings, so
+all of them are rendered together: every frame updates the 16 voice lanes side by side with
+the same branch-free arithmetic, which the compiler turns into vector instructions.
+
+Each hit can be varied with the params of its noteEvent, which come from the step it was
+played from (see stepPattern::setStepParam()); every param runs from -1 to 1, and 0 is the
+voice's own sound:
+
+    params[0]  tune   -1 an octave down ... 1 an octave up
+    params[1]  decay  -1 a quarter as long ... 1 four times as long
+    params[2]  tone   -1 darker ... 1 brighter (filter cutoff and pitch sweep)
+    params[3]  noise  -1 12 dB less noise ... 1 12 dB more
+*/
+
+// These directives are used to prevent multiple inclusions of the same header file, which
+// helps avoid redefinition errors and improves compilation efficiency:
+#ifndef synthInstrument_h
+#define synthInstrument_h
+
+#include "instrument.h"
+#include <array>    // For the voice lanes
+#include <cstdint>  // For the noise generators
+
+class synthInstrument : public instrument {
+public:
+    static constexpr int maxVoices = 16;    // Hits that can sound at the same time
+    static constexpr int numSounds = 5;     // Hi-hat, snare, kick, clap and tom
+    static constexpr int blockFrames = 64;  // Frames rendered at a time
+
+    // Constructor
+    synthInstrument();
+
+    // Overrides the pure virtual function from the instrument interface
+    // to play a specific sound based on the whichInstrument parameter.
+    // The sound starts at the beginning of the next buffer.
+    void playSound(int whichInstrument) override;
+
+    // Starts a voice for every event at its frame and mixes all voices into their tracks
+    void process(const noteEvent* events, size_t count, outputBuses& output) override;
+
+private:
+    using lanes = std::array<float, maxVoices>;
+
+    // Starts a voice for an event, taking over the oldest one if all are busy
+    void startVoice(const noteEvent& event);
+
+    // Renders frames [begin, end) of every voice and mixes them into their tracks
+    void render(outputBuses& output, size_t begin, size_t end);
+
+    // Renders one block of every voice lane into m_block
+    void renderBlock(size_t numFrames);
+
+    int m_sampleRate = 44100;   // Rate of the latest buffer; voices are set up for it
+
+    // Voice lanes: settings made when a voice starts
+    lanes m_increment{};        // Oscillator phase step at the end frequency
+    lanes m_sweep{};            // Extra phase step at the start frequency
+    lanes m_pitchCoef{};        // Per-frame decay of the pitch sweep
+    lanes m_ratio{};            // Frequency of the second oscillator relative to the first
+    lanes m_ring{};             // Ring modulation by the second oscillator (0-1)
+    lanes m_toneCoef{};         // Per-frame decay of the oscillator
+    lanes m_noiseCoef{};        // Per-frame decay of the noise
+    lanes m_cutoff{};           // Filter: tan(pi * cutoff / sampleRate)
+    lanes m_damping{};          // Filter: 1 / Q
+    lanes m_normalize{};        // Filter: 1 / (1 + g (g + k))
+    lanes m_lowMix{}, m_bandMix{}, m_highMix{}; // Filter outputs in the noise
+    lanes m_burstStep{};        // Phase step of the clap bursts
+    lanes m_burstDepth{};       // How deep the bursts cut in (0 = no bursts)
+
+    // Voice lanes: state
+    lanes m_phase{}, m_phase2{};    // Oscillator phases (0-1)
+    lanes m_pitch{};                // Pitch sweep left (1 at the start)
+    lanes m_toneLevel{};            // Oscillator envelope
+    lanes m_noiseLevel{};           // Noise envelope
+    lanes m_low{}, m_band{};        // Filter state
+    lanes m_burstPhase{};           // Position within the current burst (0-1)
+    lanes m_burstLeft{};            // Frames of bursts left
+    std::array<uint32_t, maxVoices> m_seed{}; // Noise generator of every lane
+    std::array<int, maxVoices> m_track{};     // Track every voice plays into
+    std::array<bool, maxVoices> m_active{};   // Voices that are sounding
+    int m_nextVoice = 0;                      // Voice taken over when all are busy
+
+    alignas(32) float m_block[blockFrames][maxVoices]; // Output of one block, voice lanes side by side
+};
+
+#endif /* synthInstrument_h */
@@ -5,8 +5,33 @@
 //
 
 #include <stdio.h>
+#include <chrono>
 #include "audioManager.h" // Includes the header for audioManager
 #include "factory.h"     // Includes the factory header to create instances
+#include "rtLogger.h"    // Includes the logger used from the audio thread
+#include "rtSafety.h"    // Includes the real-time safety checker (RT_SAFETY_CHECKS builds)
+#include "wavFile.h"     // Includes the WAV reader for the input file
+#include "startupTrace.h" // Includes the startup timing
+#include "timelineTrace.h" // Includes the timeline of the threads (TIMELINE_TRACE builds)
+
+namespace {
+    // The first callbacks after opening a stream warm up caches and the device; they are
+    // left out of the deadline statistics
+    constexpr uint64_t warmupCallbacks = 8;
+
+    // Stack the audio thread touches up front, so deep calls never fault in a new page
+    constexpr size_t prefaultStackBytes = 256 * 1024;
+
+    // Output buses hold at least this many frames, in case a device delivers larger buffers
+    // than it was asked for
+    constexpr int minBusFrames = 4096;
+
+    // Seconds of clean callbacks a buffer size has to survive during auto-tuning
+    constexpr int tuningSeconds = 2;
+
+    // Highest fraction of the buffer duration a callback may use during auto-tuning
+    constexpr double tuningMaxLoad = 0.8;
+}
 
 // Constructor implementation
 audioManager::audioManager(int sampleRate, int bufferSize)
@@ -23,36 +48,498 @@ audioManager::~audioManager() {
 
 //--------------------------------------------------------------
 
+void audioManager::setBackend(audioBackend backend) {
+    m_backend = backend;
+}
+
+//--------------------------------------------------------------
+
+void audioManager::setNumOutputChannels(int numOutputChannels) {
+    if (numOutputChannels > 0) {
+        m_numOutputChannels = numOutputChannels;
+    }
+}
+
+//--------------------------------------------------------------
+
+void audioManager::setNumInputChannels(int numInputChannels) {
+    m_numInputChannels = std::max(0, numInputChannels);
+}
+
+//--------------------------------------------------------------
+
+bool audioManager::setInputFile(const std::string& path) {
+    wavFile file;
+    if (!file.load(ofToDataPath(path))) {
+        return false;
+    }
+    if (file.getSampleRate() != m_sampleRate) {
+        ofLogWarning("audioManager::setInputFile") << path << " is recorded at " << file.getSampleRate()
+                                                   << " Hz and is played at " << m_sampleRate << " Hz";
+    }
+    m_inputSamples = file.getSamples();
+    m_numInputChannels = file.getNumChannels();
+    return true;
+}
+
+//--------------------------------------------------------------
+
+void audioManager::setRealtimeSettings(const realtimeSettings& settings) {
+    m_realtime = settings;
+}
+
+//--------------------------------------------------------------
+
 void audioManager::setup(sequencerGui* seqGui) {
+    // Worker threads pin themselves as they start, so the cores must be known first
+    threadTuning::setWorkerCores(m_realtime.enabled ? m_realtime.workerCores : std::vector<int>());
+
+    // Messages logged from the audio thread are printed by the logger's own thread
+    rtLogger::instance().start();
+    
     // Use the factory to create a metronome instance, passing the sequencerGui pointer
-    m_metronome = factory::createMetronome(seqGui, m_sampleRate);
+    {
+        startupTrace::phase phase("metronome");
+        m_metronome = factory::createMetronome(seqGui, m_sampleRate);
+    }
 
-    // Configure settings for the audio stream
-    ofSoundStreamSettings settings;
-    settings.setOutListener(m_metronome.get());  // Set the metronome as the listener for audio output
-    settings.sampleRate = m_sampleRate;          // Set the sample rate
-    settings.numOutputChannels = 2;              // Set the number of output channels (stereo)
-    settings.numInputChannels = 0;               // No input channels are used
-    settings.bufferSize = m_bufferSize;          // Set the buffer size for audio processing
+    // Lock after the instruments and buffers exist; later allocations are locked as they come
+    if (m_realtime.enabled && m_realtime.lockMemory) {
+        int error = 0;
+        m_memoryLockState = threadTuning::lockMemory(error);
+        m_memoryLockError = error;
+        if (m_memoryLockState != tuningState::applied) {
+            ofLogWarning("audioManager::setup") << threadTuning::describeFailure(tuningStep::memoryLock, m_memoryLockState, error);
+        }
+    }
 
-    // Setup the sound stream with the configured settings
-    m_soundStream.setup(settings);
+    openStream();
+}
+
+//--------------------------------------------------------------
+
+void audioManager::reconfigure(int sampleRate, int bufferSize, int numOutputChannels) {
+    if (sampleRate <= 0 || bufferSize <= 0 || numOutputChannels <= 0) {
+        ofLogError("audioManager::reconfigure") << "Invalid audio settings";
+        return;
+    }
+
+    // Stop the callback first, so nothing touches the metronome while it changes. A session
+    // trace is finished: it only replays at the settings it was recorded with.
+    closeStream();
+    stopTrace();
+
+    m_sampleRate = sampleRate;
+    m_bufferSize = bufferSize;
+    m_numOutputChannels = numOutputChannels;
+
+    if (m_metronome) {
+        m_metronome->setSampleRate(m_sampleRate); // Keeps the musical position and tempo
+    }
+
+    openStream();
+}
+
+//--------------------------------------------------------------
+
+void audioManager::openStream() {
+    resetStats();
+
+    // One output bus per channel pair, large enough for the buffers of the new stream
+    if (m_metronome) {
+        m_metronome->prepareOutput(std::max(m_bufferSize, minBusFrames), m_numOutputChannels);
+        
+        // Offline rendering outruns the reverb worker, so the callback finishes the tails itself,
+        // and it does not start until the kit and the reverbs are ready
+        m_metronome->getSends()->setSynchronous(m_backend == audioBackend::nullOffline);
+        if (m_backend == audioBackend::nullOffline) {
+            m_metronome->waitForStartup();
+        }
+    }
+
+    // The new stream may call back on a new thread, which has to harden itself again
+    m_audioThreadHardened = false;
+    if (m_realtime.enabled) {
+        m_priorityState = tuningState::pending;
+        m_audioPinningState = m_realtime.audioCores.empty() ? tuningState::notRequested : tuningState::pending;
+        m_denormalState = m_realtime.flushDenormals ? tuningState::pending : tuningState::notRequested;
+    }
+
+    if (m_backend == audioBackend::soundStream) {
+        // Configure settings for the audio stream
+        ofSoundStreamSettings settings;
+        settings.setOutListener(this);                      // The audio manager times and forwards every buffer
+        if (m_numInputChannels > 0) {
+            settings.setInListener(this);                   // The live input goes to the metronome
+        }
+        settings.sampleRate = m_sampleRate;                 // Set the sample rate
+        settings.numOutputChannels = m_numOutputChannels;   // Set the number of output channels
+        settings.numInputChannels = m_numInputChannels;     // Set the number of input channels
+        settings.bufferSize = m_bufferSize;                 // Set the buffer size for audio processing
+
+        // Setup the sound stream with the configured settings
+        startupTrace::phase phase("audio stream");
+        m_soundStream.setup(settings);
+    } else {
+        // Drive the same callback from the device-less backend
+        bool realtime = m_backend == audioBackend::nullRealtime;
+        m_nullDriver.setup(m_sampleRate, m_bufferSize, m_numOutputChannels,
+                           [this](ofSoundBuffer& buffer) { audioOut(buffer); }, realtime,
+                           m_numInputChannels, [this](ofSoundBuffer& buffer) { audioIn(buffer); }, m_inputSamples);
+    }
+    m_streamOpen = true;
+}
+
+//--------------------------------------------------------------
+
+void audioManager::closeStream() {
+    if (!m_streamOpen) {
+        return;
+    }
+    m_soundStream.close(); // Close the sound stream to release resources
+    m_nullDriver.close();  // Stop the null backend's thread, if it runs
+    m_streamOpen = false;
+}
+
+//--------------------------------------------------------------
+
+void audioManager::audioIn(ofSoundBuffer& buffer) {
+    if (m_realtime.enabled && !m_audioThreadHardened.load(std::memory_order_relaxed)) {
+        hardenAudioThread(); // The input may come first in a cycle
+    }
+    rtSafety::realtimeScope realtime;
+
+    auto start = std::chrono::steady_clock::now();
+    if (m_metronome) {
+        m_metronome->audioIn(buffer);
+    }
+    m_inputMicros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+//--------------------------------------------------------------
+
+void audioManager::audioOut(ofSoundBuffer& buffer) {
+    processAudio(buffer);
 }
 
 //--------------------------------------------------------------
 
 void audioManager::processAudio(ofSoundBuffer& buffer) {
+    TIMELINE_THREAD("audio");
+    if (m_realtime.enabled && !m_audioThreadHardened.load(std::memory_order_relaxed)) {
+        hardenAudioThread(); // First callback only; it falls within the warm-up callbacks
+    }
+
+    // From here on nothing may allocate, lock or block (checked in RT_SAFETY_CHECKS builds)
+    rtSafety::realtimeScope realtime;
+    startupTrace::instance().markFirstCallback();
+
+    auto start = std::chrono::steady_clock::now();
+
     if (m_metronome) {
         // Process audio through the metronome
         m_metronome->audioOut(buffer);
     }
+
+    // Compare the time spent with the time the buffer lasts
+    double micros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    micros += m_inputMicros; // The input of this cycle counts against the same deadline
+    m_inputMicros = 0.0;
+    double deadlineMicros = 1e6 * buffer.getNumFrames() / m_sampleRate;
+    double load = micros / deadlineMicros;
+
+    uint64_t callbacks = ++m_callbacks;
+    m_lastCallbackMicros.store(micros, std::memory_order_relaxed);
+    if (callbacks <= warmupCallbacks) {
+        return;
+    }
+    if (micros > m_peakCallbackMicros.load(std::memory_order_relaxed)) {
+        m_peakCallbackMicros.store(micros, std::memory_order_relaxed);
+        m_peakLoad.store(load, std::memory_order_relaxed);
+    }
+    if (load > 1.0) {
+        m_deadlineMisses++;
+        TIMELINE_INSTANT("deadline miss", micros);
+    }
+}
+
+//--------------------------------------------------------------
+
+void audioManager::processOffline(int numBuffers) {
+    if (m_backend == audioBackend::nullOffline) {
+        m_nullDriver.process(numBuffers);
+    }
+}
+
+//--------------------------------------------------------------
+
+void audioManager::startLatencyTuning(int minBufferSize) {
+    m_tuningMinBufferSize = std::max(1, minBufferSize);
+    m_stableBufferSize = 0;
+    m_tuning = true;
+    resetStats(); // Judge the current size from a clean slate
+}
+
+//--------------------------------------------------------------
+
+bool audioManager::startTrace(const std::string& path) {
+    return m_metronome && m_metronome->startTrace(path, m_bufferSize);
+}
+
+//--------------------------------------------------------------
+
+void audioManager::stopTrace() {
+    if (m_metronome) {
+        m_metronome->stopTrace();
+    }
+}
+
+//--------------------------------------------------------------
+
+bool audioManager::replayTrace(const std::string& path, replayResult& result) {
+    result = replayResult();
+    if (m_backend != audioBackend::nullOffline || !m_metronome) {
+        ofLogError("audioManager::replayTrace") << "Traces are replayed on the offline backend only";
+        return false;
+    }
+    sessionTrace::header setup;
+    std::vector<sessionTrace::entry> entries;
+    std::vector<std::string> names;
+    if (!sessionTrace::load(ofToDataPath(path, true), setup, entries, names)) {
+        return false;
+    }
+    if ((int)setup.sampleRate != m_sampleRate || (int)setup.bufferSize != m_bufferSize
+        || (int)setup.numOutputChannels != m_numOutputChannels) {
+        reconfigure((int)setup.sampleRate, (int)setup.bufferSize, (int)setup.numOutputChannels);
+    }
+    stopTrace();
+
+    // Stop and process one buffer, so the clock is at the top of the bar, then start from
+    // the trace's tempo and rhythm (its first commands bring back the pattern)
+    engineCommand stop;
+    stop.kind = engineCommand::type::transport;
+    if (!m_metronome->applyControl(stop)) {
+        processOffline(1); // Empties a full queue
+        m_metronome->applyControl(stop);
+    }
+    processOffline(1);
+    m_metronome->setup((int)setup.tempo, setup.beats, setup.tuplets);
+    m_metronome->setTempo(setup.tempo);
+
+    sessionTrace* trace = m_metronome->getTrace();
+    trace->startChecking();
+    commandQueue* queue = m_metronome->getCommandQueue();
+    std::vector<sessionTrace::entry> drained;
+    std::vector<sessionTrace::entry> replayed;  // Checkpoints of the replay
+    int64_t start = trace->getNextFrame();   // The trace's first buffer is the next one
+    int64_t end = 0;
+    size_t next = 0;
+    auto began = std::chrono::steady_clock::now();
+    if (!entries.empty()) {
+        end = entries.back().command.sampleTime - setup.startFrame;
+    }
+    for (int64_t frame = 0; frame <= end; frame += m_bufferSize) {
+        // Hand over the commands of this buffer, at their frames
+        for (; next < entries.size() && entries[next].command.sampleTime - setup.startFrame < frame + m_bufferSize; next++) {
+            if (entries[next].checkpoint) {
+                continue;
+            }
+            engineCommand command = entries[next].command;
+            command.sampleTime += start - setup.startFrame;
+
+            // Kits and responses are built here and staged before their buffer: a send swaps
+            // its response in at the start of the buffer, the sampler its kit when the kit
+            // command is applied
+            if (command.kind == engineCommand::type::sendResponse) {
+                if (command.second < 0) {
+                    m_metronome->makeHall(command.first, command.value);
+                } else if (command.second >= (int)names.size()
+                           || !m_metronome->loadImpulse(command.first, names[command.second])) {
+                    ofLogWarning("audioManager::replayTrace") << "The impulse response of send " << command.first
+                                                              << " cannot be loaded";
+                }
+                result.commands++;
+                continue;
+            }
+            if (command.kind == engineCommand::type::kit) {
+                if (command.first < 0 || command.first >= (int)names.size()) {
+                    ofLogWarning("audioManager::replayTrace") << "The trace has no files for kit " << command.first;
+                    continue;
+                }
+                m_metronome->prepareKit(names[command.first]);
+            }
+            if (!queue->push(&command, 1)) {
+                ofLogError("audioManager::replayTrace") << "The command queue is full";
+                trace->stop();
+                return false;
+            }
+            result.commands++;
+        }
+        processOffline(1);
+        result.frames += m_bufferSize;
+
+        // Keep the checkpoints; the ring also holds the commands just replayed
+        drained.clear();
+        trace->drain(drained);
+        for (const sessionTrace::entry& entry : drained) {
+            if (entry.checkpoint) {
+                replayed.push_back(entry);
+            }
+        }
+    }
+    trace->stop();
+    result.millis = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - began).count();
+
+    // Compare the checkpoints of the replay with those of the trace, frame by frame
+    size_t index = 0;
+    for (const sessionTrace::entry& entry : entries) {
+        if (!entry.checkpoint) {
+            continue;
+        }
+        result.checkpoints++;
+        int64_t frame = entry.command.sampleTime - setup.startFrame;
+        while (index < replayed.size() && replayed[index].command.sampleTime - start < frame) {
+            index++;
+        }
+        bool same = index < replayed.size() && replayed[index].command.sampleTime - start == frame
+                    && replayed[index].hash == entry.hash;
+        if (same) {
+            result.matched++;
+        } else if (result.firstMismatch < 0) {
+            result.firstMismatch = frame;
+        }
+    }
+    return true;
+}
+
+//--------------------------------------------------------------
+
+void audioManager::update() {
+    // Every frame's pattern edits, from whatever thread, become one undo step
+    m_metronome->commitEdits();
+    
+    // Write what the session trace recorded since the last update
+    m_metronome->flushTrace();
+    
+    // Print how long startup took, once the first buffer has been played
+    startupTrace::instance().reportWhenReady();
+    
+    if (!m_tuning) {
+        return;
+    }
+
+    bool unstable = m_deadlineMisses > 0 || m_peakLoad > tuningMaxLoad;
+    if (unstable) {
+        // Go back to the last size that held up, and stop there
+        m_tuning = false;
+        if (m_stableBufferSize > 0) {
+            reconfigure(m_sampleRate, m_stableBufferSize, m_numOutputChannels);
+            ofLogNotice("audioManager::update") << "Latency tuning settled on " << m_bufferSize << " frames";
+        } else {
+            ofLogWarning("audioManager::update") << "Buffer size " << m_bufferSize << " is not stable, tuning stopped";
+        }
+        return;
+    }
+
+    // Wait until this size has run cleanly for long enough
+    uint64_t needed = warmupCallbacks + (uint64_t)tuningSeconds * m_sampleRate / m_bufferSize;
+    if (m_callbacks < needed) {
+        return;
+    }
+
+    m_stableBufferSize = m_bufferSize;
+    if (m_bufferSize / 2 < m_tuningMinBufferSize) {
+        m_tuning = false;
+        ofLogNotice("audioManager::update") << "Latency tuning settled on " << m_bufferSize << " frames";
+        return;
+    }
+    reconfigure(m_sampleRate, m_bufferSize / 2, m_numOutputChannels); // Try the next size down
+}
+
+//--------------------------------------------------------------
+
+void audioManager::resetStats() {
+    m_callbacks = 0;
+    m_deadlineMisses = 0;
+    m_lastCallbackMicros = 0.0;
+    m_peakCallbackMicros = 0.0;
+    m_peakLoad = 0.0;
+}
+
+//--------------------------------------------------------------
+
+void audioManager::hardenAudioThread() {
+    // Failures are kept as error codes; getStats() makes the messages on the control thread
+    int error = 0;
+    tuningState state = threadTuning::setRealtimePriority(m_realtime.priority, m_sampleRate, m_bufferSize, error);
+    m_priorityError = error;
+    m_priorityState = state;
+    rtLogger::instance().log("audioManager", "Real-time priority: %s", threadTuning::toString(state));
+
+    if (!m_realtime.audioCores.empty()) {
+        error = 0;
+        state = threadTuning::pinCurrentThread(m_realtime.audioCores, error);
+        m_audioPinningError = error;
+        m_audioPinningState = state;
+        rtLogger::instance().log("audioManager", "Audio thread pinning: %s", threadTuning::toString(state));
+    }
+
+    if (m_realtime.flushDenormals) {
+        state = threadTuning::flushDenormals();
+        m_denormalState = state;
+        rtLogger::instance().log("audioManager", "Denormal flushing: %s", threadTuning::toString(state));
+    }
+
+    if (m_realtime.lockMemory) {
+        threadTuning::prefaultStack(prefaultStackBytes);
+    }
+    m_audioThreadHardened = true;
+}
+
+//--------------------------------------------------------------
+
+audioManager::audioStats audioManager::getStats() const {
+    audioStats stats;
+    stats.sampleRate = m_sampleRate;
+    stats.bufferSize = m_bufferSize;
+    stats.numOutputChannels = m_numOutputChannels;
+    stats.callbacks = m_callbacks;
+    stats.deadlineMisses = m_deadlineMisses;
+    stats.lastCallbackMicros = m_lastCallbackMicros;
+    stats.peakCallbackMicros = m_peakCallbackMicros;
+    stats.peakLoad = m_peakLoad;
+    stats.tuning = m_tuning;
+
+    stats.hardening.priority = m_priorityState;
+    stats.hardening.memoryLock = m_memoryLockState;
+    stats.hardening.audioPinning = m_audioPinningState;
+    stats.hardening.denormals = m_denormalState;
+    std::string workerError;
+    stats.hardening.workerPinning = threadTuning::getWorkerPinning(workerError);
+
+    // The audio thread only stores states and error codes; the messages are made here
+    std::string messages[] = {
+        threadTuning::describeFailure(tuningStep::priority, stats.hardening.priority, m_priorityError),
+        threadTuning::describeFailure(tuningStep::memoryLock, stats.hardening.memoryLock, m_memoryLockError),
+        threadTuning::describeFailure(tuningStep::pinning, stats.hardening.audioPinning, m_audioPinningError),
+        threadTuning::describeFailure(tuningStep::denormals, stats.hardening.denormals, 0),
+        workerError
+    };
+    for (const std::string& message : messages) {
+        if (!message.empty()) {
+            stats.hardening.message += (stats.hardening.message.empty() ? "" : "; ") + message;
+        }
+    }
+    return stats;
 }
 
 //--------------------------------------------------------------
 
 void audioManager::exit() {
     // Perform any necessary cleanup when exiting
-    m_soundStream.close(); // Close the sound stream to release resources
+    closeStream();
+    stopTrace();
+    rtLogger::instance().stop(); // Prints what the audio thread logged last
 }
 
 //--------------------------------------------------------------
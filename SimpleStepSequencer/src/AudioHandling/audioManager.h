@@ -9,6 +9,22 @@ The audioManager.cpp file defines the implementation for the audioManager class,
 audio setup, processing, and cleanup. It configures audio settings using OpenFrameworks,
 integrates with a metronome instance, and ensures proper resource management. The class
 manages the audio stream and provides methods to process and clean up audio resources.
+
+The stream can be reconfigured (sample rate, buffer size, channel count) while the app is
+running without losing the transport position, and it can run on a null backend when no
+audio device is present. Every callback is timed against its deadline; the results are
+available through getStats(), and an auto-tune mode uses them to find the smallest buffer
+size that runs without missed deadlines.
+
+Real-time hardening (see threadTuning) is opt-in through setRealtimeSettings(). Memory is
+locked in setup(); priority, core pinning and denormal flushing are applied by the audio
+thread itself in the first callback of every stream, since a new stream may bring a new
+thread. The outcome of each step is part of audioStats.
+
+With input channels (setNumInputChannels()) the live input is passed to the metronome,
+which looks for hits in it (see metronome::setStepRecording()). On the device-less
+backends the input can be played from a WAV file (setInputFile()), so step recording can be
+tried and measured without a sound card.
 */
 
 // These directives are used to prevent multiple inclusions of the same header file, which
@@ -16,36 +32,165 @@ manages the audio stream and provides methods to process and clean up audio reso
 #ifndef audioManager_h
 #define audioManager_h
 
-#include "ofSoundStream.h" // OpenFrameworks sound stream header for audio processing
-#include "metronome.h"     // Header for the Metronome class
-#include <memory>         // For using std::unique_ptr
+#include "ofSoundStream.h"    // OpenFrameworks sound stream header for audio processing
+#include "metronome.h"        // Header for the Metronome class
+#include "nullAudioDriver.h"  // Device-less backend
+#include "threadTuning.h"     // Real-time hardening of the audio and worker threads
+#include <atomic>             // For statistics shared with the audio thread
+#include <memory>             // For using std::unique_ptr
+#include <vector>             // For the input file
 
-class audioManager {
+class audioManager : public ofBaseSoundInput, public ofBaseSoundOutput {
 public:
+    // Where the audio callback is driven from
+    enum class audioBackend {
+        soundStream,    // The default sound device through ofSoundStream
+        nullRealtime,   // No device; a thread drives the callback at real-time pace
+        nullOffline     // No device; buffers are only processed on request (see processOffline)
+    };
+
+    // Snapshot of the audio callback statistics
+    struct audioStats {
+        int sampleRate;             // Current sample rate
+        int bufferSize;             // Current buffer size in frames
+        int numOutputChannels;      // Current number of output channels
+        uint64_t callbacks;         // Callbacks since the stream was (re)opened
+        uint64_t deadlineMisses;    // Callbacks that took longer than their buffer lasts
+        double lastCallbackMicros;  // Duration of the latest callback
+        double peakCallbackMicros;  // Longest callback since the stream was (re)opened
+        double peakLoad;            // Longest callback as a fraction of the buffer duration
+        bool tuning;                // True while the latency auto-tune is running
+        tuningReport hardening;     // Outcome of each real-time hardening step
+    };
+
     // Constructor: Initializes audioManager with sample rate and buffer size
     audioManager(int sampleRate, int bufferSize);
-    
+
     // Destructor: Cleans up resources
     ~audioManager();
 
+    // Selects the backend; takes effect at setup() or the next reconfigure()
+    void setBackend(audioBackend backend);
+
+    // Sets the number of output channels; takes effect at setup(). Every channel pair gets
+    // its own output bus (see metronome::setTrackBus()), e.g. for stems.
+    void setNumOutputChannels(int numOutputChannels);
+
+    // Sets the number of input channels (0 = no input); takes effect at setup()
+    void setNumInputChannels(int numInputChannels);
+
+    // Plays a WAV file (from bin/data unless the path is absolute) as the input of the
+    // device-less backends, from the start of every stream; returns false if it cannot be
+    // read. Sets the number of input channels to the file's.
+    bool setInputFile(const std::string& path);
+
+    // Selects the real-time hardening; takes effect at setup()
+    void setRealtimeSettings(const realtimeSettings& settings);
+
     // Sets up the audio manager with a pointer to a sequencerGui
     void setup(sequencerGui* seqGui);
-    
+
+    // Reopens the stream with new settings; the metronome keeps its musical position
+    void reconfigure(int sampleRate, int bufferSize, int numOutputChannels);
+
+    // Starts stepping the buffer size down until the smallest stable size is found
+    void startLatencyTuning(int minBufferSize = 32);
+
+    // Takes an undo snapshot of the pattern edits and drives the latency auto-tune; call
+    // regularly from the main thread
+    void update();
+
+    // Called by the sound stream for every input buffer, before the output buffer of the same cycle
+    void audioIn(ofSoundBuffer& buffer) override;
+
+    // Called by the sound stream for every output buffer
+    void audioOut(ofSoundBuffer& buffer) override;
+
     // Processes audio buffer; to be called during audio processing
     void processAudio(ofSoundBuffer& buffer);
-    
+
+    // Processes the given number of buffers right away (null offline backend only)
+    void processOffline(int numBuffers);
+
+    // Outcome of replaying a session trace
+    struct replayResult {
+        size_t commands = 0;        // Commands replayed
+        int64_t frames = 0;         // Frames rendered
+        double millis = 0.0;        // Time the replay took
+        int checkpoints = 0;        // Checkpoints compared
+        int matched = 0;            // Checkpoints whose hash was the same
+        int64_t firstMismatch = -1; // Frame (from the start of the trace) of the first that differed, -1 if none
+    };
+
+    // Starts recording a session trace into a file (see sessionTrace); a reconfiguration
+    // or exit() finishes it
+    bool startTrace(const std::string& path);
+
+    // Stops the session trace and finishes the file
+    void stopTrace();
+
+    // Plays a session trace again, as fast as possible, and compares its checkpoints with
+    // the output (null offline backend only). Switches to the trace's sample rate, buffer
+    // size and channels first. Returns false if it cannot be replayed.
+    bool replayTrace(const std::string& path, replayResult& result);
+
     // Cleans up resources before exiting
     void exit();
-    
+
     // Provides access to the metronome instance
     metronome* getMetronome();
 
+    // Returns a snapshot of the callback statistics
+    audioStats getStats() const;
+
 private:
-    int m_sampleRate;  // Sample rate for audio processing
-    int m_bufferSize;  // Buffer size for audio processing
+    // Opens the stream on the selected backend with the current settings
+    void openStream();
+
+    // Closes the stream on whichever backend is open
+    void closeStream();
+
+    // Clears the callback statistics, e.g. after a reconfiguration
+    void resetStats();
+
+    // Applies priority, pinning and denormal flushing to the calling (audio) thread
+    void hardenAudioThread();
+
+    int m_sampleRate;               // Sample rate for audio processing
+    int m_bufferSize;               // Buffer size for audio processing
+    int m_numOutputChannels = 2;    // Number of output channels (stereo by default)
+    int m_numInputChannels = 0;     // Number of input channels (none by default)
+    std::vector<float> m_inputSamples; // Input of the device-less backends, interleaved
+    audioBackend m_backend = audioBackend::soundStream; // Backend the stream runs on
+    bool m_streamOpen = false;      // True while a stream is open
 
     std::unique_ptr<metronome> m_metronome;  // Unique pointer to manage the metronome instance
     ofSoundStream m_soundStream;             // OpenFrameworks sound stream for audio input/output
+    nullAudioDriver m_nullDriver;            // Device-less backend
+
+    // Callback statistics, written by the audio thread
+    std::atomic<uint64_t> m_callbacks{0};
+    std::atomic<uint64_t> m_deadlineMisses{0};
+    std::atomic<double> m_lastCallbackMicros{0.0};
+    std::atomic<double> m_peakCallbackMicros{0.0};
+    std::atomic<double> m_peakLoad{0.0};
+    double m_inputMicros = 0.0;     // Time spent on the input of the current cycle (audio thread)
+
+    // Real-time hardening
+    realtimeSettings m_realtime;                        // What to apply
+    std::atomic<bool> m_audioThreadHardened{false};     // Set once the audio thread has applied it
+    std::atomic<tuningState> m_priorityState{tuningState::notRequested};
+    std::atomic<tuningState> m_memoryLockState{tuningState::notRequested};
+    std::atomic<tuningState> m_audioPinningState{tuningState::notRequested};
+    std::atomic<tuningState> m_denormalState{tuningState::notRequested};
+    std::atomic<int> m_priorityError{0};                // System error codes of failed steps,
+    std::atomic<int> m_memoryLockError{0};              // turned into messages by getStats()
+    std::atomic<int> m_audioPinningError{0};
+
+    // Latency auto-tune state (main thread only)
+    bool m_tuning = false;          // True while tuning
+    int m_tuningMinBufferSize = 32; // Smallest buffer size to try
+    int m_stableBufferSize = 0;     // Smallest buffer size that has proven stable so far
 };
 
 #endif /* audioManager_h */
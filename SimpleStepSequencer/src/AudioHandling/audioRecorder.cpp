@@ -0,0 +1,393 @@
+//
+//  audioRecorder.cpp
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include "ofMain.h"
+#include "audioRecorder.h"
+#include "outputBuses.h"
+#include "threadTuning.h"
+
+namespace {
+    constexpr size_t headerBytes = 4096;                // Samples start on a page boundary
+    constexpr size_t blockSamples = 64 * 1024;          // Written at a time per file (256 KB)
+    constexpr uint64_t preallocateBytes = 64ull << 20;  // Reserved on disk ahead of the writes
+    constexpr int headerUpdateSeconds = 5;              // How often the header sizes are refreshed
+
+    // WAV files are little-endian
+    void putLittle(unsigned char* to, uint64_t value, int bytes) {
+        for (int i = 0; i < bytes; i++) {
+            to[i] = (unsigned char)(value >> (8 * i));
+        }
+    }
+
+    size_t nextPowerOfTwo(size_t value) {
+        size_t power = 1;
+        while (power < value) {
+            power <<= 1;
+        }
+        return power;
+    }
+}
+
+// One file being written, with the ring feeding it
+struct audioRecorder::track {
+    std::string path;                   // File name
+    int fd = -1;                        // Open file
+    int numChannels = 2;                // Channels per frame
+    std::vector<float> ring;            // Samples from the audio thread
+    size_t mask = 0;                    // ring.size() - 1
+    std::atomic<size_t> write{0};       // Written by the audio thread
+    std::atomic<size_t> read{0};        // Written by the writer
+    std::vector<float> block;           // Samples waiting to be written
+    size_t blockFill = 0;               // Samples in block
+    uint64_t dataBytes = 0;             // Bytes of samples in the file
+    uint64_t reserved = 0;              // Bytes of samples preallocated on disk
+    uint64_t lastBlockOffset = 0;       // File offset and size of the block written before,
+    uint64_t lastBlockBytes = 0;        // dropped from the file cache after the next one
+};
+
+namespace {
+    // Writes the header for the samples written so far. Up to 4 GB it is a plain WAV file;
+    // beyond that the reserved JUNK chunk becomes the ds64 chunk of an RF64 file.
+    bool writeHeader(int fd, int numChannels, int sampleRate, uint64_t dataBytes) {
+        unsigned char header[headerBytes] = {};
+        uint64_t riffBytes = dataBytes + headerBytes - 8;
+        bool large = riffBytes > 0xffffffffull;
+        int frameBytes = numChannels * 4;
+
+        std::memcpy(header, large ? "RF64" : "RIFF", 4);
+        putLittle(header + 4, large ? 0xffffffffull : riffBytes, 4);
+        std::memcpy(header + 8, "WAVE", 4);
+
+        std::memcpy(header + 12, large ? "ds64" : "JUNK", 4);
+        putLittle(header + 16, headerBytes - 12 - 8 - 24 - 8, 4);   // Fills up to the fmt chunk
+        if (large) {
+            putLittle(header + 20, riffBytes, 8);
+            putLittle(header + 28, dataBytes, 8);
+            putLittle(header + 36, dataBytes / frameBytes, 8);      // Sample frames
+        }
+
+        unsigned char* format = header + headerBytes - 32;
+        std::memcpy(format, "fmt ", 4);
+        putLittle(format + 4, 16, 4);
+        putLittle(format + 8, 3, 2);                                // IEEE float
+        putLittle(format + 10, numChannels, 2);
+        putLittle(format + 12, sampleRate, 4);
+        putLittle(format + 16, (uint64_t)sampleRate * frameBytes, 4);
+        putLittle(format + 20, frameBytes, 2);
+        putLittle(format + 22, 32, 2);
+        std::memcpy(format + 24, "data", 4);
+        putLittle(format + 28, large ? 0xffffffffull : dataBytes, 4);
+
+        return pwrite(fd, header, headerBytes, 0) == (ssize_t)headerBytes;
+    }
+
+    // Reserves disk space for the file without changing its size, so a long recording
+    // does not wait for the file system to find blocks
+    void preallocate(int fd, uint64_t offset, uint64_t bytes) {
+#if defined(__linux__)
+        fallocate(fd, FALLOC_FL_KEEP_SIZE, (off_t)offset, (off_t)bytes); // Not every file system can; that is fine
+#elif defined(__APPLE__)
+        fstore_t store = {F_ALLOCATECONTIG, F_PEOFPOSMODE, 0, (off_t)bytes, 0};
+        if (fcntl(fd, F_PREALLOCATE, &store) == -1) {
+            store.fst_flags = F_ALLOCATEALL;
+            fcntl(fd, F_PREALLOCATE, &store);
+        }
+#else
+        (void)fd; (void)offset; (void)bytes;
+#endif
+    }
+}
+
+//--------------------------------------------------------------
+
+audioRecorder::audioRecorder() {
+}
+
+//--------------------------------------------------------------
+
+// Destructor implementation
+audioRecorder::~audioRecorder() {
+    stop(); // Finish the files of a running recording
+}
+
+//--------------------------------------------------------------
+
+bool audioRecorder::start(const std::string& path, bool stems, int sampleRate, int numChannels, int numBuses,
+                          double bufferSeconds) {
+    stop();
+    if (numChannels <= 0 || sampleRate <= 0) {
+        return false;
+    }
+    m_sampleRate = sampleRate;
+    m_numChannels = numChannels;
+
+    // The master, then one stereo file per bus
+    std::string base = path;
+    if (base.size() > 4 && base.compare(base.size() - 4, 4, ".wav") == 0) {
+        base.resize(base.size() - 4);
+    }
+    std::vector<std::pair<std::string, int>> files = {{base + ".wav", numChannels}};
+    if (stems) {
+        for (int bus = 0; bus < numBuses; bus++) {
+            files.push_back({base + "-bus" + std::to_string(bus) + ".wav", 2});
+        }
+    }
+
+    // Everything the audio thread and the writer need is allocated here, up front
+    for (const auto& file : files) {
+        auto newTrack = std::make_unique<track>();
+        newTrack->path = file.first;
+        newTrack->numChannels = file.second;
+        newTrack->ring.assign(nextPowerOfTwo(size_t(bufferSeconds * sampleRate) * file.second), 0.0f);
+        newTrack->mask = newTrack->ring.size() - 1;
+        newTrack->block.assign(blockSamples, 0.0f);
+
+        newTrack->fd = ::open(file.first.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (newTrack->fd < 0) {
+            ofLogError("audioRecorder::start") << "Cannot create " << file.first << ": " << std::strerror(errno);
+            for (auto& opened : m_tracks) {
+                ::close(opened->fd);
+            }
+            m_tracks.clear();
+            return false;
+        }
+#if defined(__APPLE__)
+        fcntl(newTrack->fd, F_NOCACHE, 1); // Keep the recording out of the file cache
+#endif
+        writeHeader(newTrack->fd, newTrack->numChannels, sampleRate, 0);
+        preallocate(newTrack->fd, headerBytes, preallocateBytes);
+        newTrack->reserved = preallocateBytes;
+        m_tracks.push_back(std::move(newTrack));
+    }
+
+    m_framesRecorded = 0;
+    m_overruns = 0;
+    m_droppedFrames = 0;
+    m_peakFill = 0.0;
+    m_bytesWritten = 0;
+    m_writeErrors = 0;
+
+    m_running = true;
+    m_thread = std::thread(&audioRecorder::run, this);
+    m_recording = true; // The audio thread starts capturing with the next buffer
+    ofLogNotice("audioRecorder::start") << "Recording " << m_tracks.size() << " files to " << base << ".wav";
+    return true;
+}
+
+//--------------------------------------------------------------
+
+void audioRecorder::stop() {
+    if (!m_recording && !m_thread.joinable()) {
+        return;
+    }
+
+    // Wait until the audio thread is out of capture(); it sees m_recording before it
+    // touches a ring, so it will not come back
+    m_recording = false;
+    while (m_capturing) {
+        std::this_thread::yield();
+    }
+
+    m_running = false;
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+
+    // Write what is left and finish the files
+    drain(true);
+    for (auto& file : m_tracks) {
+        writeHeader(file->fd, file->numChannels, m_sampleRate, file->dataBytes);
+        if (ftruncate(file->fd, (off_t)(headerBytes + file->dataBytes)) != 0) {
+            m_writeErrors++; // Some space stays reserved; the header still has the right size
+        }
+        ::close(file->fd);
+    }
+    if (!m_tracks.empty()) {
+        ofLogNotice("audioRecorder::stop") << "Recorded " << m_framesRecorded << " frames, "
+                                           << m_overruns << " overruns";
+    }
+    m_tracks.clear();
+}
+
+//--------------------------------------------------------------
+
+bool audioRecorder::isRecording() const {
+    return m_recording;
+}
+
+//--------------------------------------------------------------
+
+void audioRecorder::capture(const ofSoundBuffer& master, outputBuses& buses) {
+    m_capturing = true;
+    if (!m_recording) {
+        m_capturing = false;
+        return;
+    }
+
+    size_t frames = master.getNumFrames();
+    if ((int)master.getNumChannels() != m_numChannels) {
+        m_capturing = false;
+        return; // A new stream format ends the recording (see metronome::prepareOutput())
+    }
+
+    // Drop the buffer from every file if any ring is full, so the files stay aligned
+    double fill = 0.0;
+    for (auto& file : m_tracks) {
+        size_t used = file->write.load(std::memory_order_relaxed) - file->read.load(std::memory_order_acquire);
+        size_t needed = frames * file->numChannels;
+        if (used + needed > file->ring.size()) {
+            m_overruns++;
+            m_droppedFrames += frames;
+            m_capturing = false;
+            return;
+        }
+        fill = std::max(fill, double(used + needed) / file->ring.size());
+    }
+    if (fill > m_peakFill.load(std::memory_order_relaxed)) {
+        m_peakFill.store(fill, std::memory_order_relaxed);
+    }
+
+    // The master is interleaved already: at most two copies, around the end of the ring
+    track& main = *m_tracks[0];
+    const float* samples = master.getBuffer().data();
+    size_t count = frames * m_numChannels;
+    size_t write = main.write.load(std::memory_order_relaxed);
+    size_t start = write & main.mask;
+    size_t first = std::min(count, main.ring.size() - start);
+    std::memcpy(main.ring.data() + start, samples, first * sizeof(float));
+    std::memcpy(main.ring.data(), samples + first, (count - first) * sizeof(float));
+    main.write.store(write + count, std::memory_order_release);
+
+    // Stems are interleaved from the planar buses
+    size_t busFrames = std::min(frames, buses.getNumFrames());
+    for (size_t i = 1; i < m_tracks.size(); i++) {
+        track& stem = *m_tracks[i];
+        const float* left = buses.getChannel(int(i - 1), 0);
+        const float* right = buses.getChannel(int(i - 1), 1);
+        size_t position = stem.write.load(std::memory_order_relaxed);
+        for (size_t frame = 0; frame < frames; frame++) {
+            bool rendered = frame < busFrames;
+            stem.ring[position++ & stem.mask] = rendered ? left[frame] : 0.0f;
+            stem.ring[position++ & stem.mask] = rendered ? right[frame] : 0.0f;
+        }
+        stem.write.store(position, std::memory_order_release);
+    }
+
+    m_framesRecorded += frames;
+    m_capturing = false;
+}
+
+//--------------------------------------------------------------
+
+audioRecorder::stats audioRecorder::getStats() const {
+    stats current;
+    current.recording = m_recording;
+    current.numFiles = (int)m_tracks.size();
+    current.framesRecorded = m_framesRecorded;
+    current.overruns = m_overruns;
+    current.droppedFrames = m_droppedFrames;
+    current.peakFill = m_peakFill;
+    current.bytesWritten = m_bytesWritten;
+    current.writeErrors = m_writeErrors;
+    return current;
+}
+
+//--------------------------------------------------------------
+
+void audioRecorder::run() {
+    threadTuning::applyWorkerAffinity(); // Keep off the audio thread's cores, if configured
+
+    auto lastHeaderUpdate = std::chrono::steady_clock::now();
+    while (m_running) {
+        if (!drain(false)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+
+        // Keep the header close to the truth, so a crash loses at most a few seconds
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastHeaderUpdate >= std::chrono::seconds(headerUpdateSeconds)) {
+            for (auto& file : m_tracks) {
+                writeHeader(file->fd, file->numChannels, m_sampleRate, file->dataBytes);
+            }
+            lastHeaderUpdate = now;
+        }
+    }
+}
+
+//--------------------------------------------------------------
+
+bool audioRecorder::drain(bool flush) {
+    bool wrote = false;
+    for (auto& file : m_tracks) {
+        size_t read = file->read.load(std::memory_order_relaxed);
+        size_t available = file->write.load(std::memory_order_acquire) - read;
+
+        while (available > 0 || (flush && file->blockFill > 0)) {
+            // Fill the block from the ring
+            size_t count = std::min(available, blockSamples - file->blockFill);
+            for (size_t i = 0; i < count; i++) {
+                file->block[file->blockFill + i] = file->ring[(read + i) & file->mask];
+            }
+            file->blockFill += count;
+            read += count;
+            available -= count;
+            file->read.store(read, std::memory_order_release); // The audio thread may reuse that room
+
+            if (file->blockFill < blockSamples && !flush) {
+                break; // Wait for a full block
+            }
+
+            // Reserve more space before the recording reaches the end of what is reserved
+            uint64_t bytes = file->blockFill * sizeof(float);
+            if (file->dataBytes + bytes > file->reserved) {
+                preallocate(file->fd, headerBytes + file->reserved, preallocateBytes);
+                file->reserved += preallocateBytes;
+            }
+
+            // Write at a fixed offset; a short write is retried, a failed one is counted
+            uint64_t offset = headerBytes + file->dataBytes;
+            const char* from = reinterpret_cast<const char*>(file->block.data());
+            uint64_t done = 0;
+            while (done < bytes) {
+                ssize_t result = pwrite(file->fd, from + done, bytes - done, (off_t)(offset + done));
+                if (result <= 0) {
+                    m_writeErrors++;
+                    break;
+                }
+                done += result;
+            }
+            file->dataBytes += bytes; // Keep the timeline even if the write failed
+            m_bytesWritten += done;
+            file->blockFill = 0;
+            wrote = true;
+
+#if defined(__linux__)
+            // Start writing this block back now, then drop the previous one from the file
+            // cache, so the cache does not grow with the length of the recording
+            sync_file_range(file->fd, (off_t)offset, (off_t)bytes, SYNC_FILE_RANGE_WRITE);
+            if (file->lastBlockBytes > 0) {
+                sync_file_range(file->fd, (off_t)file->lastBlockOffset, (off_t)file->lastBlockBytes,
+                                SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+                posix_fadvise(file->fd, (off_t)file->lastBlockOffset, (off_t)file->lastBlockBytes, POSIX_FADV_DONTNEED);
+            }
+#endif
+            file->lastBlockOffset = offset;
+            file->lastBlockBytes = bytes;
+
+            if (flush && available == 0) {
+                break;
+            }
+        }
+    }
+    return wrote;
+}
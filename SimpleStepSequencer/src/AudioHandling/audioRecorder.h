@@ -0,0 +1,104 @@
+//
+//  audioRecorder.h
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+/*
+The audioRecorder class records the output to WAV files while playing: the master (all
+output channels, as sent to the device) and, optionally, every output bus as a stereo stem
+(see outputBuses).
+
+The audio thread only copies each buffer into a lock-free ring per file, which is allocated
+when the recording starts. A writer thread empties the rings and writes to disk in large
+blocks at fixed offsets. Files are preallocated ahead of the write position, and written
+pages are dropped from the file cache, so a recording of many hours needs no more memory
+than the first minute. If the disk is too slow and a ring fills up, the audio thread drops
+that buffer from every file (they stay aligned with each other) and counts an overrun. It
+never waits for the writer.
+
+Samples are stored as 32-bit float. The header reserves room so that recordings larger
+than 4 GB are finished as RF64 files. The sizes in the header are updated every few
+seconds, so a recording cut short by a crash is still readable up to that point.
+*/
+
+// These directives are used to prevent multiple inclusions of the same header file, which
+// helps avoid redefinition errors and improves compilation efficiency:
+#ifndef audioRecorder_h
+#define audioRecorder_h
+
+#include <atomic>   // For the rings and the statistics
+#include <cstdint>  // For file offsets
+#include <memory>   // For the files
+#include <string>   // For file names
+#include <thread>   // For the writer thread
+#include <vector>   // For the rings
+
+class ofSoundBuffer;
+class outputBuses;
+
+class audioRecorder {
+public:
+    // Snapshot of the recorder's counters
+    struct stats {
+        bool recording = false;         // True while recording
+        int numFiles = 0;               // Master plus stems
+        uint64_t framesRecorded = 0;    // Frames captured per file
+        uint64_t overruns = 0;          // Buffers dropped because a ring was full
+        uint64_t droppedFrames = 0;     // Frames in those buffers
+        double peakFill = 0.0;          // Highest ring fill seen, as a fraction of its size
+        uint64_t bytesWritten = 0;      // Bytes written to disk, all files together
+        uint64_t writeErrors = 0;       // Failed writes; the recording goes on
+    };
+
+    // Constructor
+    audioRecorder();
+
+    // Destructor that stops a running recording
+    ~audioRecorder();
+
+    // Starts recording to path (the master) and, with stems, to path-busN.wav for every
+    // bus. The rings hold bufferSeconds of audio. Returns false if a file cannot be created.
+    bool start(const std::string& path, bool stems, int sampleRate, int numChannels, int numBuses,
+               double bufferSeconds = 4.0);
+
+    // Stops recording, writes what is left and finishes the files
+    void stop();
+
+    // Returns true while recording
+    bool isRecording() const;
+
+    // Copies the buffer and the buses into the rings (audio thread; never blocks)
+    void capture(const ofSoundBuffer& master, outputBuses& buses);
+
+    // Returns the counters
+    stats getStats() const;
+
+private:
+    // One file being written, with the ring feeding it
+    struct track;
+
+    // Body of the writer thread
+    void run();
+
+    // Moves what is in the rings to the files; returns true if anything was written
+    bool drain(bool flush);
+
+    std::vector<std::unique_ptr<track>> m_tracks;   // Master first, then the stems
+    std::thread m_thread;                           // Writes the files
+    std::atomic<bool> m_running{false};             // Keeps the writer alive
+    std::atomic<bool> m_recording{false};           // Seen by the audio thread
+    std::atomic<bool> m_capturing{false};           // Set while the audio thread is in capture()
+    int m_sampleRate = 44100;                       // Rate of the recording
+    int m_numChannels = 0;                          // Channels of the master
+
+    std::atomic<uint64_t> m_framesRecorded{0};
+    std::atomic<uint64_t> m_overruns{0};
+    std::atomic<uint64_t> m_droppedFrames{0};
+    std::atomic<double> m_peakFill{0.0};
+    std::atomic<uint64_t> m_bytesWritten{0};
+    std::atomic<uint64_t> m_writeErrors{0};
+};
+
+#endif /* audioRecorder_h */
@@ -0,0 +1,268 @@
+//
+//  convolver.cpp
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+#include <algorithm>
+#include <thread>
+#include "convolver.h"
+
+//--------------------------------------------------------------
+
+convolver::convolver(const std::vector<float>& impulse, int numChannels) {
+    numChannels = std::max(numChannels, 1);
+    m_stereo = numChannels >= 2;
+    m_length = std::min(impulse.size() / numChannels, maxLength);
+    int numSides = m_stereo ? 2 : 1;
+
+    // Level n has blocks of 64 * 8^n frames and starts at twice its block size; the last
+    // level takes the rest of the response
+    size_t start = 0;
+    for (int index = 0; index < maxLevels && start < m_length; index++) {
+        size_t blockSize = blockFrames << (3 * index);
+        size_t end = index + 1 < maxLevels ? std::min(2 * (blockFrames << (3 * (index + 1))), m_length) : m_length;
+
+        auto part = std::make_unique<level>();
+        part->blockSize = blockSize;
+        part->bins = blockSize + 1;
+        part->numPartitions = (int)((end - start + blockSize - 1) / blockSize);
+        part->fft.setup(2 * blockSize);
+        size_t spectrumSize = part->numPartitions * part->bins;
+
+        // Every partition, zero-padded to two blocks, is transformed once here; the scale
+        // cancels the gain of the inverse transform
+        std::vector<float> padded(2 * blockSize);
+        float scale = 1.0f / (2 * blockSize);
+        for (int side = 0; side < numSides; side++) {
+            part->filterReal[side].assign(spectrumSize, 0.0f);
+            part->filterImag[side].assign(spectrumSize, 0.0f);
+            for (int partition = 0; partition < part->numPartitions; partition++) {
+                std::fill(padded.begin(), padded.end(), 0.0f);
+                size_t first = start + partition * blockSize;
+                for (size_t frame = 0; frame < blockSize && first + frame < end; frame++) {
+                    padded[frame] = impulse[(first + frame) * numChannels + side] * scale;
+                }
+                part->fft.forward(padded.data(), part->filterReal[side].data() + partition * part->bins,
+                                  part->filterImag[side].data() + partition * part->bins);
+            }
+        }
+
+        part->inputReal.assign(spectrumSize, 0.0f);
+        part->inputImag.assign(spectrumSize, 0.0f);
+        part->window.assign(2 * blockSize, 0.0f);
+        part->sumReal.assign(part->bins, 0.0f);
+        part->sumImag.assign(part->bins, 0.0f);
+        part->result.assign(2 * blockSize, 0.0f);
+        if (index > 0) {
+            part->collected.assign(blockSize, 0.0f);
+            part->job.assign(blockSize, 0.0f);
+            for (auto& block : part->output) {
+                block[0].assign(blockSize, 0.0f);
+                block[1].assign(blockSize, 0.0f);
+            }
+        }
+        m_levels.push_back(std::move(part));
+        start = end;
+    }
+}
+
+//--------------------------------------------------------------
+
+bool convolver::process(const float* input, float* left, float* right, size_t numFrames) {
+    if (m_levels.empty()) {
+        std::fill(left, left + numFrames, 0.0f);
+        std::fill(right, right + numFrames, 0.0f);
+        return false;
+    }
+
+    // Collect 64-frame blocks, and play the output of the previous one meanwhile
+    bool handedOver = false;
+    size_t done = 0;
+    while (done < numFrames) {
+        size_t count = std::min(numFrames - done, blockFrames - m_position);
+        std::copy(input + done, input + done + count, m_block + m_position);
+        std::copy(m_output[0] + m_position, m_output[0] + m_position + count, left + done);
+        std::copy(m_output[1] + m_position, m_output[1] + m_position + count, right + done);
+        m_position += count;
+        done += count;
+        if (m_position == blockFrames) {
+            processBlock(handedOver);
+            m_position = 0;
+        }
+    }
+    return handedOver;
+}
+
+//--------------------------------------------------------------
+
+bool convolver::runTail(int index) {
+    if (index < 1 || index >= (int)m_levels.size()) {
+        return false;
+    }
+    level& part = *m_levels[index];
+    int expected = pending;
+    if (!part.state.compare_exchange_strong(expected, running, std::memory_order_acquire)) {
+        return false; // Nothing to do, or another thread is on it
+    }
+
+    // Blocks the audio thread could not hand over enter the delay line as silence, so the
+    // later ones stay in place
+    uint64_t missed = part.posted - part.finished - 1;
+    if (missed > 0) {
+        std::fill(part.window.begin(), part.window.end(), 0.0f);
+        for (uint64_t block = 0; block < std::min(missed, (uint64_t)part.numPartitions); block++) {
+            part.newest = (part.newest + part.numPartitions - 1) % part.numPartitions;
+            std::fill_n(part.inputReal.begin() + part.newest * part.bins, part.bins, 0.0f);
+            std::fill_n(part.inputImag.begin() + part.newest * part.bins, part.bins, 0.0f);
+        }
+    }
+
+    convolve(part, part.job.data(), part.output[part.back][0].data(), part.output[part.back][1].data());
+    part.finished = part.posted;
+    part.state.store(done, std::memory_order_release);
+    return true;
+}
+
+//--------------------------------------------------------------
+
+void convolver::finishTails() {
+    for (size_t index = 1; index < m_levels.size(); index++) {
+        runTail((int)index);
+        while (m_levels[index]->state.load(std::memory_order_acquire) == running) {
+            std::this_thread::yield(); // The worker got there first
+        }
+    }
+}
+
+//--------------------------------------------------------------
+
+size_t convolver::getLength() const {
+    return m_length;
+}
+
+//--------------------------------------------------------------
+
+int convolver::getNumLevels() const {
+    return (int)m_levels.size();
+}
+
+//--------------------------------------------------------------
+
+uint64_t convolver::getLateBlocks() const {
+    return m_lateBlocks.load(std::memory_order_relaxed);
+}
+
+//--------------------------------------------------------------
+
+void convolver::setSource(int name, float seconds) {
+    m_sourceName = name;
+    m_sourceSeconds = seconds;
+}
+
+//--------------------------------------------------------------
+
+int convolver::getSourceName() const {
+    return m_sourceName;
+}
+
+//--------------------------------------------------------------
+
+float convolver::getSourceSeconds() const {
+    return m_sourceSeconds;
+}
+
+//--------------------------------------------------------------
+
+void convolver::convolve(level& part, const float* block, float* left, float* right) {
+    size_t blockSize = part.blockSize;
+    size_t bins = part.bins;
+
+    // Overlap-save: transform the previous and the new block together
+    std::copy(part.window.begin() + blockSize, part.window.end(), part.window.begin());
+    std::copy(block, block + blockSize, part.window.begin() + blockSize);
+    part.newest = (part.newest + part.numPartitions - 1) % part.numPartitions;
+    part.fft.forward(part.window.data(), part.inputReal.data() + part.newest * bins,
+                     part.inputImag.data() + part.newest * bins);
+
+    float* outputs[2] = {left, right};
+    for (int side = 0; side < (m_stereo ? 2 : 1); side++) {
+        float* sumReal = part.sumReal.data();
+        float* sumImag = part.sumImag.data();
+        std::fill(sumReal, sumReal + bins, 0.0f);
+        std::fill(sumImag, sumImag + bins, 0.0f);
+
+        // Partition n of the response meets the input from n blocks ago
+        for (int partition = 0; partition < part.numPartitions; partition++) {
+            size_t slot = (part.newest + partition) % part.numPartitions;
+            const float* inputReal = part.inputReal.data() + slot * bins;
+            const float* inputImag = part.inputImag.data() + slot * bins;
+            const float* filterReal = part.filterReal[side].data() + partition * bins;
+            const float* filterImag = part.filterImag[side].data() + partition * bins;
+            for (size_t bin = 0; bin < bins; bin++) {
+                sumReal[bin] += inputReal[bin] * filterReal[bin] - inputImag[bin] * filterImag[bin];
+                sumImag[bin] += inputReal[bin] * filterImag[bin] + inputImag[bin] * filterReal[bin];
+            }
+        }
+
+        // The second half of the inverse transform is free of wrap-around
+        part.fft.inverse(sumReal, sumImag, part.result.data());
+        std::copy(part.result.begin() + blockSize, part.result.end(), outputs[side]);
+    }
+    if (!m_stereo) {
+        std::copy(left, left + blockSize, right);
+    }
+}
+
+//--------------------------------------------------------------
+
+void convolver::processBlock(bool& handedOver) {
+    convolve(*m_levels[0], m_block, m_output[0], m_output[1]);
+
+    for (size_t index = 1; index < m_levels.size(); index++) {
+        level& part = *m_levels[index];
+
+        // Add the part of the level's result that lines up with this block
+        if (part.frontValid) {
+            for (int side = 0; side < 2; side++) {
+                const float* from = part.output[part.front][side].data() + part.readPosition;
+                for (size_t frame = 0; frame < blockFrames; frame++) {
+                    m_output[side][frame] += from[frame];
+                }
+            }
+        }
+        part.readPosition += blockFrames;
+
+        std::copy(m_block, m_block + blockFrames, part.collected.begin() + part.numCollected);
+        part.numCollected += blockFrames;
+        if (part.numCollected < part.blockSize) {
+            continue;
+        }
+        part.numCollected = 0;
+        part.readPosition = 0;
+
+        int state = part.state.load(std::memory_order_acquire);
+        if (state == pending || state == running) {
+            // The worker is still on the previous block: its result comes too late to be
+            // played, and this block cannot be handed over
+            part.frontValid = false;
+            part.stale = true;
+            part.skipped++;
+            m_lateBlocks.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        // The finished result covers the next blockSize frames
+        part.frontValid = state == done && !part.stale;
+        if (part.frontValid) {
+            std::swap(part.front, part.back);
+        }
+        part.stale = false;
+        std::copy(part.collected.begin(), part.collected.end(), part.job.begin());
+        part.posted += 1 + part.skipped;
+        part.skipped = 0;
+        part.state.store(pending, std::memory_order_release);
+        handedOver = true;
+    }
+}
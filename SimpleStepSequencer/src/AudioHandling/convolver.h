@@ -0,0 +1,138 @@
+//
+//  convolver.h
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+/*
+The convolver class convolves a mono signal with a mono or stereo impulse response, for the
+convolution reverb of a send (see sendEffects). It uses non-uniform partitioned FFT
+convolution: the impulse response is cut into partitions that grow along it, and each
+group of equal partitions (a level) is convolved with its own block size through a
+frequency-domain delay line.
+
+    level 0:  64-frame blocks,   frames 0 - 1023      (16 partitions, audio thread)
+    level 1:  512-frame blocks,  frames 1024 - 8191   (14 partitions, worker)
+    level 2:  4096-frame blocks, frames 8192 - end    (worker)
+
+Level 0 runs on the audio thread every 64 frames, whatever the buffer size, so the latency
+is 64 frames and the cost per frame does not grow when the buffer shrinks. A later level
+starts twice its block size into the response, which gives it one whole block of time: when
+the audio thread has collected a block for it, it hands the block to a worker thread
+(runTail()) and takes the result of the previous block, which was due one block later. If
+the worker has not finished by then, that result is dropped and counted as late; the reverb
+tail has a gap, but the audio thread never waits. Offline rendering, which runs faster than
+real time, calls finishTails() instead, so no block is ever late.
+
+Everything is allocated and the impulse response is transformed in the constructor, which
+is meant for a background thread. process() and runTail() do not allocate.
+*/
+
+// These directives are used to prevent multiple inclusions of the same header file, which
+// helps avoid redefinition errors and improves compilation efficiency:
+#ifndef convolver_h
+#define convolver_h
+
+#include <atomic>   // For the hand-over between the audio thread and the worker
+#include <cstdint>  // For block counts
+#include <memory>   // For the levels
+#include <vector>   // For spectra and buffers
+#include "fftReal.h"
+
+class convolver {
+public:
+    static constexpr size_t blockFrames = 64;           // Block size of level 0, and the latency
+    static constexpr int maxLevels = 3;                 // Level 0 on the audio thread, the rest on the worker
+    static constexpr size_t maxLength = size_t(1) << 19; // Longest impulse response in frames (about 11 s)
+
+    // Builds the partitions of an impulse response with interleaved samples of one or two
+    // channels; a mono response is used for both sides. Allocates.
+    convolver(const std::vector<float>& impulse, int numChannels);
+
+    // Convolves numFrames frames of input and writes the result to left and right (audio
+    // thread). Returns true when it handed a block to the worker, which should be woken.
+    bool process(const float* input, float* left, float* right, size_t numFrames);
+
+    // Runs the pending block of a level (1 or higher) if there is one; returns true if it
+    // did (worker thread)
+    bool runTail(int level);
+
+    // Runs or waits for every pending block, so the results are ready on time whatever the
+    // worker does. For offline rendering, which runs faster than real time; may wait.
+    void finishTails();
+
+    // Returns the length of the impulse response in frames
+    size_t getLength() const;
+
+    // Returns the number of levels in use
+    int getNumLevels() const;
+
+    // Returns the number of blocks the worker did not finish in time
+    uint64_t getLateBlocks() const;
+
+    // Tags the response with what it was made from, so the thread that swaps it in can tell
+    // which one it is: a name id and a length (see sendEffects::getPlaying())
+    void setSource(int name, float seconds);
+
+    // Returns the name id of the tag
+    int getSourceName() const;
+
+    // Returns the length of the tag in seconds
+    float getSourceSeconds() const;
+
+private:
+    // States of a level's hand-over
+    enum jobState { idle, pending, running, done };
+
+    // One level of equal partitions
+    struct level {
+        size_t blockSize = 0;                   // Frames per partition and per block
+        size_t bins = 0;                        // blockSize + 1
+        int numPartitions = 0;
+        fftReal fft;                            // Of twice the block size
+        std::vector<float> filterReal[2];       // Spectra of the partitions of both sides
+        std::vector<float> filterImag[2];
+        std::vector<float> inputReal;           // Spectra of the latest input blocks (delay line)
+        std::vector<float> inputImag;
+        int newest = 0;                         // Partition slot of the latest input spectrum
+        std::vector<float> window;              // The previous and the latest input block
+        std::vector<float> sumReal;             // Sum of the products of the delay line and the filter
+        std::vector<float> sumImag;
+        std::vector<float> result;              // Inverse transform of the sum
+
+        // Levels on the worker
+        std::vector<float> collected;           // Input collected by the audio thread
+        size_t numCollected = 0;
+        std::vector<float> job;                 // Input handed to the worker
+        std::vector<float> output[2][2];        // Results of two blocks, [block][side]
+        int front = 0;                          // Result being played
+        int back = 1;                           // Result the worker writes
+        bool frontValid = false;                // False while the front result is missing
+        bool stale = false;                     // The result being computed was late; drop it
+        size_t readPosition = 0;                // Frames of the front result played
+        uint64_t posted = 0;                    // Number of the block handed over last (audio thread)
+        uint64_t skipped = 0;                   // Blocks not handed over since then (audio thread)
+        uint64_t finished = 0;                  // Number of the block convolved last (worker)
+        std::atomic<int> state{idle};           // jobState of the hand-over
+    };
+
+    // Convolves one block with a level: moves it into the delay line and writes blockSize
+    // frames of both sides
+    void convolve(level& part, const float* block, float* left, float* right);
+
+    // Runs a 64-frame block through level 0 and the results of the other levels
+    void processBlock(bool& handedOver);
+
+    std::vector<std::unique_ptr<level>> m_levels;
+    bool m_stereo = false;                      // The impulse response has two channels
+    size_t m_length = 0;                        // Frames of the impulse response
+    float m_block[blockFrames] = {};            // Input being collected
+    float m_output[2][blockFrames] = {};        // Output of the latest block
+    size_t m_position = 0;                      // Frames collected into m_block
+    std::atomic<uint64_t> m_lateBlocks{0};
+    int m_sourceName = -1;                      // Tag set before the convolver is handed over
+    float m_sourceSeconds = 0.0f;
+};
+
+#endif /* convolver_h */
@@ -0,0 +1,156 @@
+//
+//  engineCommand.cpp
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+#include "engineCommand.h"
+
+#include <algorithm> // For the heap functions
+
+//--------------------------------------------------------------
+// commandQueue
+//--------------------------------------------------------------
+
+bool commandQueue::push(const engineCommand* commands, size_t count) {
+    std::lock_guard<std::mutex> lock(m_producerMutex);
+
+    size_t write = m_writeIndex.load(std::memory_order_relaxed);
+    size_t read = m_readIndex.load(std::memory_order_acquire);
+    if (capacity - (write - read) < count) {
+        m_dropped++;
+        return false; // The whole batch is dropped rather than applying half of it
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        m_commands[(write + i) & (capacity - 1)] = commands[i];
+    }
+    m_batchSizes[write & (capacity - 1)] = (uint32_t)count;
+
+    // Publishing the write index once makes the whole batch visible at the same time
+    m_writeIndex.store(write + count, std::memory_order_release);
+    return true;
+}
+
+//--------------------------------------------------------------
+
+size_t commandQueue::nextBatchSize() const {
+    size_t read = m_readIndex.load(std::memory_order_relaxed);
+    if (read == m_writeIndex.load(std::memory_order_acquire)) {
+        return 0;
+    }
+    return m_batchSizes[read & (capacity - 1)];
+}
+
+//--------------------------------------------------------------
+
+bool commandQueue::pop(engineCommand& command) {
+    size_t read = m_readIndex.load(std::memory_order_relaxed);
+    if (read == m_writeIndex.load(std::memory_order_acquire)) {
+        return false;
+    }
+    command = m_commands[read & (capacity - 1)];
+    m_readIndex.store(read + 1, std::memory_order_release);
+    return true;
+}
+
+//--------------------------------------------------------------
+
+uint64_t commandQueue::getDropped() const {
+    return m_dropped;
+}
+
+//--------------------------------------------------------------
+
+size_t commandQueue::getNumPushed() const {
+    return m_writeIndex.load(std::memory_order_acquire);
+}
+
+//--------------------------------------------------------------
+// commandSchedule
+//--------------------------------------------------------------
+
+size_t commandSchedule::collect(commandQueue& queue, int64_t now) {
+    size_t dropped = 0;
+    size_t batchSize;
+    while ((batchSize = queue.nextBatchSize()) > 0) {
+        // A batch is applied as a whole or not at all, so check the room for all of it first.
+        // The queue is still drained, so it does not fill up behind us
+        bool fits = batchSize <= capacity - m_immediateCount - m_timedCount;
+        if (!fits) {
+            m_dropped++;
+            dropped += batchSize;
+        }
+
+        engineCommand command;
+        for (size_t i = 0; i < batchSize && queue.pop(command); i++) {
+            if (!fits) {
+                continue;
+            }
+            entry waiting{command, m_sequence++};
+            if (command.sampleTime == engineCommand::immediately || command.sampleTime <= now) {
+                // Late and untimed commands are applied right away, in the order they arrived
+                waiting.command.sampleTime = now;
+                m_immediate[(m_immediateFirst + m_immediateCount) & (capacity - 1)] = waiting;
+                m_immediateCount++;
+            } else {
+                m_timed[m_timedCount++] = waiting;
+                std::push_heap(m_timed.begin(), m_timed.begin() + m_timedCount, isLater);
+            }
+        }
+    }
+    return dropped;
+}
+
+//--------------------------------------------------------------
+
+bool commandSchedule::isLater(const entry& a, const entry& b) {
+    if (a.command.sampleTime != b.command.sampleTime) {
+        return a.command.sampleTime > b.command.sampleTime;
+    }
+    return a.sequence > b.sequence; // Commands due at the same frame keep the order they were sent in
+}
+
+//--------------------------------------------------------------
+
+const commandSchedule::entry& commandSchedule::front() const {
+    const entry& immediate = m_immediate[m_immediateFirst];
+    if (m_timedCount == 0 || (m_immediateCount > 0 && isLater(m_timed[0], immediate))) {
+        return immediate;
+    }
+    return m_timed[0];
+}
+
+//--------------------------------------------------------------
+
+bool commandSchedule::isDue(int64_t frame) const {
+    return (m_immediateCount > 0 || m_timedCount > 0) && front().command.sampleTime <= frame;
+}
+
+//--------------------------------------------------------------
+
+engineCommand commandSchedule::pop() {
+    if (&front() == &m_immediate[m_immediateFirst]) {
+        engineCommand command = m_immediate[m_immediateFirst].command;
+        m_immediateFirst = (m_immediateFirst + 1) & (capacity - 1);
+        m_immediateCount--;
+        return command;
+    }
+    engineCommand command = m_timed[0].command;
+    std::pop_heap(m_timed.begin(), m_timed.begin() + m_timedCount, isLater);
+    m_timedCount--;
+    return command;
+}
+
+//--------------------------------------------------------------
+
+uint64_t commandSchedule::getDropped() const {
+    return m_dropped;
+}
+
+//--------------------------------------------------------------
+
+size_t commandSchedule::getNumWaiting() const {
+    return m_immediateCount + m_timedCount;
+}
@@ -0,0 +1,150 @@
+//
+//  engineCommand.h
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+/*
+Engine commands are how control threads (the OSC endpoint, for example) change the audio
+engine without touching it directly. A command is a small fixed-size struct carrying the
+frame of the sample clock it should be applied at.
+
+commandQueue carries batches of commands from control threads to the audio thread. A batch
+(e.g. all messages of one OSC packet) becomes visible to the audio thread all at once, so it
+is always applied as a whole. Producers serialize among themselves with a mutex; the audio
+thread never locks.
+
+commandSchedule lives on the audio thread. It takes the batches out of the queue into fixed
+storage: untimed and late commands go into a FIFO, timed ones into a binary heap ordered by due
+time, so the metronome can apply every command on the exact frame it is due, in the order it
+was sent. A batch that does not fit in the schedule is dropped as a whole, like in the queue.
+*/
+
+// These directives are used to prevent multiple inclusions of the same header file, which
+// helps avoid redefinition errors and improves compilation efficiency:
+#ifndef engineCommand_h
+#define engineCommand_h
+
+#include <array>    // For the fixed storage
+#include <atomic>   // For the lock-free indices
+#include <cstddef>  // For size_t
+#include <cstdint>  // For int64_t
+#include <mutex>    // For serializing producers
+
+struct engineCommand {
+    // What the command does; the meaning of the arguments depends on it
+    enum class type : uint8_t {
+        transport,      // first: 1 = play, 0 = stop
+        tempo,          // value: BPM, value2: ramp time in seconds (0 = immediate), third: exponential ramp (1)
+        rhythm,         // first: beats, second: tuplets
+        step,           // first: track, second: step, third: on (1) / off (0), fourth: slot (-1 = selected)
+        selectPattern,  // first: pattern slot
+        route,          // first: track, second: destination (0 = MIDI, 1 = sampler, 2 = synth), third: voice, fourth: MIDI channel
+        bus,            // first: track, second: output bus
+        busOutput,      // first: bus, second: first output channel (-1 = muted)
+        stepWord,       // first: track, second: word, third: steps 0-31, fourth: steps 32-63 of the word;
+                        // staged and applied at the start of the next bar
+        stepParam,      // first: track, second: step, third: param, value: -1 to 1
+        pageSteps,      // first: page (see stepPattern::pageIndex()), third: steps 0-31, fourth: steps 32-63;
+                        // replaces them at once, in any slot (undo and redo in a session trace)
+        recordStep,     // first: track, second: step, third: micro-timing; a hit the live input recorded
+                        // into the pattern (see stepPattern::recordStep())
+        insert,         // first: track, second: stage (see trackInserts::stage), third: filter or dynamics
+                        // mode, value, value2: the setting (see metronome::applyInsert())
+        sendLevel,      // first: track, second: send, value: linear gain
+        sendReturn,     // first: send, second: bus, value: level in dB
+        sendResponse,   // first: send, second: name of the impulse response file (-1 = hall), value: hall
+                        // decay in seconds; recorded when the send swaps it in (see sessionTrace::addName())
+        kit             // first: name of the kit's files; recorded when the sampler swaps it in, and
+                        // swaps in the kit staged for it when applied
+    };
+
+    static constexpr int64_t immediately = -1; // Apply at the start of the next buffer
+
+    type kind = type::transport;    // What to do
+    int64_t sampleTime = immediately; // Frame of the metronome's sample clock to apply it at
+    int32_t first = 0;              // First integer argument
+    int32_t second = 0;             // Second integer argument
+    int32_t third = 0;              // Third integer argument
+    int32_t fourth = 0;             // Fourth integer argument
+    float value = 0.0f;             // First float argument
+    float value2 = 0.0f;            // Second float argument
+};
+
+//--------------------------------------------------------------
+
+class commandQueue {
+public:
+    static constexpr size_t capacity = 4096; // Commands the queue can hold (power of two)
+
+    // Adds a batch of commands; returns false (and adds nothing) if it does not fit
+    bool push(const engineCommand* commands, size_t count);
+
+    // Returns the number of commands in the oldest batch, or 0 when the queue is empty. Only
+    // meaningful when whole batches have been popped (audio thread only)
+    size_t nextBatchSize() const;
+
+    // Takes the oldest command; returns false when the queue is empty (audio thread only)
+    bool pop(engineCommand& command);
+
+    // Returns the number of batches that were dropped because the queue was full
+    uint64_t getDropped() const;
+
+    // Returns the number of commands pushed so far, for tracking how far they have got
+    size_t getNumPushed() const;
+
+private:
+    std::array<engineCommand, capacity> m_commands;  // Ring storage
+    std::array<uint32_t, capacity> m_batchSizes;     // Size of each batch, at the slot of its first command
+    std::atomic<size_t> m_writeIndex{0};             // Published by producers
+    std::atomic<size_t> m_readIndex{0};              // Advanced by the audio thread
+    std::atomic<uint64_t> m_dropped{0};              // Batches that did not fit
+    std::mutex m_producerMutex;                      // Serializes producers, never taken by the audio thread
+};
+
+//--------------------------------------------------------------
+
+class commandSchedule {
+public:
+    static constexpr size_t capacity = 4096; // Commands that can be waiting at once
+
+    // Moves everything from the queue into the schedule; batches that do not fit are dropped.
+    // Returns the number of commands dropped
+    size_t collect(commandQueue& queue, int64_t now);
+
+    // Returns true if a command is due at or before the given frame
+    bool isDue(int64_t frame) const;
+
+    // Takes the next due command
+    engineCommand pop();
+
+    // Returns the number of batches that arrived while the schedule was full
+    uint64_t getDropped() const;
+
+    // Returns the number of commands waiting to be applied
+    size_t getNumWaiting() const;
+
+private:
+    // A waiting command and the order it arrived in, which breaks ties between equal due times
+    struct entry {
+        engineCommand command;
+        uint64_t sequence = 0;
+    };
+
+    // Returns true if a is due after b, which makes the heap functions build a min-heap
+    static bool isLater(const entry& a, const entry& b);
+
+    // Returns the waiting command that is applied first
+    const entry& front() const;
+
+    std::array<entry, capacity> m_immediate;         // Untimed and late commands, a ring in arrival order
+    size_t m_immediateFirst = 0;                     // Index of the oldest untimed command
+    size_t m_immediateCount = 0;                     // Number of untimed commands
+    std::array<entry, capacity> m_timed;             // Timed commands, a binary heap on due time
+    size_t m_timedCount = 0;                         // Number of timed commands
+    uint64_t m_sequence = 0;                         // Arrival number of the next command
+    std::atomic<uint64_t> m_dropped{0};              // Batches that did not fit
+};
+
+#endif /* engineCommand_h */
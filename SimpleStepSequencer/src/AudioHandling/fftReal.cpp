@@ -0,0 +1,128 @@
+//
+//  fftReal.cpp
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+#include <cmath>
+#include "fftReal.h"
+
+//--------------------------------------------------------------
+
+void fftReal::setup(size_t size) {
+    m_size = size;
+    m_half = size / 2;
+
+    int bits = 0;
+    while (((size_t)1 << bits) < m_half) {
+        bits++;
+    }
+    m_bitReverse.resize(m_half);
+    for (size_t index = 0; index < m_half; index++) {
+        uint32_t reversed = 0;
+        for (int bit = 0; bit < bits; bit++) {
+            reversed |= ((index >> bit) & 1) << (bits - 1 - bit);
+        }
+        m_bitReverse[index] = reversed;
+    }
+
+    // Twiddles of a stage combining pairs of blocks of span values: e^(-2 pi i j / (2 span))
+    m_stageReal.assign(m_half, 0.0f);
+    m_stageImag.assign(m_half, 0.0f);
+    for (size_t span = 1; span < m_half; span *= 2) {
+        for (size_t j = 0; j < span; j++) {
+            double angle = -M_PI * j / span;
+            m_stageReal[span + j] = (float)std::cos(angle);
+            m_stageImag[span + j] = (float)std::sin(angle);
+        }
+    }
+
+    m_splitReal.resize(m_half + 1);
+    m_splitImag.resize(m_half + 1);
+    for (size_t k = 0; k <= m_half; k++) {
+        double angle = -2.0 * M_PI * k / size;
+        m_splitReal[k] = (float)std::cos(angle);
+        m_splitImag[k] = (float)std::sin(angle);
+    }
+
+    m_workReal.assign(m_half, 0.0f);
+    m_workImag.assign(m_half, 0.0f);
+}
+
+//--------------------------------------------------------------
+
+size_t fftReal::getSize() const {
+    return m_size;
+}
+
+//--------------------------------------------------------------
+
+void fftReal::forward(const float* input, float* real, float* imag) {
+    // Even samples become the real parts, odd ones the imaginary parts
+    for (size_t index = 0; index < m_half; index++) {
+        m_workReal[m_bitReverse[index]] = input[2 * index];
+        m_workImag[m_bitReverse[index]] = input[2 * index + 1];
+    }
+    transform();
+
+    // Split the spectrum of the packed values into the spectra of the even and the odd
+    // samples, and combine those into the spectrum of the block
+    for (size_t k = 0; k <= m_half; k++) {
+        size_t mirror = (m_half - k) % m_half;
+        float zReal = m_workReal[k % m_half], zImag = m_workImag[k % m_half];
+        float cReal = m_workReal[mirror], cImag = -m_workImag[mirror];
+        float evenReal = 0.5f * (zReal + cReal), evenImag = 0.5f * (zImag + cImag);
+        float oddReal = 0.5f * (zImag - cImag), oddImag = -0.5f * (zReal - cReal);
+        real[k] = evenReal + m_splitReal[k] * oddReal - m_splitImag[k] * oddImag;
+        imag[k] = evenImag + m_splitReal[k] * oddImag + m_splitImag[k] * oddReal;
+    }
+}
+
+//--------------------------------------------------------------
+
+void fftReal::inverse(const float* real, const float* imag, float* output) {
+    // Rebuild the spectrum of the packed values, conjugated, so the forward butterflies
+    // compute the inverse transform
+    for (size_t k = 0; k < m_half; k++) {
+        float xReal = real[k], xImag = imag[k];
+        float cReal = real[m_half - k], cImag = -imag[m_half - k];
+        float evenReal = xReal + cReal, evenImag = xImag + cImag;
+        float differenceReal = xReal - cReal, differenceImag = xImag - cImag;
+        float oddReal = differenceReal * m_splitReal[k] + differenceImag * m_splitImag[k];
+        float oddImag = differenceImag * m_splitReal[k] - differenceReal * m_splitImag[k];
+        m_workReal[m_bitReverse[k]] = evenReal - oddImag;
+        m_workImag[m_bitReverse[k]] = -(evenImag + oddReal);
+    }
+    transform();
+
+    for (size_t index = 0; index < m_half; index++) {
+        output[2 * index] = m_workReal[index];
+        output[2 * index + 1] = -m_workImag[index];
+    }
+}
+
+//--------------------------------------------------------------
+
+void fftReal::transform() {
+    float* workReal = m_workReal.data();
+    float* workImag = m_workImag.data();
+    for (size_t span = 1; span < m_half; span *= 2) {
+        const float* twiddleReal = m_stageReal.data() + span;
+        const float* twiddleImag = m_stageImag.data() + span;
+        for (size_t start = 0; start < m_half; start += 2 * span) {
+            float* aReal = workReal + start;
+            float* aImag = workImag + start;
+            float* bReal = aReal + span;
+            float* bImag = aImag + span;
+            for (size_t j = 0; j < span; j++) {
+                float tReal = twiddleReal[j] * bReal[j] - twiddleImag[j] * bImag[j];
+                float tImag = twiddleReal[j] * bImag[j] + twiddleImag[j] * bReal[j];
+                bReal[j] = aReal[j] - tReal;
+                bImag[j] = aImag[j] - tImag;
+                aReal[j] += tReal;
+                aImag[j] += tImag;
+            }
+        }
+    }
+}
@@ -0,0 +1,59 @@
+//
+//  fftReal.h
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+/*
+The fftReal class transforms blocks of real samples to spectra and back, for the
+convolution reverb. A block of n samples is packed into n/2 complex values, transformed
+with an iterative radix-2 FFT and split into the n/2 + 1 bins of the real spectrum.
+
+Spectra are kept as separate arrays of real and imaginary parts, so multiplying and adding
+them is a plain loop the compiler can vectorize. The twiddle factors of every stage are
+stored one after the other, so the butterflies read them in order. setup() allocates the
+tables and the work buffer; forward() and inverse() do not allocate and can run on the
+audio thread. inverse() is not normalized: forward() followed by inverse() multiplies the
+samples by the block size.
+*/
+
+// These directives are used to prevent multiple inclusions of the same header file, which
+// helps avoid redefinition errors and improves compilation efficiency:
+#ifndef fftReal_h
+#define fftReal_h
+
+#include <cstddef>  // For size_t
+#include <cstdint>  // For the bit-reversal table
+#include <vector>   // For the tables
+
+class fftReal {
+public:
+    // Prepares for blocks of size samples; size must be a power of two, at least 4
+    void setup(size_t size);
+
+    // Returns the block size
+    size_t getSize() const;
+
+    // Transforms size samples into size / 2 + 1 bins
+    void forward(const float* input, float* real, float* imag);
+
+    // Transforms size / 2 + 1 bins back into size samples, multiplied by size
+    void inverse(const float* real, const float* imag, float* output);
+
+private:
+    // Runs the butterflies over the work buffer, which holds the input in bit-reversed order
+    void transform();
+
+    size_t m_size = 0;                      // Real samples per block
+    size_t m_half = 0;                      // Complex values per block
+    std::vector<uint32_t> m_bitReverse;     // Position of every complex value after reordering
+    std::vector<float> m_stageReal;         // Twiddles of the stage with span s at s..2s-1
+    std::vector<float> m_stageImag;
+    std::vector<float> m_splitReal;         // e^(-2 pi i k / size), k = 0..size/2, for splitting
+    std::vector<float> m_splitImag;
+    std::vector<float> m_workReal;          // The complex values being transformed
+    std::vector<float> m_workImag;
+};
+
+#endif /* fftReal_h */
@@ -0,0 +1,106 @@
+//
+//  instrumentLoader.cpp
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+#include <chrono>
+#include "ofMain.h"
+#include "instrumentLoader.h"
+#include "musicPlayer.h"
+#include "factory.h"
+#include "threadTuning.h"
+
+// Constructor implementation
+instrumentLoader::instrumentLoader(musicPlayer* player) : m_player(player) {
+    // Nothing is loaded until start() is called
+}
+
+//--------------------------------------------------------------
+
+// Destructor implementation
+instrumentLoader::~instrumentLoader() {
+    stop(); // Make sure the loader thread has finished
+}
+
+//--------------------------------------------------------------
+
+void instrumentLoader::start() {
+    if (m_running) {
+        return;
+    }
+    m_running = true;
+    m_thread = std::thread(&instrumentLoader::run, this);
+}
+
+//--------------------------------------------------------------
+
+void instrumentLoader::stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_running = false;
+    }
+    m_wakeUp.notify_all();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+//--------------------------------------------------------------
+
+void instrumentLoader::loadKit(int destination, const std::vector<std::string>& files, int source) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_requests.push_back({destination, files, source});
+        m_pending++;
+    }
+    m_wakeUp.notify_one();
+}
+
+//--------------------------------------------------------------
+
+int instrumentLoader::getPending() const {
+    return m_pending;
+}
+
+//--------------------------------------------------------------
+
+void instrumentLoader::run() {
+    threadTuning::applyWorkerAffinity(); // Keep off the audio thread's cores, if configured
+
+    while (true) {
+        request next;
+        {
+            // Wake up for requests, and regularly to destroy swapped-out instruments
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wakeUp.wait_for(lock, std::chrono::milliseconds(100), [this] { return !m_running || !m_requests.empty(); });
+            if (!m_running) {
+                break;
+            }
+            if (m_requests.empty()) {
+                lock.unlock();
+                m_player->collectRetired();
+                continue;
+            }
+            next = std::move(m_requests.front());
+            m_requests.pop_front();
+        }
+        
+        // All file I/O, decoding and allocation happen here, off the audio thread
+        auto start = std::chrono::steady_clock::now();
+        auto kit = factory::createSampleInstrument(next.files);
+        kit->setSource(next.source);
+        double millis = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        
+        if (m_player->stageInstrument(next.destination, std::move(kit))) {
+            ofLogNotice("instrumentLoader") << "Kit for destination " << next.destination << " prepared in "
+                                            << millis << " ms, swapping at the next boundary";
+        } else {
+            ofLogError("instrumentLoader") << "No destination " << next.destination << " to load a kit into";
+        }
+        m_pending--;
+        m_player->collectRetired();
+    }
+    m_player->collectRetired();
+}
@@ -0,0 +1,72 @@
+//
+//  instrumentLoader.h
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+/*
+The instrumentLoader class prepares instruments on a background thread, so kits can be
+changed while playing without the audio thread waiting for the disk. A request to load a
+kit is queued; the loader thread reads and decodes the files and builds the new
+sampleInstrument, then stages it in the musicPlayer, which swaps it in on the next step or
+bar boundary. The same thread destroys the instruments that were swapped out.
+*/
+
+// These directives are used to prevent multiple inclusions of the same header file, which
+// helps avoid redefinition errors and improves compilation efficiency:
+#ifndef instrumentLoader_h
+#define instrumentLoader_h
+
+#include <atomic>               // For the running flag
+#include <condition_variable>   // For waking up the thread
+#include <deque>                // For the queue of requests
+#include <mutex>                // For guarding the queue
+#include <string>               // For file names
+#include <thread>               // For the loader thread
+#include <vector>               // For the files of a kit
+
+class musicPlayer;
+
+class instrumentLoader {
+public:
+    // Constructor that takes the music player to stage instruments in
+    instrumentLoader(musicPlayer* player);
+
+    // Destructor that stops the loader thread
+    ~instrumentLoader();
+
+    // Starts the loader thread
+    void start();
+
+    // Stops the loader thread; requests that were not loaded yet are dropped
+    void stop();
+
+    // Queues loading a kit of files in bin/data for a destination of the music player; the
+    // kit is tagged with source (see instrument::setSource())
+    void loadKit(int destination, const std::vector<std::string>& files, int source = -1);
+
+    // Returns the number of requests waiting or being loaded
+    int getPending() const;
+
+private:
+    // A queued kit
+    struct request {
+        int destination;                 // Destination of the music player to replace
+        std::vector<std::string> files;  // Voice n plays file n
+        int source;                      // Tag of the kit
+    };
+
+    // Body of the loader thread
+    void run();
+
+    musicPlayer* m_player;                  // Receives the new instruments
+    std::thread m_thread;                   // Loads and destroys instruments
+    std::atomic<bool> m_running{false};     // Keeps the thread alive
+    mutable std::mutex m_mutex;             // Guards m_requests
+    std::condition_variable m_wakeUp;       // Signals new requests
+    std::deque<request> m_requests;         // Kits waiting to be loaded
+    std::atomic<int> m_pending{0};          // Requests not finished yet
+};
+
+#endif /* instrumentLoader_h */
@@ -6,21 +6,73 @@
 //
 
 #include <stdio.h>
+#include <chrono>
+#include <cmath>
+#include <future>
+#include <thread>
 #include "metronome.h"
+#include "sampleInstrument.h"
+#include "startupTrace.h"
+#include "timelineTrace.h"
 
 // Constructor that takes a pointer to a GUI instance
-metronome::metronome(sequencerGui* seqGuiPtr, int _sampleRate) : m_seqGuiPtr(seqGuiPtr), m_sampleRate(_sampleRate) {
+metronome::metronome(sequencerGui* seqGuiPtr, int _sampleRate) : m_sampleRate(_sampleRate), m_clock(_sampleRate), m_seqGuiPtr(seqGuiPtr) {
     
-    // Choose between MIDI or Audio Instrument using the Factory class
+    // Listing and opening the MIDI ports can take a while, so it runs on a thread of its own
+    // while the rest is built. The engine cannot start without it: destination 0 also
+    // carries the MIDI clock.
+    auto midiPorts = std::async(std::launch::async, [] {
+        startupTrace::phase phase("midi ports");
+        return factory::createMidiInstrument();
+    });
     
-    // auto instrument = factory::createSampleInstrument();
-    // Or use
-    auto instrument =  factory::createMidiInstrument();
+    // Create every other instrument a track can be routed to, using the Factory class. The
+    // sampler starts without a kit; the loader reads the default one in the background.
+    std::unique_ptr<instrument> sampler;
+    std::unique_ptr<instrument> synth;
+    {
+        startupTrace::phase phase("instruments");
+        sampler = factory::createSampleInstrument(std::vector<std::string>());
+        synth = factory::createSynthInstrument();
+        m_recorder = factory::createAudioRecorder();
+        prepareOutput(4096, 2); // Stereo until the audio manager says otherwise
+        m_inserts.setup(m_sampleRate);
+    }
+    
+    // The reverbs of the sends are built by their worker, which then runs their tails
+    m_sends.setup(m_sampleRate, true);
+    m_sends.start();
+    
+    auto midi = midiPorts.get();
+    
+    // A MIDI instrument also carries the MIDI clock in master mode
+    m_clockTransport = dynamic_cast<midiTransport*>(midi.get());
+    m_clockMaster.setTransport(m_clockTransport);
+    
+    m_musicPlayer = factory::createMusicPlayer(std::move(midi)); // Create the music player with the MIDI instrument as destination 0
+    m_samplerDestination = m_musicPlayer->addInstrument(std::move(sampler));
+    m_synthDestination = m_musicPlayer->addInstrument(std::move(synth));
+    
+    // Kits are loaded and swapped in the background, starting with the default one
+    m_loader = factory::createInstrumentLoader(m_musicPlayer.get());
+    m_loader->start();
+    loadKit(sampleInstrument::defaultKit);
     
-    // Retrieve the description from the instrument
-    m_instrumentDescription = instrument->getDescription();
+    // Input channels record into the tracks in turn: 1 hi-hat, 2 snare, 3 kick, 4 hi-hat...
+    m_detector.setup(m_sampleRate);
+    for (int channel = 0; channel < onsetDetector::maxChannels; channel++) {
+        m_inputTracks[channel].store(channel % stepPattern::numTracks);
+    }
+    
+    // By default all tracks play on the drum synthesizer: hi-hat, snare and kick
+    for (int track = 0; track < stepPattern::numTracks; track++) {
+        routeTrack(track, destination::synth, track, 1);
+    }
     
-    m_musicPlayer = factory::createMusicPlayer(std::move(instrument)); // Create the music player with the instrument
+    // The GUI (if there is one) shows and edits the pattern the metronome plays
+    if (m_seqGuiPtr) {
+        m_seqGuiPtr->setPattern(&m_pattern);
+    }
 }
 
 //----------------------------------------------
@@ -39,14 +91,21 @@ void metronome::setup(int initialTempo, int initialBeatAmount, int initialTuplet
     
     m_isSetup = true;
     
-    setTempo(initialTempo); // Set the tempo
+    // The transport is off until setup() has run, so the clock is not moving yet
+    m_clock.setTicksPerBeat(m_subdivision); // One clock tick per step
+    applyTempo(initialTempo, 0.0f, false); // Set the tempo
     updateSeqGui(); // Update the GUI
+    m_history.commit(m_pattern, m_beatsToTheBar, m_subdivision); // The default groove is the first snapshot, which cannot be undone
 }
 
 //----------------------------------------------
 
 void metronome::updateSeqGui() {
-    m_seqGuiPtr->setup(m_beatsToTheBar, m_subdivision); // Update GUI with current beat and subdivision settings
+    m_pattern.setup(m_beatsToTheBar * m_subdivision); // Resize the pattern and reset it to the default groove
+    
+    if (m_seqGuiPtr) { // There is no GUI in headless mode
+        m_seqGuiPtr->setup(m_beatsToTheBar, m_subdivision); // Update GUI with current beat and subdivision settings
+    }
 }
 
 //----------------------------------------------
@@ -59,25 +118,132 @@ metronome::~metronome() {
 //----------------------------------------------
 
 void metronome::audioOut(ofSoundBuffer &buffer) {
-    if (!m_onOff) {
-        buffer.set(0.0f); // Fill the buffer with silence
-        m_bufferCounter = 0;
-        return; // Skip further processing if metronome is off
+    TIMELINE_SCOPE("metronome::audioOut");
+    size_t frames = buffer.getNumFrames();
+    int64_t bufferFrame = m_framesProcessed;
+    m_buses.begin(frames, m_sampleRate); // Silence the buses the instruments mix into
+    m_trace.beginBuffer(m_framesProcessed, frames); // Picks up a trace started or stopped
+    
+    // Remember when this buffer started, so control threads can turn wall-clock times into
+    // frames. The estimate is smoothed against callback jitter and reset after a dropout.
+    double now = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    double estimate = now - double(m_framesProcessed) / m_sampleRate;
+    double previous = m_secondsAtFrameZero.load(std::memory_order_relaxed);
+    if (previous == 0.0 || std::fabs(estimate - previous) > 0.05) {
+        m_secondsAtFrameZero.store(estimate, std::memory_order_relaxed);
     } else {
-        // Process audio when metronome is on
-        for (int i = 0; i < buffer.size(); i += 2) {
-            buffer[i] = 0.0f;     // Set left channel to silence
-            buffer[i + 1] = 0.0f; // Set right channel to silence
+        m_secondsAtFrameZero.store(previous + (estimate - previous) * 0.01, std::memory_order_relaxed);
+    }
+    if (m_clockTransport) {
+        // MIDI leaves when the audio of its frame starts playing: one buffer after the
+        // callback that made it, when the stream plays the buffer
+        double bufferStart = m_secondsAtFrameZero.load(std::memory_order_relaxed) + double(m_framesProcessed) / m_sampleRate;
+        m_clockTransport->setStreamTime(m_framesProcessed, bufferStart + double(frames) / m_sampleRate, m_sampleRate);
+    }
+    
+    // Take the commands that arrived since the last buffer; untimed ones are due right away.
+    // Dropped ones will never be applied, so they count as done
+    m_numCommandsDone += m_schedule.collect(m_commands, m_framesProcessed);
+    
+    // While stopped there are no boundaries to wait for: new kits are swapped in at once
+    if (!m_onOff) {
+        commitSwaps(0);
+        applyStagedSteps();
+    }
+    
+    if (m_clockMode == clockMode::slave) {
+        followExternalClock(); // May start or stop the transport and adjust the tempo
+    }
+    
+    // Hits on the live input, found by audioIn() for this cycle, are placed at their frame
+    const onsetDetector::onset* inputHits = m_detector.getOnsets();
+    int nextInputHit = 0;
+    
+    // Advance the clock one frame at a time so ticks land on the exact sample they are due,
+    // independent of the buffer size. Frames are counted while stopped too, so timed
+    // commands (like a start) still land on their frame.
+    for (size_t frame = 0; frame < frames; frame++) {
+        if (m_schedule.isDue(m_framesProcessed)) {
+            // All commands due at this frame are applied before it is played; a kit they
+            // swap in plays from this frame
+            m_frameInBuffer = (int)frame;
+            while (m_schedule.isDue(m_framesProcessed)) {
+                engineCommand command = m_schedule.pop();
+                m_trace.recordApplied(command, m_framesProcessed);
+                applyCommand(command);
+            }
         }
-
-        m_bufferCounter += buffer.size() / 2.0f;
-
-        // Update metronome state periodically based on buffer size
-        if (m_bufferCounter >= m_samplesPerTick) {
-            m_bufferCounter -= m_samplesPerTick;
+        if (frame == 0 || m_onOff != m_wasRunning) {
+            updateClockMaster();
+        }
+        if (!m_onOff) {
+            m_clock.reset(); // Start from the top of the bar when switched on again
+            m_numPendingHits = 0;
+            m_earlyHitsScheduled = false;
+            m_framesProcessed++;
+            continue;
+        }
+        if (m_clockMaster.isRunning()) {
+            m_clockMaster.process(m_clock.getBeatPosition(), m_framesProcessed); // MIDI clock pulses
+        }
+        double position = m_clock.getTickPosition(); // Position of this frame, before it is advanced
+        if (m_clock.advance()) {
+            m_frameInBuffer = (int)frame; // Hits of this tick are due at this frame
             update(); // Update metronome state
         }
+        if (m_numPendingHits > 0) {
+            playPendingHits((int)frame); // Steps off the grid
+        }
+        while (nextInputHit < m_numInputHits && inputHits[nextInputHit].frame <= (int)frame) {
+            recordHit(inputHits[nextInputHit++], position);
+        }
+        m_framesProcessed++;
+    }
+    m_numInputHits = 0; // Hits found while stopped are not recorded
+    
+    // Hand the hits of this buffer to the instruments, one batch per instrument, and let
+    // them render into their tracks
+    m_musicPlayer->process(m_buses);
+    
+    // Run every track through its inserts, then mix it into its bus
+    m_inserts.process(m_buses);
+    for (int track = 0; track < m_buses.getNumTracks(); track++) {
+        m_buses.mixTrack(track, m_musicPlayer->getRoute(track).bus);
+    }
+    
+    // Feed the send buses from the tracks and add their reverbs to the buses they return into.
+    // A new response is swapped in at the start of the buffer, so that is where it is traced
+    uint32_t swappedSends = m_sends.process(m_buses);
+    for (int send = 0; swappedSends != 0; send++, swappedSends >>= 1) {
+        if (swappedSends & 1) {
+            engineCommand response;
+            response.kind = engineCommand::type::sendResponse;
+            response.first = send;
+            m_sends.getPlaying(send, response.second, response.value);
+            m_trace.recordApplied(response, bufferFrame);
+        }
     }
+    
+    // Write every bus to its output channels; this fills the whole buffer
+    m_buses.interleave(buffer);
+    
+    // Hand the output to the recorder's rings; returns at once when not recording
+    m_recorder->capture(buffer, m_buses);
+    
+    // Hash the output into the session trace's checkpoint; returns at once when not tracing
+    m_trace.endBuffer(buffer);
+    
+    // Tell the control threads how far their commands have got
+    m_commandsApplied.store(m_numCommandsDone, std::memory_order_release);
+    m_commandsSettled.store(m_numCommandsDone + m_schedule.getNumWaiting(), std::memory_order_release);
+}
+
+//--------------------------------------------------------------
+
+void metronome::audioIn(ofSoundBuffer &buffer) {
+    m_detector.setThreshold(m_inputThreshold.load(std::memory_order_relaxed));
+    m_numInputHits = m_detector.process(buffer.getBuffer().data(), buffer.getNumFrames(), buffer.getNumChannels());
+    m_inputOnsets.fetch_add(m_numInputHits, std::memory_order_relaxed);
 }
 
 //--------------------------------------------------------------
@@ -93,26 +259,825 @@ void metronome::toggleOnOff(bool _onOff) {
 //--------------------------------------------------------------
 
 void metronome::setTempo(float bpm) {
-    if (m_isSetup) {
-        m_tempo = bpm;
-        m_samplesPerTick = (m_sampleRate * 60.0) / m_tempo / m_subdivision; // Calculate samples per tick
+    rampTempo(bpm, 0.0f);
+}
+
+//--------------------------------------------------------------
+
+void metronome::rampTempo(float bpm, float seconds, bool exponential) {
+    if (!m_isSetup || bpm <= 0.0f) {
+        return;
+    }
+    // The clock belongs to the audio thread, so the change goes through the command queue
+    m_tempo = bpm;
+    engineCommand tempo;
+    tempo.kind = engineCommand::type::tempo;
+    tempo.value = bpm;
+    tempo.value2 = std::max(0.0f, seconds);
+    tempo.third = exponential ? 1 : 0;
+    m_commands.push(&tempo, 1);
+}
+
+//--------------------------------------------------------------
+
+void metronome::applyTempo(float bpm, float seconds, bool exponential) {
+    m_tempo = bpm;
+    if (seconds > 0.0f) {
+        // The clock integrates the tempo curve per sample, so the glide is free of steps
+        m_clock.rampTempo(bpm, seconds, exponential ? tempoClock::rampShape::exponential
+                                                    : tempoClock::rampShape::linear);
+    } else {
+        m_clock.setTempo(bpm); // Takes effect from the next frame
     }
 }
 
 //--------------------------------------------------------------
 
 void metronome::updateRhythm(int quarters, int tuplets) {
+    m_pattern.resize(quarters * tuplets); // Keep the steps that still fit; undo brings back the rest
+    applyRhythm(quarters, tuplets);
+}
+
+//--------------------------------------------------------------
+
+void metronome::applyRhythm(int quarters, int tuplets) {
     m_beatsToTheBar = quarters;
     m_subdivision = tuplets;
-    setTempo(m_tempo); // Update tempo based on new rhythm settings
-    updateSeqGui();    // Update the GUI with new rhythm settings
+    m_clock.setTicksPerBeat(m_subdivision); // Ticks follow the new subdivision
+    if (m_seqGuiPtr) {
+        m_seqGuiPtr->setup(m_beatsToTheBar, m_subdivision); // Update the GUI with new rhythm settings
+    }
     m_subDivisionInOneBar = m_beatsToTheBar * m_subdivision; // Recalculate subdivisions per bar
     m_tick = m_subDivisionInOneBar - 1; // Reset tick count
 }
 
+//--------------------------------------------------------------
+
+bool metronome::publishSteps(const std::array<stepPattern::trackWords, stepPattern::numTracks>& steps, uint32_t trackMask) {
+    // One batch, so the audio thread stages all of it before the next bar starts
+    std::array<engineCommand, stepPattern::numTracks * stepPattern::wordsPerTrack> commands;
+    size_t count = 0;
+    for (int track = 0; track < stepPattern::numTracks; track++) {
+        if (!((trackMask >> track) & 1)) {
+            continue;
+        }
+        for (int word = 0; word < stepPattern::wordsPerTrack; word++) {
+            engineCommand& command = commands[count++];
+            command.kind = engineCommand::type::stepWord;
+            command.first = track;
+            command.second = word;
+            command.third = int32_t(uint32_t(steps[track][word]));
+            command.fourth = int32_t(uint32_t(steps[track][word] >> 32));
+        }
+    }
+    return count == 0 || m_commands.push(commands.data(), count);
+}
+
+//--------------------------------------------------------------
+
+void metronome::applyStagedSteps() {
+    for (int track = 0; track < stepPattern::numTracks; track++) {
+        for (uint64_t staged = m_stagedWords[track]; staged != 0; staged &= staged - 1) {
+            int word = __builtin_ctzll(staged);
+            m_pattern.setWord(track, word, m_stagedSteps[track][word]);
+        }
+        m_stagedWords[track] = 0;
+    }
+}
+
+//--------------------------------------------------------------
+
+void metronome::commitEdits() {
+    size_t sent = m_commands.getNumPushed();
+    size_t settled = m_commandsSettled.load(std::memory_order_acquire);
+    if (settled < sent) {
+        // Part of an edit may still be on its way, so a later call picks it up. Only what was
+        // sent by now is waited for: under continuous traffic something always is on its way
+        if (!m_commitWaiting) {
+            m_commitWaiting = true;
+            m_commitTarget = sent;
+        }
+        if (settled < m_commitTarget) {
+            return;
+        }
+    }
+    m_commitWaiting = false;
+    m_history.commit(m_pattern, m_beatsToTheBar, m_subdivision);
+}
+
+//--------------------------------------------------------------
+
+bool metronome::undo() {
+    // Edits not committed yet, including those still on their way, become a snapshot of their
+    // own, so they can be redone
+    waitForCommands();
+    m_history.commit(m_pattern, m_beatsToTheBar, m_subdivision);
+    pageWords before = readPageWords();
+    const patternHistory::snapshot* restored = m_history.undo(m_pattern);
+    if (!restored) {
+        return false;
+    }
+    applyRestore(before, *restored);
+    return true;
+}
+
+//--------------------------------------------------------------
+
+bool metronome::redo() {
+    // An edit made since the undo, even one still on its way, ends the redo branch
+    waitForCommands();
+    m_history.commit(m_pattern, m_beatsToTheBar, m_subdivision);
+    pageWords before = readPageWords();
+    const patternHistory::snapshot* restored = m_history.redo(m_pattern);
+    if (!restored) {
+        return false;
+    }
+    applyRestore(before, *restored);
+    return true;
+}
+
+//--------------------------------------------------------------
+
+metronome::pageWords metronome::readPageWords() const {
+    pageWords words;
+    for (int page = 0; page < stepPattern::numPages; page++) {
+        words[page] = m_pattern.getPageSteps(page);
+    }
+    return words;
+}
+
+//--------------------------------------------------------------
+
+void metronome::applyRestore(const pageWords& before, const patternHistory::snapshot& restored) {
+    // The steps are back already; the rhythm belongs to the audio thread, so it goes through
+    // the queue. In a trace, the pages the restore changed go with it, so the audio thread
+    // records them; setting them to what they already are changes nothing.
+    std::vector<engineCommand> commands;
+    bool rhythmChanged = restored.beats != m_beatsToTheBar || restored.tuplets != m_subdivision;
+    if (rhythmChanged) {
+        engineCommand rhythm;
+        rhythm.kind = engineCommand::type::rhythm;
+        rhythm.first = restored.beats;
+        rhythm.second = restored.tuplets;
+        commands.push_back(rhythm);
+    }
+    if (m_trace.isActive()) {
+        // A replayed rhythm change clears steps past the new end, so then every page with
+        // steps is written again
+        for (int page = 0; page < stepPattern::numPages; page++) {
+            uint64_t steps = m_pattern.getPageSteps(page);
+            if (steps != before[page] || (rhythmChanged && steps != 0)) {
+                commands.push_back(pageCommand(page));
+            }
+        }
+    }
+    if (!commands.empty() && !m_commands.push(commands.data(), commands.size())) {
+        ofLogWarning("metronome::applyRestore") << "The command queue is full; the rhythm was not restored";
+    }
+    if (!rhythmChanged && m_seqGuiPtr) {
+        m_seqGuiPtr->patternChanged(); // A rhythm change lays out the GUI again when it is applied
+    }
+}
+
+//--------------------------------------------------------------
+
+engineCommand metronome::pageCommand(int page) const {
+    uint64_t steps = m_pattern.getPageSteps(page);
+    engineCommand command;
+    command.kind = engineCommand::type::pageSteps;
+    command.first = page;
+    command.third = int32_t(uint32_t(steps));
+    command.fourth = int32_t(uint32_t(steps >> 32));
+    return command;
+}
+
+//--------------------------------------------------------------
+
+void metronome::setHistoryBudget(size_t bytes) {
+    m_history.setBudget(bytes);
+}
+
+//--------------------------------------------------------------
+
+patternHistory::stats metronome::getHistoryStats() const {
+    return m_history.getStats();
+}
+
+//--------------------------------------------------------------
+
+void metronome::setSampleRate(int sampleRate) {
+    m_sampleRate = sampleRate;
+    m_clock.setSampleRate(m_sampleRate); // Position and running ramps are carried over
+    m_detector.setup(m_sampleRate);
+    m_inserts.setup(m_sampleRate);
+    m_sends.setup(m_sampleRate); // Rebuilds the reverbs for the new rate
+}
+
+//--------------------------------------------------------------
+
+void metronome::prepareOutput(size_t maxFrames, int numChannels) {
+    if (m_recorder->isRecording()) {
+        stopRecording(); // The files cannot change format halfway
+        ofLogNotice("metronome::prepareOutput") << "Recording stopped for the new audio settings";
+    }
+    m_buses.prepare(maxFrames, numChannels, musicPlayer::maxTracks);
+    m_sends.prepare(maxFrames);
+    m_numOutputChannels = numChannels;
+}
+
+//--------------------------------------------------------------
+
+void metronome::waitForStartup() {
+    m_sends.buildPending();
+    while (m_loader->getPending() > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+//--------------------------------------------------------------
+
+bool metronome::startRecording(const std::string& path, bool stems) {
+    return m_recorder->start(ofToDataPath(path), stems, m_sampleRate, m_numOutputChannels, m_buses.getNumBuses());
+}
+
+//--------------------------------------------------------------
+
+void metronome::stopRecording() {
+    m_recorder->stop();
+}
+
+//--------------------------------------------------------------
+
+audioRecorder::stats metronome::getRecordingStats() const {
+    return m_recorder->getStats();
+}
+
+//--------------------------------------------------------------
+
+void metronome::setStepRecording(bool on) {
+    m_stepRecording = on;
+}
+
+//--------------------------------------------------------------
+
+bool metronome::isStepRecording() const {
+    return m_stepRecording;
+}
+
+//--------------------------------------------------------------
+
+void metronome::setInputTrack(int channel, int track) {
+    if (channel < 0 || channel >= onsetDetector::maxChannels) {
+        return;
+    }
+    m_inputTracks[channel].store(track >= 0 && track < stepPattern::numTracks ? track : -1);
+}
+
+//--------------------------------------------------------------
+
+void metronome::setInputThreshold(float threshold) {
+    m_inputThreshold = threshold;
+}
+
+//--------------------------------------------------------------
+
+void metronome::setInputLatency(float milliseconds) {
+    m_inputLatencyFrames = std::max(0, (int)std::lround(milliseconds * 0.001 * m_sampleRate));
+}
+
+//--------------------------------------------------------------
+
+metronome::inputStats metronome::getInputStats() const {
+    inputStats stats;
+    stats.onsets = m_inputOnsets;
+    stats.recorded = m_recordedHits;
+    stats.lastTrack = m_lastHitTrack;
+    stats.lastStep = m_lastHitStep;
+    stats.lastMicro = m_lastHitMicro;
+    return stats;
+}
+
+//--------------------------------------------------------------
+
+void metronome::setClockMode(clockMode mode) {
+    if (mode == m_clockMode) {
+        return;
+    }
+    
+    if (mode == clockMode::slave) {
+        // Listen for clock on the first MIDI input port
+        m_clockInput = factory::createMidiClockInput(m_clockSlave);
+        if (!m_clockInput->openPort(0)) {
+            ofLogError("metronome::setClockMode") << "Failed to open MIDI input port for clock!";
+        }
+    } else if (m_clockInput) {
+        m_clockInput.reset(); // Closes the input port
+    }
+    m_clockMode = mode;
+}
+
+//--------------------------------------------------------------
+
+metronome::clockMode metronome::getClockMode() const {
+    return m_clockMode;
+}
+
+//--------------------------------------------------------------
+
+stepPattern* metronome::getPattern() {
+    return &m_pattern;
+}
+
+//--------------------------------------------------------------
+
+trackInserts* metronome::getInserts() {
+    return &m_inserts;
+}
+
+//--------------------------------------------------------------
+
+sendEffects* metronome::getSends() {
+    return &m_sends;
+}
+
+//--------------------------------------------------------------
+
+bool metronome::loadImpulse(int send, const std::string& file) {
+    return m_sends.loadImpulse(send, file, m_trace.addName(file));
+}
+
+//--------------------------------------------------------------
+
+void metronome::makeHall(int send, float seconds) {
+    m_sends.makeHall(send, seconds);
+}
+
+//--------------------------------------------------------------
+
+void metronome::routeTrack(int track, destination target, int voice, int channel) {
+    musicPlayer::route trackRoute;
+    switch (target) {
+        case destination::midi:
+            trackRoute.destination = m_midiDestination;
+            break;
+        case destination::sampler:
+            trackRoute.destination = m_samplerDestination;
+            break;
+        case destination::synth:
+            trackRoute.destination = m_synthDestination;
+            break;
+    }
+    trackRoute.voice = voice;
+    trackRoute.channel = channel;
+    trackRoute.bus = m_musicPlayer->getRoute(track).bus; // Stays on its bus
+    m_musicPlayer->setRoute(track, trackRoute);
+}
+
+//--------------------------------------------------------------
+
+std::string metronome::describeRoute(int track) const {
+    musicPlayer::route trackRoute = m_musicPlayer->getRoute(track);
+    if (trackRoute.destination == m_samplerDestination) {
+        return "sampler voice " + ofToString(trackRoute.voice) + " bus " + ofToString(trackRoute.bus);
+    }
+    if (trackRoute.destination == m_synthDestination) {
+        return "synth voice " + ofToString(trackRoute.voice) + " bus " + ofToString(trackRoute.bus);
+    }
+    return "MIDI note " + ofToString(trackRoute.voice) + " channel " + ofToString(trackRoute.channel);
+}
+
+//--------------------------------------------------------------
+
+void metronome::setTrackBus(int track, int bus) {
+    if (bus < 0 || bus >= outputBuses::maxBuses) {
+        return;
+    }
+    musicPlayer::route trackRoute = m_musicPlayer->getRoute(track);
+    trackRoute.bus = bus;
+    m_musicPlayer->setRoute(track, trackRoute);
+}
+
+//--------------------------------------------------------------
+
+void metronome::setBusOutput(int bus, int firstChannel) {
+    m_buses.setBusOutput(bus, firstChannel);
+}
+
+//--------------------------------------------------------------
+
+void metronome::loadKit(const std::vector<std::string>& files) {
+    // The MIDI destination also carries the clock, so only the sampler is replaced. The kit
+    // is tagged with its files, so a session trace can record it when it is swapped in
+    m_loader->loadKit(m_samplerDestination, files, m_trace.addName(ofJoinString(files, "\n")));
+}
+
+//--------------------------------------------------------------
+
+void metronome::prepareKit(const std::string& name) {
+    loadKit(ofSplitString(name, "\n"));
+    while (m_loader->getPending() > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+//--------------------------------------------------------------
+
+void metronome::commitSwaps(int frameOffset) {
+    uint32_t swapped = m_musicPlayer->commitSwaps(frameOffset);
+    if (m_samplerDestination < 0 || !((swapped >> m_samplerDestination) & 1)) {
+        return;
+    }
+    int name = m_musicPlayer->getSource(m_samplerDestination);
+    m_kitName.store(name, std::memory_order_relaxed);
+    if (name >= 0) {
+        engineCommand kit;
+        kit.kind = engineCommand::type::kit;
+        kit.first = name;
+        m_trace.recordApplied(kit, m_framesProcessed);
+    }
+}
+
+//--------------------------------------------------------------
+
+void metronome::setSwapPoint(swapPoint point) {
+    m_swapPoint = point;
+}
+
+//--------------------------------------------------------------
+
+commandQueue* metronome::getCommandQueue() {
+    return &m_commands;
+}
+
+//--------------------------------------------------------------
+
+bool metronome::applyControl(const engineCommand& command) {
+    // The clock, the rhythm and the routing belong to the audio thread, so every change goes
+    // through the queue and is applied (and traced) at the start of the next buffer
+    engineCommand queued = command;
+    queued.sampleTime = engineCommand::immediately;
+    return m_commands.push(&queued, 1);
+}
+
+//--------------------------------------------------------------
+
+bool metronome::waitForCommands(int timeoutMillis) {
+    size_t sent = m_commands.getNumPushed();
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMillis);
+    while (m_commandsSettled.load(std::memory_order_acquire) < sent) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+//--------------------------------------------------------------
+
+bool metronome::startTrace(const std::string& path, int bufferSize) {
+    sessionTrace::header setup;
+    setup.sampleRate = (uint32_t)m_sampleRate;
+    setup.bufferSize = (uint32_t)bufferSize;
+    setup.numOutputChannels = (uint32_t)m_numOutputChannels;
+    setup.tempo = m_tempo.load();
+    setup.beats = m_beatsToTheBar;
+    setup.tuplets = m_subdivision;
+    if (!m_trace.start(ofToDataPath(path, true), setup)) {
+        return false;
+    }
+    traceState();
+    return true;
+}
+
+//--------------------------------------------------------------
+
+void metronome::traceState() {
+    // Every page is written, so a replay does not keep the default groove where the pattern
+    // was empty
+    for (int page = 0; page < stepPattern::numPages; page++) {
+        m_trace.recordState(pageCommand(page));
+    }
+    engineCommand command;
+    command.kind = engineCommand::type::selectPattern;
+    command.first = m_pattern.getSlot();
+    m_trace.recordState(command);
+    
+    // Params and micro-timing are set in the selected slot, so they follow the slot
+    int numSteps = m_pattern.getNumSteps();
+    for (int track = 0; track < stepPattern::numTracks; track++) {
+        for (int step = 0; step < numSteps; step++) {
+            int micro = m_pattern.getMicroTiming(track, step);
+            if (micro != 0 && m_pattern.isStepOn(track, step)) {
+                command = engineCommand();
+                command.kind = engineCommand::type::recordStep;
+                command.first = track;
+                command.second = step;
+                command.third = micro;
+                m_trace.recordState(command);
+            }
+            for (int param = 0; param < stepPattern::numParams; param++) {
+                float value = m_pattern.getStepParam(track, step, param);
+                if (value != 0.0f) {
+                    command = engineCommand();
+                    command.kind = engineCommand::type::stepParam;
+                    command.first = track;
+                    command.second = step;
+                    command.third = param;
+                    command.value = value;
+                    m_trace.recordState(command);
+                }
+            }
+        }
+    }
+    
+    for (int track = 0; track < stepPattern::numTracks; track++) {
+        musicPlayer::route trackRoute = m_musicPlayer->getRoute(track);
+        command = engineCommand();
+        command.kind = engineCommand::type::route;
+        command.first = track;
+        command.second = static_cast<int32_t>(trackRoute.destination == m_samplerDestination ? destination::sampler
+                                              : trackRoute.destination == m_synthDestination ? destination::synth
+                                              : destination::midi);
+        command.third = trackRoute.voice;
+        command.fourth = trackRoute.channel;
+        m_trace.recordState(command);
+        command = engineCommand();
+        command.kind = engineCommand::type::bus;
+        command.first = track;
+        command.second = trackRoute.bus;
+        m_trace.recordState(command);
+    }
+    for (int bus = 0; bus < m_buses.getNumBuses(); bus++) {
+        command = engineCommand();
+        command.kind = engineCommand::type::busOutput;
+        command.first = bus;
+        command.second = m_buses.getBusOutput(bus);
+        m_trace.recordState(command);
+    }
+    
+    // Inserts that are on, stage by stage
+    for (int track = 0; track < stepPattern::numTracks; track++) {
+        trackInserts::values inserts = m_inserts.getValues(track);
+        command = engineCommand();
+        command.kind = engineCommand::type::insert;
+        command.first = track;
+        if (inserts.gain != 0.0f) {
+            command.second = static_cast<int32_t>(trackInserts::stage::gain);
+            command.value = inserts.gain;
+            m_trace.recordState(command);
+        }
+        if (inserts.filter != trackInserts::filterMode::off) {
+            command.second = static_cast<int32_t>(trackInserts::stage::filter);
+            command.third = static_cast<int32_t>(inserts.filter);
+            command.value = inserts.cutoff;
+            command.value2 = inserts.resonance;
+            m_trace.recordState(command);
+        }
+        if (inserts.dynamics != trackInserts::dynamicsMode::off) {
+            bool compressor = inserts.dynamics == trackInserts::dynamicsMode::compressor;
+            command.second = static_cast<int32_t>(trackInserts::stage::dynamics);
+            command.third = static_cast<int32_t>(inserts.dynamics);
+            command.value = compressor ? inserts.threshold : inserts.transient;
+            command.value2 = compressor ? inserts.ratio : 0.0f;
+            m_trace.recordState(command);
+        }
+        if (inserts.drive != 0.0f) {
+            command.second = static_cast<int32_t>(trackInserts::stage::drive);
+            command.third = 0;
+            command.value = inserts.drive;
+            command.value2 = 0.0f;
+            m_trace.recordState(command);
+        }
+    }
+    
+    // The responses of the sends, where they return and how much of every track they get
+    for (int send = 0; send < sendEffects::maxSends; send++) {
+        sendEffects::source response = m_sends.getSource(send);
+        command = engineCommand();
+        command.kind = engineCommand::type::sendResponse;
+        command.first = send;
+        command.second = response.file.empty() ? -1 : m_trace.addName(response.file);
+        command.value = response.seconds;
+        m_trace.recordState(command);
+        command = engineCommand();
+        command.kind = engineCommand::type::sendReturn;
+        command.first = send;
+        command.second = m_sends.getReturnBus(send);
+        command.value = m_sends.getReturnLevel(send);
+        m_trace.recordState(command);
+        for (int track = 0; track < stepPattern::numTracks; track++) {
+            float level = m_sends.getSendLevel(track, send);
+            if (level != 0.0f) {
+                command = engineCommand();
+                command.kind = engineCommand::type::sendLevel;
+                command.first = track;
+                command.second = send;
+                command.value = level;
+                m_trace.recordState(command);
+            }
+        }
+    }
+    
+    // The kit the sampler plays
+    int kit = m_kitName.load(std::memory_order_relaxed);
+    if (kit >= 0) {
+        command = engineCommand();
+        command.kind = engineCommand::type::kit;
+        command.first = kit;
+        m_trace.recordState(command);
+    }
+    
+    command = engineCommand();
+    command.kind = engineCommand::type::transport;
+    command.first = m_onOff;
+    m_trace.recordState(command);
+}
+
+//--------------------------------------------------------------
+
+void metronome::stopTrace() {
+    m_trace.stop();
+}
+
+//--------------------------------------------------------------
+
+void metronome::flushTrace() {
+    m_trace.flush();
+}
+
+//--------------------------------------------------------------
+
+sessionTrace* metronome::getTrace() {
+    return &m_trace;
+}
+
+//--------------------------------------------------------------
+
+int64_t metronome::framesAt(double steadySeconds) const {
+    double frameZero = m_secondsAtFrameZero.load(std::memory_order_relaxed);
+    if (frameZero == 0.0) {
+        return engineCommand::immediately; // No buffer processed yet
+    }
+    return (int64_t)std::llround((steadySeconds - frameZero) * m_sampleRate);
+}
+
+//--------------------------------------------------------------
+
+void metronome::applyCommand(const engineCommand& command) {
+    m_numCommandsDone++;
+    switch (command.kind) {
+        case engineCommand::type::transport:
+            toggleOnOff(command.first != 0);
+            break;
+        case engineCommand::type::tempo:
+            if (command.value <= 0.0f) {
+                break; // A tempo of zero would stop the clock for good
+            }
+            applyTempo(command.value, command.value2, command.third != 0);
+            break;
+        case engineCommand::type::rhythm:
+            if (command.first > 0 && command.second > 0
+                && command.first * command.second <= stepPattern::maxSteps) {
+                updateRhythm(command.first, command.second);
+            }
+            break;
+        case engineCommand::type::step:
+            if (command.fourth < 0) {
+                m_pattern.setStep(command.first, command.second, command.third != 0);
+            } else {
+                m_pattern.setStepInSlot(command.fourth, command.first, command.second, command.third != 0);
+            }
+            break;
+        case engineCommand::type::selectPattern:
+            m_pattern.selectSlot(command.first);
+            break;
+        case engineCommand::type::route:
+            if (command.second >= 0 && command.second <= 2) {
+                routeTrack(command.first, static_cast<destination>(command.second), command.third, command.fourth);
+            }
+            break;
+        case engineCommand::type::bus:
+            setTrackBus(command.first, command.second);
+            break;
+        case engineCommand::type::busOutput:
+            setBusOutput(command.first, command.second);
+            break;
+        case engineCommand::type::stepWord:
+            if (command.first >= 0 && command.first < stepPattern::numTracks
+                && command.second >= 0 && command.second < stepPattern::wordsPerTrack) {
+                m_stagedSteps[command.first][command.second] = uint64_t(uint32_t(command.third))
+                                                             | uint64_t(uint32_t(command.fourth)) << 32;
+                m_stagedWords[command.first] |= uint64_t(1) << command.second;
+            }
+            break;
+        case engineCommand::type::stepParam:
+            m_pattern.setStepParam(command.first, command.second, command.third, command.value);
+            break;
+        case engineCommand::type::pageSteps:
+            m_pattern.setPageSteps(command.first, uint64_t(uint32_t(command.third)) | uint64_t(uint32_t(command.fourth)) << 32);
+            break;
+        case engineCommand::type::recordStep:
+            m_pattern.recordStep(command.first, command.second, command.third);
+            break;
+        case engineCommand::type::insert:
+            applyInsert(command);
+            break;
+        case engineCommand::type::sendLevel:
+            m_sends.setSendLevel(command.first, command.second, command.value);
+            break;
+        case engineCommand::type::sendReturn:
+            m_sends.setReturn(command.first, command.second, command.value);
+            break;
+        case engineCommand::type::sendResponse:
+            break; // Traced when the send swaps it in; a replay builds it before that buffer
+        case engineCommand::type::kit:
+            // A replay stages the kit before the buffer, so it plays from the frame it did
+            m_musicPlayer->commitSwaps(m_frameInBuffer);
+            m_kitName.store(command.first, std::memory_order_relaxed);
+            break;
+    }
+    if (m_seqGuiPtr && m_isSetup) {
+        m_seqGuiPtr->update(m_tick % m_subDivisionInOneBar); // Redraw with the new state
+    }
+}
+
+//--------------------------------------------------------------
+
+void metronome::applyInsert(const engineCommand& command) {
+    int track = command.first;
+    switch (static_cast<trackInserts::stage>(command.second)) {
+        case trackInserts::stage::gain:
+            m_inserts.setGain(track, command.value);
+            break;
+        case trackInserts::stage::filter:
+            if (command.third >= 0 && command.third <= static_cast<int>(trackInserts::filterMode::bandpass)) {
+                m_inserts.setFilter(track, static_cast<trackInserts::filterMode>(command.third), command.value, command.value2);
+            }
+            break;
+        case trackInserts::stage::dynamics:
+            if (command.third == static_cast<int>(trackInserts::dynamicsMode::compressor)) {
+                m_inserts.setCompressor(track, command.value, command.value2);
+            } else if (command.third == static_cast<int>(trackInserts::dynamicsMode::transient)) {
+                m_inserts.setTransientShaper(track, command.value);
+            } else {
+                m_inserts.bypassDynamics(track);
+            }
+            break;
+        case trackInserts::stage::drive:
+            m_inserts.setDrive(track, command.value);
+            break;
+        case trackInserts::stage::all:
+            m_inserts.reset(track);
+            break;
+    }
+}
+
+//--------------------------------------------------------------
+
+void metronome::followExternalClock() {
+    // The external transport decides whether we run
+    bool running = m_clockSlave.isRunning();
+    if (running != m_onOff) {
+        toggleOnOff(running);
+    }
+    if (!running || !m_clockSlave.isLocked()) {
+        return; // Keep the current tempo until the loop has locked
+    }
+    
+    m_tempo = (float)m_clockSlave.getTempo();
+    m_clock.setTempo(m_tempo.load());
+    
+    // Compare where the master is with where we are; large jumps are followed at once,
+    // small errors are pulled in gradually so the steps don't stutter
+    double error = m_clockSlave.getBeatPosition(midiClockSlave::now()) - m_clock.getBeatPosition();
+    double correction = std::fabs(error) > 0.25 ? error : error * 0.1;
+    m_clock.nudge(correction * m_subdivision);
+}
+
+//--------------------------------------------------------------
+
+void metronome::updateClockMaster() {
+    bool sendClock = m_clockMode == clockMode::master && m_clockTransport;
+    
+    if (sendClock && m_onOff && !m_clockMaster.isRunning()) {
+        // Start from the top when the transport starts, continue when master mode is
+        // switched on while already playing
+        if (!m_wasRunning) {
+            m_clockMaster.start(m_framesProcessed);
+        } else {
+            m_clockMaster.resume(m_framesProcessed);
+        }
+    } else if (m_clockMaster.isRunning() && (!sendClock || !m_onOff)) {
+        m_clockMaster.stop(m_framesProcessed);
+    }
+    m_wasRunning = m_onOff;
+}
+
 //----------------------------------------------
 
 void metronome::update() {
+    TIMELINE_SCOPE("metronome::update");
     if (m_isSetup) {
         m_tick++; // Increment the tick counter
         
@@ -123,27 +1088,174 @@ void metronome::update() {
         m_myRhythm.m_quarterNote = localTick / m_subdivision;
         m_myRhythm.m_tuplet = localTick % m_subdivision;
         
-        // Check if any beats should be played based on the current local tick
-        for (int i = 0; i < 3; i++) {
-            if (m_seqGuiPtr->isTickHighlighted(localTick, i)) {
-                m_musicPlayer->play(i); // Play the beat for the corresponding track
+        // Swap in new kits on the selected boundary, before this tick's hits are queued,
+        // so the hits on the boundary already play on the new kit
+        if (m_swapPoint == swapPoint::step || localTick == 0) {
+            commitSwaps(m_frameInBuffer);
+        }
+        
+        // Generated steps replace the old ones together, on the first step of a bar
+        if (localTick == 0) {
+            applyStagedSteps();
+        }
+        
+        // Check if any beats should be played based on the current local tick. Steps with a
+        // micro-timing offset are played that far off the grid: late ones within this step,
+        // early ones within the step before theirs.
+        double framesPerStep = 60.0 * m_sampleRate / (m_clock.getTempo() * m_subdivision);
+        int nextTick = (localTick + 1) % m_subDivisionInOneBar;
+        for (int i = 0; i < stepPattern::numTracks; i++) {
+            if (m_pattern.isStepOn(i, localTick)) {
+                int micro = m_pattern.getMicroTiming(i, localTick);
+                if (micro >= 0) {
+                    scheduleHit(i, localTick, framesPerStep * micro / stepPattern::microResolution);
+                } else if (!m_earlyHitsScheduled) {
+                    scheduleHit(i, localTick, 0.0); // The first step after a start cannot be early
+                }
+            }
+            int nextMicro = m_pattern.getMicroTiming(i, nextTick);
+            if (nextMicro < 0 && m_pattern.isStepOn(i, nextTick)) {
+                scheduleHit(i, nextTick, framesPerStep * (stepPattern::microResolution + nextMicro) / stepPattern::microResolution);
             }
         }
+        m_earlyHitsScheduled = true;
         
-        m_seqGuiPtr->update(localTick); // Update the sequencer GUI with the current tick
+        if (m_seqGuiPtr) {
+            m_seqGuiPtr->update(localTick); // Update the sequencer GUI with the current tick
+        }
+    }
+}
+
+//--------------------------------------------------------------
+
+void metronome::scheduleHit(int track, int step, double delayFrames) {
+    int64_t delay = std::llround(delayFrames);
+    if (delay <= 0) {
+        playHit(track, step, m_frameInBuffer); // Play the beat for the corresponding track
+        return;
+    }
+    if (m_numPendingHits < maxPendingHits) {
+        m_pendingHits[m_numPendingHits++] = {m_framesProcessed + delay, track, step};
+    }
+}
+
+//--------------------------------------------------------------
+
+void metronome::playHit(int track, int step, int frame) {
+    noteEvent event;
+    event.track = track;
+    event.frameOffset = frame;
+    for (int param = 0; param < stepPattern::numParams && param < noteEvent::numParams; param++) {
+        event.params[param] = m_pattern.getStepParam(track, step, param);
+    }
+    m_musicPlayer->play(event);
+    m_trace.hashHit(track, step, frame);
+}
+
+//--------------------------------------------------------------
+
+void metronome::playPendingHits(int frame) {
+    int kept = 0;
+    for (int i = 0; i < m_numPendingHits; i++) {
+        const pendingHit& hit = m_pendingHits[i];
+        if (hit.frame > m_framesProcessed) {
+            m_pendingHits[kept++] = hit; // Not due yet
+            continue;
+        }
+        playHit(hit.track, hit.step, frame);
+    }
+    m_numPendingHits = kept;
+}
+
+//--------------------------------------------------------------
+
+void metronome::recordHit(const onsetDetector::onset& hit, double tickPosition) {
+    int track = m_inputTracks[hit.channel].load(std::memory_order_relaxed);
+    if (!m_stepRecording.load(std::memory_order_relaxed) || track < 0 || !m_isSetup) {
+        return;
     }
+    
+    // The hit was played earlier than it was detected: by the trip through the device and
+    // the detector. Go back that far from the current position within the bar.
+    double ticksPerFrame = m_clock.getTempo() * m_subdivision / (60.0 * m_sampleRate);
+    double lateTicks = (m_inputLatencyFrames.load(std::memory_order_relaxed) + m_detector.getDetectionDelay()) * ticksPerFrame;
+    double played = m_tick % m_subDivisionInOneBar + (tickPosition - std::floor(tickPosition)) - lateTicks;
+    
+    // Quantize to the nearest step and keep the rest as micro-timing
+    double nearest = std::floor(played + 0.5);
+    int micro = (int)std::lround((played - nearest) * stepPattern::microResolution);
+    int step = ((int)nearest % m_subDivisionInOneBar + m_subDivisionInOneBar) % m_subDivisionInOneBar;
+    
+    // Recorded like a command, so a replay of the session records the same step without the input
+    engineCommand recorded;
+    recorded.kind = engineCommand::type::recordStep;
+    recorded.first = track;
+    recorded.second = step;
+    recorded.third = micro;
+    m_trace.recordApplied(recorded, m_framesProcessed);
+    m_pattern.recordStep(track, step, micro);
+    
+    m_recordedHits.fetch_add(1, std::memory_order_relaxed);
+    m_lastHitTrack.store(track, std::memory_order_relaxed);
+    m_lastHitStep.store(step, std::memory_order_relaxed);
+    m_lastHitMicro.store(m_pattern.getMicroTiming(track, step), std::memory_order_relaxed);
 }
 
 //--------------------------------------------------------------
 
 void metronome::draw() {
+    m_drawnState = getDisplayState();
     ofSetColor(0, 0, 0); // Set text color to black
     
-    // Draw the instrument description on the screen
-    ofDrawBitmapString(m_instrumentDescription, 10, 125);
+    // Draw the description of every instrument on the screen
+    for (int i = 0; i < m_musicPlayer->getNumInstruments(); i++) {
+        ofDrawBitmapString(m_musicPlayer->getDescription(i), 10, 113 + i * 12);
+    }
     
     // Draw the current rhythm data on the screen
     ofDrawBitmapString("bar:         " + ofToString(m_myRhythm.m_bar + 1), 50, 150);
     ofDrawBitmapString("quarterNote: " + ofToString(m_myRhythm.m_quarterNote + 1), 50, 160);
     ofDrawBitmapString("tuplet:      " + ofToString(m_myRhythm.m_tuplet + 1), 50, 170);
+    
+    // Show how well we follow an external clock
+    if (m_clockMode == clockMode::slave) {
+        midiClockSlave::stats clockStats = m_clockSlave.getStats();
+        std::string status = clockStats.locked ? "locked" : "searching";
+        ofDrawBitmapString("clock in:    " + status + " " + ofToString(clockStats.tempo, 2) + " BPM, jitter "
+                           + ofToString(clockStats.jitterMs, 2) + " ms, lock time "
+                           + ofToString(clockStats.lockTimeSeconds, 2) + " s", 50, 185);
+    }
+}
+
+//--------------------------------------------------------------
+
+bool metronome::needsRedraw() const {
+    return !(getDisplayState() == m_drawnState);
+}
+
+//--------------------------------------------------------------
+
+metronome::displayState metronome::getDisplayState() const {
+    displayState state;
+    state.bar = m_myRhythm.m_bar;
+    state.quarterNote = m_myRhythm.m_quarterNote;
+    state.tuplet = m_myRhythm.m_tuplet;
+    state.descriptions = m_musicPlayer->getDescriptionVersion();
+    state.slave = m_clockMode == clockMode::slave;
+    if (state.slave) {
+        midiClockSlave::stats clockStats = m_clockSlave.getStats();
+        state.locked = clockStats.locked;
+        state.tempo = std::lround(clockStats.tempo * 100);  // Shown with two decimals
+        state.jitter = std::lround(clockStats.jitterMs * 100);
+        state.lockTime = std::lround(clockStats.lockTimeSeconds * 100);
+    }
+    return state;
+}
+
+//--------------------------------------------------------------
+
+bool metronome::displayState::operator==(const displayState& other) const {
+    return bar == other.bar && quarterNote == other.quarterNote && tuplet == other.tuplet
+           && descriptions == other.descriptions && slave == other.slave && locked == other.locked
+           && tempo == other.tempo && jitter == other.jitter && lockTime == other.lockTime;
 }
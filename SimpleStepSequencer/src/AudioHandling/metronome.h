@@ -22,15 +22,36 @@ drawing current rhythm information on-screen.
 #include "sequencerGui.h"    // Forward declaration of sequencerGui class
 #include "musicPlayer.h"     // Forward declaration of musicPlayer class
 #include "factory.h"         // Forward declaration of factory class (though not used directly here)
+#include "tempoClock.h"      // Sample-accurate musical time and tempo ramps
+#include "midiClock.h"       // MIDI clock master and slave
+#include "stepPattern.h"     // The steps that are played
+#include "patternHistory.h"  // Undo and redo of pattern edits
+#include "engineCommand.h"   // Timed commands from control threads
+#include "instrumentLoader.h" // Prepares new kits in the background
+#include "outputBuses.h"     // Buses the instruments render into, and the output channel map
+#include "trackInserts.h"    // Gain, filter, dynamics and saturation of every track
+#include "sendEffects.h"     // Send buses with convolution reverbs
+#include "audioRecorder.h"   // Records the output and the stems
+#include "onsetDetector.h"   // Finds hits in the live input
+#include "sessionTrace.h"    // Records the inputs of a session for replay
+#include <array>             // For the scheduled hits and the input map
+#include <atomic>            // For std::atomic
 #include <memory>            // For std::unique_ptr
 
 class metronome {
     
 public:
+    // Where the metronome takes its timing from, and whether it sends MIDI clock
+    enum class clockMode {
+        internal,   // Runs on its own tempo, no clock is sent
+        master,     // Runs on its own tempo and sends MIDI clock through the MIDI instrument
+        slave       // Follows tempo, phase and transport of an incoming MIDI clock
+    };
+    
     // Sets up the metronome with initial tempo, beat amount, and tuplets
     void setup(int initialTempo, int initialBeatAmount, int initialTupletAmount);
     
-    // Updates the sequencer GUI (if necessary) based on metronome state
+    // Resets the pattern to the current rhythm and updates the sequencer GUI (if there is one)
     void updateSeqGui();
     
     // Updates the metronome's internal state
@@ -39,18 +60,191 @@ public:
     // Processes audio data to generate metronome ticks
     void audioOut(ofSoundBuffer &buffer);
     
+    // Looks for hits in a buffer of live input; called before audioOut() in the same cycle
+    void audioIn(ofSoundBuffer &buffer);
+    
     // Toggles the metronome on or off
     void toggleOnOff(bool _onOff);
     
-    // Sets the tempo of the metronome
+    // Sets the tempo of the metronome; the audio thread applies it at the next buffer
     void setTempo(float bpm);
     
-    // Updates the rhythm configuration of the metronome
+    // Glides the tempo to bpm over the given number of seconds, from the next buffer on
+    void rampTempo(float bpm, float seconds, bool exponential = false);
+    
+    // Updates the rhythm configuration of the metronome; the steps that still fit are kept
     void updateRhythm(int quarters, int subdivision);
     
+    // Changes the sample rate while keeping the musical position (stream must be stopped)
+    void setSampleRate(int sampleRate);
+    
+    // Prepares the output buses for buffers of up to maxFrames and an output with
+    // numChannels channels (stream must be stopped)
+    void prepareOutput(size_t maxFrames, int numChannels);
+    
+    // Waits until the parts built in the background at startup (the default kit and the
+    // reverbs) are ready, so an offline render sounds the same every time
+    void waitForStartup();
+    
+    // Selects the clock mode; slave mode opens the first MIDI input port
+    void setClockMode(clockMode mode);
+    
+    // Returns the current clock mode
+    clockMode getClockMode() const;
+    
+    // Provides access to the pattern the metronome plays
+    stepPattern* getPattern();
+    
+    // Replaces the steps of the tracks in trackMask (bit n for track n) in the selected slot
+    // with generated words (see patternGenerator), all at the start of the next bar, or at
+    // the next buffer while stopped. Returns false if the command queue is full.
+    bool publishSteps(const std::array<stepPattern::trackWords, stepPattern::numTracks>& steps, uint32_t trackMask);
+    
+    // Takes an undo snapshot of the pattern edits made since the previous call, from any
+    // thread (control thread; the audio manager calls it on every update). While commands are
+    // on their way to the audio thread it waits for them over the next calls, so a rhythm
+    // change and its pages are not split over two snapshots; it waits only for what was sent
+    // when it started waiting, so continuous traffic does not hold off the snapshots.
+    void commitEdits();
+    
+    // Undoes the latest pattern edit or rhythm change, including edits still on their way to
+    // the audio thread; returns false if there is none (control thread)
+    bool undo();
+    
+    // Redoes the latest undone edit; returns false if there is none (control thread)
+    bool redo();
+    
+    // Sets how much memory the undo history may take, in bytes (control thread)
+    void setHistoryBudget(size_t bytes);
+    
+    // Returns the counters of the undo history (control thread)
+    patternHistory::stats getHistoryStats() const;
+    
+    // Provides access to the insert chains of the tracks
+    trackInserts* getInserts();
+    
+    // Provides access to the send buses
+    sendEffects* getSends();
+    
+    // Loads an impulse response from a WAV file in bin/data into a send, like
+    // sendEffects::loadImpulse(), tagged so a session trace records it when it is swapped in
+    // (control thread)
+    bool loadImpulse(int send, const std::string& file);
+    
+    // Gives a send a generated hall, like sendEffects::makeHall() (control thread)
+    void makeHall(int send, float seconds);
+    
+    // Provides access to the queue control threads send timed commands through
+    commandQueue* getCommandQueue();
+    
+    // Sends a command from a control thread (GUI, console) to the audio thread, which applies
+    // it at the start of the next buffer and records it in a session trace. Returns false if
+    // the command queue is full; the next buffer empties it (control thread)
+    bool applyControl(const engineCommand& command);
+
+    // Waits until the audio thread has applied every command sent so far, or scheduled it for
+    // a later frame if it is timed; returns false if no buffer was processed in time (control thread)
+    bool waitForCommands(int timeoutMillis = 200);
+    
+    // Starts recording a session trace into a file, for buffers of bufferSize frames
+    bool startTrace(const std::string& path, int bufferSize);
+    
+    // Stops the session trace and finishes the file
+    void stopTrace();
+    
+    // Writes what the session trace recorded so far to its file (control thread)
+    void flushTrace();
+    
+    // Provides access to the session trace
+    sessionTrace* getTrace();
+    
+    // Converts a std::chrono::steady_clock time in seconds to a frame of the sample clock
+    int64_t framesAt(double steadySeconds) const;
+    
     // Draws the metronome's visual representation
     void draw();
     
+    // Returns true if draw() would show something different from the last time it was called
+    bool needsRedraw() const;
+    
+    // Instruments a track can be routed to
+    enum class destination {
+        midi,       // External MIDI device, voice = note
+        sampler,    // Sample player, voice = 0 hi-hat, 1 snare, 2 kick
+        synth       // Drum synthesizer, voice = 0 hi-hat, 1 snare, 2 kick, 3 clap, 4 tom
+    };
+    
+    // Routes a track to an instrument; safe to call while playing
+    void routeTrack(int track, destination target, int voice, int channel = 1);
+    
+    // Describes where a track is routed, for display
+    std::string describeRoute(int track) const;
+    
+    // Renders a track into an output bus, e.g. to send it to the desk as a stem; safe to
+    // call while playing
+    void setTrackBus(int track, int bus);
+    
+    // Sends a bus to output channels firstChannel and firstChannel + 1 (-1 mutes it); safe
+    // to call while playing
+    void setBusOutput(int bus, int firstChannel);
+    
+    // Starts recording the output to a WAV file (in bin/data unless the path is absolute),
+    // and with stems every bus to a file of its own
+    bool startRecording(const std::string& path, bool stems);
+    
+    // Stops recording and finishes the files
+    void stopRecording();
+    
+    // Returns the counters of the recorder
+    audioRecorder::stats getRecordingStats() const;
+    
+    // Counters of the live input
+    struct inputStats {
+        uint64_t onsets = 0;    // Hits detected on the input
+        uint64_t recorded = 0;  // Hits recorded into the pattern
+        int lastTrack = -1;     // Where the latest recorded hit went
+        int lastStep = -1;
+        int lastMicro = 0;      // Its micro-timing, in 1/stepPattern::microResolution of a step
+    };
+    
+    // Records hits on the live input into the pattern while playing: each hit switches on
+    // the nearest step of its track and keeps how far off the grid it was played
+    void setStepRecording(bool on);
+    
+    // Returns true while step recording
+    bool isStepRecording() const;
+    
+    // Records hits on an input channel into a track (-1 ignores the channel)
+    void setInputTrack(int channel, int track);
+    
+    // Sets how loud a hit on the input must be (linear, 0-1)
+    void setInputThreshold(float threshold);
+    
+    // Sets the round-trip latency of the device, from output to input, so hits are placed
+    // where they were played along to
+    void setInputLatency(float milliseconds);
+    
+    // Returns the counters of the live input
+    inputStats getInputStats() const;
+    
+    // Where a new kit may be swapped in
+    enum class swapPoint {
+        step,       // On the next step
+        bar         // At the start of the next bar
+    };
+    
+    // Loads a new kit for the sampler in the background (voice n plays file n, from bin/data)
+    // and swaps it in at the selected swap point, without interrupting playback. A session
+    // trace records the kit at the frame it is swapped in (control thread)
+    void loadKit(const std::vector<std::string>& files);
+    
+    // Loads the kit of a name a session trace recorded, and waits until it is staged, so the
+    // kit command that follows swaps it in (control thread, replays)
+    void prepareKit(const std::string& name);
+    
+    // Selects where new kits are swapped in
+    void setSwapPoint(swapPoint point);
+    
     // Defines a struct to hold rhythm information
     struct m_rhythm {
         int m_bar;          // Current bar in the rhythm
@@ -62,6 +256,7 @@ public:
     m_rhythm m_myRhythm;
     
     // Constructor that initializes metronome with a pointer to a sequencerGui instance
+    // (nullptr when running without a GUI)
     metronome(sequencerGui* seqGuiPtr, int sampleRate);
     
     // Destructor to handle cleanup
@@ -70,19 +265,150 @@ public:
 private:
     bool m_isSetup = false;         // Flag to indicate if metronome is set up
     bool m_onOff = false;           // Flag to indicate if metronome is active
-    int m_bufferCounter;            // Counter to keep track of audio buffer samples
     int m_sampleRate;               // Sample rate for audio processing
-    float m_samplesPerTick;         // Number of samples per metronome tick
-    float m_tempo;                  // Tempo in beats per minute
+    std::atomic<float> m_tempo{120.0f}; // Tempo in beats per minute, or the tempo it is heading to
+    tempoClock m_clock;             // Keeps the musical position; replaces the old buffer counter
+    int64_t m_framesProcessed = 0;  // Frames processed since construction, used to stamp MIDI
+    bool m_wasRunning = false;      // Running state at the previous buffer, to detect start/stop
+    int m_frameInBuffer = 0;        // Frame of the current buffer the tick being played falls on
     int m_tick;                     // Current tick count
-    int m_subdivision;              // Subdivision of beats
+    std::atomic<int> m_subdivision{4}; // Subdivision of beats; written by the audio thread, read by the history
     int m_subDivisionInOneBar;      // Number of subdivisions per bar
-    int m_beatsToTheBar;            // Number of beats in one bar
-    string m_instrumentDescription; // String to contain instrument-description
+    std::atomic<int> m_beatsToTheBar{4}; // Number of beats in one bar; written by the audio thread, read by the history
+    
+    std::unique_ptr<musicPlayer> m_musicPlayer; // Pointer to a musicPlayer instance, owns all instruments
+    int m_midiDestination = 0;      // Index of the MIDI instrument in the music player
+    int m_samplerDestination = -1;  // Index of the sample instrument in the music player
+    int m_synthDestination = -1;    // Index of the drum synthesizer in the music player
+    std::unique_ptr<instrumentLoader> m_loader;  // Builds new kits; declared after m_musicPlayer so it stops first
+    std::atomic<swapPoint> m_swapPoint{swapPoint::bar}; // Where new kits are swapped in
+    std::atomic<int> m_kitName{-1}; // Trace name of the kit the sampler plays, -1 until one is swapped in
+    outputBuses m_buses;            // Tracks the instruments render into, mixed into buses and written to the device buffer
+    trackInserts m_inserts;         // Insert chain of every track (audio thread)
+    sendEffects m_sends;            // Send buses fed from the tracks, returning into the buses
+    int m_numOutputChannels = 2;    // Channels of the device buffer
+    std::unique_ptr<audioRecorder> m_recorder;   // Copies the output to disk while recording
+    
+    // Hits of steps played off the grid, waiting for their frame (audio thread)
+    struct pendingHit {
+        int64_t frame;  // Frame of the sample clock the hit is due at
+        int track;      // Track it comes from
+        int step;       // Step it comes from, for its params
+    };
+    static constexpr int maxPendingHits = 64;
+    std::array<pendingHit, maxPendingHits> m_pendingHits;
+    int m_numPendingHits = 0;
+    bool m_earlyHitsScheduled = false;  // False until the first step after a start has played
+    
+    // Live input
+    onsetDetector m_detector;           // Finds hits in the input (audio thread)
+    int m_numInputHits = 0;             // Hits of the latest input buffer, not placed yet
+    std::atomic<bool> m_stepRecording{false};
+    std::array<std::atomic<int>, onsetDetector::maxChannels> m_inputTracks; // Track of every input channel
+    std::atomic<float> m_inputThreshold{0.05f};
+    std::atomic<int> m_inputLatencyFrames{0};
+    std::atomic<uint64_t> m_inputOnsets{0};
+    std::atomic<uint64_t> m_recordedHits{0};
+    std::atomic<int> m_lastHitTrack{-1};
+    std::atomic<int> m_lastHitStep{-1};
+    std::atomic<int> m_lastHitMicro{0};
+    
+    // What draw() shows, compared to tell when it has to draw again
+    struct displayState {
+        int bar = -1;               // Rhythm position
+        int quarterNote = -1;
+        int tuplet = -1;
+        uint32_t descriptions = 0;  // See musicPlayer::getDescriptionVersion()
+        bool slave = false;         // Clock stats are shown, rounded as they are shown
+        bool locked = false;
+        long tempo = 0;
+        long jitter = 0;
+        long lockTime = 0;
+        
+        bool operator==(const displayState& other) const;
+    };
+    
+    // Returns what draw() would show now
+    displayState getDisplayState() const;
+    
+    // Sets the rhythm without touching the pattern
+    void applyRhythm(int quarters, int subdivision);
+    
+    // Hands the tempo, or a glide to it, to the clock (audio thread, or while the clock is
+    // stopped in setup())
+    void applyTempo(float bpm, float seconds, bool exponential);
+    
+    
+    // The steps of every page of the pattern
+    using pageWords = std::array<uint64_t, stepPattern::numPages>;
+    
+    // Returns the steps of every page of the pattern
+    pageWords readPageWords() const;
+    
+    // Sends the rhythm of a restored snapshot to the audio thread, with the pages that differ
+    // from before when tracing, so the trace records them; redraws the GUI
+    void applyRestore(const pageWords& before, const patternHistory::snapshot& restored);
+    
+    // Returns a command that sets the current steps of a page
+    engineCommand pageCommand(int page) const;
+    
+    // Records the pattern, routing, inserts, sends, kit and transport into a session trace
+    // that just started, so a replay starts from the same state (though from the top of the bar)
+    void traceState();
+    
+    // Pulls tempo, phase and transport towards the incoming MIDI clock (slave mode)
+    void followExternalClock();
+    
+    // Sends start/stop to the MIDI clock master when the transport changes (audio thread)
+    void updateClockMaster();
+    
+    // Plays the hit of a step after the given number of frames (audio thread)
+    void scheduleHit(int track, int step, double delayFrames);
+    
+    // Plays the hit of a step at a frame of the buffer, with the step's params (audio thread)
+    void playHit(int track, int step, int frame);
+    
+    // Plays the scheduled hits that are due at this frame of the buffer (audio thread)
+    void playPendingHits(int frame);
+    
+    // Records a hit on the input into the pattern, at the given clock position (audio thread)
+    void recordHit(const onsetDetector::onset& hit, double tickPosition);
+    
+    // Applies a command from the command queue (audio thread)
+    void applyCommand(const engineCommand& command);
+    
+    // Applies an insert command to the inserts of its track (audio thread)
+    void applyInsert(const engineCommand& command);
+    
+    // Swaps in staged instruments at a frame of the buffer, and records a new kit in the
+    // session trace (audio thread)
+    void commitSwaps(int frameOffset);
+    
+    // Writes the step words staged for the next bar into the pattern (audio thread)
+    void applyStagedSteps();
+    
+    std::atomic<clockMode> m_clockMode{clockMode::internal}; // Selected clock mode
+    midiClockMaster m_clockMaster;                   // Sends MIDI clock in master mode
+    midiClockSlave m_clockSlave;                     // Locks onto MIDI clock in slave mode
+    std::unique_ptr<midiClockInput> m_clockInput;    // MIDI input feeding the slave
+    midiTransport* m_clockTransport = nullptr;       // Port of the MIDI instrument, if any
     
-    std::unique_ptr<musicPlayer> m_musicPlayer; // Pointer to a musicPlayer instance
+    commandQueue m_commands;       // Commands sent by control threads
+    commandSchedule m_schedule;    // Received commands waiting for their frame (audio thread)
+    size_t m_numCommandsDone = 0;  // Commands applied, or dropped by the schedule (audio thread)
+    std::atomic<size_t> m_commandsApplied{0}; // m_numCommandsDone as of the last finished buffer
+    std::atomic<size_t> m_commandsSettled{0}; // The same, plus the commands waiting for a later frame
+    std::atomic<double> m_secondsAtFrameZero{0.0}; // Steady clock time of frame 0, for framesAt()
+    std::array<stepPattern::trackWords, stepPattern::numTracks> m_stagedSteps{}; // Generated steps waiting for the next bar (audio thread)
+    std::array<uint64_t, stepPattern::numTracks> m_stagedWords{};             // Bit n set if word n of a track is staged
     
-    sequencerGui* m_seqGuiPtr;     // Pointer to the sequencerGui instance used for GUI updates
+    sessionTrace m_trace;          // Records the inputs of the session, when started
+    stepPattern m_pattern;         // Steps of every track, shared with the GUI
+    patternHistory m_history;      // Snapshots of the pattern for undo (control thread)
+    bool m_commitWaiting = false;  // commitEdits() is waiting for commands in flight (control thread)
+    size_t m_commitTarget = 0;     // Commands sent when it started waiting (control thread)
+    sequencerGui* m_seqGuiPtr;     // Pointer to the sequencerGui instance used for GUI updates (may be nullptr)
+    displayState m_drawnState;     // What the latest draw() showed (GUI thread)
 };
 
 #endif /* metronome_h */
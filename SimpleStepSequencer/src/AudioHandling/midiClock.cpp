@@ -0,0 +1,352 @@
+//
+//  midiClock.cpp
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include "midiClock.h"
+#include "tempoClock.h"
+
+//--------------------------------------------------------------
+// midiClockMaster
+//--------------------------------------------------------------
+
+void midiClockMaster::setTransport(midiTransport* transport) {
+    m_transport = transport;
+}
+
+//--------------------------------------------------------------
+
+void midiClockMaster::start(int64_t sampleTime) {
+    sendStatus(midiClockStatus::start, sampleTime);
+    m_nextPulse = 0; // The first pulse after Start marks the first beat
+    m_running = true;
+}
+
+//--------------------------------------------------------------
+
+void midiClockMaster::stop(int64_t sampleTime) {
+    sendStatus(midiClockStatus::stop, sampleTime);
+    m_running = false;
+}
+
+//--------------------------------------------------------------
+
+void midiClockMaster::resume(int64_t sampleTime) {
+    sendStatus(midiClockStatus::resume, sampleTime);
+    m_running = true;
+}
+
+//--------------------------------------------------------------
+
+void midiClockMaster::process(double beatPosition, int64_t sampleTime) {
+    if (!m_running) {
+        return;
+    }
+
+    // Send a pulse on the first frame at or after each 1/24th of a beat
+    double pulsePosition = beatPosition * pulsesPerQuarter;
+    if (pulsePosition >= (double)m_nextPulse) {
+        sendStatus(midiClockStatus::clock, sampleTime);
+        m_nextPulse = (int64_t)std::floor(pulsePosition) + 1;
+    }
+}
+
+//--------------------------------------------------------------
+
+bool midiClockMaster::isRunning() const {
+    return m_running;
+}
+
+//--------------------------------------------------------------
+
+void midiClockMaster::sendStatus(unsigned char status, int64_t sampleTime) {
+    if (m_transport) {
+        m_transport->sendMidiBytes(&status, 1, sampleTime);
+    }
+}
+
+//--------------------------------------------------------------
+// midiClockSlave
+//--------------------------------------------------------------
+
+midiClockSlave::midiClockSlave(double bandwidthHz) : m_bandwidth(bandwidthHz) {
+}
+
+//--------------------------------------------------------------
+
+void midiClockSlave::setBandwidth(double bandwidthHz) {
+    if (bandwidthHz > 0.0) {
+        m_bandwidth = bandwidthHz;
+    }
+}
+
+//--------------------------------------------------------------
+
+void midiClockSlave::receive(unsigned char status, double seconds) {
+    switch (status) {
+        case midiClockStatus::clock:
+            pulse(seconds);
+            break;
+        case midiClockStatus::start:
+            // Start over from the first beat; the loop has to lock again
+            m_pulseCount = 0;
+            m_goodPulses = 0;
+            m_locked = false;
+            m_lockTime = -1.0;
+            m_jitterSquared = 0.0;
+            m_sharedRunning.store(true);
+            break;
+        case midiClockStatus::resume:
+            m_sharedRunning.store(true);
+            break;
+        case midiClockStatus::stop:
+            m_sharedRunning.store(false);
+            break;
+        default:
+            return; // Not a clock or transport message
+    }
+    publish();
+}
+
+//--------------------------------------------------------------
+
+void midiClockSlave::pulse(double seconds) {
+    m_pulseCount++;
+
+    if (m_pulseCount == 1) {
+        // The first pulse only gives a phase reference
+        m_firstPulse = seconds;
+        m_filteredTime = seconds;
+        m_lastPulse = seconds;
+        return;
+    }
+
+    if (m_pulseCount == 2 || seconds - m_lastPulse > 0.5) {
+        // The second pulse (or the first one after a stalled clock) gives the initial period
+        if (m_pulseCount == 2) {
+            m_period = seconds - m_lastPulse;
+        }
+        m_filteredTime = seconds;
+        m_predicted = seconds + m_period;
+        m_lastPulse = seconds;
+        m_goodPulses = 0;
+        m_locked = false;
+        return;
+    }
+    m_lastPulse = seconds;
+
+    // Second-order loop: the phase term corrects the pulse time, the integral term the period.
+    // The loop runs wide open until it has locked, then narrows to filter the jitter.
+    double error = seconds - m_predicted;
+    double bandwidth = m_locked ? m_bandwidth : m_bandwidth * 8.0;
+    double omega = std::fmin(2.0 * M_PI * bandwidth * m_period, 0.7);
+    double b = std::sqrt(2.0) * omega;
+    double c = omega * omega;
+
+    m_filteredTime = m_predicted + b * error;
+    m_period += c * error;
+    m_predicted = m_filteredTime + m_period;
+
+    // Running mean of the squared error gives the RMS jitter of the incoming clock
+    m_jitterSquared += 0.02 * (error * error - m_jitterSquared);
+
+    // Lock once a full beat of pulses has arrived close to where they were predicted
+    if (std::fabs(error) < 0.25 * m_period) {
+        m_goodPulses++;
+    } else {
+        m_goodPulses = 0;
+    }
+    if (!m_locked && m_goodPulses >= midiClockMaster::pulsesPerQuarter) {
+        m_locked = true;
+        m_lockTime = seconds - m_firstPulse;
+    } else if (m_locked && std::fabs(error) > 0.5 * m_period) {
+        m_locked = false; // The master jumped; follow it with the wide loop again
+    }
+}
+
+//--------------------------------------------------------------
+
+void midiClockSlave::publish() {
+    // Odd sequence numbers tell readers that an update is in progress
+    m_sequence.fetch_add(1, std::memory_order_acq_rel);
+    m_sharedTime.store(m_filteredTime, std::memory_order_relaxed);
+    m_sharedPeriod.store(m_period, std::memory_order_relaxed);
+    m_sharedPulses.store(m_pulseCount, std::memory_order_relaxed);
+    m_sharedLocked.store(m_locked, std::memory_order_relaxed);
+    m_sharedLockTime.store(m_lockTime, std::memory_order_relaxed);
+    m_sharedJitter.store(std::sqrt(m_jitterSquared), std::memory_order_relaxed);
+    m_sequence.fetch_add(1, std::memory_order_release);
+}
+
+//--------------------------------------------------------------
+
+bool midiClockSlave::isRunning() const {
+    return m_sharedRunning.load();
+}
+
+//--------------------------------------------------------------
+
+bool midiClockSlave::isLocked() const {
+    return m_sharedLocked.load();
+}
+
+//--------------------------------------------------------------
+
+double midiClockSlave::getTempo() const {
+    double period = m_sharedPeriod.load();
+    if (period <= 0.0) {
+        return 0.0; // No tempo known yet
+    }
+    return 60.0 / (period * midiClockMaster::pulsesPerQuarter);
+}
+
+//--------------------------------------------------------------
+
+double midiClockSlave::getBeatPosition(double seconds) const {
+    double time, period;
+    int64_t pulses;
+    unsigned before, after;
+
+    // Retry until a consistent snapshot has been read
+    do {
+        before = m_sequence.load(std::memory_order_acquire);
+        time = m_sharedTime.load(std::memory_order_relaxed);
+        period = m_sharedPeriod.load(std::memory_order_relaxed);
+        pulses = m_sharedPulses.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = m_sequence.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+
+    if (pulses == 0 || period <= 0.0) {
+        return 0.0;
+    }
+
+    // Pulse n (counting from zero) sits at beat n / 24; interpolate from the latest one
+    double pulsePosition = (double)(pulses - 1) + (seconds - time) / period;
+    return pulsePosition / midiClockMaster::pulsesPerQuarter;
+}
+
+//--------------------------------------------------------------
+
+midiClockSlave::stats midiClockSlave::getStats() const {
+    stats snapshot;
+    snapshot.running = m_sharedRunning.load();
+    snapshot.locked = m_sharedLocked.load();
+    snapshot.tempo = getTempo();
+    snapshot.lockTimeSeconds = m_sharedLockTime.load();
+    snapshot.jitterMs = m_sharedJitter.load() * 1000.0;
+    snapshot.pulses = m_sharedPulses.load();
+    return snapshot;
+}
+
+//--------------------------------------------------------------
+
+double midiClockSlave::now() {
+    auto sinceEpoch = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration<double>(sinceEpoch).count();
+}
+
+//--------------------------------------------------------------
+// midiClockInput
+//--------------------------------------------------------------
+
+midiClockInput::midiClockInput(midiClockSlave& slave) : m_slave(slave) {
+}
+
+//--------------------------------------------------------------
+
+midiClockInput::~midiClockInput() {
+    closePort();
+}
+
+//--------------------------------------------------------------
+
+bool midiClockInput::openPort(int portIndex) {
+    if (!m_midiIn.openPort(portIndex)) {
+        return false;
+    }
+    m_midiIn.ignoreTypes(true, false, true); // Keep timing messages, drop sysex and active sensing
+    m_midiIn.addListener(this);
+    return true;
+}
+
+//--------------------------------------------------------------
+
+void midiClockInput::closePort() {
+    m_midiIn.removeListener(this);
+    m_midiIn.closePort();
+}
+
+//--------------------------------------------------------------
+
+void midiClockInput::newMidiMessage(ofxMidiMessage& message) {
+    // Stamp the message as early as possible; the loop filters out the delivery jitter
+    m_slave.receive((unsigned char)message.status, midiClockSlave::now());
+}
+
+//--------------------------------------------------------------
+// midiLoopbackTransport
+//--------------------------------------------------------------
+
+midiLoopbackTransport::midiLoopbackTransport(midiClockSlave& slave, int sampleRate, double jitterMs)
+: m_slave(slave), m_sampleRate(sampleRate), m_jitterSeconds(jitterMs / 1000.0) {
+}
+
+//--------------------------------------------------------------
+
+void midiLoopbackTransport::sendMidiBytes(const unsigned char* bytes, size_t count, int64_t sampleTime) {
+    std::uniform_real_distribution<double> delay(0.0, m_jitterSeconds);
+    double seconds = (double)sampleTime / m_sampleRate + delay(m_random);
+
+    for (size_t i = 0; i < count; i++) {
+        m_slave.receive(bytes[i], seconds);
+    }
+}
+
+//--------------------------------------------------------------
+
+midiLoopbackTransport::report midiLoopbackTransport::measure(int sampleRate, double bpm, double jitterMs, double seconds) {
+    report result;
+    if (sampleRate <= 0 || bpm <= 0.0 || seconds <= 0.0) {
+        return result;
+    }
+    midiClockSlave slave;
+    midiLoopbackTransport loopback(slave, sampleRate, jitterMs);
+    midiClockMaster master;
+    master.setTransport(&loopback);
+    tempoClock clock(sampleRate);
+    clock.setTempo(bpm);
+
+    // Drive the master like the metronome does, one frame at a time, and compare the two
+    // positions every millisecond once the slave has locked
+    int64_t frames = (int64_t)(seconds * sampleRate);
+    int64_t comparePeriod = std::max(1, sampleRate / 1000);
+    double msPerBeat = 60000.0 / bpm;
+    double squaredSum = 0.0;
+    int64_t compared = 0;
+    master.start(0);
+    for (int64_t frame = 0; frame < frames; frame++) {
+        double beat = clock.getBeatPosition();
+        master.process(beat, frame);
+        if (frame % comparePeriod == 0 && slave.isLocked()) {
+            double error = (slave.getBeatPosition((double)frame / sampleRate) - beat) * msPerBeat;
+            squaredSum += error * error;
+            result.worstPhaseErrorMs = std::max(result.worstPhaseErrorMs, std::fabs(error));
+            compared++;
+        }
+        clock.advance();
+    }
+
+    midiClockSlave::stats stats = slave.getStats();
+    result.locked = stats.locked;
+    result.lockTimeSeconds = stats.lockTimeSeconds;
+    result.jitterMs = stats.jitterMs;
+    result.phaseErrorMs = compared > 0 ? std::sqrt(squaredSum / compared) : 0.0;
+    result.tempo = stats.tempo;
+    return result;
+}
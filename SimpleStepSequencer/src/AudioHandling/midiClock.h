@@ -0,0 +1,220 @@
+//
+//  midiClock.h
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+/*
+The midiClock classes synchronize the sequencer with other gear using MIDI clock (24 pulses
+per quarter note) and the start/stop/continue transport messages.
+
+midiClockMaster is driven by the metronome's tempoClock once per frame and sends clock and
+transport messages through a midiTransport, stamped with the frame of the sample clock they
+belong to. The transport turns the frame into a time: the MIDI instrument sends every
+message from a thread of its own when the audio of its frame starts playing (see
+setStreamTime()), so pulses are not bunched at the start of each callback. midiClockSlave receives clock messages and locks onto them with a second-order
+phase-locked loop (a delay-locked loop in the time domain), which filters out the jitter
+that USB-MIDI adds to the pulses. The metronome reads the filtered tempo and beat phase to
+follow an external master. midiLoopbackTransport connects a master directly to a slave,
+optionally adding jitter, so synchronisation can be exercised without any hardware;
+midiLoopbackTransport::measure() runs such a loop and reports lock time, jitter and phase
+error (the headless command "clock loopback").
+*/
+
+// These directives are used to prevent multiple inclusions of the same header file, which
+// helps avoid redefinition errors and improves compilation efficiency:
+#ifndef midiClock_h
+#define midiClock_h
+
+#include <atomic>    // For std::atomic, shared between the MIDI and audio threads
+#include <cstddef>   // For size_t
+#include <cstdint>   // For int64_t
+#include <random>    // For the jitter generator of the loopback transport
+#include "ofxMidi.h" // For ofxMidiIn and ofxMidiListener
+
+// MIDI real-time status bytes used for clock synchronisation
+namespace midiClockStatus {
+    constexpr unsigned char clock = 0xF8;     // Timing clock, 24 per quarter note
+    constexpr unsigned char start = 0xFA;     // Start from the beginning of the song
+    constexpr unsigned char resume = 0xFB;    // Continue from the current position
+    constexpr unsigned char stop = 0xFC;      // Stop
+}
+
+// Interface for anything that can carry outgoing MIDI bytes
+class midiTransport {
+public:
+    virtual ~midiTransport() = default;
+
+    // Sends raw MIDI bytes; sampleTime is the frame of the sample clock the message belongs to
+    virtual void sendMidiBytes(const unsigned char* bytes, size_t count, int64_t sampleTime) = 0;
+
+    // Tells the transport when the frames of the sample clock are due: frame is due at seconds
+    // on the steady clock (see midiClockSlave::now()). Called by the audio thread at the start
+    // of every buffer; transports that deliver at once ignore it.
+    virtual void setStreamTime(int64_t frame, double seconds, int sampleRate) {}
+};
+
+//--------------------------------------------------------------
+
+class midiClockMaster {
+public:
+    static constexpr int pulsesPerQuarter = 24; // MIDI clock resolution
+
+    // Sets the transport the clock is sent through (nullptr disables sending)
+    void setTransport(midiTransport* transport);
+
+    // Sends Start and restarts the pulse count from the top
+    void start(int64_t sampleTime);
+
+    // Sends Stop; no more pulses are sent until start() or resume()
+    void stop(int64_t sampleTime);
+
+    // Sends Continue and carries on from the current position
+    void resume(int64_t sampleTime);
+
+    // Called once per frame with the beat position of that frame; sends the pulses that are due
+    void process(double beatPosition, int64_t sampleTime);
+
+    // Returns true between start()/resume() and stop()
+    bool isRunning() const;
+
+private:
+    // Sends a single status byte through the transport
+    void sendStatus(unsigned char status, int64_t sampleTime);
+
+    midiTransport* m_transport = nullptr; // Where the messages go
+    bool m_running = false;               // True while the transport is running
+    int64_t m_nextPulse = 0;              // Index of the next pulse to send
+};
+
+//--------------------------------------------------------------
+
+class midiClockSlave {
+public:
+    // Snapshot of the loop state for display and diagnostics
+    struct stats {
+        bool running;           // Transport state from Start/Stop/Continue
+        bool locked;            // True once the loop follows the incoming clock closely
+        double tempo;           // Filtered tempo in BPM
+        double lockTimeSeconds; // Time from the first pulse until lock (-1 if never locked)
+        double jitterMs;        // RMS deviation of the incoming pulses from the loop's prediction
+        int64_t pulses;         // Pulses received since the last Start
+    };
+
+    // Constructor that sets the loop bandwidth in Hz once locked
+    midiClockSlave(double bandwidthHz = 0.5);
+
+    // Sets the loop bandwidth; lower values filter more jitter but follow tempo changes slower
+    void setBandwidth(double bandwidthHz);
+
+    // Feeds a real-time status byte received at the given time in seconds (MIDI thread)
+    void receive(unsigned char status, double seconds);
+
+    // Returns true while the external transport is running
+    bool isRunning() const;
+
+    // Returns true while the loop is locked to the incoming clock
+    bool isLocked() const;
+
+    // Returns the filtered tempo in BPM
+    double getTempo() const;
+
+    // Returns the beat position the master is at, at the given time in seconds
+    double getBeatPosition(double seconds) const;
+
+    // Returns a snapshot of the loop state
+    stats getStats() const;
+
+    // Seconds on the clock used to timestamp incoming messages
+    static double now();
+
+private:
+    // Advances the loop with a clock pulse received at the given time
+    void pulse(double seconds);
+
+    // Publishes the loop state for readers on other threads
+    void publish();
+
+    double m_bandwidth;           // Loop bandwidth in Hz once locked
+    double m_predicted = 0.0;     // Time the next pulse is expected at
+    double m_filteredTime = 0.0;  // Filtered time of the latest pulse
+    double m_period = 0.0;        // Filtered time between pulses
+    double m_firstPulse = 0.0;    // Time of the first pulse after Start
+    double m_lastPulse = 0.0;     // Unfiltered time of the latest pulse
+    double m_jitterSquared = 0.0; // Running mean of the squared prediction error
+    int64_t m_pulseCount = 0;     // Pulses received since Start
+    int m_goodPulses = 0;         // Consecutive pulses close to the prediction
+    bool m_locked = false;        // Loop lock state (MIDI thread copy)
+    double m_lockTime = -1.0;     // Seconds from the first pulse until lock
+
+    // State shared with the audio thread, guarded by a sequence counter
+    std::atomic<unsigned> m_sequence{0};
+    std::atomic<double> m_sharedTime{0.0};
+    std::atomic<double> m_sharedPeriod{0.0};
+    std::atomic<int64_t> m_sharedPulses{0};
+    std::atomic<bool> m_sharedLocked{false};
+    std::atomic<bool> m_sharedRunning{false};
+    std::atomic<double> m_sharedLockTime{-1.0};
+    std::atomic<double> m_sharedJitter{0.0};
+};
+
+//--------------------------------------------------------------
+
+// Receives MIDI clock from a hardware port and forwards it to a midiClockSlave
+class midiClockInput : public ofxMidiListener {
+public:
+    // Constructor that connects the input to the slave that should receive the clock
+    midiClockInput(midiClockSlave& slave);
+
+    // Destructor that closes the port
+    ~midiClockInput() override;
+
+    // Opens the MIDI input port with the given index
+    bool openPort(int portIndex);
+
+    // Closes the MIDI input port
+    void closePort();
+
+    // Called by ofxMidi on its own thread for every incoming message
+    void newMidiMessage(ofxMidiMessage& message) override;
+
+private:
+    ofxMidiIn m_midiIn;      // MIDI input the clock arrives on
+    midiClockSlave& m_slave; // Slave the clock is forwarded to
+};
+
+//--------------------------------------------------------------
+
+// Transport stand-in that delivers the bytes straight to a slave, for testing without hardware
+class midiLoopbackTransport : public midiTransport {
+public:
+    // Result of measure()
+    struct report {
+        bool locked = false;            // The slave locked and stayed locked to the end
+        double lockTimeSeconds = -1.0;  // Time from the first pulse until lock
+        double jitterMs = 0.0;          // Jitter the slave measured on the incoming pulses
+        double phaseErrorMs = 0.0;      // RMS distance between master and slave after lock
+        double worstPhaseErrorMs = 0.0; // Largest distance after lock
+        double tempo = 0.0;             // Tempo the slave followed at the end
+    };
+
+    // Runs a master through a loopback into a slave for the given number of simulated
+    // seconds and compares where the slave thinks the master is with where it is
+    static report measure(int sampleRate, double bpm, double jitterMs, double seconds);
+
+    // Constructor that connects to a slave; sampleRate converts sample time to seconds and
+    // jitterMs adds a random delay of up to that many milliseconds to every message
+    midiLoopbackTransport(midiClockSlave& slave, int sampleRate, double jitterMs = 0.0);
+
+    // Delivers every byte to the slave at its sample time plus jitter
+    void sendMidiBytes(const unsigned char* bytes, size_t count, int64_t sampleTime) override;
+
+private:
+    midiClockSlave& m_slave;        // Receiving end of the loopback
+    int m_sampleRate;               // Converts sample time into seconds
+    double m_jitterSeconds;         // Maximum random delay per message
+    std::minstd_rand m_random{1};   // Deterministic jitter source
+};
+
+#endif /* midiClock_h */
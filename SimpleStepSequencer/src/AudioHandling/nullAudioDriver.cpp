@@ -0,0 +1,101 @@
+//
+//  nullAudioDriver.cpp
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+#include <algorithm>
+#include <chrono>
+#include "nullAudioDriver.h"
+
+// Constructor implementation
+nullAudioDriver::nullAudioDriver() {
+    // Nothing runs until setup() is called
+}
+
+//--------------------------------------------------------------
+
+// Destructor implementation
+nullAudioDriver::~nullAudioDriver() {
+    close(); // Make sure the driver thread has stopped
+}
+
+//--------------------------------------------------------------
+
+void nullAudioDriver::setup(int sampleRate, int bufferSize, int numOutputChannels, callback audioCallback, bool realtime,
+                            int numInputChannels, callback inputCallback, const std::vector<float>& inputSamples) {
+    close(); // Stop a previous configuration first
+
+    m_sampleRate = sampleRate;
+    m_bufferSize = bufferSize;
+    m_callback = std::move(audioCallback);
+    m_bufferCount = 0;
+
+    // Allocate the buffer once; the callback always gets the same memory
+    m_buffer.allocate(m_bufferSize, numOutputChannels);
+    m_buffer.setSampleRate(m_sampleRate);
+
+    // The input starts from the top of the file with every stream
+    m_inputCallback = numInputChannels > 0 ? std::move(inputCallback) : nullptr;
+    if (m_inputCallback) {
+        m_inputBuffer.allocate(m_bufferSize, numInputChannels);
+        m_inputBuffer.setSampleRate(m_sampleRate);
+        m_inputSamples = inputSamples;
+        m_inputPosition = 0;
+    }
+
+    if (realtime) {
+        m_running = true;
+        m_thread = std::thread(&nullAudioDriver::run, this);
+    }
+}
+
+//--------------------------------------------------------------
+
+void nullAudioDriver::close() {
+    m_running = false;
+    if (m_thread.joinable()) {
+        m_thread.join(); // Wait for the current buffer to finish
+    }
+}
+
+//--------------------------------------------------------------
+
+void nullAudioDriver::process(int numBuffers) {
+    for (int i = 0; i < numBuffers && m_callback; i++) {
+        if (m_inputCallback) {
+            // Copy the next part of the input, then silence
+            std::vector<float>& input = m_inputBuffer.getBuffer();
+            size_t count = std::min(input.size(), m_inputSamples.size() - m_inputPosition);
+            std::copy(m_inputSamples.begin() + m_inputPosition, m_inputSamples.begin() + m_inputPosition + count, input.begin());
+            std::fill(input.begin() + count, input.end(), 0.0f);
+            m_inputPosition += count;
+            m_inputCallback(m_inputBuffer);
+        }
+        m_callback(m_buffer);
+        m_bufferCount++;
+    }
+}
+
+//--------------------------------------------------------------
+
+uint64_t nullAudioDriver::getBufferCount() const {
+    return m_bufferCount;
+}
+
+//--------------------------------------------------------------
+
+void nullAudioDriver::run() {
+    using clock = std::chrono::steady_clock;
+    auto period = std::chrono::duration<double>((double)m_bufferSize / m_sampleRate);
+    auto start = clock::now();
+
+    while (m_running) {
+        process(1);
+
+        // Wake up on an absolute schedule so the pace does not drift, like a real device
+        auto deadline = start + std::chrono::duration_cast<clock::duration>(period * (double)m_bufferCount);
+        std::this_thread::sleep_until(deadline);
+    }
+}
@@ -0,0 +1,71 @@
+//
+//  nullAudioDriver.h
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+/*
+The nullAudioDriver class is a stand-in for a sound card. It calls an audio callback with
+ofSoundBuffers of the configured size, either paced in real time on its own thread (like a
+device would) or offline as fast as possible on the calling thread. The output is thrown
+away. With input channels it calls an input callback before every output buffer, with the
+samples of an input file (or silence once the file has ended). It lets the audio engine run, be reconfigured and be measured on machines without an
+audio device, and it makes offline processing deterministic.
+*/
+
+// These directives are used to prevent multiple inclusions of the same header file, which
+// helps avoid redefinition errors and improves compilation efficiency:
+#ifndef nullAudioDriver_h
+#define nullAudioDriver_h
+
+#include <atomic>          // For the running flag shared with the driver thread
+#include <functional>      // For std::function
+#include <thread>          // For the real-time driver thread
+#include <vector>          // For the input samples
+#include "ofSoundStream.h" // For ofSoundBuffer
+
+class nullAudioDriver {
+public:
+    // Signature of the audio callback the driver calls for every buffer
+    using callback = std::function<void(ofSoundBuffer&)>;
+
+    // Constructor
+    nullAudioDriver();
+
+    // Destructor that stops the driver thread
+    ~nullAudioDriver();
+
+    // Configures the buffers and the callbacks; in real-time mode a thread starts calling
+    // them. With input channels, inputCallback gets the interleaved inputSamples buffer by buffer.
+    void setup(int sampleRate, int bufferSize, int numOutputChannels, callback audioCallback, bool realtime,
+               int numInputChannels = 0, callback inputCallback = nullptr,
+               const std::vector<float>& inputSamples = std::vector<float>());
+
+    // Stops the driver thread (if any)
+    void close();
+
+    // Runs the callback for the given number of buffers on the calling thread (offline mode)
+    void process(int numBuffers);
+
+    // Returns the number of buffers processed since setup
+    uint64_t getBufferCount() const;
+
+private:
+    // Body of the real-time driver thread
+    void run();
+
+    callback m_callback;                 // Audio callback to drive
+    ofSoundBuffer m_buffer;              // Buffer handed to the callback, reused every time
+    callback m_inputCallback;            // Input callback, if there are input channels
+    ofSoundBuffer m_inputBuffer;         // Buffer handed to the input callback
+    std::vector<float> m_inputSamples;   // Input played to the callback, interleaved
+    size_t m_inputPosition = 0;          // Next input sample to play
+    int m_sampleRate = 44100;            // Sample rate of the simulated device
+    int m_bufferSize = 512;              // Frames per buffer
+    std::thread m_thread;                // Real-time driver thread
+    std::atomic<bool> m_running{false};  // Keeps the driver thread alive
+    std::atomic<uint64_t> m_bufferCount{0}; // Buffers processed since setup
+};
+
+#endif /* nullAudioDriver_h */
@@ -0,0 +1,129 @@
+//
+//  onsetDetector.cpp
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+#include <algorithm>
+#include <cmath>
+#include "onsetDetector.h"
+
+namespace {
+    constexpr double attackSeconds = 0.0005;     // Fast envelope: rise time
+    constexpr double releaseSeconds = 0.010;     // Fast envelope: fall time
+    constexpr double riseSeconds = 0.005;        // Slow envelope: rise time, slow enough for a hit to stand out
+    constexpr double decaySeconds = 0.100;       // Slow envelope: fall time, longer than the decay of a hit
+    constexpr double holdSeconds = 0.030;        // Quiet time after a hit, about a 32nd at 240 BPM
+    constexpr size_t blockFrames = 64;           // Frames deinterleaved at a time
+    constexpr float silenceFloor = 1e-15f;       // Keeps the envelopes of silent lanes out of denormal range
+
+    // Coefficient of a one-pole follower with the given time constant
+    float coefficient(double seconds, int sampleRate) {
+        return (float)(1.0 - std::exp(-1.0 / (seconds * sampleRate)));
+    }
+}
+
+//--------------------------------------------------------------
+
+onsetDetector::onsetDetector() {
+    setup(44100);
+}
+
+//--------------------------------------------------------------
+
+void onsetDetector::setup(int sampleRate) {
+    m_attack = coefficient(attackSeconds, sampleRate);
+    m_release = coefficient(releaseSeconds, sampleRate);
+    m_rise = coefficient(riseSeconds, sampleRate);
+    m_decay = coefficient(decaySeconds, sampleRate);
+    m_holdFrames = (float)(holdSeconds * sampleRate);
+
+    // A sharp hit crosses the trigger level after about a third of the attack time constant
+    m_detectionDelay = (int)std::lround(attackSeconds * sampleRate / 3.0);
+
+    m_fast.fill(0.0f);
+    m_slow.fill(0.0f);
+    m_hold.fill(0.0f);
+    m_numOnsets = 0;
+}
+
+//--------------------------------------------------------------
+
+void onsetDetector::setThreshold(float threshold, float ratio) {
+    m_threshold = std::max(threshold, 0.0f);
+    m_ratio = std::max(ratio, 1.0f);
+}
+
+//--------------------------------------------------------------
+
+int onsetDetector::process(const float* input, size_t numFrames, size_t numChannels) {
+    m_numOnsets = 0;
+    size_t used = std::min(numChannels, (size_t)maxChannels);
+
+    // Copied into locals, so the compiler knows nothing in the loop changes them
+    lanes fast = m_fast, slow = m_slow, hold = m_hold;
+    const float attack = m_attack, release = m_release, rise = m_rise, decay = m_decay;
+    const float holdFrames = m_holdFrames, threshold = m_threshold, ratio = m_ratio;
+
+    float block[blockFrames][maxChannels];
+    for (size_t start = 0; start < numFrames; start += blockFrames) {
+        size_t count = std::min(blockFrames, numFrames - start);
+
+        // Deinterleave into full lanes; lanes without an input get silence
+        for (size_t frame = 0; frame < count; frame++) {
+            const float* from = input + (start + frame) * numChannels;
+            for (size_t lane = 0; lane < (size_t)maxChannels; lane++) {
+                block[frame][lane] = lane < used ? from[lane] : 0.0f;
+            }
+        }
+
+        for (size_t frame = 0; frame < count; frame++) {
+            // The same branch-free update for every lane
+            int triggered[maxChannels];
+            for (int lane = 0; lane < maxChannels; lane++) {
+                float level = std::fabs(block[frame][lane]) + silenceFloor;
+                float coef = level > fast[lane] ? attack : release;
+                fast[lane] += coef * (level - fast[lane]);
+                coef = fast[lane] > slow[lane] ? rise : decay;
+                slow[lane] += coef * (fast[lane] - slow[lane]);
+                hold[lane] = std::max(hold[lane] - 1.0f, 0.0f);
+                bool hit = fast[lane] > threshold && fast[lane] > slow[lane] * ratio && hold[lane] == 0.0f;
+                hold[lane] = hit ? holdFrames : hold[lane];
+                triggered[lane] = hit ? 1 : 0;
+            }
+            int any = 0;
+            for (int lane = 0; lane < maxChannels; lane++) {
+                any |= triggered[lane];
+            }
+            if (!any) {
+                continue;
+            }
+            for (size_t lane = 0; lane < used; lane++) {
+                if (triggered[lane] && m_numOnsets < maxOnsetsPerBuffer) {
+                    onset& found = m_onsets[m_numOnsets++];
+                    found.frame = (int)(start + frame);
+                    found.channel = (int)lane;
+                    found.strength = fast[lane];
+                }
+            }
+        }
+    }
+
+    m_fast = fast;
+    m_slow = slow;
+    m_hold = hold;
+    return m_numOnsets;
+}
+
+//--------------------------------------------------------------
+
+const onsetDetector::onset* onsetDetector::getOnsets() const {
+    return m_onsets.data();
+}
+
+//--------------------------------------------------------------
+
+int onsetDetector::getDetectionDelay() const {
+    return m_detectionDelay;
+}
@@ -0,0 +1,81 @@
+//
+//  onsetDetector.h
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+/*
+The onsetDetector class finds hits (drum pads, mics on a kit, a tapped table) in the live
+input. Each input channel has two envelope followers on the rectified signal: a fast one
+that jumps on a hit, and a slow one that follows the fast one with a lag and lets go
+slowly, so it lies below the fast one only at the start of a hit. A channel triggers when
+the fast envelope rises above the slow one by a ratio and above an absolute threshold; it
+then stays quiet for a hold time, so the decay of the same hit does not trigger again.
+
+The state of all channels is kept side by side in fixed lanes, and every frame updates all
+lanes with the same branch-free arithmetic, so the compiler turns the inner loop into
+vector instructions; 8 inputs cost about as much as one. Unused lanes are fed silence.
+Onsets are reported with the frame they were found at; getDetectionDelay() tells how far
+that typically lies after the actual start of the hit. Nothing allocates.
+*/
+
+// These directives are used to prevent multiple inclusions of the same header file, which
+// helps avoid redefinition errors and improves compilation efficiency:
+#ifndef onsetDetector_h
+#define onsetDetector_h
+
+#include <array>    // For the lanes
+#include <cstddef>  // For size_t
+
+class onsetDetector {
+public:
+    static constexpr int maxChannels = 8;           // Input channels analysed
+    static constexpr int maxOnsetsPerBuffer = 64;   // Onsets kept per buffer; more are dropped
+
+    // One detected hit
+    struct onset {
+        int frame = 0;          // Frame of the buffer it was detected at
+        int channel = 0;        // Input channel
+        float strength = 0.0f;  // Envelope level at detection (0-1 for full-scale input)
+    };
+
+    // Constructor
+    onsetDetector();
+
+    // Sets the time constants for a sample rate and clears the envelopes
+    void setup(int sampleRate);
+
+    // Sets the level a hit must reach (linear, 0-1) and how far above the background it
+    // must rise (ratio of the envelopes)
+    void setThreshold(float threshold, float ratio = 2.0f);
+
+    // Analyses an interleaved buffer; returns the number of onsets found (audio thread)
+    int process(const float* input, size_t numFrames, size_t numChannels);
+
+    // Returns the onsets found by the latest process()
+    const onset* getOnsets() const;
+
+    // Returns the typical delay in frames between the start of a hit and its detection
+    int getDetectionDelay() const;
+
+private:
+    using lanes = std::array<float, maxChannels>;
+
+    float m_attack = 0.0f;      // Coefficient of the fast envelope while rising
+    float m_release = 0.0f;     // Coefficient of the fast envelope while falling
+    float m_rise = 0.0f;        // Coefficient of the slow envelope while rising
+    float m_decay = 0.0f;       // Coefficient of the slow envelope while falling
+    float m_holdFrames = 0.0f;  // Frames a channel stays quiet after a hit
+    float m_threshold = 0.05f;  // Lowest envelope level of a hit
+    float m_ratio = 2.0f;       // Rise of the fast over the slow envelope needed for a hit
+    int m_detectionDelay = 0;   // See getDetectionDelay()
+
+    lanes m_fast{};             // Fast envelope of every channel
+    lanes m_slow{};             // Slow envelope of every channel
+    lanes m_hold{};             // Frames left until a channel may trigger again
+    std::array<onset, maxOnsetsPerBuffer> m_onsets{};
+    int m_numOnsets = 0;
+};
+
+#endif /* onsetDetector_h */
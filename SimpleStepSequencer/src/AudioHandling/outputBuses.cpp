@@ -0,0 +1,186 @@
+//
+//  outputBuses.cpp
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+#include <algorithm>
+#include <cstring>
+#include "ofMain.h"
+#include "outputBuses.h"
+#include "rtLogger.h"
+
+namespace {
+    // Frames interleaved at a time; a block of 64 channels stays within 8 KB
+    constexpr size_t blockFrames = 32;
+}
+
+//--------------------------------------------------------------
+
+outputBuses::outputBuses() {
+    for (int bus = 0; bus < maxBuses; bus++) {
+        m_busOutputs[bus].store(bus * 2);
+    }
+}
+
+//--------------------------------------------------------------
+
+void outputBuses::prepare(size_t maxFrames, int numChannels, int numTracks) {
+    m_maxFrames = maxFrames;
+    m_numBuses = std::min(maxBuses, std::max(1, (numChannels + 1) / 2));
+    m_numTracks = std::min(maxTracks, std::max(1, numTracks));
+    m_storage.assign(m_maxFrames * m_numBuses * 2, 0.0f);
+    m_tracks.assign(m_maxFrames * m_numTracks * 2, 0.0f);
+    m_numFrames = 0;
+}
+
+//--------------------------------------------------------------
+
+void outputBuses::begin(size_t numFrames, int sampleRate) {
+    if (numFrames > m_maxFrames) {
+        rtLogger::instance().log("outputBuses", "Buffer of %d frames is larger than the %d prepared",
+                                 (int)numFrames, (int)m_maxFrames);
+        numFrames = m_maxFrames; // The rest of the buffer stays silent
+    }
+    m_numFrames = numFrames;
+    m_sampleRate = sampleRate;
+    for (int side = 0; side < m_numBuses * 2; side++) {
+        std::memset(m_storage.data() + side * m_maxFrames, 0, m_numFrames * sizeof(float));
+    }
+    for (int side = 0; side < m_numTracks * 2; side++) {
+        std::memset(m_tracks.data() + side * m_maxFrames, 0, m_numFrames * sizeof(float));
+    }
+}
+
+//--------------------------------------------------------------
+
+int outputBuses::getNumTracks() const {
+    return m_numTracks;
+}
+
+//--------------------------------------------------------------
+
+float* outputBuses::getTrackChannel(int track, int side) {
+    if (track < 0 || track >= m_numTracks) {
+        track = 0;
+    }
+    return m_tracks.data() + (track * 2 + (side & 1)) * m_maxFrames;
+}
+
+//--------------------------------------------------------------
+
+void outputBuses::mixTrack(int track, int bus) {
+    for (int side = 0; side < 2; side++) {
+        const float* from = getTrackChannel(track, side);
+        float* to = getChannel(bus, side);
+        for (size_t frame = 0; frame < m_numFrames; frame++) {
+            to[frame] += from[frame];
+        }
+    }
+}
+
+//--------------------------------------------------------------
+
+int outputBuses::getNumBuses() const {
+    return m_numBuses;
+}
+
+//--------------------------------------------------------------
+
+size_t outputBuses::getNumFrames() const {
+    return m_numFrames;
+}
+
+//--------------------------------------------------------------
+
+int outputBuses::getSampleRate() const {
+    return m_sampleRate;
+}
+
+//--------------------------------------------------------------
+
+float* outputBuses::getChannel(int bus, int side) {
+    if (bus < 0 || bus >= m_numBuses) {
+        bus = 0;
+    }
+    return m_storage.data() + (bus * 2 + (side & 1)) * m_maxFrames;
+}
+
+//--------------------------------------------------------------
+
+void outputBuses::setBusOutput(int bus, int firstChannel) {
+    if (bus < 0 || bus >= maxBuses) {
+        return;
+    }
+    m_busOutputs[bus].store(firstChannel < 0 ? muted : firstChannel, std::memory_order_relaxed);
+}
+
+//--------------------------------------------------------------
+
+int outputBuses::getBusOutput(int bus) const {
+    if (bus < 0 || bus >= maxBuses) {
+        return muted;
+    }
+    return m_busOutputs[bus].load(std::memory_order_relaxed);
+}
+
+//--------------------------------------------------------------
+
+void outputBuses::interleave(ofSoundBuffer& output) {
+    size_t channels = output.getNumChannels();
+    size_t frames = std::min(output.getNumFrames(), m_numFrames);
+    float* out = output.getBuffer().data();
+    if (channels == 0) {
+        return;
+    }
+
+    // Find the sources of every output channel
+    size_t fed = std::min(channels, (size_t)maxChannels);
+    std::fill(m_numSources.begin(), m_numSources.begin() + fed, 0);
+    for (int bus = 0; bus < m_numBuses; bus++) {
+        int first = m_busOutputs[bus].load(std::memory_order_relaxed);
+        for (int side = 0; side < 2 && first >= 0; side++) {
+            size_t channel = first + side;
+            if (channel < fed) {
+                m_sources[channel][m_numSources[channel]++] = getChannel(bus, side);
+            }
+        }
+    }
+
+    // Copy block by block: the block of the output stays in the cache while every channel
+    // is written into it
+    for (size_t start = 0; start < frames; start += blockFrames) {
+        size_t end = std::min(start + blockFrames, frames);
+        for (size_t channel = 0; channel < fed; channel++) {
+            float* to = out + channel;
+            int count = m_numSources[channel];
+            if (count == 0) {
+                for (size_t frame = start; frame < end; frame++) {
+                    to[frame * channels] = 0.0f;
+                }
+                continue;
+            }
+            const float* from = m_sources[channel][0];
+            for (size_t frame = start; frame < end; frame++) {
+                to[frame * channels] = from[frame];
+            }
+            for (int source = 1; source < count; source++) {
+                from = m_sources[channel][source];
+                for (size_t frame = start; frame < end; frame++) {
+                    to[frame * channels] += from[frame];
+                }
+            }
+        }
+        for (size_t channel = fed; channel < channels; channel++) {
+            for (size_t frame = start; frame < end; frame++) {
+                out[frame * channels + channel] = 0.0f; // More channels than buses can feed
+            }
+        }
+    }
+
+    // Frames beyond the prepared size are left silent
+    if (frames < output.getNumFrames()) {
+        std::memset(out + frames * channels, 0, (output.getNumFrames() - frames) * channels * sizeof(float));
+    }
+}
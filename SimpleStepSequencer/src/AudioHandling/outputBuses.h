@@ -0,0 +1,103 @@
+//
+//  outputBuses.h
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+/*
+The outputBuses class holds the stereo channels of every track, which instruments render
+into, and the stereo buses the tracks are mixed into after their inserts (see
+trackInserts). It writes the buses to the output channels of the sound device. Every track
+is assigned to a bus (see musicPlayer::route), so tracks or groups of tracks can leave the
+sequencer as stems on their own channel pairs, for a mixing desk.
+
+Tracks and buses are planar: each side is one contiguous block of floats, so instruments
+add to them with simple loops. A channel map gives the first of the two output channels
+each bus is written to; by default bus n goes to channels 2n and 2n+1, so bus 0 is the main
+pair. Several buses may share a pair; they are summed. A bus mapped to -1 is muted.
+
+interleave() turns the planar buses into the interleaved device buffer. It works through
+the buffer in short blocks of frames that stay in the cache, and only touches the buses
+that exist, so its cost grows linearly with the channel count. The number of buses follows
+the output channel count and is set, with the storage, by prepare() while the stream is
+stopped. Nothing allocates on the audio thread.
+*/
+
+// These directives are used to prevent multiple inclusions of the same header file, which
+// helps avoid redefinition errors and improves compilation efficiency:
+#ifndef outputBuses_h
+#define outputBuses_h
+
+#include <array>   // For the channel map
+#include <atomic>  // For a channel map that can be changed while playing
+#include <cstddef> // For size_t
+#include <vector>  // For the bus storage
+
+class ofSoundBuffer;
+
+class outputBuses {
+public:
+    static constexpr int maxBuses = 32;                 // Stereo buses, for up to 64 output channels
+    static constexpr int maxChannels = maxBuses * 2;    // Output channels that can be fed
+    static constexpr int muted = -1;                    // Channel map entry of a muted bus
+    static constexpr int maxTracks = 64;                // Tracks that can be rendered
+
+    // Constructor; every bus goes to its own channel pair
+    outputBuses();
+
+    // Allocates numTracks tracks and the buses for buffers of up to maxFrames and an output
+    // with numChannels channels (one bus per channel pair). Call while the stream is stopped.
+    void prepare(size_t maxFrames, int numChannels, int numTracks);
+
+    // Starts a buffer: silences the tracks and the buses for numFrames frames (audio thread)
+    void begin(size_t numFrames, int sampleRate);
+
+    // Returns the number of tracks
+    int getNumTracks() const;
+
+    // Returns one side (0 = left, 1 = right) of a track; tracks that do not exist fall back to track 0
+    float* getTrackChannel(int track, int side);
+
+    // Adds a track to a bus (audio thread)
+    void mixTrack(int track, int bus);
+
+    // Returns the number of buses
+    int getNumBuses() const;
+
+    // Returns the number of frames of the current buffer
+    size_t getNumFrames() const;
+
+    // Returns the sample rate of the current buffer
+    int getSampleRate() const;
+
+    // Returns one side (0 = left, 1 = right) of a bus; buses that do not exist fall back to bus 0
+    float* getChannel(int bus, int side);
+
+    // Sends a bus to output channels firstChannel and firstChannel + 1 (muted = off); safe
+    // to call while playing
+    void setBusOutput(int bus, int firstChannel);
+
+    // Returns the first output channel of a bus
+    int getBusOutput(int bus) const;
+
+    // Writes the buses into the interleaved output buffer, following the channel map (audio thread)
+    void interleave(ofSoundBuffer& output);
+
+private:
+    std::vector<float> m_storage;   // Every side of every bus, maxFrames floats each
+    std::vector<float> m_tracks;    // Every side of every track, maxFrames floats each
+    size_t m_maxFrames = 0;         // Frames per side
+    int m_numBuses = 0;             // Buses in use
+    int m_numTracks = 0;            // Tracks in use
+    size_t m_numFrames = 0;         // Frames of the current buffer
+    int m_sampleRate = 44100;       // Sample rate of the current buffer
+
+    std::array<std::atomic<int>, maxBuses> m_busOutputs;   // First output channel of every bus
+
+    // Sources of every output channel, rebuilt from the channel map for each buffer (audio thread)
+    std::array<std::array<const float*, maxBuses>, maxChannels> m_sources{};
+    std::array<int, maxChannels> m_numSources{};
+};
+
+#endif /* outputBuses_h */
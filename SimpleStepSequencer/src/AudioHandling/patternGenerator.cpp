@@ -0,0 +1,157 @@
+//
+//  patternGenerator.cpp
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+#include <algorithm>
+#include <cmath>
+#include "patternGenerator.h"
+
+namespace {
+    constexpr int wordBits = stepPattern::stepsPerWord;
+
+    // Returns the bits of a word that are inside a pattern of numSteps steps
+    uint64_t insideMask(int numSteps, int word) {
+        int inside = std::max(0, std::min(numSteps - word * wordBits, wordBits));
+        return inside >= wordBits ? ~uint64_t(0) : (uint64_t(1) << inside) - 1;
+    }
+
+    // Returns the number of words holding steps of a pattern of numSteps steps
+    int usedWords(int numSteps) {
+        return std::max(0, std::min((numSteps + wordBits - 1) / wordBits, stepPattern::wordsPerTrack));
+    }
+
+    // Returns count bits (1-64) from a bit position of the packed steps
+    uint64_t readBits(const stepPattern::trackWords& steps, int position, int count) {
+        int word = position / wordBits;
+        int offset = position % wordBits;
+        uint64_t bits = steps[word] >> offset;
+        if (offset != 0 && offset + count > wordBits) {
+            bits |= steps[word + 1] << (wordBits - offset);
+        }
+        return count >= wordBits ? bits : bits & ((uint64_t(1) << count) - 1);
+    }
+
+    // Returns the 64 bits from a bit position of steps that repeat every period steps
+    uint64_t repeatedBits(const stepPattern::trackWords& steps, int period, int position) {
+        uint64_t result = 0;
+        for (int done = 0; done < wordBits;) {
+            int count = std::min(wordBits - done, period - position);
+            result |= readBits(steps, position, count) << done;
+            done += count;
+            position = (position + count) % period;
+        }
+        return result;
+    }
+}
+
+// Constructor for the patternGenerator class
+patternGenerator::patternGenerator(uint64_t seed) {
+    setSeed(seed);
+}
+
+//--------------------------------------------------------------
+
+void patternGenerator::setSeed(uint64_t seed) {
+    m_state = seed;
+}
+
+//--------------------------------------------------------------
+
+void patternGenerator::euclid(stepPattern::trackWords& steps, int numSteps, int hits, int length, int rotation) {
+    numSteps = std::max(0, std::min(numSteps, stepPattern::maxSteps));
+    length = std::max(1, std::min(length, std::max(numSteps, 1)));
+    hits = std::max(0, std::min(hits, length));
+    rotation = ((rotation % length) + length) % length;
+
+    // One period: step i is on where i * hits / length reaches the next whole number
+    // (Bresenham's line, which gives the same rhythms as Bjorklund's algorithm)
+    stepPattern::trackWords period{};
+    for (int step = 0; step < length; step++) {
+        int unrotated = (step - rotation + length) % length;
+        if (unrotated * hits % length < hits) {
+            period[step / wordBits] |= uint64_t(1) << (step % wordBits);
+        }
+    }
+
+    // Repeated over the pattern, a word at a time
+    for (int word = 0; word < stepPattern::wordsPerTrack; word++) {
+        steps[word] = numSteps > word * wordBits
+            ? repeatedBits(period, length, word * wordBits % length) & insideMask(numSteps, word) : 0;
+    }
+}
+
+//--------------------------------------------------------------
+
+void patternGenerator::random(stepPattern::trackWords& steps, int numSteps, float density) {
+    // Random words are only drawn for the words in the pattern
+    int used = usedWords(numSteps);
+    for (int word = 0; word < stepPattern::wordsPerTrack; word++) {
+        steps[word] = word < used ? chanceWord(density) & insideMask(numSteps, word) : 0;
+    }
+}
+
+//--------------------------------------------------------------
+
+void patternGenerator::fill(stepPattern::trackWords& steps, int numSteps, float density) {
+    int used = usedWords(numSteps);
+    for (int word = 0; word < stepPattern::wordsPerTrack; word++) {
+        steps[word] = word < used ? (steps[word] | chanceWord(density)) & insideMask(numSteps, word) : 0;
+    }
+}
+
+//--------------------------------------------------------------
+
+void patternGenerator::mutate(stepPattern::trackWords& steps, int numSteps, float amount) {
+    int used = usedWords(numSteps);
+    for (int word = 0; word < stepPattern::wordsPerTrack; word++) {
+        steps[word] = word < used ? (steps[word] ^ chanceWord(amount)) & insideMask(numSteps, word) : 0;
+    }
+}
+
+//--------------------------------------------------------------
+
+void patternGenerator::rotate(stepPattern::trackWords& steps, int numSteps, int offset) {
+    numSteps = std::max(0, std::min(numSteps, stepPattern::maxSteps));
+    if (numSteps == 0) {
+        steps.fill(0);
+        return;
+    }
+    // Step i takes the step offset steps before it
+    stepPattern::trackWords source = steps;
+    int start = ((-offset % numSteps) + numSteps) % numSteps;
+    for (int word = 0; word < stepPattern::wordsPerTrack; word++) {
+        steps[word] = numSteps > word * wordBits
+            ? repeatedBits(source, numSteps, (start + word * wordBits) % numSteps) & insideMask(numSteps, word) : 0;
+    }
+}
+
+//--------------------------------------------------------------
+
+uint64_t patternGenerator::nextWord() {
+    uint64_t z = (m_state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+//--------------------------------------------------------------
+
+uint64_t patternGenerator::chanceWord(float chance) {
+    int scaled = (int)std::lround(std::max(0.0f, std::min(chance, 1.0f)) * (1 << densityBits));
+    if (scaled <= 0) {
+        return 0;
+    }
+    if (scaled >= (1 << densityBits)) {
+        return ~uint64_t(0);
+    }
+    // Going from the lowest bit of the chance to the highest, a 1 bit ORs in a random word
+    // and a 0 bit ANDs one in: each halves the chance of a bit so far and adds the bit's own
+    uint64_t bits = 0;
+    for (int bit = __builtin_ctz(scaled); bit < densityBits; bit++) {
+        bits = (scaled >> bit) & 1 ? bits | nextWord() : bits & nextWord();
+    }
+    return bits;
+}
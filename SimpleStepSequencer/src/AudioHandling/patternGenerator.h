@@ -0,0 +1,70 @@
+//
+//  patternGenerator.h
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+/*
+The patternGenerator class writes rhythms into the packed steps of a track (see
+stepPattern::trackWords), 64 steps at a time with word operations rather than step by step:
+
+    euclid   spreads k hits as evenly as possible over every n steps, rotated
+    random   replaces the steps with hits of a given density
+    fill     adds hits of a given density to the empty steps
+    mutate   flips every step with a given chance
+    rotate   moves the steps along the pattern, wrapping around its end
+
+Random steps come from a word of random bits per 64 steps for every bit of the density (a
+density of 1/4 is one word ANDed with another), so a whole word of steps takes eight random
+words whatever the density. Steps beyond the end of the pattern are always left off.
+
+The generator only computes steps; metronome::publishSteps() hands the result to the audio
+thread, which applies all tracks at the start of the next bar.
+*/
+
+// These directives are used to prevent multiple inclusions of the same header file, which
+// helps avoid redefinition errors and improves compilation efficiency:
+#ifndef patternGenerator_h
+#define patternGenerator_h
+
+#include <cstdint>  // For the packed steps and the random state
+#include "stepPattern.h"
+
+class patternGenerator {
+public:
+    static constexpr int densityBits = 8; // Resolution of densities and chances (1/256)
+
+    // Constructor with the seed of the random steps
+    explicit patternGenerator(uint64_t seed = 1);
+
+    // Restarts the random steps from a seed, so a sequence of generators can be repeated
+    void setSeed(uint64_t seed);
+
+    // Replaces the steps with hits spread as evenly as possible over every length steps,
+    // moved rotation steps later
+    static void euclid(stepPattern::trackWords& steps, int numSteps, int hits, int length, int rotation);
+
+    // Replaces the steps with random hits, each step on with the given chance (0-1)
+    void random(stepPattern::trackWords& steps, int numSteps, float density);
+
+    // Switches empty steps on, each with the given chance (0-1); steps that are on stay on
+    void fill(stepPattern::trackWords& steps, int numSteps, float density);
+
+    // Flips every step with the given chance (0-1)
+    void mutate(stepPattern::trackWords& steps, int numSteps, float amount);
+
+    // Moves the steps offset steps later (earlier if negative), wrapping around the end
+    static void rotate(stepPattern::trackWords& steps, int numSteps, int offset);
+
+private:
+    // Returns a word of random bits (splitmix64)
+    uint64_t nextWord();
+
+    // Returns a word whose bits are each 1 with the given chance
+    uint64_t chanceWord(float chance);
+
+    uint64_t m_state = 0; // Random state
+};
+
+#endif /* patternGenerator_h */
@@ -0,0 +1,198 @@
+//
+//  patternHistory.cpp
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+#include "patternHistory.h"
+
+namespace {
+    // Memory of a shared node: the node and the counts of its shared pointer
+    template <typename node>
+    constexpr size_t sharedSize() {
+        return sizeof(node) + 2 * sizeof(long);
+    }
+
+    // Adds the size of a node to the memory of the history for as long as the node exists
+    class allocation {
+    public:
+        allocation(size_t* total, size_t size) : m_total(total), m_size(size) {
+            *m_total += m_size;
+        }
+        allocation(const allocation& other) : allocation(other.m_total, other.m_size) {
+        }
+        allocation& operator=(const allocation&) = delete;
+        ~allocation() {
+            *m_total -= m_size;
+        }
+
+    private:
+        size_t* m_total;
+        size_t m_size;
+    };
+
+    // One page, shared by every snapshot it did not change in
+    struct pageNode {
+        pageNode(size_t* total, const stepPattern::page& data)
+            : data(data), counted(total, sharedSize<pageNode>()) {}
+
+        stepPattern::page data;
+        allocation counted;
+    };
+}
+
+// The pages of one track of one slot, shared by every snapshot none of them changed in
+struct patternHistory::trackPages {
+    trackPages(size_t* total) : counted(total, sharedSize<trackPages>()) {}
+
+    std::array<std::shared_ptr<const pageNode>, stepPattern::wordsPerTrack> pages;
+    allocation counted;
+};
+
+//--------------------------------------------------------------
+
+patternHistory::patternHistory() {
+}
+
+//--------------------------------------------------------------
+
+patternHistory::~patternHistory() {
+    m_snapshots.clear(); // Frees the pages while m_bytes is still there to count them
+}
+
+//--------------------------------------------------------------
+
+void patternHistory::setBudget(size_t bytes) {
+    m_budget = bytes;
+    trim();
+}
+
+//--------------------------------------------------------------
+
+bool patternHistory::commit(stepPattern& pattern, int beats, int tuplets) {
+    std::array<uint64_t, stepPattern::changedWords> changed;
+    pattern.takeChangedPages(changed);
+
+    // The new snapshot starts out sharing every track of the current one
+    const snapshot* previous = m_snapshots.empty() ? nullptr : m_snapshots[m_current].get();
+    auto next = std::make_shared<snapshot>();
+    if (previous) {
+        *next = *previous;
+    }
+    next->numSteps = pattern.getNumSteps();
+    next->beats = beats;
+    next->tuplets = tuplets;
+    bool differs = !previous || next->numSteps != previous->numSteps
+                   || next->beats != previous->beats || next->tuplets != previous->tuplets;
+
+    // Copy the changed pages, and the tracks holding them; everything else stays shared
+    std::array<std::shared_ptr<trackPages>, stepPattern::numSlots * stepPattern::numTracks> copies;
+    for (int index = 0; index < stepPattern::numPages; index++) {
+        bool pageChanged = (changed[index / 64] >> (index % 64)) & 1;
+        if (previous && !pageChanged) {
+            continue;
+        }
+        int track = index / stepPattern::wordsPerTrack;
+        int word = index % stepPattern::wordsPerTrack;
+        stepPattern::page data;
+        pattern.readPage(index, data);
+        if (previous && previous->tracks[track]->pages[word]->data == data) {
+            continue; // Changed and changed back
+        }
+        if (!copies[track]) {
+            copies[track] = previous ? std::make_shared<trackPages>(*previous->tracks[track])
+                                     : std::make_shared<trackPages>(&m_bytes);
+            next->tracks[track] = copies[track];
+        }
+        copies[track]->pages[word] = std::make_shared<const pageNode>(&m_bytes, data);
+        differs = true;
+    }
+    if (!differs) {
+        return false; // The copies, if any, are freed with next
+    }
+
+    // A new edit ends the redo branch
+    while (m_snapshots.size() > m_current + 1) {
+        m_snapshots.pop_back();
+        m_bytes -= sharedSize<snapshot>();
+    }
+    m_snapshots.push_back(std::move(next));
+    m_bytes += sharedSize<snapshot>();
+    m_current = m_snapshots.size() - 1;
+    trim();
+    return true;
+}
+
+//--------------------------------------------------------------
+
+const patternHistory::snapshot* patternHistory::undo(stepPattern& pattern) {
+    if (m_snapshots.empty() || m_current == 0) {
+        return nullptr;
+    }
+    const snapshot& target = *m_snapshots[m_current - 1];
+    restore(pattern, target);
+    m_current--;
+    return &target;
+}
+
+//--------------------------------------------------------------
+
+const patternHistory::snapshot* patternHistory::redo(stepPattern& pattern) {
+    if (m_current + 1 >= m_snapshots.size()) {
+        return nullptr;
+    }
+    const snapshot& target = *m_snapshots[m_current + 1];
+    restore(pattern, target);
+    m_current++;
+    return &target;
+}
+
+//--------------------------------------------------------------
+
+void patternHistory::restore(stepPattern& pattern, const snapshot& target) {
+    const snapshot& current = *m_snapshots[m_current];
+    for (size_t track = 0; track < target.tracks.size(); track++) {
+        if (target.tracks[track] == current.tracks[track]) {
+            continue; // Shared, so nothing in it changed
+        }
+        for (int word = 0; word < stepPattern::wordsPerTrack; word++) {
+            const auto& page = target.tracks[track]->pages[word];
+            if (page != current.tracks[track]->pages[word]) {
+                pattern.writePage((int)track * stepPattern::wordsPerTrack + word, page->data);
+            }
+        }
+    }
+    pattern.restoreNumSteps(target.numSteps);
+}
+
+//--------------------------------------------------------------
+
+void patternHistory::trim() {
+    // The oldest snapshots go first, then the ones furthest ahead; the current snapshot is
+    // kept whatever it takes
+    while (m_bytes > m_budget && m_current > 0) {
+        m_snapshots.pop_front();
+        m_bytes -= sharedSize<snapshot>();
+        m_current--;
+        m_dropped++;
+    }
+    while (m_bytes > m_budget && m_snapshots.size() > m_current + 1) {
+        m_snapshots.pop_back();
+        m_bytes -= sharedSize<snapshot>();
+        m_dropped++;
+    }
+}
+
+//--------------------------------------------------------------
+
+patternHistory::stats patternHistory::getStats() const {
+    stats current;
+    current.snapshots = m_snapshots.size();
+    current.undoable = m_snapshots.empty() ? 0 : m_current;
+    current.redoable = m_snapshots.empty() ? 0 : m_snapshots.size() - m_current - 1;
+    current.bytes = m_bytes;
+    current.budget = m_budget;
+    current.dropped = m_dropped;
+    return current;
+}
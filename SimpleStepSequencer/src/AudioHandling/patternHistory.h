@@ -0,0 +1,111 @@
+//
+//  patternHistory.h
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+/*
+The patternHistory class keeps snapshots of a stepPattern for undo and redo. Snapshots are
+persistent: they are never changed once taken, and a new snapshot shares every page (see
+stepPattern::page) that did not change with the snapshot before it, so taking one costs the
+pages edited since, not a copy of the pattern.
+
+    snapshot ──> track of slot 0 ──> page of steps 0-63
+             ├─> track of slot 1 ──> ...
+             ...
+
+Undoing or redoing moves to the neighbouring snapshot and writes the pages that differ from
+the current one back into the pattern. The audio thread reads the pattern as always, so a
+restored page takes effect at the next step that reads it, like any other edit. Two
+snapshots share a page exactly when it did not change between them, so finding those pages
+only compares pointers.
+
+History is unlimited apart from its memory: when the pages and snapshots take more than the
+budget, the oldest snapshots are dropped (or, after undoing all the way back, the ones
+furthest ahead), and so are the pages only they still use. An edit of one page takes about
+1 KB, so the default budget holds some 15,000 edits.
+
+The history is used from one control thread (the GUI or the headless command loop); edits
+from other threads, including the audio thread, are picked up by the next commit().
+*/
+
+// These directives are used to prevent multiple inclusions of the same header file, which
+// helps avoid redefinition errors and improves compilation efficiency:
+#ifndef patternHistory_h
+#define patternHistory_h
+
+#include <array>    // For the tracks and pages of a snapshot
+#include <cstdint>  // For counters
+#include <deque>    // For the snapshots
+#include <memory>   // For the shared pages
+#include "stepPattern.h"
+
+class patternHistory {
+public:
+    static constexpr size_t defaultBudget = size_t(16) << 20; // Bytes of snapshots kept (16 MB)
+
+    // The pages of one track of one slot
+    struct trackPages;
+
+    // The whole pattern at one point in time; never changed once taken
+    struct snapshot {
+        std::array<std::shared_ptr<const trackPages>, stepPattern::numSlots * stepPattern::numTracks> tracks;
+        int numSteps = 0;   // Steps per track
+        int beats = 0;      // Rhythm of the pattern, so undo can bring it back
+        int tuplets = 0;
+    };
+
+    // Counters of the history
+    struct stats {
+        size_t snapshots = 0;   // Snapshots kept
+        size_t undoable = 0;    // Snapshots before the current one
+        size_t redoable = 0;    // Snapshots after the current one
+        size_t bytes = 0;       // Memory taken by the snapshots and their pages
+        size_t budget = 0;      // Memory the history may take
+        uint64_t dropped = 0;   // Snapshots dropped to stay within the budget
+    };
+
+    // Constructor that creates an empty history
+    patternHistory();
+
+    // Destructor that frees every snapshot
+    ~patternHistory();
+
+    patternHistory(const patternHistory&) = delete;
+    patternHistory& operator=(const patternHistory&) = delete;
+
+    // Sets how much memory the history may take; drops snapshots if it is over
+    void setBudget(size_t bytes);
+
+    // Takes a snapshot of the pages changed since the previous commit, which becomes the
+    // current one; anything that could be redone is discarded. Returns false if nothing
+    // changed.
+    bool commit(stepPattern& pattern, int beats, int tuplets);
+
+    // Moves to the previous snapshot and restores it into the pattern; returns it, or
+    // nullptr if there is nothing to undo
+    const snapshot* undo(stepPattern& pattern);
+
+    // Moves to the next snapshot and restores it into the pattern; returns it, or nullptr
+    // if there is nothing to redo
+    const snapshot* redo(stepPattern& pattern);
+
+    // Returns the counters of the history
+    stats getStats() const;
+
+private:
+    // Writes the pages of target that differ from the current snapshot into the pattern
+    void restore(stepPattern& pattern, const snapshot& target);
+
+    // Drops snapshots until the history is within its budget
+    void trim();
+
+    size_t m_bytes = 0;                 // Memory taken now; declared first so it outlives the snapshots
+    size_t m_budget = defaultBudget;
+    uint64_t m_dropped = 0;
+    std::deque<std::shared_ptr<const snapshot>> m_snapshots; // Oldest first
+    size_t m_current = 0;               // Index of the snapshot the pattern is at
+};
+
+#endif /* patternHistory_h */
@@ -0,0 +1,120 @@
+//
+//  rtLogger.cpp
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include "ofMain.h"
+#include "rtLogger.h"
+#include "threadTuning.h"
+
+//--------------------------------------------------------------
+
+rtLogger& rtLogger::instance() {
+    static rtLogger logger;
+    return logger;
+}
+
+//--------------------------------------------------------------
+
+// Destructor implementation
+rtLogger::~rtLogger() {
+    stop(); // Make sure the printing thread has finished
+}
+
+//--------------------------------------------------------------
+
+void rtLogger::start() {
+    if (m_running) {
+        return;
+    }
+    m_running = true;
+    m_thread = std::thread(&rtLogger::run, this);
+}
+
+//--------------------------------------------------------------
+
+void rtLogger::stop() {
+    m_running = false;
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    drain(); // Print what came in while stopping
+}
+
+//--------------------------------------------------------------
+
+void rtLogger::log(const char* module, const char* format, ...) {
+    // Rate limit in windows of one second
+    int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    if (now - m_windowStart >= 1000) {
+        m_windowStart = now;
+        m_inWindow = 0;
+    }
+    if (m_inWindow == maxPerSecond) {
+        m_dropped++;
+        return;
+    }
+
+    size_t write = m_writeIndex.load(std::memory_order_relaxed);
+    if (write - m_readIndex.load(std::memory_order_acquire) == capacity) {
+        m_dropped++;
+        return; // The printing thread is behind
+    }
+    m_inWindow++;
+
+    // snprintf into fixed storage does not allocate
+    record& entry = m_records[write & (capacity - 1)];
+    std::snprintf(entry.module, sizeof(entry.module), "%s", module);
+    va_list arguments;
+    va_start(arguments, format);
+    std::vsnprintf(entry.text, sizeof(entry.text), format, arguments);
+    va_end(arguments);
+
+    m_writeIndex.store(write + 1, std::memory_order_release);
+}
+
+//--------------------------------------------------------------
+
+uint64_t rtLogger::getDropped() const {
+    return m_dropped;
+}
+
+//--------------------------------------------------------------
+
+void rtLogger::run() {
+    threadTuning::applyWorkerAffinity(); // Keep off the audio thread's cores, if configured
+
+    while (m_running) {
+        if (!drain()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+    }
+}
+
+//--------------------------------------------------------------
+
+bool rtLogger::drain() {
+    size_t read = m_readIndex.load(std::memory_order_relaxed);
+    size_t write = m_writeIndex.load(std::memory_order_acquire);
+    bool printed = read != write;
+    for (; read != write; read++) {
+        const record& entry = m_records[read & (capacity - 1)];
+        ofLogNotice(entry.module) << entry.text;
+        m_readIndex.store(read + 1, std::memory_order_release);
+    }
+
+    // Report suppressed messages at most once a second
+    int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    uint64_t dropped = m_dropped;
+    if (dropped != m_droppedReported && (now - m_lastReport >= 1000 || !m_running)) {
+        ofLogWarning("rtLogger") << (dropped - m_droppedReported) << " log messages from the audio thread were suppressed";
+        m_droppedReported = dropped;
+        m_lastReport = now;
+    }
+    return printed;
+}
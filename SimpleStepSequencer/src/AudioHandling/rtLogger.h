@@ -0,0 +1,87 @@
+//
+//  rtLogger.h
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+/*
+The rtLogger class lets the audio thread log without blocking. ofLog() formats into
+std::strings and writes to the console under a lock, which can take milliseconds, so it must
+not be called from the audio callback. Instead, log() formats the message into a fixed-size
+record in a preallocated ring and returns; a background thread prints the records through
+ofLog(). Messages are rate-limited: beyond maxPerSecond per second they are only counted,
+and the count is reported at most once a second.
+
+There is one logger for the whole program, reached through instance(). log() may be called
+from one real-time thread at a time (the audio thread).
+*/
+
+// These directives are used to prevent multiple inclusions of the same header file, which
+// helps avoid redefinition errors and improves compilation efficiency:
+#ifndef rtLogger_h
+#define rtLogger_h
+
+#include <array>    // For the ring of records
+#include <atomic>   // For the lock-free indices and counters
+#include <cstdint>  // For uint64_t
+#include <thread>   // For the printing thread
+
+class rtLogger {
+public:
+    static constexpr size_t capacity = 256;       // Records waiting to be printed (power of two)
+    static constexpr size_t maxLength = 120;      // Characters per record
+    static constexpr int maxPerSecond = 20;       // Records accepted per second
+
+    // Returns the program's logger
+    static rtLogger& instance();
+
+    // Destructor that stops the printing thread
+    ~rtLogger();
+
+    // Starts the printing thread; call from a non-real-time thread before audio starts
+    void start();
+
+    // Stops the printing thread after printing what is waiting
+    void stop();
+
+    // Formats a message like printf and queues it; never blocks or allocates
+    void log(const char* module, const char* format, ...)
+#if defined(__GNUC__)
+        __attribute__((format(printf, 3, 4)))
+#endif
+        ;
+
+    // Returns the number of messages dropped by the rate limit or a full ring
+    uint64_t getDropped() const;
+
+private:
+    // Only instance() creates the logger
+    rtLogger() = default;
+
+    // Body of the printing thread
+    void run();
+
+    // Prints the waiting records; returns true if there were any
+    bool drain();
+
+    struct record {
+        char module[32];        // Module name, as passed to ofLog
+        char text[maxLength];   // The formatted message
+    };
+
+    std::array<record, capacity> m_records;          // Ring storage
+    std::atomic<size_t> m_writeIndex{0};             // Advanced by the audio thread
+    std::atomic<size_t> m_readIndex{0};              // Advanced by the printing thread
+
+    int64_t m_windowStart = 0;                       // Start of the rate-limit window (ms, audio thread)
+    int m_inWindow = 0;                              // Records accepted in the window (audio thread)
+    std::atomic<uint64_t> m_dropped{0};              // Messages not printed
+    uint64_t m_droppedReported = 0;                  // Part of m_dropped already reported (printing thread)
+    int64_t m_lastReport = 0;                        // Time of the last report (ms, printing thread)
+
+    std::thread m_thread;                            // Prints the records
+    std::atomic<bool> m_running{false};              // Keeps the thread alive
+};
+
+#endif /* rtLogger_h */
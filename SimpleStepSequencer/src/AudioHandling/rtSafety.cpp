@@ -0,0 +1,228 @@
+//
+//  rtSafety.cpp
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+#include <cstdlib>
+#include "rtSafety.h"
+
+#if defined(RT_SAFETY_CHECKS)
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__GLIBC__)
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    constexpr int maxFrames = 32;       // Depth of a recorded call stack
+    constexpr int maxRecords = 64;      // Distinct call stacks kept for the report
+
+    // One distinct offending call stack
+    struct violation {
+        std::atomic<bool> ready{false};     // Set once the fields below are written
+        const char* kind = nullptr;         // The function that was called
+        int depth = 0;                      // Frames in the stack
+        void* frames[maxFrames];            // The stack
+        std::atomic<uint64_t> count{0};     // Times this stack was hit
+    };
+
+    violation records[maxRecords];
+    std::atomic<int> numRecords{0};
+    std::atomic<uint64_t> total{0};
+
+    // Plain thread-locals in the executable live in static TLS, so reading them does not
+    // allocate, even from inside malloc
+    thread_local bool isRealtime = false;   // Set inside a realtimeScope
+    thread_local bool isRecording = false;  // Set while a violation is being recorded
+}
+
+//--------------------------------------------------------------
+
+rtSafety::realtimeScope::realtimeScope() : m_previous(isRealtime) {
+    isRealtime = true;
+}
+
+//--------------------------------------------------------------
+
+rtSafety::realtimeScope::~realtimeScope() {
+    isRealtime = m_previous;
+}
+
+//--------------------------------------------------------------
+
+rtSafety::exemptScope::exemptScope() : m_previous(isRealtime) {
+    isRealtime = false;
+}
+
+//--------------------------------------------------------------
+
+rtSafety::exemptScope::~exemptScope() {
+    isRealtime = m_previous;
+}
+
+//--------------------------------------------------------------
+
+uint64_t rtSafety::getViolations() {
+    return total;
+}
+
+#if defined(__GLIBC__)
+
+namespace {
+    // Records the calling stack if the thread is flagged as real-time. Kept out of line,
+    // so the first frame of every stack is this function and the second the interposed call.
+    __attribute__((noinline)) void check(const char* kind) {
+        if (!isRealtime || isRecording) {
+            return;
+        }
+        isRecording = true; // backtrace() itself may lock or allocate
+        total++;
+
+        void* frames[maxFrames];
+        int depth = backtrace(frames, maxFrames);
+
+        // Count repeated hits of a known stack instead of filling the table
+        int known = std::min(numRecords.load(), maxRecords);
+        for (int i = 0; i < known; i++) {
+            violation& record = records[i];
+            if (record.ready && record.kind == kind && record.depth == depth
+                && std::memcmp(record.frames, frames, depth * sizeof(void*)) == 0) {
+                record.count++;
+                isRecording = false;
+                return;
+            }
+        }
+        int index = numRecords++;
+        if (index < maxRecords) {
+            violation& record = records[index];
+            record.kind = kind;
+            record.depth = depth;
+            std::memcpy(record.frames, frames, depth * sizeof(void*));
+            record.count = 1;
+            record.ready = true;
+        }
+        isRecording = false;
+    }
+
+    // backtrace() loads its unwinder on first use, which allocates; do that up front
+    struct unwinderLoader {
+        unwinderLoader() {
+            void* frames[2];
+            backtrace(frames, 2);
+        }
+    } loadUnwinder;
+
+    using mutexLockFunction = int (*)(pthread_mutex_t*);
+    std::atomic<mutexLockFunction> realMutexLock{nullptr};
+}
+
+// glibc's own implementations, which the functions below forward to
+extern "C" {
+    void* __libc_malloc(size_t size);
+    void* __libc_calloc(size_t count, size_t size);
+    void* __libc_realloc(void* pointer, size_t size);
+    void __libc_free(void* pointer);
+    ssize_t __write(int fd, const void* data, size_t size);
+    ssize_t __read(int fd, void* data, size_t size);
+    int __nanosleep(const struct timespec* duration, struct timespec* remaining);
+}
+
+// Definitions in the executable take precedence over the C library's, for every library
+// in the process
+extern "C" void* malloc(size_t size) {
+    check("malloc");
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) {
+    check("calloc");
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* pointer, size_t size) {
+    check("realloc");
+    return __libc_realloc(pointer, size);
+}
+
+extern "C" void free(void* pointer) {
+    if (pointer) {
+        check("free");
+    }
+    __libc_free(pointer);
+}
+
+extern "C" int pthread_mutex_lock(pthread_mutex_t* mutex) {
+    check("pthread_mutex_lock");
+    mutexLockFunction lock = realMutexLock.load(std::memory_order_relaxed);
+    if (!lock) {
+        // The C library's dynamic-linker lock is internal, so this does not come back here
+        lock = reinterpret_cast<mutexLockFunction>(dlsym(RTLD_NEXT, "pthread_mutex_lock"));
+        realMutexLock.store(lock, std::memory_order_relaxed);
+    }
+    return lock(mutex);
+}
+
+extern "C" ssize_t write(int fd, const void* data, size_t size) {
+    check("write");
+    return __write(fd, data, size);
+}
+
+extern "C" ssize_t read(int fd, void* data, size_t size) {
+    check("read");
+    return __read(fd, data, size);
+}
+
+extern "C" int nanosleep(const struct timespec* duration, struct timespec* remaining) {
+    check("nanosleep");
+    return __nanosleep(duration, remaining);
+}
+
+//--------------------------------------------------------------
+
+uint64_t rtSafety::report() {
+    uint64_t violations = total;
+    if (violations == 0) {
+        std::fprintf(stderr, "rtSafety: no real-time violations\n");
+        return 0;
+    }
+    std::fprintf(stderr, "rtSafety: %llu real-time violations\n", (unsigned long long)violations);
+    int recorded = std::min(numRecords.load(), maxRecords);
+    for (int i = 0; i < recorded; i++) {
+        const violation& record = records[i];
+        if (!record.ready) {
+            continue;
+        }
+        std::fprintf(stderr, "\n%s called %llu times from the audio thread:\n", record.kind,
+                     (unsigned long long)record.count.load());
+        std::fflush(stderr);
+        backtrace_symbols_fd(record.frames + 1, record.depth - 1, STDERR_FILENO); // Skips check()
+    }
+    if (numRecords > maxRecords) {
+        std::fprintf(stderr, "\n%d more call stacks were not recorded\n", numRecords.load() - maxRecords);
+    }
+    return violations;
+}
+
+#else
+
+//--------------------------------------------------------------
+
+uint64_t rtSafety::report() {
+    // Without glibc nothing is interposed; clang's -fsanitize=realtime covers macOS
+    std::fprintf(stderr, "rtSafety: interposition needs glibc, nothing was checked\n");
+    return 0;
+}
+
+#endif /* __GLIBC__ */
+
+#endif /* RT_SAFETY_CHECKS */
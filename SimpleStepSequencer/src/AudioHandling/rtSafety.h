@@ -0,0 +1,68 @@
+//
+//  rtSafety.h
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+/*
+rtSafety catches calls that may block on the audio thread: memory allocation (malloc,
+free and everything built on them, like new, std::string and ofLog), mutex locks and
+blocking system calls (write, read, sleeps). The audio callback flags its thread as
+real-time with a realtimeScope; while the flag is set, every such call is recorded with its
+call stack. report() prints each offending stack once, with the number of times it was hit.
+
+The checker is a debug/CI build mode: compile with RT_SAFETY_CHECKS defined (add it to
+PROJECT_DEFINES in config.make, or to the preprocessor macros in Xcode). Without it the
+scopes compile to nothing and no function is interposed. Interposition needs glibc (Linux);
+on other platforms the scopes still compile, but nothing is caught, and report() says so.
+
+A CI job can run the headless app with RT_SAFETY_CHECKS; it exits with status 1 when any
+violation was recorded (see main.cpp).
+*/
+
+// These directives are used to prevent multiple inclusions of the same header file, which
+// helps avoid redefinition errors and improves compilation efficiency:
+#ifndef rtSafety_h
+#define rtSafety_h
+
+#include <cstdint>  // For the violation count
+
+namespace rtSafety {
+    // Flags the calling thread as real-time for the lifetime of the scope
+    class realtimeScope {
+    public:
+        realtimeScope();
+        ~realtimeScope();
+    private:
+        bool m_previous;    // Flag to restore, so scopes can nest
+    };
+
+    // Lifts the flag for calls that are blocking by design and known to be short
+    class exemptScope {
+    public:
+        exemptScope();
+        ~exemptScope();
+    private:
+        bool m_previous;    // Flag to restore
+    };
+
+    // Returns the number of violations recorded so far
+    uint64_t getViolations();
+
+    // Prints every distinct offending call stack to standard error; returns the number of
+    // violations. Call from a normal thread.
+    uint64_t report();
+}
+
+#if !defined(RT_SAFETY_CHECKS)
+// Without the checker the scopes do nothing and cost nothing
+inline rtSafety::realtimeScope::realtimeScope() : m_previous(false) {}
+inline rtSafety::realtimeScope::~realtimeScope() {}
+inline rtSafety::exemptScope::exemptScope() : m_previous(false) {}
+inline rtSafety::exemptScope::~exemptScope() {}
+inline uint64_t rtSafety::getViolations() { return 0; }
+inline uint64_t rtSafety::report() { return 0; }
+#endif
+
+#endif /* rtSafety_h */
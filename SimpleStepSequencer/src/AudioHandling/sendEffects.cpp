@@ -0,0 +1,480 @@
+//
+//  sendEffects.cpp
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include "ofMain.h"
+#include "sendEffects.h"
+#include "wavFile.h"
+#include "threadTuning.h"
+#include "startupTrace.h"
+
+namespace {
+    constexpr float defaultHallSeconds = 2.5f;  // Decay of the hall send 0 starts with
+    constexpr float defaultRoomSeconds = 0.6f;  // Decay of the room send 1 starts with
+    constexpr double fadeInSeconds = 0.005;     // Onset of a generated response
+
+    uint64_t nowMicros() {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Scales interleaved stereo samples so the louder side has unit energy
+    void normalize(std::vector<float>& samples) {
+        double energy[2] = {0.0, 0.0};
+        for (size_t index = 0; index < samples.size(); index++) {
+            energy[index % 2] += (double)samples[index] * samples[index];
+        }
+        double loudest = std::max(energy[0], energy[1]);
+        if (loudest > 0.0) {
+            float scale = (float)(1.0 / std::sqrt(loudest));
+            for (float& sample : samples) {
+                sample *= scale;
+            }
+        }
+    }
+}
+
+//--------------------------------------------------------------
+
+sendEffects::sendEffects() {
+    for (auto& track : m_levels) {
+        for (auto& level : track) {
+            level.store(0.0f, std::memory_order_relaxed);
+        }
+    }
+    for (int send = 0; send < maxSends; send++) {
+        m_returnBuses[send].store(0, std::memory_order_relaxed);
+        m_returnGains[send].store(1.0f, std::memory_order_relaxed);
+        m_returnDecibels[send].store(0.0f, std::memory_order_relaxed);
+        m_sources[send].seconds = send == 0 ? defaultHallSeconds : defaultRoomSeconds;
+    }
+}
+
+//--------------------------------------------------------------
+
+sendEffects::~sendEffects() {
+    stop();
+    for (int send = 0; send < maxSends; send++) {
+        delete m_active[send].exchange(nullptr);
+        delete m_staged[send].exchange(nullptr);
+        delete m_retired[send].exchange(nullptr);
+    }
+}
+
+//--------------------------------------------------------------
+
+void sendEffects::start() {
+    if (m_running) {
+        return;
+    }
+    m_running = true;
+    m_startMicros = nowMicros();
+    m_busyMicros = 0;
+    m_worker = std::thread(&sendEffects::run, this);
+}
+
+//--------------------------------------------------------------
+
+void sendEffects::stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_running = false;
+    }
+    m_wakeUp.notify_all();
+    if (m_worker.joinable()) {
+        m_worker.join();
+    }
+}
+
+//--------------------------------------------------------------
+
+void sendEffects::setup(int sampleRate, bool inBackground) {
+    std::lock_guard<std::mutex> lock(m_buildMutex);
+    m_sampleRate = sampleRate;
+    m_buildPending = inBackground;
+    if (inBackground) {
+        m_wakeUp.notify_one(); // In case the worker is already waiting
+        return;
+    }
+    buildAll();
+}
+
+//--------------------------------------------------------------
+
+void sendEffects::buildPending() {
+    if (!m_buildPending) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_buildMutex);
+    if (m_buildPending) { // Whoever gets here first builds; the other finds it done
+        buildAll();
+        m_buildPending = false;
+    }
+}
+
+//--------------------------------------------------------------
+
+void sendEffects::buildAll() {
+    startupTrace::phase phase("reverb sends");
+    std::array<source, maxSends> sources;
+    {
+        std::lock_guard<std::mutex> lock(m_sourceMutex);
+        sources = m_sources;
+    }
+    for (int send = 0; send < maxSends; send++) {
+        auto reverb = build(sources[send]);
+        if (!reverb && !sources[send].file.empty()) {
+            // The file has gone; fall back to a hall rather than leave the send silent
+            source hall;
+            hall.seconds = send == 0 ? defaultHallSeconds : defaultRoomSeconds;
+            reverb = build(hall);
+        }
+        stage(send, std::move(reverb));
+    }
+}
+
+//--------------------------------------------------------------
+
+void sendEffects::prepare(size_t maxFrames) {
+    m_send.assign(maxFrames, 0.0f);
+    m_returns[0].assign(maxFrames, 0.0f);
+    m_returns[1].assign(maxFrames, 0.0f);
+}
+
+//--------------------------------------------------------------
+
+void sendEffects::setSendLevel(int track, int send, float gain) {
+    if (track >= 0 && track < maxTracks && send >= 0 && send < maxSends) {
+        m_levels[track][send].store(std::max(gain, 0.0f), std::memory_order_relaxed);
+    }
+}
+
+//--------------------------------------------------------------
+
+float sendEffects::getSendLevel(int track, int send) const {
+    if (track < 0 || track >= maxTracks || send < 0 || send >= maxSends) {
+        return 0.0f;
+    }
+    return m_levels[track][send].load(std::memory_order_relaxed);
+}
+
+//--------------------------------------------------------------
+
+void sendEffects::setReturn(int send, int bus, float decibels) {
+    if (send < 0 || send >= maxSends || bus < 0 || bus >= outputBuses::maxBuses) {
+        return;
+    }
+    m_returnBuses[send].store(bus, std::memory_order_relaxed);
+    m_returnDecibels[send].store(decibels, std::memory_order_relaxed);
+    m_returnGains[send].store(std::pow(10.0f, decibels / 20.0f), std::memory_order_relaxed);
+}
+
+//--------------------------------------------------------------
+
+int sendEffects::getReturnBus(int send) const {
+    if (send < 0 || send >= maxSends) {
+        return 0;
+    }
+    return m_returnBuses[send].load(std::memory_order_relaxed);
+}
+
+//--------------------------------------------------------------
+
+float sendEffects::getReturnLevel(int send) const {
+    if (send < 0 || send >= maxSends) {
+        return 0.0f;
+    }
+    return m_returnDecibels[send].load(std::memory_order_relaxed);
+}
+
+//--------------------------------------------------------------
+
+bool sendEffects::loadImpulse(int send, const std::string& file, int name) {
+    if (send < 0 || send >= maxSends) {
+        return false;
+    }
+    buildPending(); // Otherwise the default response could replace this one later
+    source from;
+    from.file = file;
+    from.name = name;
+    auto start = std::chrono::steady_clock::now();
+    auto reverb = build(from);
+    if (!reverb) {
+        return false;
+    }
+    double millis = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    ofLogNotice("sendEffects") << "Send " << send << ": " << file << " prepared in " << millis << " ms";
+    {
+        std::lock_guard<std::mutex> lock(m_sourceMutex);
+        m_sources[send] = from;
+    }
+    stage(send, std::move(reverb));
+    return true;
+}
+
+//--------------------------------------------------------------
+
+void sendEffects::makeHall(int send, float seconds) {
+    if (send < 0 || send >= maxSends) {
+        return;
+    }
+    buildPending();
+    source from;
+    from.seconds = std::min(std::max(seconds, 0.05f), (float)convolver::maxLength / m_sampleRate);
+    {
+        std::lock_guard<std::mutex> lock(m_sourceMutex);
+        m_sources[send] = from;
+    }
+    stage(send, build(from));
+}
+
+//--------------------------------------------------------------
+
+sendEffects::source sendEffects::getSource(int send) const {
+    if (send < 0 || send >= maxSends) {
+        return source();
+    }
+    std::lock_guard<std::mutex> lock(m_sourceMutex);
+    return m_sources[send];
+}
+
+//--------------------------------------------------------------
+
+void sendEffects::getPlaying(int send, int& name, float& seconds) const {
+    name = -1;
+    seconds = 0.0f;
+    convolver* reverb = send >= 0 && send < maxSends ? m_active[send].load(std::memory_order_relaxed) : nullptr;
+    if (reverb) {
+        name = reverb->getSourceName();
+        seconds = reverb->getSourceSeconds();
+    }
+}
+
+//--------------------------------------------------------------
+
+std::string sendEffects::describe(int send) const {
+    if (send < 0 || send >= maxSends) {
+        return "";
+    }
+    source from;
+    {
+        std::lock_guard<std::mutex> lock(m_sourceMutex);
+        from = m_sources[send];
+    }
+    std::string text = from.file.empty() ? "hall " + ofToString(from.seconds, 1) + " s" : from.file;
+    float gain = m_returnGains[send].load(std::memory_order_relaxed);
+    text += ", returns to bus " + ofToString(m_returnBuses[send].load(std::memory_order_relaxed))
+          + " at " + ofToString(20.0f * std::log10(std::max(gain, 1e-6f)), 1) + " dB";
+    std::string tracks;
+    for (int track = 0; track < maxTracks; track++) {
+        float level = getSendLevel(track, send);
+        if (level > 0.0f) {
+            tracks += (tracks.empty() ? "" : ", ") + ofToString(track) + " at "
+                    + ofToString(20.0f * std::log10(level), 1) + " dB";
+        }
+    }
+    return text + (tracks.empty() ? ", no tracks" : ", tracks " + tracks);
+}
+
+//--------------------------------------------------------------
+
+sendEffects::stats sendEffects::getStats() const {
+    stats current;
+    for (int send = 0; send < maxSends; send++) {
+        current.lateBlocks += m_lateBlocks[send].load(std::memory_order_relaxed);
+    }
+    uint64_t elapsed = nowMicros() - m_startMicros.load();
+    if (m_running && elapsed > 0) {
+        current.workerLoad = (double)m_busyMicros.load(std::memory_order_relaxed) / elapsed;
+    }
+    return current;
+}
+
+//--------------------------------------------------------------
+
+void sendEffects::setSynchronous(bool synchronous) {
+    m_synchronous.store(synchronous, std::memory_order_relaxed);
+}
+
+//--------------------------------------------------------------
+
+uint32_t sendEffects::process(outputBuses& buses) {
+    size_t numFrames = std::min(buses.getNumFrames(), m_send.size());
+    int numTracks = std::min(buses.getNumTracks(), maxTracks);
+    bool handedOver = false;
+    uint32_t swapped = 0;
+
+    for (int send = 0; send < maxSends; send++) {
+        // Swap in a new response once the worker has destroyed the previous outgoing one
+        if (m_staged[send].load(std::memory_order_relaxed) && !m_retired[send].load(std::memory_order_acquire)) {
+            convolver* incoming = m_staged[send].exchange(nullptr, std::memory_order_acq_rel);
+            convolver* outgoing = m_active[send].exchange(incoming, std::memory_order_acq_rel);
+            if (outgoing) {
+                m_lateBase[send] += outgoing->getLateBlocks();
+                m_retired[send].store(outgoing, std::memory_order_release);
+            }
+            swapped |= uint32_t(1) << send;
+        }
+        convolver* reverb = m_active[send].load(std::memory_order_relaxed);
+        if (!reverb) {
+            continue;
+        }
+
+        // Mix the send from the tracks; level changes ramp over the buffer
+        float* signal = m_send.data();
+        std::fill(signal, signal + numFrames, 0.0f);
+        for (int track = 0; track < numTracks; track++) {
+            float target = m_levels[track][send].load(std::memory_order_relaxed);
+            float& level = m_currentLevels[track][send];
+            if (target == 0.0f && level == 0.0f) {
+                continue;
+            }
+            const float* left = buses.getTrackChannel(track, 0);
+            const float* right = buses.getTrackChannel(track, 1);
+            float step = (target - level) / numFrames;
+            for (size_t frame = 0; frame < numFrames; frame++) {
+                signal[frame] += (level + step * (frame + 1)) * 0.5f * (left[frame] + right[frame]);
+            }
+            level = target;
+        }
+
+        handedOver |= reverb->process(signal, m_returns[0].data(), m_returns[1].data(), numFrames);
+        if (m_synchronous.load(std::memory_order_relaxed)) {
+            reverb->finishTails();
+        }
+        m_lateBlocks[send].store(m_lateBase[send] + reverb->getLateBlocks(), std::memory_order_relaxed);
+
+        float gain = m_returnGains[send].load(std::memory_order_relaxed);
+        int bus = m_returnBuses[send].load(std::memory_order_relaxed);
+        for (int side = 0; side < 2; side++) {
+            float* to = buses.getChannel(bus, side);
+            const float* from = m_returns[side].data();
+            for (size_t frame = 0; frame < numFrames; frame++) {
+                to[frame] += gain * from[frame];
+            }
+        }
+    }
+
+    // The worker takes no lock to be woken, so this never waits
+    if (handedOver && !m_synchronous.load(std::memory_order_relaxed)) {
+        m_wakeUp.notify_one();
+    }
+    return swapped;
+}
+
+//--------------------------------------------------------------
+
+std::unique_ptr<convolver> sendEffects::build(const source& from) const {
+    std::vector<float> impulse;
+    if (from.file.empty()) {
+        // Decorrelated noise on both sides, decaying by 60 dB over the decay time and
+        // growing darker as it goes
+        size_t numFrames = std::min((size_t)(from.seconds * m_sampleRate), convolver::maxLength);
+        impulse.resize(numFrames * 2);
+        std::minstd_rand random(20261019);
+        std::uniform_real_distribution<float> noise(-1.0f, 1.0f);
+        double decay = -std::log(1000.0) / (from.seconds * m_sampleRate);
+        double fadeIn = fadeInSeconds * m_sampleRate;
+        float smoothed[2] = {0.0f, 0.0f};
+        for (size_t frame = 0; frame < numFrames; frame++) {
+            float envelope = (float)(std::exp(decay * frame) * std::min(1.0, frame / fadeIn));
+            float brightness = 1.0f - 0.85f * frame / numFrames;
+            for (int side = 0; side < 2; side++) {
+                smoothed[side] += brightness * (noise(random) - smoothed[side]);
+                impulse[frame * 2 + side] = envelope * smoothed[side];
+            }
+        }
+    } else {
+        wavFile file;
+        if (!file.load(ofToDataPath(from.file))) {
+            return nullptr;
+        }
+        int numChannels = file.getNumChannels();
+        const std::vector<float>& samples = file.getSamples();
+        if (file.getNumFrames() == 0) {
+            ofLogError("sendEffects") << from.file << " is empty";
+            return nullptr;
+        }
+
+        // Take the first two channels (a mono file plays on both sides), resampled to the
+        // current rate
+        double ratio = (double)file.getSampleRate() / m_sampleRate;
+        size_t numFrames = std::min((size_t)(file.getNumFrames() / ratio), convolver::maxLength);
+        if (numFrames < (size_t)(file.getNumFrames() / ratio)) {
+            ofLogWarning("sendEffects") << from.file << " is cut to " << numFrames << " frames";
+        }
+        impulse.resize(numFrames * 2);
+        for (size_t frame = 0; frame < numFrames; frame++) {
+            double position = frame * ratio;
+            size_t before = std::min((size_t)position, file.getNumFrames() - 1);
+            size_t after = std::min(before + 1, file.getNumFrames() - 1);
+            float weight = (float)(position - before);
+            for (int side = 0; side < 2; side++) {
+                int channel = std::min(side, numChannels - 1);
+                float first = samples[before * numChannels + channel];
+                float second = samples[after * numChannels + channel];
+                impulse[frame * 2 + side] = first + (second - first) * weight;
+            }
+        }
+    }
+    normalize(impulse);
+    auto reverb = std::make_unique<convolver>(impulse, 2);
+    reverb->setSource(from.name, from.seconds);
+    return reverb;
+}
+
+//--------------------------------------------------------------
+
+void sendEffects::stage(int send, std::unique_ptr<convolver> next) {
+    // A staged convolver that was never swapped in was never used, so it can go here
+    delete m_staged[send].exchange(next.release(), std::memory_order_acq_rel);
+}
+
+//--------------------------------------------------------------
+
+void sendEffects::run() {
+    threadTuning::applyWorkerAffinity(); // Keep off the audio thread's cores, if configured
+
+    while (m_running) {
+        buildPending(); // Only does something once, at startup
+
+        // Shortest blocks first, since they are due soonest; after every block, look again
+        bool worked = false;
+        for (int level = 1; level < convolver::maxLevels && !worked; level++) {
+            for (int send = 0; send < maxSends && !worked; send++) {
+                convolver* reverb = m_active[send].load(std::memory_order_acquire);
+                if (!reverb) {
+                    continue;
+                }
+                uint64_t start = nowMicros();
+                worked = reverb->runTail(level);
+                if (worked) {
+                    m_busyMicros.fetch_add(nowMicros() - start, std::memory_order_relaxed);
+                }
+            }
+        }
+        collectRetired(); // Nothing above still uses a swapped-out convolver
+        if (!worked) {
+            // The audio thread signals without the mutex, so a signal can slip in before
+            // the wait; the timeout bounds how late such a block is picked up
+            std::unique_lock<std::mutex> lock(m_wakeMutex);
+            m_wakeUp.wait_for(lock, std::chrono::milliseconds(2));
+        }
+    }
+    collectRetired();
+}
+
+//--------------------------------------------------------------
+
+void sendEffects::collectRetired() {
+    for (int send = 0; send < maxSends; send++) {
+        delete m_retired[send].exchange(nullptr, std::memory_order_acq_rel);
+    }
+}
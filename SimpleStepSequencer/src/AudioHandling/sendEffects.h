@@ -0,0 +1,171 @@
+//
+//  sendEffects.h
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+/*
+The sendEffects class holds the send buses: every track feeds each send with a level of its
+own, after its inserts, and every send runs through a convolution reverb (see convolver)
+whose output returns into one of the output buses. Send 0 starts as a generated hall and
+send 1 as a generated room; either can load an impulse response from a WAV file in bin/data
+instead. Files at another sample rate are resampled when they are loaded, and every
+response is scaled to unit energy, so a send at 0 dB returns about as loud as it went in.
+
+A worker thread owned by this class runs the tail blocks of the convolvers. It always takes
+the level with the shortest blocks first, since those are due soonest, and it is woken by
+the audio thread whenever a block is handed over. New impulse responses are prepared on the
+calling thread and swapped in by the audio thread at its next buffer; the replaced convolver
+is destroyed by the worker, the only other thread that uses it. At startup the responses can
+be left to the worker, so the first buffers play dry instead of waiting for the halls; any
+call that depends on them builds them first if the worker has not yet.
+*/
+
+// These directives are used to prevent multiple inclusions of the same header file, which
+// helps avoid redefinition errors and improves compilation efficiency:
+#ifndef sendEffects_h
+#define sendEffects_h
+
+#include <array>                // For the sends and the track levels
+#include <atomic>               // For settings and convolvers that change while playing
+#include <condition_variable>   // For waking up the worker
+#include <mutex>                // For the worker's wait and the sources
+#include <string>               // For file names and describe()
+#include <thread>               // For the worker
+#include <vector>               // For the send signals
+#include "convolver.h"
+#include "outputBuses.h"
+
+class sendEffects {
+public:
+    static constexpr int maxSends = 2;                      // Send buses
+    static constexpr int maxTracks = outputBuses::maxTracks; // Tracks that can feed the sends
+
+    // Where the response of a send comes from, kept to rebuild it for a new sample rate
+    struct source {
+        std::string file;           // WAV file in bin/data, or empty for a generated hall
+        float seconds = 2.0f;       // Decay time of a generated hall
+        int name = -1;              // Id of the file in a session trace (see sessionTrace::addName())
+    };
+
+    // Statistics of the sends
+    struct stats {
+        uint64_t lateBlocks = 0;    // Tail blocks the worker did not finish in time
+        double workerLoad = 0.0;    // Share of the time the worker spent convolving (0-1)
+    };
+
+    // Constructor; sends start with generated responses and no track feeding them
+    sendEffects();
+
+    // Destructor that stops the worker and destroys the convolvers
+    ~sendEffects();
+
+    // Starts the worker thread
+    void start();
+
+    // Stops the worker thread
+    void stop();
+
+    // Sets the sample rate and rebuilds the responses for it (stream must be stopped). In the
+    // background, the worker builds them once started, and the sends are silent until then.
+    void setup(int sampleRate, bool inBackground = false);
+
+    // Builds the responses now if setup() left them to the worker and it has not yet
+    void buildPending();
+
+    // Allocates the send signals for buffers of up to maxFrames (stream must be stopped)
+    void prepare(size_t maxFrames);
+
+    // Sets how much of a track goes to a send (linear gain, 0 = none)
+    void setSendLevel(int track, int send, float gain);
+
+    // Returns how much of a track goes to a send
+    float getSendLevel(int track, int send) const;
+
+    // Returns a send into a bus at the given level in decibels
+    void setReturn(int send, int bus, float decibels);
+
+    // Returns the bus a send returns into
+    int getReturnBus(int send) const;
+
+    // Returns the level a send returns at, in decibels as it was set
+    float getReturnLevel(int send) const;
+
+    // Loads an impulse response from a WAV file in bin/data into a send; reads and prepares
+    // it on the calling thread. name is the file's id in a session trace, which the
+    // response is tagged with. Returns false (and logs why) if the file cannot be used.
+    bool loadImpulse(int send, const std::string& file, int name = -1);
+
+    // Gives a send a generated hall: decorrelated noise decaying by 60 dB over the given time
+    void makeHall(int send, float seconds);
+
+    // Returns where the response of a send comes from (the latest one loaded, even if it
+    // is not swapped in yet)
+    source getSource(int send) const;
+
+    // Returns the tag of the response a send plays: the name of its file, or -1 for a hall
+    // of the given decay time (audio thread)
+    void getPlaying(int send, int& name, float& seconds) const;
+
+    // Describes a send, for display
+    std::string describe(int send) const;
+
+    // Returns the statistics of all sends
+    stats getStats() const;
+
+    // Makes the audio thread finish the reverb tails itself, for offline rendering, which
+    // runs faster than real time (see convolver::finishTails())
+    void setSynchronous(bool synchronous);
+
+    // Feeds the sends from the tracks, runs the reverbs and adds their returns to the buses
+    // (audio thread). Returns a mask with bit n set if send n swapped in a new response.
+    uint32_t process(outputBuses& buses);
+
+private:
+    // Builds a convolver from a source at the current sample rate, tagged with it; nullptr
+    // on failure
+    std::unique_ptr<convolver> build(const source& from) const;
+
+    // Builds and stages the responses of all sends (m_buildMutex must be held)
+    void buildAll();
+
+    // Hands a convolver to the audio thread
+    void stage(int send, std::unique_ptr<convolver> next);
+
+    // Body of the worker thread
+    void run();
+
+    // Destroys convolvers the audio thread has swapped out (worker thread)
+    void collectRetired();
+
+    int m_sampleRate = 44100;
+    std::mutex m_buildMutex;                    // Serializes building the responses of all sends
+    std::atomic<bool> m_buildPending{false};    // setup() left the responses to the worker
+    std::array<source, maxSends> m_sources;             // Guarded by m_sourceMutex
+    mutable std::mutex m_sourceMutex;
+    std::array<std::array<std::atomic<float>, maxSends>, maxTracks> m_levels; // Send levels of every track
+    std::array<std::array<float, maxSends>, maxTracks> m_currentLevels{};     // Levels reached (audio thread)
+    std::array<std::atomic<int>, maxSends> m_returnBuses;                     // Bus every send returns into
+    std::array<std::atomic<float>, maxSends> m_returnGains;                   // Linear return levels
+    std::array<std::atomic<float>, maxSends> m_returnDecibels;                // The same as they were set
+
+    std::array<std::atomic<convolver*>, maxSends> m_active{};   // Used by the audio thread and the worker
+    std::array<std::atomic<convolver*>, maxSends> m_staged{};   // Waiting to be swapped in
+    std::array<std::atomic<convolver*>, maxSends> m_retired{};  // Swapped out, waiting for the worker
+    std::array<uint64_t, maxSends> m_lateBase{};                // Late blocks of swapped-out convolvers (audio thread)
+    std::array<std::atomic<uint64_t>, maxSends> m_lateBlocks{}; // Late blocks of every send
+
+    std::vector<float> m_send;                  // Mono signal of the send being processed
+    std::vector<float> m_returns[2];            // Reverb output of the send being processed
+
+    std::thread m_worker;                       // Runs the tail blocks
+    std::atomic<bool> m_running{false};
+    std::atomic<bool> m_synchronous{false};     // The audio thread finishes the tails
+    std::mutex m_wakeMutex;                     // Only for the worker's wait
+    std::condition_variable m_wakeUp;           // Signalled when a block is handed over
+    std::atomic<uint64_t> m_busyMicros{0};      // Time the worker spent convolving
+    std::atomic<uint64_t> m_startMicros{0};     // When the worker started
+};
+
+#endif /* sendEffects_h */
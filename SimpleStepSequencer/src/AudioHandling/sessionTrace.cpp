@@ -0,0 +1,448 @@
+//
+//  sessionTrace.cpp
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+#include <algorithm>
+#include <cstring>
+#include "ofMain.h"
+#include "sessionTrace.h"
+
+namespace {
+    constexpr char magic[4] = {'S', 'S', 'T', 'R'};
+    constexpr size_t headerBytes = 40;
+    constexpr uint8_t checkpointTag = 0xFF;      // Tag of a checkpoint; commands are tagged with their type
+    constexpr uint8_t nameTag = 0xFE;            // Tag of a name: its id, length and bytes, without a frame
+    constexpr uint64_t hashBasis = 0xcbf29ce484222325ull;   // FNV-1a
+    constexpr uint64_t hashPrime = 0x100000001b3ull;
+
+    // Adds a 32-bit value to a hash
+    uint64_t hashValue(uint64_t hash, uint32_t value) {
+        return (hash ^ value) * hashPrime;
+    }
+
+    // Little-endian writers and readers, so a trace reads the same on any machine
+    void putFixed(std::vector<uint8_t>& bytes, uint64_t value, int size) {
+        for (int i = 0; i < size; i++) {
+            bytes.push_back(uint8_t(value >> (8 * i)));
+        }
+    }
+
+    uint64_t getFixed(const uint8_t* bytes, int size) {
+        uint64_t value = 0;
+        for (int i = 0; i < size; i++) {
+            value |= uint64_t(bytes[i]) << (8 * i);
+        }
+        return value;
+    }
+
+    // Variable-length integers: 7 bits a byte, small magnitudes (zigzag) in few bytes
+    void putVarint(std::vector<uint8_t>& bytes, int64_t value) {
+        uint64_t zigzag = (uint64_t(value) << 1) ^ uint64_t(value >> 63);
+        while (zigzag >= 0x80) {
+            bytes.push_back(uint8_t(zigzag) | 0x80);
+            zigzag >>= 7;
+        }
+        bytes.push_back(uint8_t(zigzag));
+    }
+
+    bool getVarint(const std::vector<uint8_t>& bytes, size_t& position, int64_t& value) {
+        uint64_t zigzag = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (position >= bytes.size()) {
+                return false;
+            }
+            uint8_t byte = bytes[position++];
+            zigzag |= uint64_t(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                value = int64_t(zigzag >> 1) ^ -int64_t(zigzag & 1);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    uint32_t floatBits(float value) {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    float bitsFloat(uint32_t bits) {
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    bool getFloat(const std::vector<uint8_t>& bytes, size_t& position, float& value) {
+        if (position + 4 > bytes.size()) {
+            return false;
+        }
+        value = bitsFloat((uint32_t)getFixed(&bytes[position], 4));
+        position += 4;
+        return true;
+    }
+}
+
+//--------------------------------------------------------------
+
+sessionTrace::~sessionTrace() {
+    stop();
+}
+
+//--------------------------------------------------------------
+
+bool sessionTrace::start(const std::string& path, const header& setup) {
+    stop();
+    m_file = std::fopen(path.c_str(), "wb");
+    if (!m_file) {
+        ofLogError("sessionTrace") << "Cannot create " << path;
+        return false;
+    }
+    m_header = setup;
+    m_lastWrittenFrame = 0;
+    m_namesWritten = 0;
+    m_state.clear();
+    writeHeader(); // Written again with the frame of the first buffer when the trace stops
+    startChecking();
+    return true;
+}
+
+//--------------------------------------------------------------
+
+void sessionTrace::startChecking() {
+    std::vector<entry> stale;
+    drain(stale); // Whatever is left from a previous trace
+    m_startFrame = -1;
+    m_dropped = 0;
+    m_generation++; // The audio thread starts over even if it never saw the previous trace stop
+    m_requested.store(true, std::memory_order_release);
+}
+
+//--------------------------------------------------------------
+
+void sessionTrace::stop() {
+    if (!m_requested) {
+        return;
+    }
+    m_requested.store(false, std::memory_order_release);
+    if (m_file) {
+        flush();
+        m_header.startFrame = std::max<int64_t>(m_startFrame, 0);
+        std::fseek(m_file, 0, SEEK_SET);
+        writeHeader();
+        std::fclose(m_file);
+        m_file = nullptr;
+        if (m_dropped > 0) {
+            ofLogWarning("sessionTrace") << m_dropped << " entries were dropped; the trace will not replay exactly";
+        }
+    }
+}
+
+//--------------------------------------------------------------
+
+bool sessionTrace::isActive() const {
+    return m_requested.load(std::memory_order_relaxed);
+}
+
+//--------------------------------------------------------------
+
+void sessionTrace::beginBuffer(int64_t frame, size_t numFrames) {
+    m_nextFrame.store(frame + (int64_t)numFrames, std::memory_order_relaxed);
+    bool active = m_requested.load(std::memory_order_acquire);
+    uint32_t generation = m_generation.load(std::memory_order_relaxed);
+    if (active && (!m_active || generation != m_activeGeneration)) {
+        // The trace starts at a buffer boundary, so a replay hashes the same buffers
+        m_startFrame.store(frame, std::memory_order_relaxed);
+        m_bufferCount = 0;
+        m_hash = hashBasis;
+    }
+    m_active = active;
+    m_activeGeneration = generation;
+    m_bufferFrame = frame;
+}
+
+//--------------------------------------------------------------
+
+void sessionTrace::recordApplied(const engineCommand& command, int64_t frame) {
+    if (!m_active) {
+        return;
+    }
+    size_t write = m_writeIndex.load(std::memory_order_relaxed);
+    if (write - m_readIndex.load(std::memory_order_acquire) == capacity) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    entry& next = m_ring[write & (capacity - 1)];
+    next.checkpoint = false;
+    next.command = command;
+    next.command.sampleTime = frame;
+    m_writeIndex.store(write + 1, std::memory_order_release);
+}
+
+//--------------------------------------------------------------
+
+void sessionTrace::hashHit(int track, int step, int frame) {
+    if (!m_active) {
+        return;
+    }
+    m_hash = hashValue(m_hash, uint32_t(track));
+    m_hash = hashValue(m_hash, uint32_t(step));
+    m_hash = hashValue(m_hash, uint32_t(m_bufferFrame + frame - m_startFrame.load(std::memory_order_relaxed)));
+}
+
+//--------------------------------------------------------------
+
+void sessionTrace::endBuffer(const ofSoundBuffer& buffer) {
+    if (!m_active) {
+        return;
+    }
+    for (float sample : buffer.getBuffer()) {
+        m_hash = hashValue(m_hash, floatBits(sample));
+    }
+    if (++m_bufferCount < checkpointBuffers) {
+        return;
+    }
+
+    size_t write = m_writeIndex.load(std::memory_order_relaxed);
+    if (write - m_readIndex.load(std::memory_order_acquire) == capacity) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        entry& next = m_ring[write & (capacity - 1)];
+        next.checkpoint = true;
+        next.command = engineCommand();
+        next.command.sampleTime = m_bufferFrame + (int64_t)buffer.getNumFrames();
+        next.hash = m_hash;
+        m_writeIndex.store(write + 1, std::memory_order_release);
+    }
+    m_bufferCount = 0;
+    m_hash = hashBasis;
+}
+
+//--------------------------------------------------------------
+
+void sessionTrace::recordState(const engineCommand& command) {
+    if (!m_file) {
+        return;
+    }
+    entry next;
+    next.command = command;
+    m_state.push_back(next);
+}
+
+//--------------------------------------------------------------
+
+int sessionTrace::addName(const std::string& name) {
+    auto found = std::find(m_names.begin(), m_names.end(), name);
+    if (found != m_names.end()) {
+        return int(found - m_names.begin());
+    }
+    m_names.push_back(name);
+    return int(m_names.size() - 1);
+}
+
+//--------------------------------------------------------------
+
+void sessionTrace::drain(std::vector<entry>& entries) {
+    size_t first = entries.size();
+    size_t read = m_readIndex.load(std::memory_order_relaxed);
+    size_t write = m_writeIndex.load(std::memory_order_acquire);
+    for (; read != write; read++) {
+        entries.push_back(m_ring[read & (capacity - 1)]);
+    }
+    m_readIndex.store(read, std::memory_order_release);
+
+    // Commands due at the same frame keep the order they were recorded in
+    std::stable_sort(entries.begin() + first, entries.end(), [](const entry& a, const entry& b) {
+        return a.command.sampleTime < b.command.sampleTime;
+    });
+}
+
+//--------------------------------------------------------------
+
+void sessionTrace::flush() {
+    int64_t startFrame = m_startFrame.load(std::memory_order_relaxed);
+    if (!m_file || startFrame < 0) {
+        return; // The state waits for the frame of the first buffer traced
+    }
+    m_flushed.clear();
+    for (entry& next : m_state) {
+        next.command.sampleTime = startFrame; // Before everything recorded in that buffer
+        m_flushed.push_back(next);
+    }
+    m_state.clear();
+    drain(m_flushed);
+    m_bytes.clear();
+    
+    // Names go before the commands that refer to them
+    for (; m_namesWritten < m_names.size(); m_namesWritten++) {
+        const std::string& name = m_names[m_namesWritten];
+        m_bytes.push_back(nameTag);
+        putVarint(m_bytes, (int64_t)m_namesWritten);
+        putVarint(m_bytes, (int64_t)name.size());
+        m_bytes.insert(m_bytes.end(), name.begin(), name.end());
+    }
+    for (const entry& next : m_flushed) {
+        const engineCommand& command = next.command;
+        m_bytes.push_back(next.checkpoint ? checkpointTag : uint8_t(command.kind));
+        putVarint(m_bytes, command.sampleTime - m_lastWrittenFrame);
+        m_lastWrittenFrame = command.sampleTime;
+        if (next.checkpoint) {
+            putFixed(m_bytes, next.hash, 8);
+            continue;
+        }
+        // Arguments that are 0 are left out; a mask says which are there
+        const int32_t ints[4] = {command.first, command.second, command.third, command.fourth};
+        uint8_t mask = 0;
+        for (int i = 0; i < 4; i++) {
+            mask |= ints[i] != 0 ? uint8_t(1 << i) : 0;
+        }
+        mask |= command.value != 0.0f ? 0x10 : 0;
+        mask |= command.value2 != 0.0f ? 0x20 : 0;
+        m_bytes.push_back(mask);
+        for (int i = 0; i < 4; i++) {
+            if (ints[i] != 0) {
+                putVarint(m_bytes, ints[i]);
+            }
+        }
+        if (mask & 0x10) {
+            putFixed(m_bytes, floatBits(command.value), 4);
+        }
+        if (mask & 0x20) {
+            putFixed(m_bytes, floatBits(command.value2), 4);
+        }
+    }
+    if (!m_bytes.empty()) {
+        std::fwrite(m_bytes.data(), 1, m_bytes.size(), m_file);
+        std::fflush(m_file); // A trace cut short by a crash is readable up to the last flush
+    }
+}
+
+//--------------------------------------------------------------
+
+int64_t sessionTrace::getNextFrame() const {
+    return m_nextFrame.load(std::memory_order_relaxed);
+}
+
+//--------------------------------------------------------------
+
+uint64_t sessionTrace::getDropped() const {
+    return m_dropped;
+}
+
+//--------------------------------------------------------------
+
+void sessionTrace::writeHeader() {
+    std::vector<uint8_t> bytes(magic, magic + 4);
+    putFixed(bytes, version, 4);
+    putFixed(bytes, m_header.sampleRate, 4);
+    putFixed(bytes, m_header.bufferSize, 4);
+    putFixed(bytes, m_header.numOutputChannels, 4);
+    putFixed(bytes, floatBits(m_header.tempo), 4);
+    putFixed(bytes, uint32_t(m_header.beats), 4);
+    putFixed(bytes, uint32_t(m_header.tuplets), 4);
+    putFixed(bytes, uint64_t(m_header.startFrame), 8);
+    std::fwrite(bytes.data(), 1, bytes.size(), m_file);
+}
+
+//--------------------------------------------------------------
+
+bool sessionTrace::load(const std::string& path, header& setup, std::vector<entry>& entries,
+                        std::vector<std::string>& names) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        ofLogError("sessionTrace") << "Cannot open " << path;
+        return false;
+    }
+    std::vector<uint8_t> bytes;
+    uint8_t block[65536];
+    for (size_t read; (read = std::fread(block, 1, sizeof(block), file)) > 0;) {
+        bytes.insert(bytes.end(), block, block + read);
+    }
+    std::fclose(file);
+
+    uint32_t fileVersion = bytes.size() < headerBytes ? 0 : (uint32_t)getFixed(&bytes[4], 4);
+    if (bytes.size() < headerBytes || std::memcmp(bytes.data(), magic, 4) != 0
+        || fileVersion < 1 || fileVersion > version) {
+        ofLogError("sessionTrace") << path << " is not a session trace of version " << version << " or earlier";
+        return false;
+    }
+    setup.sampleRate = (uint32_t)getFixed(&bytes[8], 4);
+    setup.bufferSize = (uint32_t)getFixed(&bytes[12], 4);
+    setup.numOutputChannels = (uint32_t)getFixed(&bytes[16], 4);
+    setup.tempo = bitsFloat((uint32_t)getFixed(&bytes[20], 4));
+    setup.beats = (int32_t)getFixed(&bytes[24], 4);
+    setup.tuplets = (int32_t)getFixed(&bytes[28], 4);
+    setup.startFrame = (int64_t)getFixed(&bytes[32], 8);
+
+    entries.clear();
+    names.clear();
+    size_t position = headerBytes;
+    int64_t frame = 0;
+    bool truncated = false;
+    while (position < bytes.size()) {
+        truncated = true; // Until the whole entry has been read
+        entry next;
+        uint8_t tag = bytes[position++];
+        if (tag == nameTag) {
+            int64_t id = 0, length = 0;
+            // Names are written in the order of their ids
+            if (!getVarint(bytes, position, id) || !getVarint(bytes, position, length)
+                || id != (int64_t)names.size() || length < 0 || (uint64_t)length > bytes.size() - position) {
+                break;
+            }
+            names.emplace_back(bytes.begin() + position, bytes.begin() + position + length);
+            position += (size_t)length;
+            truncated = false;
+            continue;
+        }
+        int64_t delta = 0;
+        if (!getVarint(bytes, position, delta)) {
+            break;
+        }
+        frame += delta;
+        next.command.sampleTime = frame;
+        if (tag == checkpointTag) {
+            if (position + 8 > bytes.size()) {
+                break;
+            }
+            next.checkpoint = true;
+            next.hash = getFixed(&bytes[position], 8);
+            position += 8;
+            entries.push_back(next);
+            truncated = false;
+            continue;
+        }
+        if (position >= bytes.size()) {
+            break;
+        }
+        next.command.kind = static_cast<engineCommand::type>(tag);
+        uint8_t mask = bytes[position++];
+        int32_t* ints[4] = {&next.command.first, &next.command.second, &next.command.third, &next.command.fourth};
+        bool complete = true;
+        for (int i = 0; i < 4 && complete; i++) {
+            int64_t value = 0;
+            if (mask & (1 << i)) {
+                complete = getVarint(bytes, position, value);
+                *ints[i] = (int32_t)value;
+            }
+        }
+        if (complete && (mask & 0x10)) {
+            complete = getFloat(bytes, position, next.command.value);
+        }
+        if (complete && (mask & 0x20)) {
+            complete = getFloat(bytes, position, next.command.value2);
+        }
+        if (!complete) {
+            break;
+        }
+        entries.push_back(next);
+        truncated = false;
+    }
+    if (truncated) {
+        ofLogWarning("sessionTrace") << path << " ends in the middle of an entry; replaying up to there";
+    }
+    return true;
+}
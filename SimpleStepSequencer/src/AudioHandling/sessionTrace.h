@@ -0,0 +1,171 @@
+//
+//  sessionTrace.h
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+/*
+The sessionTrace class records every input of the engine into a compact binary file, so a
+session can be played again offline and sound exactly the same: a glitch from a show can be
+replayed under a profiler, and a collection of traces becomes a corpus of performance tests.
+
+Every input is stored as the engineCommand it came in as, stamped with the frame of the
+sample clock it took effect at. Every command reaches the engine through the command queue,
+the GUI and the console too (see metronome::applyControl()), so the audio thread records
+each one as it applies it, at its exact frame. Only undo and redo restore the steps on the
+control thread; the pages they changed are sent after them and recorded at the next buffer,
+so those are exact to within a buffer.
+
+To check a replay, the output of every buffer and every hit played are hashed, and the hash
+of every checkpointBuffers buffers is stored as a checkpoint. A replay computes the same
+checkpoints and compares them, so it shows where the output started to differ.
+
+The audio thread writes into a preallocated lock-free ring and never blocks; flush() empties
+it into the file from a control thread. Entries that do not fit are dropped and counted.
+
+Kits and reverb responses are built off the audio thread and swapped in later, so they are
+recorded when the audio thread swaps them in, as kit and sendResponse commands at that frame.
+The files they were loaded from are stored once in the trace as names the commands refer to
+by id (see addName()); a replay loads them again and stages them before their buffer.
+
+A trace opens with the state the engine was in (see metronome::traceState()): the pattern,
+the routing, the inserts, the sends, the kit and the transport, so it can start partway
+through a session. The state is read
+on the control thread and stamped with the first buffer traced. The replay starts
+from the top of the bar, though, and sounds still ringing when the trace started are not
+part of it, so for every checkpoint to match, record from the start (--trace) and replay in
+a fresh session (see audioManager::replayTrace()).
+
+The live input is not recorded, but every hit it records into the pattern is, as a recordStep
+command at the frame it was recorded at, so step recording replays without the input.
+
+Not recorded: the clock mode. A session that follows an external clock replays on the
+internal one, and the checkpoints show where that made a difference.
+*/
+
+// These directives are used to prevent multiple inclusions of the same header file, which
+// helps avoid redefinition errors and improves compilation efficiency:
+#ifndef sessionTrace_h
+#define sessionTrace_h
+
+#include <array>    // For the ring
+#include <atomic>   // For the lock-free indices
+#include <cstdint>  // For frames and hashes
+#include <cstdio>   // For the file
+#include <string>   // For file names
+#include <vector>   // For the entries of a loaded trace
+#include "engineCommand.h"
+
+class ofSoundBuffer;
+
+class sessionTrace {
+public:
+    static constexpr uint32_t version = 2;        // Format of the file (2 added names; 1 still reads)
+    static constexpr int checkpointBuffers = 64;  // Buffers hashed into one checkpoint
+    static constexpr size_t capacity = 16384;     // Entries waiting to be flushed (power of two)
+
+    // How the engine was set up when the trace started
+    struct header {
+        uint32_t sampleRate = 44100;
+        uint32_t bufferSize = 512;
+        uint32_t numOutputChannels = 2;
+        float tempo = 120.0f;
+        int32_t beats = 4;
+        int32_t tuplets = 4;
+        int64_t startFrame = 0;     // Frame of the sample clock of the first buffer traced
+    };
+
+    // A command, or the hash of the output up to a frame
+    struct entry {
+        bool checkpoint = false;
+        engineCommand command;      // sampleTime is the frame it took effect at (checkpoints: the frame they end at)
+        uint64_t hash = 0;          // Checkpoints only: hash of the output and the hits since the previous one
+    };
+
+    // Destructor that finishes the file
+    ~sessionTrace();
+
+    // Starts recording into a file; returns false if it cannot be created (control thread)
+    bool start(const std::string& path, const header& setup);
+
+    // Starts computing checkpoints without a file, to check a replay (control thread)
+    void startChecking();
+
+    // Stops tracing and finishes the file, if there is one (control thread)
+    void stop();
+
+    // Returns true while tracing
+    bool isActive() const;
+
+    // Marks the start of a buffer: publishes the frame the next buffer starts at, and picks
+    // up a start or stop (audio thread)
+    void beginBuffer(int64_t frame, size_t numFrames);
+
+    // Records a command from the queue as it is applied (audio thread)
+    void recordApplied(const engineCommand& command, int64_t frame);
+
+    // Hashes a hit played at a frame of the current buffer (audio thread)
+    void hashHit(int track, int step, int frame);
+
+    // Hashes the output of a buffer, and adds a checkpoint every checkpointBuffers buffers
+    // (audio thread)
+    void endBuffer(const ofSoundBuffer& buffer);
+
+    // Records a command of the state the trace opens with, written before everything else
+    // and stamped with the first buffer traced (control thread, right after start())
+    void recordState(const engineCommand& command);
+
+    // Returns the id commands refer to a name by (the files of a kit, an impulse response);
+    // a name keeps its id for as long as the engine runs, and every trace writes the names
+    // it needs (control thread)
+    int addName(const std::string& name);
+
+    // Moves the entries recorded so far into entries, sorted by frame (control thread)
+    void drain(std::vector<entry>& entries);
+
+    // Writes the entries recorded so far to the file, once the first buffer has been traced
+    // (control thread)
+    void flush();
+
+    // Returns the frame the next buffer starts at
+    int64_t getNextFrame() const;
+
+    // Returns the number of entries dropped because the ring was full
+    uint64_t getDropped() const;
+
+    // Reads a trace file, and the names its commands refer to by id; returns false (and
+    // logs why) if it cannot be read
+    static bool load(const std::string& path, header& setup, std::vector<entry>& entries,
+                     std::vector<std::string>& names);
+
+private:
+    // Writes the header at the start of the file
+    void writeHeader();
+
+    std::FILE* m_file = nullptr;                // Trace being written, nullptr when checking
+    header m_header;                            // Setup of the trace being written
+    int64_t m_lastWrittenFrame = 0;             // Frames are stored relative to the previous entry
+    std::vector<entry> m_state;                 // State the trace opens with, until it is written (control thread)
+    std::vector<entry> m_flushed;               // Entries being written (control thread)
+    std::vector<uint8_t> m_bytes;               // Encoded entries being written
+    std::vector<std::string> m_names;           // Names added, at their id (control thread)
+    size_t m_namesWritten = 0;                  // Names already in the file
+
+    std::atomic<bool> m_requested{false};       // Set by start(), cleared by stop()
+    std::atomic<uint32_t> m_generation{0};      // Counts the traces started
+    bool m_active = false;                      // Tracing this buffer (audio thread)
+    uint32_t m_activeGeneration = 0;            // Trace the audio thread is hashing for
+    std::atomic<int64_t> m_startFrame{-1};      // First buffer traced, -1 until it has begun
+    std::atomic<int64_t> m_nextFrame{0};        // Frame the next buffer starts at
+    int64_t m_bufferFrame = 0;                  // Frame the current buffer started at (audio thread)
+    int m_bufferCount = 0;                      // Buffers hashed into the current checkpoint (audio thread)
+    uint64_t m_hash = 0;                        // Hash of the current checkpoint (audio thread)
+
+    std::array<entry, capacity> m_ring;         // Entries from the audio thread
+    std::atomic<size_t> m_writeIndex{0};        // Advanced by the audio thread
+    std::atomic<size_t> m_readIndex{0};         // Advanced by drain()
+    std::atomic<uint64_t> m_dropped{0};         // Entries that did not fit
+};
+
+#endif /* sessionTrace_h */
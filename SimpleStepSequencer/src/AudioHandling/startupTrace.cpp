@@ -0,0 +1,158 @@
+//
+//  startupTrace.cpp
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <thread>
+#include "ofMain.h"
+#include "startupTrace.h"
+
+namespace {
+    // Returns the steady clock in microseconds
+    int64_t steadyMicros() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+//--------------------------------------------------------------
+
+startupTrace::phase::phase(const char* name) : m_name(name), m_start(startupTrace::instance().nowMicros()) {
+}
+
+//--------------------------------------------------------------
+
+startupTrace::phase::~phase() {
+    startupTrace& trace = startupTrace::instance();
+    trace.addPhase(m_name, m_start, trace.nowMicros());
+}
+
+//--------------------------------------------------------------
+
+startupTrace& startupTrace::instance() {
+    static startupTrace trace;
+    return trace;
+}
+
+//--------------------------------------------------------------
+
+void startupTrace::begin() {
+    m_origin = steadyMicros();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_threads[0] = std::hash<std::thread::id>()(std::this_thread::get_id()); // The main thread is thread 1
+    m_numThreads = 1;
+}
+
+//--------------------------------------------------------------
+
+void startupTrace::setExpectsFrame(bool expectsFrame) {
+    m_expectsFrame = expectsFrame;
+}
+
+//--------------------------------------------------------------
+
+int64_t startupTrace::nowMicros() {
+    int64_t now = steadyMicros();
+    int64_t origin = m_origin.load(std::memory_order_relaxed);
+    if (origin == 0 && m_origin.compare_exchange_strong(origin, now)) {
+        origin = now; // begin() was not called; the first time asked for becomes the start
+    }
+    return now - origin;
+}
+
+//--------------------------------------------------------------
+
+void startupTrace::markFirstCallback() {
+    if (m_firstCallback.load(std::memory_order_relaxed) >= 0) {
+        return; // Every callback after the first only costs this load
+    }
+    int64_t expected = -1;
+    m_firstCallback.compare_exchange_strong(expected, nowMicros());
+}
+
+//--------------------------------------------------------------
+
+void startupTrace::markFirstFrame() {
+    if (m_firstFrame.load(std::memory_order_relaxed) < 0) {
+        m_firstFrame = nowMicros();
+    }
+}
+
+//--------------------------------------------------------------
+
+void startupTrace::addPhase(const char* name, int64_t start, int64_t end) {
+    if (m_reported) {
+        return; // Startup is over
+    }
+    size_t id = std::hash<std::thread::id>()(std::this_thread::get_id());
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_numPhases == maxPhases) {
+        return;
+    }
+    int thread = (int)(std::find(m_threads.begin(), m_threads.begin() + m_numThreads, id) - m_threads.begin());
+    if (thread == m_numThreads) {
+        m_threads[m_numThreads++] = id;  // At most one new thread per phase, so there is room
+    }
+    m_phases[m_numPhases++] = record{name, start, end, thread + 1};
+}
+
+//--------------------------------------------------------------
+
+bool startupTrace::reportWhenReady() {
+    if (m_reported || getFirstCallbackMillis() < 0 || (m_expectsFrame && getFirstFrameMillis() < 0)) {
+        return false;
+    }
+    m_reported = true;
+    ofLogNotice("startupTrace") << getReport();
+    return true;
+}
+
+//--------------------------------------------------------------
+
+std::string startupTrace::getReport() const {
+    std::array<record, maxPhases> phases;
+    int numPhases = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        phases = m_phases;
+        numPhases = m_numPhases;
+    }
+    std::sort(phases.begin(), phases.begin() + numPhases,
+              [](const record& a, const record& b) { return a.start < b.start; });
+
+    char line[160];
+    std::string report = "Startup: first audio callback at ";
+    double callback = getFirstCallbackMillis();
+    double frame = getFirstFrameMillis();
+    std::snprintf(line, sizeof(line), "%.1f ms", callback);
+    report += callback < 0 ? "-" : line;
+    if (m_expectsFrame) {
+        std::snprintf(line, sizeof(line), ", first frame at %.1f ms", frame);
+        report += frame < 0 ? ", no frame yet" : line;
+    }
+    for (int i = 0; i < numPhases; i++) {
+        std::snprintf(line, sizeof(line), "\n  %8.1f - %8.1f ms  thread %d  %s", phases[i].start / 1000.0,
+                      phases[i].end / 1000.0, phases[i].thread, phases[i].name);
+        report += line;
+    }
+    return report;
+}
+
+//--------------------------------------------------------------
+
+double startupTrace::getFirstCallbackMillis() const {
+    int64_t micros = m_firstCallback.load(std::memory_order_relaxed);
+    return micros < 0 ? -1.0 : micros / 1000.0;
+}
+
+//--------------------------------------------------------------
+
+double startupTrace::getFirstFrameMillis() const {
+    int64_t micros = m_firstFrame.load(std::memory_order_relaxed);
+    return micros < 0 ? -1.0 : micros / 1000.0;
+}
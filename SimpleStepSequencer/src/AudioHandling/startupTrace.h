@@ -0,0 +1,111 @@
+//
+//  startupTrace.h
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+/*
+The startupTrace class measures how long the program takes to start: when every
+initialization phase began and ended, on which thread, and the two moments that matter to
+someone waiting for the sequencer, the first audio callback and the first frame drawn.
+Times are in milliseconds since begin(), which main() calls first thing.
+
+Startup is spread over several threads (see metronome and ofApp::setup), so phases may
+overlap; the trace shows how much. Phases that end after the report has been printed are
+not recorded, so work that keeps running later, like loading another kit, adds nothing.
+The report is printed once, by reportWhenReady() on a control thread, as soon as the first
+callback (and, with a window, the first frame) has happened.
+
+There is one trace for the whole program, reached through instance(). markFirstCallback()
+is safe to call from the audio thread: it neither locks nor allocates.
+*/
+
+// These directives are used to prevent multiple inclusions of the same header file, which
+// helps avoid redefinition errors and improves compilation efficiency:
+#ifndef startupTrace_h
+#define startupTrace_h
+
+#include <array>    // For the phases
+#include <atomic>   // For the milestones
+#include <cstdint>  // For times in microseconds
+#include <mutex>    // For the phases
+#include <string>   // For the report
+
+class startupTrace {
+public:
+    static constexpr int maxPhases = 32;  // Phases recorded; more are ignored
+
+    // Times the scope it lives in as a phase of startup, on whatever thread it runs
+    class phase {
+    public:
+        explicit phase(const char* name);
+        ~phase();
+
+        phase(const phase&) = delete;
+        phase& operator=(const phase&) = delete;
+
+    private:
+        const char* m_name;   // Name of the phase (a string literal)
+        int64_t m_start;      // Microseconds since begin()
+    };
+
+    // Returns the program's trace
+    static startupTrace& instance();
+
+    // Marks the start of the program; call first thing in main()
+    void begin();
+
+    // Sets whether the program draws frames, so the report waits for the first one
+    void setExpectsFrame(bool expectsFrame);
+
+    // Marks the first audio callback; only the first call counts (audio thread)
+    void markFirstCallback();
+
+    // Marks the first frame drawn; only the first call counts (GUI thread)
+    void markFirstFrame();
+
+    // Prints the report once the first callback, and the first frame if there is a window,
+    // have happened; returns true when it printed it. Call regularly from a control thread.
+    bool reportWhenReady();
+
+    // Returns the report as text, whether or not everything has happened yet
+    std::string getReport() const;
+
+    // Returns milliseconds from begin() to the first callback and the first frame, or -1 if
+    // they have not happened yet
+    double getFirstCallbackMillis() const;
+    double getFirstFrameMillis() const;
+
+private:
+    // Only instance() creates the trace
+    startupTrace() = default;
+
+    // Returns microseconds since begin()
+    int64_t nowMicros();
+
+    // Records a finished phase
+    void addPhase(const char* name, int64_t start, int64_t end);
+
+    // A finished phase
+    struct record {
+        const char* name = "";
+        int64_t start = 0;      // Microseconds since begin()
+        int64_t end = 0;
+        int thread = 0;         // Threads are numbered in the order they first record a phase
+    };
+
+    std::atomic<int64_t> m_origin{0};           // Steady clock at begin(), in microseconds
+    std::atomic<int64_t> m_firstCallback{-1};   // Microseconds since begin(), -1 until it happens
+    std::atomic<int64_t> m_firstFrame{-1};
+    std::atomic<bool> m_expectsFrame{false};
+    std::atomic<bool> m_reported{false};
+
+    mutable std::mutex m_mutex;                 // Guards the phases
+    std::array<record, maxPhases> m_phases;
+    int m_numPhases = 0;
+    std::array<size_t, maxPhases> m_threads{};  // Hashed ids of the threads seen, in order
+    int m_numThreads = 0;
+};
+
+#endif /* startupTrace_h */
@@ -0,0 +1,357 @@
+//
+//  stepPattern.cpp
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+#include <algorithm>
+#include <cmath>
+#include "stepPattern.h"
+
+// Constructor implementation
+stepPattern::stepPattern() {
+    for (auto& slot : m_words) {
+        for (auto& track : slot) {
+            for (auto& word : track) {
+                word.store(0); // Every step starts switched off
+            }
+        }
+    }
+    clearMicroTiming();
+    clearParams();
+    for (auto& changed : m_changed) {
+        changed.store(0);
+    }
+}
+
+//--------------------------------------------------------------
+
+void stepPattern::setup(int steps) {
+    if (steps < 0) steps = 0;
+    if (steps > maxSteps) steps = maxSteps;
+
+    // Default groove: hi-hat on every step, snare and kick empty
+    for (int track = 0; track < numTracks; track++) {
+        for (int word = 0; word < wordsPerTrack; word++) {
+            uint64_t bits = 0;
+            if (track == 0) {
+                int stepsInWord = steps - word * stepsPerWord;
+                if (stepsInWord >= stepsPerWord) {
+                    bits = ~uint64_t(0);
+                } else if (stepsInWord > 0) {
+                    bits = (uint64_t(1) << stepsInWord) - 1;
+                }
+            }
+            for (auto& slot : m_words) {
+                slot[track][word].store(bits, std::memory_order_relaxed);
+            }
+        }
+    }
+    clearMicroTiming(); // The default groove is on the grid
+    clearParams();      // and plays the instruments' own sounds
+    m_numSteps.store(steps, std::memory_order_release);
+    markAllChanged();
+}
+
+//--------------------------------------------------------------
+
+void stepPattern::resize(int steps) {
+    steps = std::max(0, std::min(steps, maxSteps));
+    int oldSteps = getNumSteps();
+
+    // Clear the steps from the new end on, so steps of a longer rhythm do not come back
+    // when the pattern grows again (the undo history still has them)
+    for (int slot = 0; slot < numSlots; slot++) {
+        for (int track = 0; track < numTracks; track++) {
+            for (int step = steps; step < std::max(steps, oldSteps); step++) {
+                m_micro[slot][track][step].store(0, std::memory_order_relaxed);
+                for (auto& param : m_params[slot][track][step]) {
+                    param.store(0, std::memory_order_relaxed);
+                }
+            }
+            for (int first = steps - steps % stepsPerWord; first < std::max(steps, oldSteps); first += stepsPerWord) {
+                int kept = std::max(0, steps - first);  // Steps of this word inside the pattern
+                uint64_t mask = kept >= stepsPerWord ? ~uint64_t(0) : (uint64_t(1) << kept) - 1;
+                word(slot, track, first).fetch_and(mask, std::memory_order_relaxed);
+                markChanged(slot, track, first);
+            }
+        }
+    }
+    m_numSteps.store(steps, std::memory_order_release);
+}
+
+//--------------------------------------------------------------
+
+int stepPattern::getNumSteps() const {
+    return m_numSteps.load(std::memory_order_acquire);
+}
+
+//--------------------------------------------------------------
+
+bool stepPattern::isValid(int track, int step) const {
+    return track >= 0 && track < numTracks && step >= 0 && step < getNumSteps();
+}
+
+//--------------------------------------------------------------
+
+bool stepPattern::isStepOn(int track, int step) const {
+    // Called from the audio thread: invalid indices are simply off, nothing is logged
+    if (!isValid(track, step)) {
+        return false;
+    }
+    uint64_t bits = word(m_currentSlot.load(std::memory_order_relaxed), track, step).load(std::memory_order_relaxed);
+    return (bits >> (step % stepsPerWord)) & 1;
+}
+
+//--------------------------------------------------------------
+
+void stepPattern::setStep(int track, int step, bool on) {
+    setStepInSlot(m_currentSlot.load(std::memory_order_relaxed), track, step, on);
+}
+
+//--------------------------------------------------------------
+
+uint64_t stepPattern::getWord(int track, int word) const {
+    if (track < 0 || track >= numTracks || word < 0 || word >= wordsPerTrack) {
+        return 0;
+    }
+    return m_words[m_currentSlot.load(std::memory_order_relaxed)][track][word].load(std::memory_order_relaxed);
+}
+
+//--------------------------------------------------------------
+
+void stepPattern::setWord(int track, int word, uint64_t steps) {
+    if (track < 0 || track >= numTracks || word < 0 || word >= wordsPerTrack) {
+        return;
+    }
+    setPageSteps(pageIndex(m_currentSlot.load(std::memory_order_relaxed), track, word * stepsPerWord), steps);
+}
+
+//--------------------------------------------------------------
+
+uint64_t stepPattern::getPageSteps(int index) const {
+    if (index < 0 || index >= numPages) {
+        return 0;
+    }
+    return m_words[index / (numTracks * wordsPerTrack)][index / wordsPerTrack % numTracks][index % wordsPerTrack]
+        .load(std::memory_order_relaxed);
+}
+
+//--------------------------------------------------------------
+
+void stepPattern::setPageSteps(int index, uint64_t steps) {
+    if (index < 0 || index >= numPages) {
+        return;
+    }
+    int slot = index / (numTracks * wordsPerTrack);
+    int track = index / wordsPerTrack % numTracks;
+    int first = index % wordsPerTrack * stepsPerWord;
+    int inside = std::max(0, std::min(getNumSteps() - first, stepsPerWord)); // Steps of the word inside the pattern
+    steps &= inside >= stepsPerWord ? ~uint64_t(0) : (uint64_t(1) << inside) - 1;
+
+    std::atomic<uint64_t>& target = m_words[slot][track][index % wordsPerTrack];
+    for (uint64_t added = steps & ~target.load(std::memory_order_relaxed); added != 0; added &= added - 1) {
+        int step = first + __builtin_ctzll(added);
+        m_micro[slot][track][step].store(0, std::memory_order_relaxed); // New steps sit on the grid
+    }
+    target.store(steps, std::memory_order_release);
+    markChanged(slot, track, first);
+}
+
+//--------------------------------------------------------------
+
+void stepPattern::setStepInSlot(int slot, int track, int step, bool on) {
+    if (slot < 0 || slot >= numSlots || !isValid(track, step)) {
+        return;
+    }
+    uint64_t mask = uint64_t(1) << (step % stepsPerWord);
+    if (on) {
+        m_micro[slot][track][step].store(0, std::memory_order_relaxed); // Steps set by hand sit on the grid
+        word(slot, track, step).fetch_or(mask, std::memory_order_relaxed);
+    } else {
+        word(slot, track, step).fetch_and(~mask, std::memory_order_relaxed);
+    }
+    markChanged(slot, track, step);
+}
+
+//--------------------------------------------------------------
+
+void stepPattern::toggleStep(int track, int step) {
+    if (!isValid(track, step)) {
+        return;
+    }
+    int slot = m_currentSlot.load(std::memory_order_relaxed);
+    uint64_t mask = uint64_t(1) << (step % stepsPerWord);
+    m_micro[slot][track][step].store(0, std::memory_order_relaxed); // Steps set by hand sit on the grid
+    word(slot, track, step).fetch_xor(mask, std::memory_order_relaxed);
+    markChanged(slot, track, step);
+}
+
+//--------------------------------------------------------------
+
+void stepPattern::recordStep(int track, int step, int micro) {
+    if (!isValid(track, step)) {
+        return;
+    }
+    micro = std::max(-microResolution / 2, std::min(micro, microResolution / 2 - 1));
+    int slot = m_currentSlot.load(std::memory_order_relaxed);
+    m_micro[slot][track][step].store((int8_t)micro, std::memory_order_relaxed);
+    word(slot, track, step).fetch_or(uint64_t(1) << (step % stepsPerWord), std::memory_order_relaxed);
+    markChanged(slot, track, step);
+}
+
+//--------------------------------------------------------------
+
+int stepPattern::getMicroTiming(int track, int step) const {
+    if (!isValid(track, step)) {
+        return 0;
+    }
+    return m_micro[m_currentSlot.load(std::memory_order_relaxed)][track][step].load(std::memory_order_relaxed);
+}
+
+//--------------------------------------------------------------
+
+void stepPattern::clearMicroTiming() {
+    for (auto& slot : m_micro) {
+        for (auto& track : slot) {
+            for (auto& micro : track) {
+                micro.store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+}
+
+//--------------------------------------------------------------
+
+void stepPattern::setStepParam(int track, int step, int param, float value) {
+    if (!isValid(track, step) || param < 0 || param >= numParams) {
+        return;
+    }
+    value = std::max(-1.0f, std::min(value, 1.0f));
+    int slot = m_currentSlot.load(std::memory_order_relaxed);
+    m_params[slot][track][step][param].store((int8_t)std::lround(value * paramResolution), std::memory_order_relaxed);
+    markChanged(slot, track, step);
+}
+
+//--------------------------------------------------------------
+
+float stepPattern::getStepParam(int track, int step, int param) const {
+    if (!isValid(track, step) || param < 0 || param >= numParams) {
+        return 0.0f;
+    }
+    int slot = m_currentSlot.load(std::memory_order_relaxed);
+    return m_params[slot][track][step][param].load(std::memory_order_relaxed) / float(paramResolution);
+}
+
+//--------------------------------------------------------------
+
+void stepPattern::clearParams() {
+    for (auto& slot : m_params) {
+        for (auto& track : slot) {
+            for (auto& step : track) {
+                for (auto& param : step) {
+                    param.store(0, std::memory_order_relaxed);
+                }
+            }
+        }
+    }
+}
+
+//--------------------------------------------------------------
+
+bool stepPattern::page::operator==(const page& other) const {
+    return steps == other.steps && micro == other.micro && params == other.params;
+}
+
+//--------------------------------------------------------------
+
+int stepPattern::pageIndex(int slot, int track, int step) {
+    return (slot * numTracks + track) * wordsPerTrack + step / stepsPerWord;
+}
+
+//--------------------------------------------------------------
+
+void stepPattern::readPage(int index, page& out) const {
+    int slot = index / (numTracks * wordsPerTrack);
+    int track = index / wordsPerTrack % numTracks;
+    int first = index % wordsPerTrack * stepsPerWord;
+    out.steps = m_words[slot][track][first / stepsPerWord].load(std::memory_order_relaxed);
+    for (int i = 0; i < stepsPerWord && first + i < maxSteps; i++) {
+        out.micro[i] = m_micro[slot][track][first + i].load(std::memory_order_relaxed);
+        for (int param = 0; param < numParams; param++) {
+            out.params[i][param] = m_params[slot][track][first + i][param].load(std::memory_order_relaxed);
+        }
+    }
+}
+
+//--------------------------------------------------------------
+
+void stepPattern::writePage(int index, const page& in) {
+    int slot = index / (numTracks * wordsPerTrack);
+    int track = index / wordsPerTrack % numTracks;
+    int first = index % wordsPerTrack * stepsPerWord;
+    for (int i = 0; i < stepsPerWord && first + i < maxSteps; i++) {
+        m_micro[slot][track][first + i].store(in.micro[i], std::memory_order_relaxed);
+        for (int param = 0; param < numParams; param++) {
+            m_params[slot][track][first + i][param].store(in.params[i][param], std::memory_order_relaxed);
+        }
+    }
+    // The steps go last, with their timing and params already in place
+    m_words[slot][track][first / stepsPerWord].store(in.steps, std::memory_order_release);
+}
+
+//--------------------------------------------------------------
+
+void stepPattern::restoreNumSteps(int steps) {
+    m_numSteps.store(std::max(0, std::min(steps, maxSteps)), std::memory_order_release);
+}
+
+//--------------------------------------------------------------
+
+void stepPattern::takeChangedPages(std::array<uint64_t, changedWords>& changed) {
+    for (int i = 0; i < changedWords; i++) {
+        changed[i] = m_changed[i].exchange(0, std::memory_order_acq_rel);
+    }
+}
+
+//--------------------------------------------------------------
+
+void stepPattern::markChanged(int slot, int track, int step) {
+    int index = pageIndex(slot, track, step);
+    m_changed[index / 64].fetch_or(uint64_t(1) << (index % 64), std::memory_order_release);
+}
+
+//--------------------------------------------------------------
+
+void stepPattern::markAllChanged() {
+    for (int index = 0; index < numPages; index++) {
+        m_changed[index / 64].fetch_or(uint64_t(1) << (index % 64), std::memory_order_release);
+    }
+}
+
+//--------------------------------------------------------------
+
+void stepPattern::selectSlot(int slot) {
+    if (slot >= 0 && slot < numSlots) {
+        m_currentSlot.store(slot, std::memory_order_relaxed);
+    }
+}
+
+//--------------------------------------------------------------
+
+int stepPattern::getSlot() const {
+    return m_currentSlot.load(std::memory_order_relaxed);
+}
+
+//--------------------------------------------------------------
+
+std::atomic<uint64_t>& stepPattern::word(int slot, int track, int step) {
+    return m_words[slot][track][step / stepsPerWord];
+}
+
+//--------------------------------------------------------------
+
+const std::atomic<uint64_t>& stepPattern::word(int slot, int track, int step) const {
+    return m_words[slot][track][step / stepsPerWord];
+}
@@ -0,0 +1,165 @@
+//
+//  stepPattern.h
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+/*
+The stepPattern class holds which steps are switched on for every track. It used to live in
+sequencerGui as one flag per rectangle; keeping it separate lets the metronome play a
+pattern without any GUI, for example in headless mode. Steps are stored bit-packed, 64 steps
+per word, in atomic words so the GUI (or a control interface) can edit the pattern while the
+audio thread reads it. There are several pattern slots; the selected slot is the one that
+is played and edited.
+
+Every step also has a micro-timing offset: how far before or after the grid it is played,
+in 1/128 of a step. Steps entered by hand sit on the grid; steps recorded from the live
+input (see metronome::setStepRecording()) keep the offset the player hit them with.
+
+Every step also has numParams sound params, each from -1 to 1, that are handed to the
+instrument with its hits (see noteEvent::params); the synth uses them for tune, decay, tone
+and noise. They stay with a step when it is switched off and on again.
+
+For the undo history (see patternHistory) the pattern is divided into pages: one word of
+steps of one track in one slot, with the micro-timing and params of those steps. Every edit
+marks its page as changed, from any thread and without locking, so a snapshot only has to
+copy the pages changed since the previous one.
+*/
+
+// These directives are used to prevent multiple inclusions of the same header file, which
+// helps avoid redefinition errors and improves compilation efficiency:
+#ifndef stepPattern_h
+#define stepPattern_h
+
+#include <array>    // For std::array
+#include <atomic>   // For std::atomic
+#include <cstdint>  // For uint64_t
+
+class stepPattern {
+public:
+    static constexpr int numTracks = 3;      // Hi-hat, snare and kick
+    static constexpr int maxSteps = 1024;    // 128 beats of 8 tuplets
+    static constexpr int stepsPerWord = 64;  // Steps packed into one word
+    static constexpr int wordsPerTrack = (maxSteps + stepsPerWord - 1) / stepsPerWord;
+    static constexpr int numSlots = 8;       // Patterns that can be switched between
+    static constexpr int microResolution = 128; // Micro-timing units per step
+    static constexpr int numParams = 4;      // Sound params per step
+    static constexpr int paramResolution = 127; // Param units from 0 to 1
+    using trackWords = std::array<uint64_t, wordsPerTrack>; // Packed steps of one track
+
+    static constexpr int numPages = numSlots * numTracks * wordsPerTrack; // Pages of the undo history
+    static constexpr int changedWords = (numPages + 63) / 64;             // Words of changed-page flags
+
+    // One word of steps of one track in one slot, with their micro-timing and params
+    struct page {
+        uint64_t steps = 0;                                             // Bit n is step n of the word
+        std::array<int8_t, stepsPerWord> micro{};                       // See getMicroTiming()
+        std::array<std::array<int8_t, numParams>, stepsPerWord> params{}; // See getStepParam()
+
+        bool operator==(const page& other) const;
+    };
+
+    // Constructor that creates an empty pattern
+    stepPattern();
+
+    // Sets the number of steps and resets every slot to the default groove
+    void setup(int steps);
+
+    // Changes the number of steps and keeps the steps that are still inside the pattern;
+    // the steps beyond the new end are cleared in every slot
+    void resize(int steps);
+
+    // Returns the number of steps per track
+    int getNumSteps() const;
+
+    // Returns whether the step is switched on; out-of-range steps are off
+    bool isStepOn(int track, int step) const;
+
+    // Switches a step on or off
+    void setStep(int track, int step, bool on);
+
+    // Flips a step
+    void toggleStep(int track, int step);
+
+    // Returns a word of packed steps of a track in the selected slot, bit n for step
+    // word * stepsPerWord + n
+    uint64_t getWord(int track, int word) const;
+
+    // Replaces a word of packed steps of a track in the selected slot; steps beyond the end
+    // are left off, and steps switched on sit on the grid
+    void setWord(int track, int word, uint64_t steps);
+
+    // Returns the packed steps of a page, in any slot (see pageIndex())
+    uint64_t getPageSteps(int index) const;
+
+    // Replaces the packed steps of a page, in any slot, like setWord()
+    void setPageSteps(int index, uint64_t steps);
+
+    // Switches a step on or off in a slot that may not be selected
+    void setStepInSlot(int slot, int track, int step, bool on);
+
+    // Switches a step on with a micro-timing offset in 1/microResolution of a step, between
+    // -microResolution / 2 (half a step early) and microResolution / 2 - 1
+    void recordStep(int track, int step, int micro);
+
+    // Returns the micro-timing offset of a step; 0 is on the grid
+    int getMicroTiming(int track, int step) const;
+
+    // Sets a sound param of a step, from -1 to 1 (stored in 1/paramResolution steps)
+    void setStepParam(int track, int step, int param, float value);
+
+    // Returns a sound param of a step; 0 is the instrument's own sound
+    float getStepParam(int track, int step, int param) const;
+
+    // Selects the slot that is played and edited
+    void selectSlot(int slot);
+
+    // Returns the selected slot
+    int getSlot() const;
+
+    // Returns true if the track and step are inside the pattern
+    bool isValid(int track, int step) const;
+
+    // Returns the index of the page holding a step of a track in a slot
+    static int pageIndex(int slot, int track, int step);
+
+    // Copies a page out of the pattern
+    void readPage(int index, page& out) const;
+
+    // Overwrites a page, without marking it as changed (for restoring a snapshot)
+    void writePage(int index, const page& in);
+
+    // Sets the number of steps without touching any step (for restoring a snapshot)
+    void restoreNumSteps(int steps);
+
+    // Hands out the flags of the pages changed since the previous call, bit n of word n / 64
+    // for page n, and clears them
+    void takeChangedPages(std::array<uint64_t, changedWords>& changed);
+
+private:
+    // Puts every step of every slot back on the grid
+    void clearMicroTiming();
+
+    // Sets every param of every step of every slot back to 0
+    void clearParams();
+
+    // Marks the page holding a step as changed
+    void markChanged(int slot, int track, int step);
+
+    // Marks every page as changed
+    void markAllChanged();
+
+    // Returns the word holding a step of a track in a slot
+    std::atomic<uint64_t>& word(int slot, int track, int step);
+    const std::atomic<uint64_t>& word(int slot, int track, int step) const;
+
+    std::atomic<int> m_numSteps{0};     // Steps per track
+    std::atomic<int> m_currentSlot{0};  // Slot that is played and edited
+    std::array<std::array<std::array<std::atomic<uint64_t>, wordsPerTrack>, numTracks>, numSlots> m_words; // Packed steps
+    std::array<std::array<std::array<std::atomic<int8_t>, maxSteps>, numTracks>, numSlots> m_micro;         // Micro-timing of every step
+    std::array<std::array<std::array<std::array<std::atomic<int8_t>, numParams>, maxSteps>, numTracks>, numSlots> m_params; // Sound params of every step
+    std::array<std::atomic<uint64_t>, changedWords> m_changed;  // Flags of the pages changed since the latest snapshot
+};
+
+#endif /* stepPattern_h */
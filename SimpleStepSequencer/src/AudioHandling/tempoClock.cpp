@@ -0,0 +1,302 @@
+//
+//  tempoClock.cpp
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+#include <algorithm>
+#include <cmath>
+#include "tempoClock.h"
+
+// Constructor that stores the sample rate; the clock starts at position zero
+tempoClock::tempoClock(int sampleRate) : m_sampleRate(sampleRate) {
+}
+
+//--------------------------------------------------------------
+
+void tempoClock::setSampleRate(int sampleRate) {
+    if (sampleRate <= 0 || sampleRate == m_sampleRate) {
+        return; // Nothing to do for invalid or unchanged sample rates
+    }
+    reanchor(); // Fold the position travelled at the old rate into the anchor
+
+    // Scale the remaining ramp so it still takes the same amount of time
+    m_rampFrames = std::llround(m_rampFrames * (double)sampleRate / m_sampleRate);
+    m_sampleRate = sampleRate;
+}
+
+//--------------------------------------------------------------
+
+void tempoClock::setTicksPerBeat(int ticksPerBeat) {
+    if (ticksPerBeat <= 0 || ticksPerBeat == m_ticksPerBeat) {
+        return; // Nothing to do for invalid or unchanged subdivisions
+    }
+    reanchor();
+
+    // Keep the position in beats, expressed in the new tick unit
+    double beats = m_anchorTicks / m_ticksPerBeat;
+    m_ticksPerBeat = ticksPerBeat;
+    m_anchorTicks = beats * m_ticksPerBeat;
+    m_nextTick = (int64_t)std::ceil(m_anchorTicks);
+}
+
+//--------------------------------------------------------------
+
+void tempoClock::setTempo(double bpm) {
+    if (bpm <= 0.0) {
+        return; // A tempo must be positive
+    }
+    reanchor();
+    m_startTempo = bpm;
+    m_targetTempo = bpm;
+    m_rampFrames = 0; // Cancel any running ramp
+}
+
+//--------------------------------------------------------------
+
+void tempoClock::rampTempo(double targetBpm, double seconds, rampShape shape) {
+    int64_t frames = std::llround(seconds * m_sampleRate);
+    if (targetBpm <= 0.0 || frames <= 0) {
+        setTempo(targetBpm); // Zero-length ramps are plain tempo changes
+        return;
+    }
+    reanchor();
+    m_startTempo = getTempo(); // Start gliding from wherever the tempo is right now
+    m_targetTempo = targetBpm;
+    m_rampFrames = frames;
+    m_rampShape = shape;
+}
+
+//--------------------------------------------------------------
+
+void tempoClock::nudge(double ticks) {
+    // The shift only moves the position; ticks that have already been reported are
+    // not repeated, a backwards nudge simply delays the next one
+    m_anchorTicks += ticks;
+}
+
+//--------------------------------------------------------------
+
+void tempoClock::reset() {
+    m_sampleTime = 0;
+    m_anchorSample = 0;
+    m_anchorTicks = 0.0;
+    m_nextTick = 0;
+
+    // Jump straight to the end of any running ramp
+    m_startTempo = m_targetTempo;
+    m_rampFrames = 0;
+}
+
+//--------------------------------------------------------------
+
+bool tempoClock::advance() {
+    bool tickStarts = false;
+    double position = getTickPosition();
+
+    // Report the tick once the position has reached it
+    if (position >= (double)m_nextTick) {
+        tickStarts = true;
+        m_nextTick = (int64_t)std::floor(position) + 1;
+    }
+
+    m_sampleTime++;
+
+    // Once a ramp has finished, continue from a fresh constant-tempo segment
+    if (m_rampFrames > 0 && m_sampleTime - m_anchorSample >= m_rampFrames) {
+        reanchor();
+    }
+    return tickStarts;
+}
+
+//--------------------------------------------------------------
+
+double tempoClock::getTempo() const {
+    int64_t frames = m_sampleTime - m_anchorSample;
+    if (m_rampFrames == 0 || frames >= m_rampFrames) {
+        return m_targetTempo; // Not ramping (anymore)
+    }
+
+    double progress = (double)frames / m_rampFrames;
+    if (m_rampShape == rampShape::exponential) {
+        return m_startTempo * std::pow(m_targetTempo / m_startTempo, progress);
+    }
+    return m_startTempo + (m_targetTempo - m_startTempo) * progress;
+}
+
+//--------------------------------------------------------------
+
+double tempoClock::getTargetTempo() const {
+    return m_targetTempo;
+}
+
+//--------------------------------------------------------------
+
+double tempoClock::getTickPosition() const {
+    return m_anchorTicks + ticksSinceAnchor(m_sampleTime - m_anchorSample);
+}
+
+//--------------------------------------------------------------
+
+double tempoClock::getBeatPosition() const {
+    return getTickPosition() / m_ticksPerBeat;
+}
+
+//--------------------------------------------------------------
+
+int64_t tempoClock::getSampleTime() const {
+    return m_sampleTime;
+}
+
+//--------------------------------------------------------------
+
+bool tempoClock::isRamping() const {
+    return m_rampFrames > 0;
+}
+
+//--------------------------------------------------------------
+
+double tempoClock::ticksSinceAnchor(int64_t frames) const {
+    double k = ticksPerFramePerBpm();
+
+    if (m_rampFrames == 0) {
+        // Constant tempo: the position is a single multiplication of an exact frame count,
+        // so no rounding error builds up no matter how long the clock runs
+        return k * m_targetTempo * (double)frames;
+    }
+
+    // Integrate the tempo curve over the part of the ramp that has been travelled
+    int64_t rampPart = std::min(frames, m_rampFrames);
+    double n = (double)rampPart;
+    double length = (double)m_rampFrames;
+    double ticks;
+
+    double logRatio = std::log(m_targetTempo / m_startTempo);
+    if (m_rampShape == rampShape::exponential && std::abs(logRatio) > 1e-12) {
+        ticks = k * m_startTempo * length / logRatio * (std::exp(logRatio * n / length) - 1.0);
+    } else {
+        ticks = k * n * (m_startTempo + (m_targetTempo - m_startTempo) * n / (2.0 * length));
+    }
+
+    // Anything after the end of the ramp runs at the target tempo
+    if (frames > m_rampFrames) {
+        ticks += k * m_targetTempo * (double)(frames - m_rampFrames);
+    }
+    return ticks;
+}
+
+//--------------------------------------------------------------
+
+void tempoClock::reanchor() {
+    int64_t frames = m_sampleTime - m_anchorSample;
+    double tempoNow = getTempo();
+
+    m_anchorTicks += ticksSinceAnchor(frames);
+    m_anchorSample = m_sampleTime;
+
+    if (m_rampFrames > 0) {
+        // Continue the remainder of the ramp from the current tempo; both ramp shapes
+        // follow the same curve when restarted from a point on it
+        m_rampFrames = std::max<int64_t>(0, m_rampFrames - frames);
+        m_startTempo = m_rampFrames > 0 ? tempoNow : m_targetTempo;
+    }
+}
+
+//--------------------------------------------------------------
+
+tempoClock::driftReport tempoClock::measureDrift(int sampleRate, int bpm, int ticksPerBeat, double hours) {
+    driftReport report;
+    if (sampleRate <= 0 || bpm <= 0 || ticksPerBeat <= 0 || hours <= 0.0) {
+        return report;
+    }
+    tempoClock clock(sampleRate);
+    clock.setTicksPerBeat(ticksPerBeat);
+    clock.setTempo(bpm);
+
+    // Tick k is due at the first frame whose position reaches it:
+    // ceil(k * 60 * sampleRate / (bpm * ticksPerBeat))
+    const int64_t numerator = 60 * (int64_t)sampleRate;
+    const int64_t denominator = (int64_t)bpm * ticksPerBeat;
+    report.frames = (int64_t)(hours * 3600.0 * sampleRate);
+    for (int64_t frame = 0; frame < report.frames; frame++) {
+        if (clock.advance()) {
+            int64_t due = (report.ticks * numerator + denominator - 1) / denominator;
+            report.worstError = std::max(report.worstError, std::abs(frame - due));
+            report.ticks++;
+        }
+    }
+    report.expectedTicks = ((report.frames - 1) * denominator) / numerator + 1; // Ticks due at frames 0 to frames - 1
+    return report;
+}
+
+//--------------------------------------------------------------
+
+tempoClock::driftReport tempoClock::measureRamp(int sampleRate, double startBpm, double targetBpm, double rampSeconds,
+                                                rampShape shape, int ticksPerBeat, double hours) {
+    driftReport report;
+    if (sampleRate <= 0 || startBpm <= 0.0 || targetBpm <= 0.0 || ticksPerBeat <= 0 || hours <= 0.0) {
+        return report;
+    }
+    tempoClock clock(sampleRate);
+    clock.setTicksPerBeat(ticksPerBeat);
+    clock.setTempo(startBpm);
+    int64_t rampFrames = std::llround(std::max(rampSeconds, 0.0) * sampleRate);
+    if (rampFrames > 0) {
+        clock.rampTempo(targetBpm, rampSeconds, shape);
+    } else {
+        targetBpm = startBpm;
+    }
+
+    // Position of a frame, integrated in closed form over the whole run from frame 0
+    const long double k = (long double)ticksPerBeat / (60.0L * sampleRate);
+    const long double start = startBpm, target = targetBpm, length = (long double)rampFrames;
+    const long double logRatio = std::log(target / start);
+    auto position = [&](int64_t frame) {
+        long double n = (long double)std::min(frame, rampFrames);
+        long double ticks = 0.0L;
+        if (rampFrames > 0 && shape == rampShape::exponential && std::fabs(logRatio) > 1e-12L) {
+            ticks = k * start * length / logRatio * std::expm1(logRatio * n / length);
+        } else if (rampFrames > 0) {
+            ticks = k * n * (start + (target - start) * n / (2.0L * length));
+        }
+        return ticks + k * target * (long double)std::max<int64_t>(frame - rampFrames, 0);
+    };
+    auto tempoAt = [&](int64_t frame) {
+        if (frame >= rampFrames) {
+            return target;
+        }
+        long double progress = (long double)frame / length;
+        return shape == rampShape::exponential ? start * std::exp(logRatio * progress)
+                                               : start + (target - start) * progress;
+    };
+
+    // Tick n is due at the first frame whose position reaches it. Rounding of the positions
+    // is allowed for, far below a frame.
+    const long double tolerance = 1e-6L;
+    report.frames = (int64_t)(hours * 3600.0 * sampleRate);
+    for (int64_t frame = 0; frame < report.frames; frame++) {
+        if (clock.advance()) {
+            long double tick = (long double)report.ticks;
+            long double ticksPerFrame = k * tempoAt(frame);
+            int64_t error = 0;
+            long double here = position(frame);
+            long double before = frame > 0 ? position(frame - 1) : -1.0L;
+            if (here < tick - tolerance) {
+                error = (int64_t)std::ceil((tick - here) / ticksPerFrame); // Early
+            } else if (before >= tick + tolerance) {
+                error = (int64_t)std::floor((before - tick) / ticksPerFrame) + 1; // Late
+            }
+            report.worstError = std::max(report.worstError, error);
+            report.ticks++;
+        }
+    }
+    report.expectedTicks = (int64_t)std::floor(position(report.frames - 1)) + 1; // Ticks due at frames 0 to frames - 1
+    return report;
+}
+
+//--------------------------------------------------------------
+
+double tempoClock::ticksPerFramePerBpm() const {
+    return m_ticksPerBeat / (60.0 * m_sampleRate);
+}
@@ -0,0 +1,118 @@
+//
+//  tempoClock.h
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+/*
+The tempoClock class keeps track of the musical position of the sequencer in ticks. The
+position is never accumulated from rounded per-tick sample counts; instead it is evaluated
+from a 64-bit frame counter relative to an anchor point, using double precision. This keeps
+tick onsets sample-exact over arbitrarily long runs. Tempo changes can be applied
+immediately or as linear or exponential ramps that are integrated per sample, so the tempo
+glides smoothly from the old value to the new one.
+*/
+
+// These directives are used to prevent multiple inclusions of the same header file, which
+// helps avoid redefinition errors and improves compilation efficiency:
+#ifndef tempoClock_h
+#define tempoClock_h
+
+#include <cstdint>  // For int64_t
+
+class tempoClock {
+public:
+    // Shapes available for tempo ramps
+    enum class rampShape {
+        linear,       // Tempo changes by the same amount of BPM per sample
+        exponential   // Tempo changes by the same ratio per sample
+    };
+
+    // Result of measureDrift()
+    struct driftReport {
+        int64_t frames = 0;         // Frames the clock was advanced
+        int64_t ticks = 0;          // Ticks it reported
+        int64_t expectedTicks = 0;  // Ticks that are due in that many frames
+        int64_t worstError = 0;     // Largest distance of a tick from its exact frame, in frames
+    };
+
+    // Runs a clock at a constant tempo for the given number of simulated hours and compares
+    // every tick with the frame it is due at, computed exactly in integers. Takes a few
+    // seconds per simulated hour; the clock has not drifted when worstError is 0.
+    static driftReport measureDrift(int sampleRate, int bpm, int ticksPerBeat, double hours);
+
+    // Like measureDrift(), for any tempo and for ramps: the clock glides from startBpm to
+    // targetBpm over rampSeconds (0 = a constant startBpm) and then keeps the target tempo.
+    // Every tick is compared with the frame the closed-form position, evaluated in long
+    // double, reaches it at.
+    static driftReport measureRamp(int sampleRate, double startBpm, double targetBpm, double rampSeconds,
+                                   rampShape shape, int ticksPerBeat, double hours);
+
+    // Constructor that initializes the clock with a sample rate
+    tempoClock(int sampleRate);
+
+    // Changes the sample rate while keeping the current musical position
+    void setSampleRate(int sampleRate);
+
+    // Sets how many ticks make up one beat, keeping the current position in beats
+    void setTicksPerBeat(int ticksPerBeat);
+
+    // Sets the tempo immediately, cancelling any running ramp
+    void setTempo(double bpm);
+
+    // Glides from the current tempo to targetBpm over the given number of seconds
+    void rampTempo(double targetBpm, double seconds, rampShape shape);
+
+    // Moves the position by a (possibly fractional) number of ticks without changing tempo
+    void nudge(double ticks);
+
+    // Resets the musical position to zero, the next advance() will start tick 0
+    void reset();
+
+    // Advances the clock by one frame; returns true when a new tick starts at this frame
+    bool advance();
+
+    // Returns the tempo at the current frame in beats per minute
+    double getTempo() const;
+
+    // Returns the tempo the clock is heading to (equal to getTempo() when not ramping)
+    double getTargetTempo() const;
+
+    // Returns the current position in ticks since the last reset
+    double getTickPosition() const;
+
+    // Returns the current position in beats since the last reset
+    double getBeatPosition() const;
+
+    // Returns the number of frames processed since the last reset
+    int64_t getSampleTime() const;
+
+    // Returns true while a tempo ramp is in progress
+    bool isRamping() const;
+
+private:
+    // Ticks travelled between the anchor and the given number of frames after it
+    double ticksSinceAnchor(int64_t frames) const;
+
+    // Moves the anchor to the current frame, folding the travelled ticks into it
+    void reanchor();
+
+    // Number of ticks travelled per frame for one BPM
+    double ticksPerFramePerBpm() const;
+
+    int m_sampleRate;               // Sample rate the clock runs at
+    int m_ticksPerBeat = 1;         // Number of ticks per beat (the subdivision)
+
+    int64_t m_sampleTime = 0;       // Frames processed since the last reset
+    int64_t m_anchorSample = 0;     // Frame at which the current tempo segment started
+    double m_anchorTicks = 0.0;     // Tick position at the anchor frame
+    int64_t m_nextTick = 0;         // Index of the next tick that has not been reported yet
+
+    double m_startTempo = 120.0;    // Tempo at the anchor frame
+    double m_targetTempo = 120.0;   // Tempo at the end of the ramp
+    int64_t m_rampFrames = 0;       // Length of the running ramp in frames (0 = no ramp)
+    rampShape m_rampShape = rampShape::linear; // Shape of the running ramp
+};
+
+#endif /* tempoClock_h */
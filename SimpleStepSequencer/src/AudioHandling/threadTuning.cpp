@@ -0,0 +1,223 @@
+//
+//  threadTuning.cpp
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+#include <alloca.h>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <sstream>
+#include <pthread.h>
+#include <sys/mman.h>
+#include "threadTuning.h"
+
+#if defined(__APPLE__)
+#include <mach/mach.h>
+#include <mach/mach_time.h>
+#include <mach/thread_policy.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <xmmintrin.h>
+#endif
+
+namespace {
+    // Cores for worker threads, set once before the threads start
+    std::mutex workerMutex;
+    std::vector<int> workerCores;
+    std::string workerError;
+    std::atomic<tuningState> workerState{tuningState::notRequested};
+}
+
+//--------------------------------------------------------------
+
+tuningState threadTuning::setRealtimePriority(int priority, int sampleRate, int bufferSize, int& error) {
+#if defined(__APPLE__)
+    // macOS schedules real-time threads by time constraints rather than priorities: the
+    // thread asks for a share of every buffer period
+    mach_timebase_info_data_t timebase;
+    mach_timebase_info(&timebase);
+    double ticksPerNano = double(timebase.denom) / timebase.numer;
+    double periodNanos = 1e9 * bufferSize / sampleRate;
+
+    thread_time_constraint_policy_data_t policy;
+    policy.period = uint32_t(periodNanos * ticksPerNano);
+    policy.computation = uint32_t(periodNanos * 0.5 * ticksPerNano);
+    policy.constraint = uint32_t(periodNanos * 0.9 * ticksPerNano);
+    policy.preemptible = 1;
+    kern_return_t result = thread_policy_set(pthread_mach_thread_np(pthread_self()), THREAD_TIME_CONSTRAINT_POLICY,
+                                             (thread_policy_t)&policy, THREAD_TIME_CONSTRAINT_POLICY_COUNT);
+    if (result != KERN_SUCCESS) {
+        error = result;
+        return tuningState::failed;
+    }
+    return tuningState::applied;
+#else
+    sched_param parameters{};
+    parameters.sched_priority = priority;
+    int result = pthread_setschedparam(pthread_self(), SCHED_FIFO, &parameters);
+    if (result != 0) {
+        // Usually EPERM: needs CAP_SYS_NICE or an rtprio limit in /etc/security/limits.conf
+        error = result;
+        return tuningState::failed;
+    }
+    return tuningState::applied;
+#endif
+}
+
+//--------------------------------------------------------------
+
+tuningState threadTuning::lockMemory(int& error) {
+    // Locking current memory also faults it in; future allocations are locked as they come
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        // Usually ENOMEM or EPERM: the memlock limit (ulimit -l) is too low
+        error = errno;
+        return errno == ENOSYS ? tuningState::unsupported : tuningState::failed;
+    }
+    return tuningState::applied;
+}
+
+//--------------------------------------------------------------
+
+void threadTuning::prefaultStack(size_t bytes) {
+    // Writing every page makes the system map it now rather than in a later callback
+    volatile char* stack = static_cast<volatile char*>(alloca(bytes));
+    for (size_t i = 0; i < bytes; i += 4096) {
+        stack[i] = 0;
+    }
+}
+
+//--------------------------------------------------------------
+
+tuningState threadTuning::pinCurrentThread(const std::vector<int>& cores, int& error) {
+    if (cores.empty()) {
+        return tuningState::notRequested;
+    }
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int core : cores) {
+        if (core >= 0 && core < CPU_SETSIZE) {
+            CPU_SET(core, &set);
+        }
+    }
+    int result = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (result != 0) {
+        error = result;
+        return tuningState::failed;
+    }
+    return tuningState::applied;
+#else
+    // macOS only takes affinity hints, which it is free to ignore
+    return tuningState::unsupported;
+#endif
+}
+
+//--------------------------------------------------------------
+
+tuningState threadTuning::flushDenormals() {
+#if defined(__x86_64__) || defined(__i386__)
+    // FTZ (bit 15) flushes denormal results, DAZ (bit 6) treats denormal inputs as zero
+    _mm_setcsr(_mm_getcsr() | 0x8040);
+    return tuningState::applied;
+#elif defined(__aarch64__)
+    // FZ (bit 24) of FPCR covers both inputs and results
+    uint64_t fpcr;
+    asm volatile("mrs %0, fpcr" : "=r"(fpcr));
+    asm volatile("msr fpcr, %0" : : "r"(fpcr | (uint64_t(1) << 24)));
+    return tuningState::applied;
+#else
+    return tuningState::unsupported;
+#endif
+}
+
+//--------------------------------------------------------------
+
+void threadTuning::setWorkerCores(const std::vector<int>& cores) {
+    std::lock_guard<std::mutex> lock(workerMutex);
+    workerCores = cores;
+    workerState = cores.empty() ? tuningState::notRequested : tuningState::pending;
+}
+
+//--------------------------------------------------------------
+
+void threadTuning::applyWorkerAffinity() {
+    std::lock_guard<std::mutex> lock(workerMutex);
+    if (workerCores.empty()) {
+        return;
+    }
+    int error = 0;
+    tuningState state = pinCurrentThread(workerCores, error);
+    if (state != tuningState::applied) {
+        workerError = describeFailure(tuningStep::pinning, state, error);
+        workerState = state; // One failing thread marks the whole step as failed
+    } else if (workerState == tuningState::pending) {
+        workerState = tuningState::applied;
+    }
+}
+
+//--------------------------------------------------------------
+
+tuningState threadTuning::getWorkerPinning(std::string& error) {
+    std::lock_guard<std::mutex> lock(workerMutex);
+    error = workerError;
+    return workerState;
+}
+
+//--------------------------------------------------------------
+
+std::string threadTuning::describeFailure(tuningStep step, tuningState state, int error) {
+    if (state != tuningState::failed && state != tuningState::unsupported) {
+        return "";
+    }
+    switch (step) {
+        case tuningStep::priority:
+#if defined(__APPLE__)
+            return "time-constraint policy refused (" + std::to_string(error) + ")";
+#else
+            return std::string("SCHED_FIFO refused: ") + std::strerror(error);
+#endif
+        case tuningStep::memoryLock:
+            return std::string("mlockall refused: ") + std::strerror(error);
+        case tuningStep::pinning:
+            if (state == tuningState::unsupported) {
+                return "core pinning is not available on this platform";
+            }
+            return std::string("pinning refused: ") + std::strerror(error);
+        case tuningStep::denormals:
+            return "denormal flushing is not available on this CPU";
+    }
+    return "";
+}
+
+//--------------------------------------------------------------
+
+const char* threadTuning::toString(tuningState state) {
+    switch (state) {
+        case tuningState::notRequested: return "off";
+        case tuningState::pending: return "pending";
+        case tuningState::applied: return "ok";
+        case tuningState::failed: return "FAILED";
+        case tuningState::unsupported: return "unsupported";
+    }
+    return "";
+}
+
+//--------------------------------------------------------------
+
+std::vector<int> threadTuning::parseCores(const std::string& list) {
+    std::vector<int> cores;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) {
+            cores.push_back(std::atoi(item.c_str()));
+        }
+    }
+    return cores;
+}
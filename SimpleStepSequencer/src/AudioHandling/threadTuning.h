@@ -0,0 +1,108 @@
+//
+//  threadTuning.h
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+/*
+threadTuning holds the operating-system settings that make the audio thread reliable on a
+busy machine:
+- real-time priority: SCHED_FIFO on Linux, a time-constraint policy on macOS, so other
+  programs cannot delay the callback;
+- locked memory: all pages of the process are locked in RAM and the audio thread's stack is
+  touched once, so the callback never waits for a page fault;
+- core pinning: the audio thread and the worker threads (logger, loader, control) run on
+  configured cores, so they do not compete with each other;
+- denormal flushing (FTZ/DAZ): very small floats, as in decaying sample tails, are treated
+  as zero instead of taking the slow path in the CPU.
+
+Everything is opt-in through realtimeSettings (--realtime on the command line). Priority,
+pinning and denormal flushing apply per thread, so the audio thread applies them itself in
+its first callback. Every step reports whether it succeeded, and why not, through
+audioManager::getStats(). The steps return the system's error code rather than a message, so
+the audio thread does not format strings; describeFailure() turns a code into text later.
+*/
+
+// These directives are used to prevent multiple inclusions of the same header file, which
+// helps avoid redefinition errors and improves compilation efficiency:
+#ifndef threadTuning_h
+#define threadTuning_h
+
+#include <string>   // For error messages
+#include <vector>   // For core lists
+
+// What to configure; nothing is changed unless enabled is set
+struct realtimeSettings {
+    bool enabled = false;           // Apply the settings below
+    int priority = 70;              // SCHED_FIFO priority of the audio thread (1-99)
+    bool lockMemory = true;         // Lock all memory and pre-fault the audio stack
+    bool flushDenormals = true;     // Set FTZ/DAZ on the audio thread
+    std::vector<int> audioCores;    // Cores the audio thread may run on (empty = any)
+    std::vector<int> workerCores;   // Cores worker threads may run on (empty = any)
+};
+
+// Outcome of one step
+enum class tuningState {
+    notRequested,   // Not enabled in the settings
+    pending,        // Requested, waiting for the audio thread
+    applied,        // Done
+    failed,         // The system refused; see the message
+    unsupported     // Not available on this platform
+};
+
+// The steps, for describeFailure()
+enum class tuningStep {
+    priority,
+    memoryLock,
+    pinning,
+    denormals
+};
+
+// Outcome of every step, for the stats surface
+struct tuningReport {
+    tuningState priority = tuningState::notRequested;
+    tuningState memoryLock = tuningState::notRequested;
+    tuningState audioPinning = tuningState::notRequested;
+    tuningState workerPinning = tuningState::notRequested;
+    tuningState denormals = tuningState::notRequested;
+    std::string message;            // Why steps failed, empty if none did
+};
+
+namespace threadTuning {
+    // Raises the calling thread to real-time priority; sets error to the system's code on failure
+    tuningState setRealtimePriority(int priority, int sampleRate, int bufferSize, int& error);
+
+    // Locks current and future memory of the process in RAM
+    tuningState lockMemory(int& error);
+
+    // Touches the given number of bytes of the calling thread's stack
+    void prefaultStack(size_t bytes);
+
+    // Restricts the calling thread to the given cores
+    tuningState pinCurrentThread(const std::vector<int>& cores, int& error);
+
+    // Makes the calling thread flush denormal floats to zero
+    tuningState flushDenormals();
+
+    // Says why a step ended in the given state, e.g. "SCHED_FIFO refused: Operation not
+    // permitted"; empty unless it failed or is unsupported
+    std::string describeFailure(tuningStep step, tuningState state, int error);
+
+    // Selects the cores worker threads pin themselves to (empty = no pinning)
+    void setWorkerCores(const std::vector<int>& cores);
+
+    // Pins the calling worker thread to the worker cores; call at the start of a worker thread
+    void applyWorkerAffinity();
+
+    // Returns the outcome of worker pinning so far
+    tuningState getWorkerPinning(std::string& error);
+
+    // Returns a short name for a state, for display
+    const char* toString(tuningState state);
+
+    // Parses a list of cores like "2,3"
+    std::vector<int> parseCores(const std::string& list);
+}
+
+#endif /* threadTuning_h */
@@ -0,0 +1,195 @@
+//
+//  timelineTrace.cpp
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+#include "ofMain.h"
+#include "timelineTrace.h"
+
+namespace {
+    // Returns the steady clock in nanoseconds
+    int64_t steadyNanos() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Index of the calling thread's ring, -1 until it has claimed one, -2 if none was left
+    thread_local int t_ring = -1;
+
+#if defined(TIMELINE_TRACE)
+    // A span copied out of a ring
+    struct copiedSpan {
+        const char* name;
+        int64_t start;
+        int64_t end;
+        int32_t value;
+    };
+
+    // Writes a name as a JSON string; names are literals from the source, so only quotes
+    // and backslashes need escaping
+    void putName(std::FILE* file, const char* name) {
+        std::fputc('"', file);
+        for (const char* c = name; *c; c++) {
+            if (*c == '"' || *c == '\\') {
+                std::fputc('\\', file);
+            }
+            std::fputc(*c, file);
+        }
+        std::fputc('"', file);
+    }
+#endif
+}
+
+//--------------------------------------------------------------
+
+timelineTrace::scope::scope(const char* name, int32_t value)
+: m_name(name), m_value(value), m_start(timelineTrace::instance().now()) {
+}
+
+//--------------------------------------------------------------
+
+timelineTrace::scope::~scope() {
+    timelineTrace& trace = timelineTrace::instance();
+    trace.record(m_name, m_start, trace.now(), m_value);
+}
+
+//--------------------------------------------------------------
+
+timelineTrace& timelineTrace::instance() {
+    static timelineTrace trace;
+    return trace;
+}
+
+//--------------------------------------------------------------
+
+timelineTrace::timelineTrace() : m_origin(steadyNanos()) {
+#if defined(TIMELINE_TRACE)
+    m_rings = std::make_unique<std::array<threadRing, maxThreads>>(); // The audio thread must not allocate later
+#endif
+}
+
+//--------------------------------------------------------------
+
+int64_t timelineTrace::now() const {
+    return steadyNanos() - m_origin;
+}
+
+//--------------------------------------------------------------
+
+timelineTrace::threadRing* timelineTrace::ring() {
+    if (t_ring == -1) {
+        int index = m_numThreads.fetch_add(1, std::memory_order_relaxed);
+        t_ring = m_rings && index < maxThreads ? index : -2;
+    }
+    return t_ring >= 0 ? &(*m_rings)[t_ring] : nullptr;
+}
+
+//--------------------------------------------------------------
+
+void timelineTrace::nameThread(const char* name) {
+    threadRing* current = ring();
+    if (current && current->name.load(std::memory_order_relaxed) != name) {
+        current->name.store(name, std::memory_order_relaxed);
+    }
+}
+
+//--------------------------------------------------------------
+
+void timelineTrace::record(const char* name, int64_t start, int64_t end, int32_t value) {
+    threadRing* current = ring();
+    if (!current) {
+        return;
+    }
+    // Claim the slot before writing it, so write() can tell when it read a slot that was
+    // being overwritten
+    uint64_t index = current->written.load(std::memory_order_relaxed);
+    current->claimed.store(index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    span& slot = current->spans[index & (capacity - 1)];
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.start.store(start, std::memory_order_relaxed);
+    slot.end.store(end, std::memory_order_relaxed);
+    slot.value.store(value, std::memory_order_relaxed);
+    current->written.store(index + 1, std::memory_order_release);
+}
+
+//--------------------------------------------------------------
+
+void timelineTrace::instant(const char* name, int32_t value) {
+    record(name, now(), -1, value);
+}
+
+//--------------------------------------------------------------
+
+bool timelineTrace::write(const std::string& path) {
+#if !defined(TIMELINE_TRACE)
+    ofLogWarning("timelineTrace") << "Nothing was recorded: build with TIMELINE_TRACE defined to trace the timeline";
+    return false;
+#else
+    std::string file = ofToDataPath(path, true);
+    std::FILE* out = std::fopen(file.c_str(), "w");
+    if (!out) {
+        ofLogError("timelineTrace") << "Cannot create " << file;
+        return false;
+    }
+    std::fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    std::fprintf(out, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"SimpleStepSequencer\"}}");
+
+    size_t total = 0;
+    std::vector<copiedSpan> spans;
+    int numThreads = std::min(m_numThreads.load(), maxThreads);
+    for (int thread = 0; thread < numThreads; thread++) {
+        threadRing& current = (*m_rings)[thread];
+        const char* name = current.name.load(std::memory_order_relaxed);
+        std::fprintf(out, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":", thread + 1);
+        putName(out, name ? name : ("thread " + ofToString(thread + 1)).c_str());
+        std::fprintf(out, "}}");
+
+        // Copy the ring, then drop what the thread overwrote while it was copied
+        uint64_t written = current.written.load(std::memory_order_acquire);
+        uint64_t first = written > capacity ? written - capacity : 0;
+        spans.clear();
+        for (uint64_t index = first; index < written; index++) {
+            const span& slot = current.spans[index & (capacity - 1)];
+            spans.push_back({slot.name.load(std::memory_order_relaxed), slot.start.load(std::memory_order_relaxed),
+                             slot.end.load(std::memory_order_relaxed), slot.value.load(std::memory_order_relaxed)});
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t claimed = current.claimed.load(std::memory_order_relaxed);
+        size_t overwritten = claimed > first + capacity ? size_t(claimed - capacity - first) : 0;
+        overwritten = std::min(overwritten, spans.size());
+
+        // Times are in microseconds
+        for (size_t i = overwritten; i < spans.size(); i++) {
+            const copiedSpan& next = spans[i];
+            std::fprintf(out, ",\n{\"name\":");
+            putName(out, next.name);
+            if (next.end < 0) {
+                std::fprintf(out, ",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f", next.start / 1000.0);
+            } else {
+                std::fprintf(out, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f", next.start / 1000.0,
+                             (next.end - next.start) / 1000.0);
+            }
+            std::fprintf(out, ",\"pid\":1,\"tid\":%d", thread + 1);
+            if (next.value != noValue) {
+                std::fprintf(out, ",\"args\":{\"value\":%d}", next.value);
+            }
+            std::fprintf(out, "}");
+        }
+        total += spans.size() - overwritten;
+    }
+    std::fprintf(out, "\n]}\n");
+    bool closed = std::fclose(out) == 0;
+    if (closed) {
+        ofLogNotice("timelineTrace") << "Wrote " << total << " spans of " << numThreads << " threads to " << file;
+    } else {
+        ofLogError("timelineTrace") << "Cannot write " << file;
+    }
+    return closed;
+#endif
+}
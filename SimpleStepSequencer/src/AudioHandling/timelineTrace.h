@@ -0,0 +1,130 @@
+//
+//  timelineTrace.h
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+/*
+The timelineTrace class records what the threads of the program were doing and when: every
+audio callback, every tick of the metronome, every MIDI write and every frame and redraw of
+the window, as spans of time on the thread that ran them. write() saves the spans as a Chrome
+trace (JSON), which chrome://tracing and the Perfetto UI (ui.perfetto.dev) show as one
+timeline per thread, so a GUI stall, a burst of MIDI and a late callback can be seen side by
+side when a set glitches.
+
+Spans are recorded through the macros at the end of this file. The tracer is a
+profiling build mode: compile with TIMELINE_TRACE defined (add it to PROJECT_DEFINES in
+config.make, or to the preprocessor macros in Xcode). Without it the macros compile to
+nothing and write() only says so.
+
+Every thread records into a preallocated ring of its own, so recording never locks or
+allocates and is safe on the audio thread: a span costs two reads of the steady clock and a
+few stores. Each ring keeps the latest capacity spans, so the trace always holds the last
+seconds before write() is called; older spans are overwritten. write() copies the rings
+while they are being written and leaves out the spans that were overwritten meanwhile.
+
+There is one tracer for the whole program, reached through instance().
+*/
+
+// These directives are used to prevent multiple inclusions of the same header file, which
+// helps avoid redefinition errors and improves compilation efficiency:
+#ifndef timelineTrace_h
+#define timelineTrace_h
+
+#include <array>    // For the rings
+#include <atomic>   // For the lock-free indices
+#include <cstdint>  // For times in nanoseconds
+#include <memory>   // For the rings, allocated once
+#include <string>   // For file names
+
+class timelineTrace {
+public:
+    static constexpr int maxThreads = 8;            // Threads that can record; later ones are ignored
+    static constexpr size_t capacity = 16384;       // Spans kept per thread (power of two)
+    static constexpr int32_t noValue = INT32_MIN;   // A span without a value
+
+    // Records the scope it lives in as a span of the calling thread
+    class scope {
+    public:
+        explicit scope(const char* name, int32_t value = noValue);
+        ~scope();
+
+        scope(const scope&) = delete;
+        scope& operator=(const scope&) = delete;
+
+    private:
+        const char* m_name;     // Name of the span (a string literal)
+        int32_t m_value;        // Shown with the span, e.g. a count
+        int64_t m_start;        // Nanoseconds since the tracer was created
+    };
+
+    // Returns the program's tracer
+    static timelineTrace& instance();
+
+    // Names the calling thread in the trace (a string literal); cheap to call again
+    void nameThread(const char* name);
+
+    // Records a span of the calling thread
+    void record(const char* name, int64_t start, int64_t end, int32_t value = noValue);
+
+    // Records a moment on the calling thread, like a missed deadline
+    void instant(const char* name, int32_t value = noValue);
+
+    // Returns nanoseconds since the tracer was created
+    int64_t now() const;
+
+    // Writes the spans recorded so far as a Chrome trace (in bin/data unless the path is
+    // absolute); returns false if the file cannot be written, or without TIMELINE_TRACE.
+    // Call from a control thread.
+    bool write(const std::string& path);
+
+private:
+    // Only instance() creates the tracer
+    timelineTrace();
+
+    // A span, or a moment when end is -1; the fields are atomic so write() may read a span
+    // while it is being overwritten (it is then left out)
+    struct span {
+        std::atomic<const char*> name{nullptr};
+        std::atomic<int64_t> start{0};
+        std::atomic<int64_t> end{0};
+        std::atomic<int32_t> value{noValue};
+    };
+
+    // The ring of one thread
+    struct threadRing {
+        std::atomic<const char*> name{nullptr};     // Set by nameThread()
+        std::atomic<uint64_t> claimed{0};           // Spans started being written
+        std::atomic<uint64_t> written{0};           // Spans finished
+        std::array<span, capacity> spans;
+    };
+
+    // Returns the ring of the calling thread, claiming one the first time; nullptr if all are taken
+    threadRing* ring();
+
+    int64_t m_origin;                                       // Steady clock at creation, in nanoseconds
+    std::unique_ptr<std::array<threadRing, maxThreads>> m_rings;  // Allocated once, up front
+    std::atomic<int> m_numThreads{0};                       // Rings claimed
+};
+
+#if defined(TIMELINE_TRACE)
+#define TIMELINE_CONCAT_(a, b) a##b
+#define TIMELINE_CONCAT(a, b) TIMELINE_CONCAT_(a, b)
+// Records the rest of the enclosing scope as a span
+#define TIMELINE_SCOPE(name) timelineTrace::scope TIMELINE_CONCAT(timelineScope, __LINE__)(name)
+// Records the rest of the enclosing scope as a span with a value, e.g. a count
+#define TIMELINE_SCOPE_VALUE(name, value) timelineTrace::scope TIMELINE_CONCAT(timelineScope, __LINE__)(name, (int32_t)(value))
+// Records a moment
+#define TIMELINE_INSTANT(name, value) timelineTrace::instance().instant(name, (int32_t)(value))
+// Names the calling thread
+#define TIMELINE_THREAD(name) timelineTrace::instance().nameThread(name)
+#else
+// Without the tracer nothing is recorded and nothing is evaluated
+#define TIMELINE_SCOPE(name) ((void)0)
+#define TIMELINE_SCOPE_VALUE(name, value) ((void)0)
+#define TIMELINE_INSTANT(name, value) ((void)0)
+#define TIMELINE_THREAD(name) ((void)0)
+#endif
+
+#endif /* timelineTrace_h */
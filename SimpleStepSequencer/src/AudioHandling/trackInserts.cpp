@@ -0,0 +1,431 @@
+//
+//  trackInserts.cpp
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+#include <algorithm>
+#include <cmath>
+#include "ofMain.h"
+#include "trackInserts.h"
+
+namespace {
+    constexpr double fastAttackSeconds = 0.001;    // Dynamics envelopes: the fast one follows the hit,
+    constexpr double fastReleaseSeconds = 0.100;   // the slow one lags behind its attack; together they
+    constexpr double slowAttackSeconds = 0.030;    // tell the attack of a hit from its body
+    constexpr double slowReleaseSeconds = 0.100;
+    constexpr double smoothingSeconds = 0.010;     // Filter settings glide over about this long
+    constexpr int segmentFrames = 8;               // Frames between two dynamics gain computations
+    constexpr float floorLevel = 1e-15f;           // Keeps envelopes and filters of silent tracks out of denormal range
+    constexpr float maxTransientGain = 4.0f;       // Limits the transient shaper to +-12 dB
+
+    using lane = std::array<float, trackInserts::lanes>;
+
+    // Coefficient of a one-pole follower with the given time constant
+    float coefficient(double seconds, double rate) {
+        return (float)(1.0 - std::exp(-1.0 / (seconds * rate)));
+    }
+
+    // Moves a one-pole follower towards a level with one coefficient when rising and another
+    // when falling. Written without comparisons: compilers do not turn a compare-and-select
+    // on floats into vector code while floating-point traps are honoured (GCC's default).
+    inline float follow(float value, float level, float rising, float falling) {
+        float difference = level - value;
+        return value + 0.5f * ((rising + falling) * difference + (rising - falling) * std::fabs(difference));
+    }
+
+    // Copies the lanes of a group out of a per-track array, and back
+    inline lane load(const std::array<float, trackInserts::maxTracks>& from, int first) {
+        lane values;
+        std::copy(from.begin() + first, from.begin() + first + trackInserts::lanes, values.begin());
+        return values;
+    }
+
+    inline void store(const lane& values, std::array<float, trackInserts::maxTracks>& to, int first) {
+        std::copy(values.begin(), values.end(), to.begin() + first);
+    }
+
+    float fromDecibels(float decibels) {
+        return std::pow(10.0f, decibels / 20.0f);
+    }
+
+    float toDecibels(float gain) {
+        return 20.0f * std::log10(std::max(gain, 1e-6f));
+    }
+}
+
+//--------------------------------------------------------------
+
+trackInserts::trackInserts() {
+    setup(44100);
+}
+
+//--------------------------------------------------------------
+
+void trackInserts::setup(int sampleRate) {
+    m_sampleRate = sampleRate;
+    m_fastAttack = coefficient(fastAttackSeconds, sampleRate);
+    m_fastRelease = coefficient(fastReleaseSeconds, sampleRate);
+    m_slowAttack = coefficient(slowAttackSeconds, sampleRate);
+    m_slowRelease = coefficient(slowReleaseSeconds, sampleRate);
+    m_smoothing = coefficient(smoothingSeconds, double(sampleRate) / blockFrames);
+
+    for (int track = 0; track < maxTracks; track++) {
+        const settings& current = m_settings[track];
+        m_gain[track] = m_gainTarget[track] = current.gain.load(std::memory_order_relaxed);
+        m_drive[track] = m_driveTarget[track] = current.drive.load(std::memory_order_relaxed);
+        m_cutoff[track] = current.cutoff.load(std::memory_order_relaxed);
+        m_resonance[track] = current.resonance.load(std::memory_order_relaxed);
+        m_fast[track] = m_slow[track] = floorLevel;
+        m_dynamicsGain[track] = 1.0f;
+        for (int side = 0; side < 2; side++) {
+            m_z1[side][track] = m_z2[side][track] = 0.0f;
+        }
+        updateFilter(track, (filterMode)current.filter.load(std::memory_order_relaxed));
+    }
+}
+
+//--------------------------------------------------------------
+
+void trackInserts::setGain(int track, float decibels) {
+    if (track >= 0 && track < maxTracks) {
+        m_settings[track].gainDecibels.store(decibels, std::memory_order_relaxed);
+        m_settings[track].gain.store(fromDecibels(decibels), std::memory_order_relaxed);
+    }
+}
+
+//--------------------------------------------------------------
+
+void trackInserts::setFilter(int track, filterMode mode, float cutoff, float resonance) {
+    if (track < 0 || track >= maxTracks) {
+        return;
+    }
+    settings& target = m_settings[track];
+    target.cutoff.store(std::min(std::max(cutoff, 20.0f), 20000.0f), std::memory_order_relaxed);
+    target.resonance.store(std::min(std::max(resonance, 0.1f), 20.0f), std::memory_order_relaxed);
+    target.filter.store((int)mode, std::memory_order_relaxed);
+}
+
+//--------------------------------------------------------------
+
+void trackInserts::setCompressor(int track, float thresholdDecibels, float ratio) {
+    if (track < 0 || track >= maxTracks) {
+        return;
+    }
+    settings& target = m_settings[track];
+    thresholdDecibels = std::min(thresholdDecibels, 0.0f);
+    target.thresholdDecibels.store(thresholdDecibels, std::memory_order_relaxed);
+    target.threshold.store(fromDecibels(thresholdDecibels), std::memory_order_relaxed);
+    target.ratio.store(std::max(ratio, 1.0f), std::memory_order_relaxed);
+    target.dynamics.store((int)dynamicsMode::compressor, std::memory_order_relaxed);
+}
+
+//--------------------------------------------------------------
+
+void trackInserts::setTransientShaper(int track, float amount) {
+    if (track < 0 || track >= maxTracks) {
+        return;
+    }
+    settings& target = m_settings[track];
+    target.transient.store(std::min(std::max(amount, -1.0f), 1.0f), std::memory_order_relaxed);
+    target.dynamics.store((int)dynamicsMode::transient, std::memory_order_relaxed);
+}
+
+//--------------------------------------------------------------
+
+void trackInserts::bypassDynamics(int track) {
+    if (track >= 0 && track < maxTracks) {
+        m_settings[track].dynamics.store((int)dynamicsMode::off, std::memory_order_relaxed);
+    }
+}
+
+//--------------------------------------------------------------
+
+void trackInserts::setDrive(int track, float decibels) {
+    if (track >= 0 && track < maxTracks) {
+        decibels = std::min(std::max(decibels, 0.0f), 48.0f);
+        m_settings[track].driveDecibels.store(decibels, std::memory_order_relaxed);
+        m_settings[track].drive.store(fromDecibels(decibels), std::memory_order_relaxed);
+    }
+}
+
+//--------------------------------------------------------------
+
+void trackInserts::reset(int track) {
+    setGain(track, 0.0f);
+    setFilter(track, filterMode::off);
+    bypassDynamics(track);
+    setDrive(track, 0.0f);
+}
+
+//--------------------------------------------------------------
+
+trackInserts::values trackInserts::getValues(int track) const {
+    values current;
+    if (track < 0 || track >= maxTracks) {
+        return current;
+    }
+    const settings& from = m_settings[track];
+    current.gain = from.gainDecibels.load(std::memory_order_relaxed);
+    current.filter = (filterMode)from.filter.load(std::memory_order_relaxed);
+    current.cutoff = from.cutoff.load(std::memory_order_relaxed);
+    current.resonance = from.resonance.load(std::memory_order_relaxed);
+    current.dynamics = (dynamicsMode)from.dynamics.load(std::memory_order_relaxed);
+    current.threshold = from.thresholdDecibels.load(std::memory_order_relaxed);
+    current.ratio = from.ratio.load(std::memory_order_relaxed);
+    current.transient = from.transient.load(std::memory_order_relaxed);
+    current.drive = from.driveDecibels.load(std::memory_order_relaxed);
+    return current;
+}
+
+//--------------------------------------------------------------
+
+std::string trackInserts::describe(int track) const {
+    if (track < 0 || track >= maxTracks) {
+        return "";
+    }
+    const settings& current = m_settings[track];
+    std::string text = "gain " + ofToString(toDecibels(current.gain), 1) + " dB";
+    filterMode filter = (filterMode)current.filter.load();
+    if (filter != filterMode::off) {
+        const char* names[] = {"off", "lowpass", "highpass", "bandpass"};
+        text += ", " + std::string(names[(int)filter]) + " " + ofToString(current.cutoff.load(), 0)
+              + " Hz Q " + ofToString(current.resonance.load(), 2);
+    }
+    dynamicsMode dynamics = (dynamicsMode)current.dynamics.load();
+    if (dynamics == dynamicsMode::compressor) {
+        text += ", compressor " + ofToString(toDecibels(current.threshold), 1) + " dB "
+              + ofToString(current.ratio.load(), 1) + ":1";
+    } else if (dynamics == dynamicsMode::transient) {
+        text += ", transient " + ofToString(current.transient.load(), 2);
+    }
+    if (current.drive > 1.0f) {
+        text += ", drive " + ofToString(toDecibels(current.drive), 1) + " dB";
+    }
+    return text;
+}
+
+//--------------------------------------------------------------
+
+void trackInserts::process(outputBuses& buses) {
+    int numTracks = std::min(buses.getNumTracks(), maxTracks);
+    size_t numFrames = buses.getNumFrames();
+
+    for (int first = 0; first < numTracks; first += lanes) {
+        int count = std::min(lanes, numTracks - first);
+        for (size_t start = 0; start < numFrames; start += blockFrames) {
+            size_t frames = std::min((size_t)blockFrames, numFrames - start);
+            updateGroup(first);
+
+            // Lane-interleave the block; lanes without a track get silence
+            for (int side = 0; side < 2; side++) {
+                for (int track = 0; track < lanes; track++) {
+                    const float* from = track < count ? buses.getTrackChannel(first + track, side) + start : nullptr;
+                    for (size_t frame = 0; frame < frames; frame++) {
+                        m_block[side][frame][track] = from ? from[frame] : 0.0f;
+                    }
+                }
+            }
+
+            processBlock(first, frames);
+
+            for (int side = 0; side < 2; side++) {
+                for (int track = 0; track < count; track++) {
+                    float* to = buses.getTrackChannel(first + track, side) + start;
+                    for (size_t frame = 0; frame < frames; frame++) {
+                        to[frame] = m_block[side][frame][track];
+                    }
+                }
+            }
+        }
+    }
+}
+
+//--------------------------------------------------------------
+
+void trackInserts::updateGroup(int first) {
+    for (int track = first; track < first + lanes; track++) {
+        const settings& current = m_settings[track];
+
+        // Gain and drive ramp from where the last block ended
+        m_gain[track] = m_gainTarget[track];
+        m_gainTarget[track] = current.gain.load(std::memory_order_relaxed);
+        m_drive[track] = m_driveTarget[track];
+        m_driveTarget[track] = current.drive.load(std::memory_order_relaxed);
+        m_saturate[track] = m_driveTarget[track] > 1.0f || m_drive[track] > 1.0f ? 1.0f : 0.0f;
+
+        // The filter glides towards its settings, the cutoff on a musical (logarithmic) scale
+        filterMode mode = (filterMode)current.filter.load(std::memory_order_relaxed);
+        float cutoff = current.cutoff.load(std::memory_order_relaxed);
+        float resonance = current.resonance.load(std::memory_order_relaxed);
+        bool gliding = std::fabs(cutoff - m_cutoff[track]) > 0.01f * cutoff
+                    || std::fabs(resonance - m_resonance[track]) > 0.001f;
+        if (gliding) {
+            m_cutoff[track] *= std::pow(cutoff / m_cutoff[track], m_smoothing);
+            m_resonance[track] += (resonance - m_resonance[track]) * m_smoothing;
+        }
+        if (gliding || mode != (filterMode)m_filterMode[track]) {
+            updateFilter(track, mode);
+        }
+
+        // Dynamics: gain = (fast / threshold) ^ (1 / ratio - 1) above the threshold for the
+        // compressor, (fast / slow) ^ amount for the transient shaper, 1 when off
+        dynamicsMode dynamics = (dynamicsMode)current.dynamics.load(std::memory_order_relaxed);
+        m_dynamicsMode[track] = (int)dynamics;
+        m_thresholdInverse[track] = 1.0f / current.threshold.load(std::memory_order_relaxed);
+        if (dynamics == dynamicsMode::compressor) {
+            m_exponent[track] = 1.0f / current.ratio.load(std::memory_order_relaxed) - 1.0f;
+        } else if (dynamics == dynamicsMode::transient) {
+            m_exponent[track] = current.transient.load(std::memory_order_relaxed) * 2.0f;
+        } else {
+            m_exponent[track] = 0.0f;
+        }
+    }
+}
+
+//--------------------------------------------------------------
+
+void trackInserts::updateFilter(int track, filterMode mode) {
+    m_filterMode[track] = (int)mode;
+    if (mode == filterMode::off) {
+        m_b0[track] = 1.0f;
+        m_b1[track] = m_b2[track] = m_a1[track] = m_a2[track] = 0.0f;
+        return;
+    }
+
+    // Biquads from the Audio EQ Cookbook (R. Bristow-Johnson)
+    double omega = 2.0 * M_PI * std::min((double)m_cutoff[track], 0.49 * m_sampleRate) / m_sampleRate;
+    double cosine = std::cos(omega);
+    double alpha = std::sin(omega) / (2.0 * m_resonance[track]);
+    double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+    switch (mode) {
+        case filterMode::lowpass:
+            b0 = b2 = (1.0 - cosine) / 2.0;
+            b1 = 1.0 - cosine;
+            break;
+        case filterMode::highpass:
+            b0 = b2 = (1.0 + cosine) / 2.0;
+            b1 = -(1.0 + cosine);
+            break;
+        default:
+            b0 = alpha; // Bandpass with 0 dB at the centre
+            b2 = -alpha;
+            break;
+    }
+    double a0 = 1.0 + alpha;
+    m_b0[track] = float(b0 / a0);
+    m_b1[track] = float(b1 / a0);
+    m_b2[track] = float(b2 / a0);
+    m_a1[track] = float(-2.0 * cosine / a0);
+    m_a2[track] = float((1.0 - alpha) / a0);
+}
+
+//--------------------------------------------------------------
+
+void trackInserts::processBlock(int first, size_t numFrames) {
+    // Work on local copies of the group's lanes, so the loops below only see fixed-size
+    // arrays and vectorize
+    float step = 1.0f / numFrames;
+
+    // Gain, ramped over the block
+    {
+        lane gain = load(m_gain, first);
+        lane target = load(m_gainTarget, first);
+        for (size_t frame = 0; frame < numFrames; frame++) {
+            float position = (frame + 1) * step;
+            for (int track = 0; track < lanes; track++) {
+                float value = gain[track] + (target[track] - gain[track]) * position;
+                m_block[0][frame][track] *= value;
+                m_block[1][frame][track] *= value;
+            }
+        }
+    }
+
+    // Filter, transposed direct form II
+    {
+        lane b0 = load(m_b0, first), b1 = load(m_b1, first), b2 = load(m_b2, first);
+        lane a1 = load(m_a1, first), a2 = load(m_a2, first);
+        for (int side = 0; side < 2; side++) {
+            lane z1 = load(m_z1[side], first), z2 = load(m_z2[side], first);
+            for (size_t frame = 0; frame < numFrames; frame++) {
+                float* samples = m_block[side][frame];
+                for (int track = 0; track < lanes; track++) {
+                    float in = samples[track];
+                    float out = b0[track] * in + z1[track];
+                    z1[track] = b1[track] * in - a1[track] * out + z2[track];
+                    z2[track] = b2[track] * in - a2[track] * out;
+                    samples[track] = out;
+                }
+            }
+            for (int track = 0; track < lanes; track++) {
+                z1[track] = std::fabs(z1[track]) < floorLevel ? 0.0f : z1[track];
+                z2[track] = std::fabs(z2[track]) < floorLevel ? 0.0f : z2[track];
+            }
+            store(z1, m_z1[side], first);
+            store(z2, m_z2[side], first);
+        }
+    }
+
+    // Dynamics: the envelopes run every frame, the gain is computed every few frames and
+    // ramped in between
+    {
+        lane fast = load(m_fast, first), slow = load(m_slow, first);
+        lane gain = load(m_dynamicsGain, first);
+        lane thresholdInverse = load(m_thresholdInverse, first), exponent = load(m_exponent, first);
+        const float fastAttack = m_fastAttack, fastRelease = m_fastRelease;
+        const float slowAttack = m_slowAttack, slowRelease = m_slowRelease;
+        for (size_t start = 0; start < numFrames; start += segmentFrames) {
+            size_t end = std::min(start + segmentFrames, numFrames);
+
+            // Gain at the end of this segment, from the envelopes at its start
+            lane gainStep;
+            for (int track = 0; track < lanes; track++) {
+                float target = 1.0f;
+                if (m_dynamicsMode[first + track] == (int)dynamicsMode::compressor) {
+                    target = std::pow(std::max(fast[track] * thresholdInverse[track], 1.0f), exponent[track]);
+                } else if (m_dynamicsMode[first + track] == (int)dynamicsMode::transient) {
+                    target = std::pow(fast[track] / slow[track], exponent[track]);
+                    target = std::min(std::max(target, 1.0f / maxTransientGain), maxTransientGain);
+                }
+                gainStep[track] = (target - gain[track]) / float(end - start);
+            }
+
+            for (size_t frame = start; frame < end; frame++) {
+                float* left = m_block[0][frame];
+                float* right = m_block[1][frame];
+                for (int track = 0; track < lanes; track++) {
+                    float level = 0.5f * (std::fabs(left[track]) + std::fabs(right[track])) + floorLevel;
+                    fast[track] = follow(fast[track], level, fastAttack, fastRelease);
+                    slow[track] = follow(slow[track], level, slowAttack, slowRelease);
+                    gain[track] += gainStep[track];
+                    left[track] *= gain[track];
+                    right[track] *= gain[track];
+                }
+            }
+        }
+        store(fast, m_fast, first);
+        store(slow, m_slow, first);
+        store(gain, m_dynamicsGain, first);
+    }
+
+    // Saturator: x / (1 + |drive * x|), which is unity gain for small signals and approaches
+    // 1 / drive for large ones; blended out where it is off
+    {
+        lane drive = load(m_drive, first);
+        lane target = load(m_driveTarget, first);
+        lane saturate = load(m_saturate, first);
+        for (int side = 0; side < 2; side++) {
+            for (size_t frame = 0; frame < numFrames; frame++) {
+                float position = (frame + 1) * step;
+                float* samples = m_block[side][frame];
+                for (int track = 0; track < lanes; track++) {
+                    float amount = drive[track] + (target[track] - drive[track]) * position;
+                    float dry = samples[track];
+                    float wet = dry / (1.0f + std::fabs(dry * amount));
+                    samples[track] = dry + (wet - dry) * saturate[track];
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,171 @@
+//
+//  trackInserts.h
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+/*
+The trackInserts class is the insert chain of every track: gain, a multimode filter
+(lowpass, highpass or bandpass biquad), dynamics (a compressor or a transient shaper) and a
+saturator, in that order. It processes the track channels of outputBuses in place, after
+the instruments have rendered into them and before the tracks are mixed into their buses.
+
+There are no insert objects and no virtual calls. The tracks are processed in groups of 8,
+side by side: a block of up to 64 frames of each track in the group is copied into one
+lane of a small scratch block, and every stage updates all 8 lanes with the same
+arithmetic, so the compiler turns the loops into vector instructions. A biquad cannot be
+vectorized along time, but it can across tracks. Stages that are switched off run as
+neutral settings (a pass-through biquad, a gain of 1), so the cost is the same for every
+track and there are no branches in the inner loops.
+
+Settings can be changed from any thread at any time. They are picked up once per block and
+smoothed from block to block (gain and drive ramp within the block), so changes do not
+click. All state lives in fixed arrays sized for outputBuses::maxTracks tracks; nothing
+allocates, and memory does not depend on the settings.
+*/
+
+// These directives are used to prevent multiple inclusions of the same header file, which
+// helps avoid redefinition errors and improves compilation efficiency:
+#ifndef trackInserts_h
+#define trackInserts_h
+
+#include <array>        // For the lanes
+#include <atomic>       // For settings that can be changed while playing
+#include <string>       // For describe()
+#include "outputBuses.h" // The track channels that are processed
+
+class trackInserts {
+public:
+    static constexpr int maxTracks = outputBuses::maxTracks; // Tracks that can be processed
+    static constexpr int lanes = 8;                          // Tracks processed side by side
+    static constexpr int blockFrames = 64;                   // Frames processed at a time
+
+    // Response of the filter
+    enum class filterMode {
+        off,        // Passes everything
+        lowpass,    // 12 dB/octave above the cutoff
+        highpass,   // 12 dB/octave below the cutoff
+        bandpass    // Around the cutoff, narrower as the resonance rises
+    };
+
+    // What the dynamics stage does
+    enum class dynamicsMode {
+        off,        // Passes everything
+        compressor, // Turns down what rises above the threshold
+        transient   // Raises (or softens) the attack of every hit
+    };
+
+    // A stage of the chain, as engine commands address it (all: every stage, to reset them)
+    enum class stage {
+        gain,
+        filter,
+        dynamics,
+        drive,
+        all
+    };
+
+    // Settings of a track as they were set, e.g. to record them in a session trace
+    struct values {
+        float gain = 0.0f;                          // dB
+        filterMode filter = filterMode::off;
+        float cutoff = 1000.0f;                     // Hz
+        float resonance = 0.707f;                   // Q
+        dynamicsMode dynamics = dynamicsMode::off;
+        float threshold = -18.06f;                  // Compressor threshold, dB
+        float ratio = 4.0f;                         // Compressor ratio
+        float transient = 0.0f;                     // Transient shaper amount
+        float drive = 0.0f;                         // Saturator drive, dB
+    };
+
+    // Constructor; every insert starts switched off
+    trackInserts();
+
+    // Sets the sample rate and clears the filters and envelopes (stream must be stopped)
+    void setup(int sampleRate);
+
+    // Sets the gain of a track
+    void setGain(int track, float decibels);
+
+    // Sets the filter of a track; resonance is the Q (0.707 is flat)
+    void setFilter(int track, filterMode mode, float cutoff = 1000.0f, float resonance = 0.707f);
+
+    // Compresses a track above thresholdDecibels by ratio (e.g. 4 for 4:1)
+    void setCompressor(int track, float thresholdDecibels, float ratio);
+
+    // Shapes the attack of a track: positive amounts (up to 1) make hits snappier, negative
+    // ones softer
+    void setTransientShaper(int track, float amount);
+
+    // Switches the dynamics stage of a track off
+    void bypassDynamics(int track);
+
+    // Drives a track into the saturator by the given gain; 0 dB switches it off
+    void setDrive(int track, float decibels);
+
+    // Switches every insert of a track off
+    void reset(int track);
+
+    // Returns the settings of a track
+    values getValues(int track) const;
+
+    // Describes the inserts of a track, for display
+    std::string describe(int track) const;
+
+    // Runs the inserts on the track channels of the current buffer (audio thread)
+    void process(outputBuses& buses);
+
+private:
+    // Settings of one track, written by any thread
+    struct settings {
+        std::atomic<float> gain{1.0f};          // Linear
+        std::atomic<int> filter{0};             // filterMode
+        std::atomic<float> cutoff{1000.0f};     // Hz
+        std::atomic<float> resonance{0.707f};   // Q
+        std::atomic<int> dynamics{0};           // dynamicsMode
+        std::atomic<float> threshold{0.125f};   // Compressor threshold, linear
+        std::atomic<float> ratio{4.0f};         // Compressor ratio
+        std::atomic<float> transient{0.0f};     // Transient shaper amount
+        std::atomic<float> drive{1.0f};         // Saturator drive, linear
+        std::atomic<float> gainDecibels{0.0f};  // Gain, threshold and drive as they were set,
+        std::atomic<float> thresholdDecibels{-18.06f}; // so getValues() returns them exactly
+        std::atomic<float> driveDecibels{0.0f};
+    };
+
+    using laneArray = std::array<float, maxTracks>;
+
+    // Picks up the settings of a group of tracks and smooths them for the next block
+    void updateGroup(int first);
+
+    // Runs a block through the stages of a group of tracks
+    void processBlock(int first, size_t numFrames);
+
+    // Recomputes the biquad coefficients of a track from its smoothed settings
+    void updateFilter(int track, filterMode mode);
+
+    std::array<settings, maxTracks> m_settings;
+    int m_sampleRate = 44100;
+
+    // Smoothed settings and state of every track (audio thread)
+    laneArray m_gain{}, m_gainTarget{};             // Gain at the start and end of the block
+    laneArray m_drive{}, m_driveTarget{};           // Saturator drive at the start and end of the block
+    laneArray m_saturate{};                         // 1 where the saturator is on, 0 where it is off
+    laneArray m_cutoff{}, m_resonance{};            // Smoothed filter settings
+    std::array<int, maxTracks> m_filterMode{};      // Filter mode the coefficients were made for
+    laneArray m_b0{}, m_b1{}, m_b2{}, m_a1{}, m_a2{}; // Biquad coefficients, normalized
+    laneArray m_z1[2]{}, m_z2[2]{};                 // Biquad state of both sides
+    laneArray m_fast{}, m_slow{};                   // Envelopes of the dynamics stage
+    laneArray m_dynamicsGain{};                     // Current gain of the dynamics stage
+    std::array<int, maxTracks> m_dynamicsMode{};    // dynamicsMode of every track
+    laneArray m_thresholdInverse{};                 // 1 / compressor threshold
+    laneArray m_exponent{};                         // Dynamics gain = level ratio ^ exponent
+
+    // Envelope coefficients
+    float m_fastAttack = 0.0f, m_fastRelease = 0.0f, m_slowAttack = 0.0f, m_slowRelease = 0.0f;
+    float m_smoothing = 0.0f;                       // Per-block smoothing of the filter settings
+
+    // One block of a group, lane-interleaved: frame by frame, the 8 tracks side by side
+    alignas(32) float m_block[2][blockFrames][lanes];
+};
+
+#endif /* trackInserts_h */
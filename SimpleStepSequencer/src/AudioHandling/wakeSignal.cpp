@@ -0,0 +1,79 @@
+//
+//  wakeSignal.cpp
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+#include <cerrno>
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include "wakeSignal.h"
+
+//--------------------------------------------------------------
+
+wakeSignal::wakeSignal() {
+#if defined(__APPLE__)
+    m_semaphore = dispatch_semaphore_create(0);
+#else
+    sem_init(&m_semaphore, 0, 0);
+#endif
+}
+
+//--------------------------------------------------------------
+
+wakeSignal::~wakeSignal() {
+#if defined(__APPLE__)
+    dispatch_release(m_semaphore);
+#else
+    sem_destroy(&m_semaphore);
+#endif
+}
+
+//--------------------------------------------------------------
+
+void wakeSignal::signal() {
+#if defined(__APPLE__)
+    dispatch_semaphore_signal(m_semaphore);
+#else
+    sem_post(&m_semaphore);
+#endif
+}
+
+//--------------------------------------------------------------
+
+void wakeSignal::wait() {
+#if defined(__APPLE__)
+    dispatch_semaphore_wait(m_semaphore, DISPATCH_TIME_FOREVER);
+#else
+    while (sem_wait(&m_semaphore) != 0 && errno == EINTR) {
+    }
+#endif
+}
+
+//--------------------------------------------------------------
+
+bool wakeSignal::waitFor(double seconds) {
+    long long nanos = std::llround(std::max(0.0, seconds) * 1e9);
+#if defined(__APPLE__)
+    return dispatch_semaphore_wait(m_semaphore, dispatch_time(DISPATCH_TIME_NOW, nanos)) == 0;
+#else
+    // sem_timedwait takes a deadline on the wall clock; a jump of the wall clock only makes
+    // this wait shorter or longer, the caller checks the time again after waking
+    timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += time_t(nanos / 1000000000);
+    deadline.tv_nsec += long(nanos % 1000000000);
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+    while (sem_timedwait(&m_semaphore, &deadline) != 0) {
+        if (errno != EINTR) {
+            return false;
+        }
+    }
+    return true;
+#endif
+}
@@ -0,0 +1,51 @@
+//
+//  wakeSignal.h
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+/*
+wakeSignal lets the audio thread wake a worker thread without taking a lock. It is a counting
+semaphore of the operating system (a dispatch semaphore on macOS, a POSIX semaphore
+elsewhere): signal() never blocks or allocates, and a signal given before the worker starts
+to wait is kept, so the worker can sleep until there is work instead of polling for it.
+*/
+
+// These directives are used to prevent multiple inclusions of the same header file, which
+// helps avoid redefinition errors and improves compilation efficiency:
+#ifndef wakeSignal_h
+#define wakeSignal_h
+
+#if defined(__APPLE__)
+#include <dispatch/dispatch.h>
+#else
+#include <semaphore.h>
+#endif
+
+class wakeSignal {
+public:
+    wakeSignal();
+    ~wakeSignal();
+
+    wakeSignal(const wakeSignal&) = delete;
+    wakeSignal& operator=(const wakeSignal&) = delete;
+
+    // Wakes the waiting thread, or the next wait if none is waiting (any thread, lock-free)
+    void signal();
+
+    // Waits until signalled
+    void wait();
+
+    // Waits until signalled or the time has passed; returns true if signalled
+    bool waitFor(double seconds);
+
+private:
+#if defined(__APPLE__)
+    dispatch_semaphore_t m_semaphore;
+#else
+    sem_t m_semaphore;
+#endif
+};
+
+#endif /* wakeSignal_h */
@@ -0,0 +1,129 @@
+//
+//  wavFile.cpp
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include "ofMain.h"
+#include "wavFile.h"
+
+namespace {
+    // WAV files are little-endian
+    uint32_t readLittle(const unsigned char* data, int bytes) {
+        uint32_t value = 0;
+        for (int i = 0; i < bytes; i++) {
+            value |= uint32_t(data[i]) << (8 * i);
+        }
+        return value;
+    }
+
+    constexpr int formatPcm = 1;          // Integer samples
+    constexpr int formatFloat = 3;        // IEEE float samples
+    constexpr int formatExtensible = 0xFFFE; // Format given in the extension
+}
+
+//--------------------------------------------------------------
+
+bool wavFile::load(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        ofLogError("wavFile::load") << "Cannot open " << path;
+        return false;
+    }
+    std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (data.size() < 12 || std::memcmp(data.data(), "RIFF", 4) != 0 || std::memcmp(data.data() + 8, "WAVE", 4) != 0) {
+        ofLogError("wavFile::load") << path << " is not a WAV file";
+        return false;
+    }
+
+    // Walk the chunks; "fmt " describes the samples, "data" holds them
+    int format = 0, bitsPerSample = 0;
+    const unsigned char* samples = nullptr;
+    size_t samplesSize = 0;
+    size_t offset = 12;
+    while (offset + 8 <= data.size()) {
+        const unsigned char* chunk = data.data() + offset;
+        size_t chunkSize = readLittle(chunk + 4, 4);
+        size_t available = std::min(chunkSize, data.size() - offset - 8); // Tolerate truncated files
+        if (std::memcmp(chunk, "fmt ", 4) == 0 && available >= 16) {
+            format = readLittle(chunk + 8, 2);
+            m_numChannels = readLittle(chunk + 10, 2);
+            m_sampleRate = readLittle(chunk + 12, 4);
+            bitsPerSample = readLittle(chunk + 22, 2);
+            if (format == formatExtensible && available >= 26) {
+                format = readLittle(chunk + 32, 2); // First two bytes of the sub-format GUID
+            }
+        } else if (std::memcmp(chunk, "data", 4) == 0) {
+            samples = chunk + 8;
+            samplesSize = available;
+        }
+        offset += 8 + chunkSize + (chunkSize & 1); // Chunks are padded to an even size
+    }
+
+    bool supported = (format == formatPcm && (bitsPerSample == 16 || bitsPerSample == 24 || bitsPerSample == 32))
+                  || (format == formatFloat && bitsPerSample == 32);
+    if (!samples || m_numChannels <= 0 || m_sampleRate <= 0 || !supported) {
+        ofLogError("wavFile::load") << path << " has an unsupported format";
+        m_numChannels = 0;
+        return false;
+    }
+
+    // Convert to float
+    int bytes = bitsPerSample / 8;
+    size_t count = samplesSize / bytes;
+    count -= count % m_numChannels; // Whole frames only
+    m_samples.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        uint32_t raw = readLittle(samples + i * bytes, bytes);
+        if (format == formatFloat) {
+            std::memcpy(&m_samples[i], &raw, 4);
+        } else {
+            // Sign-extend and scale to -1..1
+            int32_t value = int32_t(raw << (32 - bitsPerSample));
+            m_samples[i] = float(value / 2147483648.0);
+        }
+    }
+    return true;
+}
+
+//--------------------------------------------------------------
+
+int wavFile::getNumChannels() const {
+    return m_numChannels;
+}
+
+//--------------------------------------------------------------
+
+int wavFile::getSampleRate() const {
+    return m_sampleRate;
+}
+
+//--------------------------------------------------------------
+
+size_t wavFile::getNumFrames() const {
+    return m_numChannels > 0 ? m_samples.size() / m_numChannels : 0;
+}
+
+//--------------------------------------------------------------
+
+const std::vector<float>& wavFile::getSamples() const {
+    return m_samples;
+}
+
+//--------------------------------------------------------------
+
+std::vector<float> wavFile::getMono() const {
+    std::vector<float> mono(getNumFrames());
+    for (size_t frame = 0; frame < mono.size(); frame++) {
+        float sum = 0.0f;
+        for (int channel = 0; channel < m_numChannels; channel++) {
+            sum += m_samples[frame * m_numChannels + channel];
+        }
+        mono[frame] = sum / m_numChannels;
+    }
+    return mono;
+}
@@ -0,0 +1,49 @@
+//
+//  wavFile.h
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+/*
+The wavFile class reads RIFF/WAVE files into memory as 32-bit float samples, so the
+sampler can play them inside the audio callback instead of through ofSoundPlayer. It reads
+16-, 24- and 32-bit integer PCM and 32-bit float files with any number of channels.
+Loading does file I/O and allocates, so it belongs on a background thread.
+*/
+
+// These directives are used to prevent multiple inclusions of the same header file, which
+// helps avoid redefinition errors and improves compilation efficiency:
+#ifndef wavFile_h
+#define wavFile_h
+
+#include <string>   // For file paths
+#include <vector>   // For the samples
+
+class wavFile {
+public:
+    // Reads a file; returns false (and logs why) if it cannot be read
+    bool load(const std::string& path);
+
+    // Returns the number of channels
+    int getNumChannels() const;
+
+    // Returns the sample rate the file was recorded at
+    int getSampleRate() const;
+
+    // Returns the number of frames
+    size_t getNumFrames() const;
+
+    // Returns the samples, interleaved
+    const std::vector<float>& getSamples() const;
+
+    // Returns the samples mixed down to one channel
+    std::vector<float> getMono() const;
+
+private:
+    int m_numChannels = 0;          // Channels per frame
+    int m_sampleRate = 0;           // Frames per second
+    std::vector<float> m_samples;   // Interleaved samples between -1 and 1
+};
+
+#endif /* wavFile_h */
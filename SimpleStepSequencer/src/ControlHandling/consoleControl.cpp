@@ -0,0 +1,94 @@
+//
+//  consoleControl.cpp
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+#include <poll.h>
+#include <unistd.h>
+#include "consoleControl.h"
+#include "threadTuning.h"
+
+// Constructor implementation
+consoleControl::consoleControl() {
+    // Nothing is read until start() is called
+}
+
+//--------------------------------------------------------------
+
+// Destructor implementation
+consoleControl::~consoleControl() {
+    stop(); // Make sure the reading thread has finished
+}
+
+//--------------------------------------------------------------
+
+void consoleControl::start() {
+    if (m_running) {
+        return;
+    }
+    m_running = true;
+    m_thread = std::thread(&consoleControl::run, this);
+}
+
+//--------------------------------------------------------------
+
+void consoleControl::stop() {
+    m_running = false;
+    if (m_thread.joinable()) {
+        m_thread.join(); // The thread wakes up at least every 100 ms to check the flag
+    }
+}
+
+//--------------------------------------------------------------
+
+bool consoleControl::poll(std::string& line) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_lines.empty()) {
+        return false;
+    }
+    line = std::move(m_lines.front());
+    m_lines.pop_front();
+    return true;
+}
+
+//--------------------------------------------------------------
+
+bool consoleControl::isClosed() const {
+    return m_closed;
+}
+
+//--------------------------------------------------------------
+
+void consoleControl::run() {
+    threadTuning::applyWorkerAffinity(); // Keep off the audio thread's cores, if configured
+
+    std::string pending; // Characters of the line being received
+    char chunk[256];
+
+    while (m_running) {
+        // Wait for input with a timeout, so stop() never has to wait for a key press
+        struct pollfd input = { STDIN_FILENO, POLLIN, 0 };
+        if (::poll(&input, 1, 100) <= 0) {
+            continue;
+        }
+
+        ssize_t count = ::read(STDIN_FILENO, chunk, sizeof(chunk));
+        if (count <= 0) {
+            m_closed = true; // End of file: nobody will send more commands
+            break;
+        }
+
+        // Split the received characters into lines
+        for (ssize_t i = 0; i < count; i++) {
+            if (chunk[i] == '\n') {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_lines.push_back(pending);
+                pending.clear();
+            } else if (chunk[i] != '\r') {
+                pending += chunk[i];
+            }
+        }
+    }
+}
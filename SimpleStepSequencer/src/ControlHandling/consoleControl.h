@@ -0,0 +1,57 @@
+//
+//  consoleControl.h
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+/*
+The consoleControl class reads text commands line by line from standard input on a
+background thread, so a headless sequencer can be driven from a terminal, a script or a
+process supervisor. Complete lines are queued and handed to the main thread through poll(),
+where they are interpreted; the reading thread never touches the audio engine itself.
+*/
+
+// These directives are used to prevent multiple inclusions of the same header file, which
+// helps avoid redefinition errors and improves compilation efficiency:
+#ifndef consoleControl_h
+#define consoleControl_h
+
+#include <atomic>   // For the running flag
+#include <deque>    // For the queue of received lines
+#include <mutex>    // For guarding the queue
+#include <string>   // For std::string
+#include <thread>   // For the reading thread
+
+class consoleControl {
+public:
+    // Constructor
+    consoleControl();
+
+    // Destructor that stops the reading thread
+    ~consoleControl();
+
+    // Starts reading standard input
+    void start();
+
+    // Stops reading standard input
+    void stop();
+
+    // Fetches the next received line; returns false when there is none
+    bool poll(std::string& line);
+
+    // Returns true once standard input has been closed
+    bool isClosed() const;
+
+private:
+    // Body of the reading thread
+    void run();
+
+    std::thread m_thread;               // Reads standard input
+    std::atomic<bool> m_running{false}; // Keeps the thread alive
+    std::atomic<bool> m_closed{false};  // Set when standard input reaches end of file
+    std::mutex m_mutex;                 // Guards m_lines
+    std::deque<std::string> m_lines;    // Lines waiting for the main thread
+};
+
+#endif /* consoleControl_h */
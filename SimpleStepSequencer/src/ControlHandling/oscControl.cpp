@@ -0,0 +1,294 @@
+//
+//  oscControl.cpp
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstring>
+#include "oscControl.h"
+#include "metronome.h"
+#include "threadTuning.h"
+
+namespace {
+    // Seconds between the OSC (NTP) epoch, 1900, and the Unix epoch, 1970
+    constexpr uint64_t ntpToUnixSeconds = 2208988800ULL;
+
+    // Timetag meaning "immediately"
+    constexpr uint64_t timetagImmediately = 1;
+
+    // Reads a big-endian 32-bit word
+    uint32_t readWord(const char* data) {
+        uint32_t word;
+        std::memcpy(&word, data, 4);
+        return ntohl(word);
+    }
+
+    // Returns the size of a padded OSC string, or 0 if it is not terminated inside size
+    size_t paddedStringSize(const char* data, size_t size) {
+        const void* end = std::memchr(data, '\0', size);
+        if (!end) {
+            return 0;
+        }
+        size_t length = static_cast<const char*>(end) - data + 1; // Including the terminator
+        size_t padded = (length + 3) & ~size_t(3);
+        return padded <= size ? padded : 0;
+    }
+}
+
+// Constructor implementation
+oscControl::oscControl(metronome* metronomePtr) : m_metronome(metronomePtr) {
+    // Nothing is received until start() is called
+}
+
+//--------------------------------------------------------------
+
+// Destructor implementation
+oscControl::~oscControl() {
+    stop(); // Make sure the receiving thread has finished
+}
+
+//--------------------------------------------------------------
+
+bool oscControl::start(int port) {
+    if (m_running) {
+        return true;
+    }
+
+    m_socket = ::socket(AF_INET, SOCK_DGRAM, 0);
+    if (m_socket < 0) {
+        ofLogError("oscControl::start") << "Failed to create UDP socket!";
+        return false;
+    }
+
+    // A large receive buffer absorbs bursts while the thread is busy parsing
+    int receiveBuffer = 1 << 20;
+    setsockopt(m_socket, SOL_SOCKET, SO_RCVBUF, &receiveBuffer, sizeof(receiveBuffer));
+
+    // Only local clients may control the sequencer
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons((uint16_t)port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::bind(m_socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        ofLogError("oscControl::start") << "Failed to bind UDP port " << port << "!";
+        ::close(m_socket);
+        m_socket = -1;
+        return false;
+    }
+
+    m_running = true;
+    m_thread = std::thread(&oscControl::run, this);
+    ofLogNotice("oscControl") << "Listening for OSC on 127.0.0.1:" << port;
+    return true;
+}
+
+//--------------------------------------------------------------
+
+void oscControl::stop() {
+    m_running = false;
+    if (m_thread.joinable()) {
+        m_thread.join(); // The thread wakes up at least every 100 ms to check the flag
+    }
+    if (m_socket >= 0) {
+        ::close(m_socket);
+        m_socket = -1;
+    }
+}
+
+//--------------------------------------------------------------
+
+oscControl::stats oscControl::getStats() const {
+    stats current;
+    current.packets = m_packets;
+    current.messages = m_messages;
+    current.bundles = m_bundles;
+    current.dropped = m_dropped;
+    current.malformed = m_malformed;
+    return current;
+}
+
+//--------------------------------------------------------------
+
+void oscControl::run() {
+    threadTuning::applyWorkerAffinity(); // Keep off the audio thread's cores, if configured
+
+    while (m_running) {
+        // Wait for a packet with a timeout, so stop() never has to wait for a client
+        struct pollfd input = { m_socket, POLLIN, 0 };
+        if (::poll(&input, 1, 100) <= 0) {
+            continue;
+        }
+
+        // Empty the socket before going back to sleep
+        while (true) {
+            ssize_t size = ::recv(m_socket, m_packet.data(), m_packet.size(), MSG_DONTWAIT);
+            if (size <= 0) {
+                break;
+            }
+            m_packets++;
+
+            m_batchSize = 0;
+            if (!parsePacket(m_packet.data(), (size_t)size, engineCommand::immediately, 0)) {
+                m_malformed++;
+            }
+            if (m_batchSize == 0) {
+                continue;
+            }
+
+            // The whole packet goes to the audio thread as one batch
+            if (m_metronome->getCommandQueue()->push(m_batch.data(), m_batchSize)) {
+                m_messages += m_batchSize;
+            } else {
+                m_dropped++;
+            }
+        }
+    }
+}
+
+//--------------------------------------------------------------
+
+bool oscControl::parsePacket(const char* data, size_t size, int64_t sampleTime, int depth) {
+    // Every OSC packet is a multiple of four bytes
+    if (size < 4 || size % 4 != 0) {
+        return false;
+    }
+    if (data[0] == '/') {
+        return parseMessage(data, size, sampleTime);
+    }
+    if (size < 16 || std::memcmp(data, "#bundle", 8) != 0 || depth > 8) {
+        return false;
+    }
+    m_bundles++;
+
+    // Elements of a bundle are due at the bundle's time
+    uint64_t timetag = (uint64_t(readWord(data + 8)) << 32) | readWord(data + 12);
+    int64_t bundleTime = timetagToFrame(timetag);
+
+    size_t offset = 16;
+    bool valid = true;
+    while (offset + 4 <= size) {
+        size_t elementSize = readWord(data + offset);
+        offset += 4;
+        if (elementSize > size - offset) {
+            return false; // The element claims to be longer than the packet
+        }
+        valid &= parsePacket(data + offset, elementSize, bundleTime, depth + 1);
+        offset += elementSize;
+    }
+    return valid;
+}
+
+//--------------------------------------------------------------
+
+bool oscControl::parseMessage(const char* data, size_t size, int64_t sampleTime) {
+    // Address pattern
+    size_t addressSize = paddedStringSize(data, size);
+    if (addressSize == 0) {
+        return false;
+    }
+    const char* address = data;
+
+    // Type tag string; a message without one has no arguments
+    const char* tags = ",";
+    size_t offset = addressSize;
+    if (offset < size && data[offset] == ',') {
+        size_t tagsSize = paddedStringSize(data + offset, size - offset);
+        if (tagsSize == 0) {
+            return false;
+        }
+        tags = data + offset;
+        offset += tagsSize;
+    }
+
+    // Read up to four numeric arguments; ints and floats are accepted for every argument
+    float values[4] = {0, 0, 0, 0};
+    int count = 0;
+    for (const char* tag = tags + 1; *tag; tag++) {
+        if (*tag != 'i' && *tag != 'f') {
+            return false;
+        }
+        if (offset + 4 > size) {
+            return false;
+        }
+        uint32_t word = readWord(data + offset);
+        offset += 4;
+        if (count == 4) {
+            continue; // Extra arguments are ignored
+        }
+        if (*tag == 'i') {
+            values[count++] = (float)(int32_t)word;
+        } else {
+            float value;
+            std::memcpy(&value, &word, 4);
+            values[count++] = value;
+        }
+    }
+
+    engineCommand command;
+    command.sampleTime = sampleTime;
+    if (std::strcmp(address, "/transport") == 0 && count >= 1) {
+        command.kind = engineCommand::type::transport;
+        command.first = values[0] != 0.0f;
+    } else if (std::strcmp(address, "/tempo") == 0 && count >= 1) {
+        command.kind = engineCommand::type::tempo;
+        command.value = values[0];
+        command.value2 = count >= 2 ? values[1] : 0.0f;
+    } else if (std::strcmp(address, "/rhythm") == 0 && count >= 2) {
+        command.kind = engineCommand::type::rhythm;
+        command.first = (int32_t)values[0];
+        command.second = (int32_t)values[1];
+    } else if (std::strcmp(address, "/step") == 0 && count >= 3) {
+        command.kind = engineCommand::type::step;
+        command.first = (int32_t)values[0];
+        command.second = (int32_t)values[1];
+        command.third = values[2] != 0.0f;
+        command.fourth = count >= 4 ? (int32_t)values[3] : -1;
+    } else if (std::strcmp(address, "/route") == 0 && count >= 3) {
+        command.kind = engineCommand::type::route;
+        command.first = (int32_t)values[0];
+        command.second = (int32_t)values[1];
+        command.third = (int32_t)values[2];
+        command.fourth = count >= 4 ? (int32_t)values[3] : 1;
+    } else if (std::strcmp(address, "/bus") == 0 && count >= 2) {
+        command.kind = engineCommand::type::bus;
+        command.first = (int32_t)values[0];
+        command.second = (int32_t)values[1];
+    } else if (std::strcmp(address, "/busout") == 0 && count >= 2) {
+        command.kind = engineCommand::type::busOutput;
+        command.first = (int32_t)values[0];
+        command.second = (int32_t)values[1];
+    } else if (std::strcmp(address, "/pattern") == 0 && count >= 1) {
+        command.kind = engineCommand::type::selectPattern;
+        command.first = (int32_t)values[0];
+    } else {
+        return false; // Unknown address or missing arguments
+    }
+
+    if (m_batchSize == m_batch.size()) {
+        return false; // More messages in one packet than we keep
+    }
+    m_batch[m_batchSize++] = command;
+    return true;
+}
+
+//--------------------------------------------------------------
+
+int64_t oscControl::timetagToFrame(uint64_t timetag) const {
+    if (timetag == timetagImmediately) {
+        return engineCommand::immediately;
+    }
+
+    // The timetag is wall-clock (NTP) time; go through the system clock to the steady clock
+    // the metronome uses for its sample clock
+    double unixSeconds = double((timetag >> 32) - ntpToUnixSeconds) + double(timetag & 0xffffffff) / 4294967296.0;
+    double systemNow = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+    double steadyNow = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    return m_metronome->framesAt(steadyNow + (unixSeconds - systemNow));
+}
@@ -0,0 +1,99 @@
+//
+//  oscControl.h
+//  SimpleStepSequencer
+//
+//  Created by Anders Monrad on 19/10/2026.
+//
+
+/*
+The oscControl class is a local OSC endpoint: it listens for OSC packets on a UDP port of
+127.0.0.1 and turns them into engine commands for a metronome. Packets are received and
+parsed on a background thread into fixed storage, so no memory is allocated per message.
+All messages of one packet, including nested bundles, are sent to the metronome as one
+batch, which the audio thread applies as a whole. Bundles with a timetag are applied at the
+frame of the sample clock the timetag corresponds to; messages without one as soon as
+possible.
+
+Supported addresses:
+  /transport i          1 = play, 0 = stop
+  /tempo f [f]          BPM, optionally a ramp time in seconds
+  /rhythm i i           beats, tuplets
+  /step i i i [i]       track, step, on (1) / off (0), optionally a pattern slot
+  /pattern i            selects a pattern slot
+  /route i i i [i]      track, destination (0 = MIDI, 1 = sampler, 2 = synth), voice, MIDI channel
+
+Every sequencer instance listens on its own port, so many can be driven side by side.
+*/
+
+// These directives are used to prevent multiple inclusions of the same header file, which
+// helps avoid redefinition errors and improves compilation efficiency:
+#ifndef oscControl_h
+#define oscControl_h
+
+#include <array>          // For the fixed storage
+#include <atomic>         // For the running flag and the counters
+#include <cstdint>        // For the fixed-size integers
+#include <thread>         // For the receiving thread
+#include "engineCommand.h" // For the commands that are sent to the metronome
+
+class metronome;
+
+class oscControl {
+public:
+    // Counters of what has been received
+    struct stats {
+        uint64_t packets = 0;     // UDP packets received
+        uint64_t messages = 0;    // OSC messages turned into commands
+        uint64_t bundles = 0;     // OSC bundles received, nested ones included
+        uint64_t dropped = 0;     // Packets dropped because the command queue was full
+        uint64_t malformed = 0;   // Packets or messages that could not be understood
+    };
+
+    static constexpr size_t maxPacketSize = 65536;   // Largest UDP datagram
+    static constexpr size_t maxCommandsPerPacket = 512; // Messages kept from one packet
+
+    // Constructor that takes the metronome to control
+    oscControl(metronome* metronomePtr);
+
+    // Destructor that closes the socket and stops the thread
+    ~oscControl();
+
+    // Opens the port on 127.0.0.1 and starts receiving; returns false on failure
+    bool start(int port);
+
+    // Stops receiving and closes the port
+    void stop();
+
+    // Returns the counters
+    stats getStats() const;
+
+private:
+    // Body of the receiving thread
+    void run();
+
+    // Parses one packet (a message or a bundle) into m_batch
+    bool parsePacket(const char* data, size_t size, int64_t sampleTime, int depth);
+
+    // Parses one message into m_batch
+    bool parseMessage(const char* data, size_t size, int64_t sampleTime);
+
+    // Converts an OSC timetag to a frame of the metronome's sample clock
+    int64_t timetagToFrame(uint64_t timetag) const;
+
+    metronome* m_metronome;                 // Receives the commands
+    int m_socket = -1;                      // UDP socket
+    std::thread m_thread;                   // Receives and parses packets
+    std::atomic<bool> m_running{false};     // Keeps the thread alive
+
+    std::array<char, maxPacketSize> m_packet;                    // Received packet
+    std::array<engineCommand, maxCommandsPerPacket> m_batch;     // Commands of the packet
+    size_t m_batchSize = 0;                                      // Commands in m_batch
+
+    std::atomic<uint64_t> m_packets{0};     // See stats
+    std::atomic<uint64_t> m_messages{0};
+    std::atomic<uint64_t> m_bundles{0};
+    std::atomic<uint64_t> m_dropped{0};
+    std::atomic<uint64_t> m_malformed{0};
+};
+
+#endif /* oscControl_h */
@@ -20,11 +20,14 @@ customGui::customGui(metronome* metronomePtr) : m_metronomePtr(metronomePtr) {
     m_gui1.setup();                     // Initializes the panel
     m_gui1.add(m_onOff.setup("onOff", false));   // Add a toggle button to the panel with default value false
     m_gui1.add(m_tempo.setup("Tempo", initialTempo, 30, 200));  // Add a float slider for tempo control
+    m_gui1.add(m_rampTime.setup("Ramp (s)", 0, 0, 8));  // Add a float slider for the tempo glide time
+    m_gui1.add(m_clockOut.setup("MIDI clock out", false));  // Add a toggle for sending MIDI clock
+    m_gui1.add(m_clockIn.setup("MIDI clock in", false));    // Add a toggle for following MIDI clock
     m_gui1.setPosition(10, 200);        // Position the panel at coordinates (10, 200)
     
     // Set up the second GUI panel (m_gui2)
     m_gui2.setup();                     // Initializes the panel
-    m_gui2.add(m_beats.setup("Beats", initialBeatAmount, 1, 8));  // Add an int slider for beats control
+    m_gui2.add(m_beats.setup("Beats", initialBeatAmount, 1, stepPattern::maxSteps / 8));  // Add an int slider for beats control (up to 1024 steps of 8 tuplets)
     m_gui2.add(m_tuplets.setup("Tuplets", initialTupletAmount, 2, 8));  // Add an int slider for tuplets control
     
     // Position the second panel to the right of the first panel with padding
@@ -34,6 +37,8 @@ customGui::customGui(metronome* metronomePtr) : m_metronomePtr(metronomePtr) {
     // Add listeners to GUI elements to handle user interactions
     m_onOff.addListener(this, &customGui::onToggleChanged);   // Toggle listener
     m_tempo.addListener(this, &customGui::onTempoChanged);    // Tempo slider listener
+    m_clockOut.addListener(this, &customGui::onClockOutChanged); // Clock out toggle listener
+    m_clockIn.addListener(this, &customGui::onClockInChanged);   // Clock in toggle listener
     m_beats.addListener(this, &customGui::onBeatsChanged);    // Beats slider listener
     m_tuplets.addListener(this, &customGui::onTupletsChanged);  // Tuplets slider listener
     
@@ -55,7 +60,10 @@ customGui::~customGui() {
 void customGui::onToggleChanged(bool & value) {
     
     if (m_metronomePtr) { // Check if the pointer is not null before using it
-        m_metronomePtr->toggleOnOff(value); // Update the metronome's on/off state
+        engineCommand transport;
+        transport.kind = engineCommand::type::transport;
+        transport.first = value;
+        sendControl(transport); // Update the metronome's on/off state
     }
 }
 
@@ -64,7 +72,33 @@ void customGui::onToggleChanged(bool & value) {
 void customGui::onTempoChanged(float &value) {
     
     if (m_metronomePtr) { // Check if the pointer is not null before using it
-        m_metronomePtr->setTempo(value); // Update the metronome's tempo
+        engineCommand tempo;
+        tempo.kind = engineCommand::type::tempo;
+        tempo.value = value;
+        tempo.value2 = m_rampTime; // Glide to the new tempo, or change at once if 0
+        sendControl(tempo);
+    }
+}
+
+//----------------------------------------------
+
+void customGui::onClockOutChanged(bool &value) {
+    
+    if (m_metronomePtr && !m_clockIn) { // Following an external clock takes precedence
+        m_metronomePtr->setClockMode(value ? metronome::clockMode::master : metronome::clockMode::internal);
+    }
+}
+
+//----------------------------------------------
+
+void customGui::onClockInChanged(bool &value) {
+    
+    if (m_metronomePtr) { // Check if the pointer is not null before using it
+        if (value) {
+            m_metronomePtr->setClockMode(metronome::clockMode::slave);
+        } else {
+            m_metronomePtr->setClockMode(m_clockOut ? metronome::clockMode::master : metronome::clockMode::internal);
+        }
     }
 }
 
@@ -72,7 +106,11 @@ void customGui::onTempoChanged(float &value) {
 
 void customGui::onBeatsChanged(int &value){
     if (m_metronomePtr) { // Ensure metronomePtr is valid before using it
-        m_metronomePtr->updateRhythm(value, m_tuplets); // Update rhythm with the new beats value
+        engineCommand rhythm;
+        rhythm.kind = engineCommand::type::rhythm;
+        rhythm.first = value;
+        rhythm.second = m_tuplets;
+        sendControl(rhythm); // Update rhythm with the new beats value
     }
 }
 
@@ -80,7 +118,20 @@ void customGui::onBeatsChanged(int &value){
 
 void customGui::onTupletsChanged(int &value){
     if (m_metronomePtr) { // Ensure metronomePtr is valid before using it
-        m_metronomePtr->updateRhythm(m_beats, value); // Update rhythm with the new tuplets value
+        engineCommand rhythm;
+        rhythm.kind = engineCommand::type::rhythm;
+        rhythm.first = m_beats;
+        rhythm.second = value;
+        sendControl(rhythm); // Update rhythm with the new tuplets value
+    }
+}
+
+//----------------------------------------------
+
+void customGui::sendControl(const engineCommand& command) {
+    if (!m_metronomePtr->applyControl(command)) {
+        // The queue empties every buffer, so this only happens under a flood of commands
+        ofLogWarning("customGui") << "Setting not sent: the command queue is full";
     }
 }
 
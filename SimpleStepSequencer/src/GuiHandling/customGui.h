@@ -23,6 +23,7 @@ displaying some panels based on the state of the toggle switch.
 
 // Forward declaration of the metronome class
 class metronome;
+struct engineCommand;
 
 class customGui {
     
@@ -36,12 +37,21 @@ public:
     // Callback for when the tempo slider changes its value
     void onTempoChanged(float & value);
     
+    // Callback for when the MIDI clock out toggle changes its value
+    void onClockOutChanged(bool & value);
+    
+    // Callback for when the MIDI clock in toggle changes its value
+    void onClockInChanged(bool & value);
+    
     // Callback for when the beats slider changes its value
     void onBeatsChanged(int & value);
     
     // Callback for when the tuplets slider changes its value
     void onTupletsChanged(int & value);
     
+    // Sends a command to the metronome; logs a warning if the command queue is full
+    void sendControl(const engineCommand& command);
+    
     // Constructor that initializes customGui with a metronome pointer
     customGui(metronome* metronomePtr);
     
@@ -53,9 +63,12 @@ public:
 
     // GUI elements
     ofxFloatSlider m_tempo;    // Slider for tempo control
+    ofxFloatSlider m_rampTime; // Slider for the tempo glide time in seconds (0 = immediate)
     ofxIntSlider m_beats;      // Slider for beats control
     ofxIntSlider m_tuplets;    // Slider for tuplets control
     ofxToggle m_onOff;         // Toggle switch for enabling/disabling
+    ofxToggle m_clockOut;      // Toggle for sending MIDI clock
+    ofxToggle m_clockIn;       // Toggle for following an incoming MIDI clock
     
     // Panels for organizing GUI elements
     ofxPanel m_gui1;           // First GUI panel
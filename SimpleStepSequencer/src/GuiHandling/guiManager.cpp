@@ -8,6 +8,7 @@
 #include "guiManager.h"     // Includes the header for the guiManager class
 #include "factory.h"        // Includes the factory class for creating GUI components
 #include "metronome.h"      // Includes the metronome class
+#include "timelineTrace.h"  // Includes the timeline of the threads (TIMELINE_TRACE builds)
 
 // Constructor
 guiManager::guiManager() {
@@ -55,26 +56,108 @@ void guiManager::update() {
             m_isFboSetup = true;  // Mark framebuffer as set up
         }
     }
+
+    // Keep the screen framebuffer the size of the window
+    if (m_screen.getWidth() != ofGetWidth() || m_screen.getHeight() != ofGetHeight()) {
+        m_screen.allocate(ofGetWidth(), ofGetHeight());
+        m_redrawRequested = true;
+    }
+
+    // Drop the frame rate once nothing has changed for a while; a change raises it again
+    bool idle = ofGetElapsedTimeMillis() - m_lastRedrawMillis >= idleDelayMillis;
+    int frameRate = idle ? idleFrameRate : activeFrameRate;
+    if (frameRate != m_frameRate) {
+        ofSetFrameRate(frameRate);
+        m_frameRate = frameRate;
+    }
 }
 
 //--------------------------------------------------------------
 
 // Draw method
 void guiManager::draw() {
-    // Draw the GUI components if they exist
-    if (m_seqGui) m_seqGui->draw();         // Draw the sequencerGui if it's initialized
-    if (m_gui) m_gui->draw();               // Draw the customGui if it's initialized
-    if (m_metronome) m_metronome->draw();   // Draw the metronome if it's initialized
-    
+    if (needsRedraw()) {
+        TIMELINE_SCOPE("redraw");
+        m_redrawRequested = false;
+        m_lastRedrawMillis = ofGetElapsedTimeMillis();
+        m_screen.begin();
+        ofClear(ofGetBackgroundColor());
+
+        // Draw the GUI components if they exist
+        if (m_seqGui) m_seqGui->draw();         // Draw the sequencerGui if it's initialized
+        if (m_gui) m_gui->draw();               // Draw the customGui if it's initialized
+        if (m_metronome) m_metronome->draw();   // Draw the metronome if it's initialized
+        m_screen.end();
+    }
+    ofSetColor(255, 255, 255);  // Draw the framebuffer as it is
+    m_screen.draw(0, 0);
+}
+
+//--------------------------------------------------------------
+
+// Request a redraw
+void guiManager::requestRedraw() {
+    m_redrawRequested = true;
+}
+
+//--------------------------------------------------------------
+
+// Check whether anything on the screen changed
+bool guiManager::needsRedraw() const {
+    return m_redrawRequested
+           || (m_seqGui && m_seqGui->needsRedraw())
+           || (m_metronome && m_metronome->needsRedraw());
 }
 
 //--------------------------------------------------------------
 
 // Mouse pressed event handler
 void guiManager::mousePressed(int x, int y) {
-    if (m_seqGui) {  // Check if sequencerGui is initialized
-        ofPoint mousePosition(x, y);  // Create an ofPoint object with mouse coordinates
-        m_seqGui->checkBox(mousePosition);  // Check if a checkbox was clicked
+    requestRedraw();  // The panels may react as well
+    int track = 0, step = 0;
+    ofPoint mousePosition(x, y);  // Create an ofPoint object with mouse coordinates
+    if (m_seqGui && m_metronome && m_seqGui->checkBox(mousePosition, track, step)) {  // Check if a checkbox was clicked
+        // Toggle it through the metronome, so a session trace records the edit
+        engineCommand toggle;
+        toggle.kind = engineCommand::type::step;
+        toggle.first = track;
+        toggle.second = step;
+        toggle.third = !m_metronome->getPattern()->isStepOn(track, step);
+        toggle.fourth = -1;
+        if (!m_metronome->applyControl(toggle)) {
+            // The queue empties every buffer, so clicking again works
+            ofLogWarning("guiManager::mousePressed") << "Step edit not sent: the command queue is full";
+        }
+    }
+}
+
+//--------------------------------------------------------------
+
+// Mouse scrolled event handler
+void guiManager::mouseScrolled(float scrollX, float scrollY) {
+    requestRedraw();
+    if (m_seqGui) {
+        // Wheels and trackpads both move through the pattern, a sixteenth of the view a notch
+        m_seqGui->scroll((scrollX - scrollY) * m_seqGui->getVisibleSteps() / 16.0f);
+    }
+}
+
+//--------------------------------------------------------------
+
+// Key pressed event handler
+void guiManager::keyPressed(int key) {
+    requestRedraw();
+    if (!m_seqGui) {
+        return;
+    }
+    if (key == OF_KEY_LEFT || key == OF_KEY_RIGHT) {  // Arrows page through the pattern
+        m_seqGui->scroll(key == OF_KEY_LEFT ? -m_seqGui->getVisibleSteps() : m_seqGui->getVisibleSteps());
+    } else if (key == '+' || key == '=') {  // Zoom in and out
+        m_seqGui->zoom(1.25f);
+    } else if (key == '-') {
+        m_seqGui->zoom(0.8f);
+    } else if (key == 'f') {  // Follow the playhead, or stop following it
+        m_seqGui->setFollowPlayhead(!m_seqGui->isFollowingPlayhead());
     }
 }
 
@@ -11,6 +11,13 @@ GUI elements and maintains pointers to these elements. The class ensures that co
 are drawn and updated correctly while managing state such as whether the framebuffer
 object has been set up. The exit method is included for potential future cleanup
 operations.
+
+Drawing is driven by changes rather than by the frame loop. The whole window is kept in a
+framebuffer that is drawn again only when something on it changed: the playhead moved, a
+step or the view changed, the metronome's text changed, or there was input the panels may
+react to. Other frames only put that framebuffer on the screen. Once nothing has changed
+for idleDelayMillis, the frame rate drops to idleFrameRate, so the GUI leaves the CPU to the
+audio thread; the first change brings it back to activeFrameRate.
 */
 
 // These directives are used to prevent multiple inclusions of the same header file, which
@@ -27,6 +34,10 @@ operations.
 // Declaration of the guiManager class
 class guiManager {
 public:
+    static constexpr int activeFrameRate = 60;         // Frames per second while things change
+    static constexpr int idleFrameRate = 10;           // Frames per second while nothing changes
+    static constexpr uint64_t idleDelayMillis = 1000;  // Time without changes before going idle
+
     // Constructor
     guiManager();
     
@@ -40,6 +51,10 @@ public:
     void exit();               // Clean up resources before exiting
 
     void mousePressed(int x, int y); // Handle mouse press events
+    void mouseScrolled(float scrollX, float scrollY); // Scroll the step grid
+    void keyPressed(int key);  // Handle the keys that scroll and zoom the step grid
+    void requestRedraw();      // Draw again on the next frame, e.g. after input the panels react to
+    bool needsRedraw() const;  // Returns true if the window has to be drawn again
     
     void setMetronome(metronome* metronomePtr); // Set the metronome pointer
     
@@ -53,6 +68,10 @@ private:
     std::unique_ptr<sequencerGui> m_seqGui; // Smart pointer to manage the sequencerGui instance
 
     bool m_isFboSetup = false;        // Flag to indicate if the framebuffer object (FBO) has been set up
+    ofFbo m_screen;                   // The window as it was last drawn
+    bool m_redrawRequested = true;    // Flag to draw again on the next frame
+    uint64_t m_lastRedrawMillis = 0;  // Time of the latest redraw, for dropping the frame rate
+    int m_frameRate = 0;              // Frame rate set, 0 before the first update
 };
 
 #endif /* guiManager_h */
@@ -5,7 +5,18 @@
 //
 
 #include <stdio.h>
+#include <algorithm>
+#include <cmath>
 #include "sequencerGui.h"
+#include "timelineTrace.h"
+
+namespace {
+    constexpr float gridLeft = 10.0f;     // Left edge of the view
+    constexpr float gridTop = 20.0f;      // Top of the first track
+    constexpr float rowHeight = 25.0f;    // Distance between tracks
+    constexpr float cellHeight = 15.0f;   // Height of a step
+    constexpr float cellFill = 15.0f / 18.0f; // Part of the width of a step taken by its rectangle
+}
 
 // Constructor implementation
 sequencerGui::sequencerGui() {
@@ -21,56 +32,49 @@ sequencerGui::~sequencerGui() {
 
 //--------------------------------------------------------------
 
+void sequencerGui::setPattern(stepPattern* pattern) {
+    m_pattern = pattern;  // The pattern is owned by the metronome
+}
+
+//--------------------------------------------------------------
+
 void sequencerGui::setup(int quarters, int _tuplets) {
-    
-    int steps = quarters * _tuplets;  // Calculate the total number of steps based on quarters and tuplets
-    m_tuplets = _tuplets;  // Store the number of tuplets
-    
+    // Only remember the rhythm here; the view is laid out on the GUI thread
+    m_pendingQuarters = quarters;
+    m_pendingTuplets = _tuplets;
+    m_layoutChanged = true;  // Mark layout as changed
+    m_guiChanged = true;  // Mark GUI as changed
+}
+
+//--------------------------------------------------------------
+
+void sequencerGui::layout() {
+    m_layoutChanged = false;
+    int quarters = m_pendingQuarters;
+    int tuplets = m_pendingTuplets;
+    int steps = quarters * tuplets;  // Calculate the total number of steps based on quarters and tuplets
+
     // Ensure steps is a positive number
     if (steps <= 0) {
         ofLogError("gui::setup") << "Steps must be greater than 0";
         return;
     }
-
-    // Clear previous data in the vectors to avoid duplications
-    for (int i = 0; i < 3; ++i) {
-        m_beats[i].clear();
-    }
-
-    // Initialize each vector in the array with 'steps' number of RectangleWithFlag objects
-    for (int i = 0; i < 3; ++i) {
-        for (int j = 0; j < steps; ++j) {
-            // Calculate the position for the rectangle
-            float x = 10 + j * 18;
-            float y = 20 + (i * 25);
-            
-            // Setup steps with toggle on for hi-hat beats, otherwise toggle off
-            if (i == 0) {
-                m_beats[i].push_back({ ofRectangle(x, y, 15, 15), true });
-            } else {
-                m_beats[i].push_back({ ofRectangle(x, y, 15, 15), false });
-            }
-            // Add the rectangle to the vector
-        }
-    }
-    m_guiChanged = true;  // Mark GUI as changed
+    m_tuplets = tuplets;  // Store the number of tuplets
+    m_numSteps = std::min(steps, stepPattern::maxSteps);  // The metronome has already resized the pattern
+    clampView();
 }
 
 //--------------------------------------------------------------
 
-// Setup framebuffer separately to handle OpenFrameworks issue on iOS devices
+// Setup textures separately to handle OpenFrameworks issue on iOS devices
 void sequencerGui::setupFramebuffer() {
-    m_frameBuffer.allocate(ofGetWidth(), ofGetHeight());  // Allocate the framebuffer with the current window size
-    ofClear(0, 0, 0, 255);  // Clear the framebuffer with black color and full opacity
-    m_frameBuffer.end();  // End the framebuffer drawing
-    
-    refreshFramebuffer();  // Refresh framebuffer to initialize content
+    m_texturesReady = true;  // Pages are allocated when they first come into view
 }
 
 //--------------------------------------------------------------
 
 bool sequencerGui::isFramebufferReady() {
-    return m_frameBuffer.isAllocated();  // Check if the framebuffer has been successfully allocated
+    return m_texturesReady;
 }
 
 //--------------------------------------------------------------
@@ -83,103 +87,293 @@ void sequencerGui::update(int _highlightTick) {
 
 //--------------------------------------------------------------
 
-bool sequencerGui::isTickHighlighted(int _tick, int whichTrack) {
-    // Check bounds to ensure valid access
-    if (whichTrack < 0 || whichTrack >= 3 || _tick < 0 || _tick >= m_beats[whichTrack].size()) {
-        ofLog() << "Invalid index!";
-        return false;  // Return false if the index is out of bounds
-    }
-    
-    // Return whether the specified tick is highlighted
-    return m_beats[whichTrack][_tick].flag;
+void sequencerGui::patternChanged() {
+    m_guiChanged = true;  // Mark GUI as changed
+}
+
+//--------------------------------------------------------------
+
+void sequencerGui::scroll(float steps) {
+    m_followPlayhead = false;  // Scrolling by hand takes over from the playhead
+    m_firstStep += steps;
+    clampView();
+    m_guiChanged = true;
+}
+
+//--------------------------------------------------------------
+
+void sequencerGui::zoom(float factor) {
+    float centre = m_firstStep + getVisibleSteps() * 0.5f;  // Keep the step in the middle where it is
+    m_cellWidth = std::max(minCellWidth, std::min(m_cellWidth * factor, maxCellWidth));
+    m_firstStep = centre - getVisibleSteps() * 0.5f;
+    clampView();
+    m_guiChanged = true;
+}
+
+//--------------------------------------------------------------
+
+void sequencerGui::setFollowPlayhead(bool follow) {
+    m_followPlayhead = follow;
+    m_guiChanged = true;
+}
+
+//--------------------------------------------------------------
+
+bool sequencerGui::isFollowingPlayhead() const {
+    return m_followPlayhead;
+}
+
+//--------------------------------------------------------------
+
+int sequencerGui::getVisibleSteps() const {
+    return std::max(1, (int)(m_viewWidth / m_cellWidth));
+}
+
+//--------------------------------------------------------------
+
+void sequencerGui::clampView() {
+    // Never show more pages than the cache can hold, so every page in view stays cached
+    float minWidth = m_viewWidth / ((maxCachedPages - 2) * stepsPerPage);
+    m_cellWidth = std::max(m_cellWidth, std::min(minWidth, maxCellWidth));
+
+    float lastFirstStep = std::max(0.0f, m_numSteps - m_viewWidth / m_cellWidth);
+    m_firstStep = std::max(0.0f, std::min(m_firstStep, lastFirstStep));
 }
 
 //--------------------------------------------------------------
 
 void sequencerGui::draw() {
-    if (m_guiChanged) {
-        refreshFramebuffer();  // Refresh the framebuffer if the GUI has changed
+    m_guiChanged = false;  // Cleared first, so changes made while drawing are not lost
+    if (m_layoutChanged) {
+        layout();  // The rhythm has changed since the last frame
+    }
+    if (!m_texturesReady || !m_pattern) {
+        return;
+    }
+    m_frame++;
+
+    float viewWidth = windowViewWidth();
+    if (viewWidth != m_viewWidth) {
+        m_viewWidth = viewWidth;  // The window has been resized
+        clampView();
+    }
+
+    // Jump a screen ahead when the playhead leaves the view (or back to the start of the bar)
+    int highlight = m_highlightTick;
+    int visibleSteps = getVisibleSteps();
+    if (m_followPlayhead && highlight >= 0
+        && (highlight < m_firstStep || highlight >= m_firstStep + visibleSteps)) {
+        m_firstStep = (float)(highlight - highlight % visibleSteps);
+        clampView();
+    }
+
+    // Draw the part of every page that is in view
+    float lastStep = std::min((float)m_numSteps, m_firstStep + m_viewWidth / m_cellWidth);
+    int firstPage = 0, endPage = 0;
+    pagesInView(firstPage, endPage);
+    ofSetColor(255, 255, 255);  // Draw the textures as they are
+    for (int page = firstPage; page < endPage; page++) {
+        pageTexture& cached = cachedPage(page);
+        float from = std::max(m_firstStep, (float)(page * stepsPerPage));
+        float to = std::min(lastStep, (float)((page + 1) * stepsPerPage));
+        cached.texture.getTexture().drawSubsection(gridLeft + (from - m_firstStep) * m_cellWidth, gridTop,
+                                                   (to - from) * m_cellWidth, cached.texture.getHeight(),
+                                                   (from - page * stepsPerPage) * m_cellWidth, 0);
+    }
+
+    // The step under the playhead goes on top, if it is wholly in view
+    if (highlight >= 0 && highlight < m_numSteps
+        && highlight >= m_firstStep && highlight + 1 <= m_firstStep + m_viewWidth / m_cellWidth) {
+        for (int track = 0; track < stepPattern::numTracks; ++track) {
+            ofRectangle rect = stepRectangle(track, highlight - m_firstStep);
+            rect.x += gridLeft;
+            rect.y += gridTop;
+            ofSetColor(setRectangleColor(highlight, true));
+            ofDrawRectangle(rect);
+            if (m_pattern->isStepOn(track, highlight)) {
+                drawDiagonalCross(rect);
+            }
+        }
+    }
+
+    // A scroll bar under the tracks when the pattern does not fit
+    if (m_numSteps > visibleSteps) {
+        float barTop = gridTop + stepPattern::numTracks * rowHeight - 6;
+        ofSetColor(60, 60, 60);
+        ofDrawRectangle(gridLeft, barTop, m_viewWidth, 3);
+        ofSetColor(m_followPlayhead ? ofColor(200, 90, 90) : ofColor(155, 155, 155));
+        ofDrawRectangle(gridLeft + m_viewWidth * m_firstStep / m_numSteps, barTop,
+                        m_viewWidth * std::min(1.0f, visibleSteps / (float)m_numSteps), 3);
     }
-    ofSetColor(255, 255, 255);  // Set the color to white for drawing the framebuffer
-    m_frameBuffer.draw(0, 0);  // Draw the framebuffer to the screen at position (0, 0)
 }
 
 //--------------------------------------------------------------
 
-void sequencerGui::checkBox(const ofPoint& mouseClick) {
-    // Iterate over each vector in the array of beats
-    for (auto& vec : m_beats) {
-        // Iterate over each RectangleWithFlag in the current vector
-        for (auto& item : vec) {
-            // Check if the mouse click is inside the rectangle
-            if (item.rect.inside(mouseClick)) {
-                // Toggle the boolean flag
-                item.flag = !item.flag;
-                m_guiChanged = true;  // Mark GUI as changed
+bool sequencerGui::needsRedraw() const {
+    if (m_guiChanged || m_layoutChanged || windowViewWidth() != m_viewWidth) {
+        return true;
+    }
+    if (!m_texturesReady || !m_pattern) {
+        return false;
+    }
+
+    // Edits from other threads (OSC, generators, step recording) only show in the pattern,
+    // so compare the steps in view with the ones drawn into their pages
+    int firstPage = 0, endPage = 0;
+    pagesInView(firstPage, endPage);
+    for (int page = firstPage; page < endPage; page++) {
+        auto cached = std::find_if(m_pages.begin(), m_pages.end(),
+                                   [page](const pageTexture& candidate) { return candidate.page == page; });
+        if (cached == m_pages.end()) {
+            return true;
+        }
+        for (int track = 0; track < stepPattern::numTracks; ++track) {
+            if (cached->steps[track] != m_pattern->getWord(track, page)) {
+                return true;
             }
         }
     }
+    return false;
+}
+
+//--------------------------------------------------------------
+
+float sequencerGui::windowViewWidth() {
+    return std::max(0.0f, ofGetWidth() - 2 * gridLeft);
 }
 
 //--------------------------------------------------------------
 
-void sequencerGui::refreshFramebuffer() {
-    m_frameBuffer.begin();  // Begin drawing to the framebuffer
-    ofClear(0, 0, 0);  // Clear the framebuffer with black color
+void sequencerGui::pagesInView(int& first, int& end) const {
+    float lastStep = std::min((float)m_numSteps, m_firstStep + m_viewWidth / m_cellWidth);
+    first = (int)m_firstStep / stepsPerPage;
+    end = std::max(first, (int)std::ceil(lastStep / stepsPerPage));
+}
 
-    // Iterate over each vector in the array of beats
-    for (const auto& vec : m_beats) {
-        // Iterate over each RectangleWithFlag in the current vector
-        for (size_t i = 0; i < vec.size(); ++i) {
-            const auto& item = vec[i];
+//--------------------------------------------------------------
+
+sequencerGui::pageTexture& sequencerGui::cachedPage(int page) {
+    // The page itself if it is cached, otherwise the texture drawn longest ago
+    pageTexture* cached = &m_pages[0];
+    for (auto& candidate : m_pages) {
+        if (candidate.page == page) {
+            cached = &candidate;
+            break;
+        }
+        if (candidate.lastDrawn < cached->lastDrawn) {
+            cached = &candidate;
+        }
+    }
+
+    // Redraw it unless it shows exactly what it would show now
+    bool current = cached->page == page && cached->cellWidth == m_cellWidth
+                   && cached->tuplets == m_tuplets && cached->numSteps == m_numSteps;
+    for (int track = 0; current && track < stepPattern::numTracks; ++track) {
+        current = cached->steps[track] == m_pattern->getWord(track, page);
+    }
+    if (!current) {
+        drawPage(*cached, page);
+    }
+    cached->lastDrawn = m_frame;
+    return *cached;
+}
+
+//--------------------------------------------------------------
+
+void sequencerGui::drawPage(pageTexture& cached, int page) {
+    TIMELINE_SCOPE_VALUE("draw page", page);
+    int width = (int)std::ceil(stepsPerPage * m_cellWidth);
+    int height = (int)(stepPattern::numTracks * rowHeight);
+    if (cached.texture.getWidth() != width || cached.texture.getHeight() != height) {
+        cached.texture.allocate(width, height);  // Only when first used or zoomed
+    }
+    cached.page = page;
+    cached.cellWidth = m_cellWidth;
+    cached.tuplets = m_tuplets;
+    cached.numSteps = m_numSteps;
+
+    cached.texture.begin();  // Begin drawing to the texture
+    ofClear(0, 0, 0, 255);  // Clear the texture with black color
+
+    // Iterate over each track, and each step of the page that is inside the pattern
+    int first = page * stepsPerPage;
+    int end = std::min(first + stepsPerPage, m_numSteps);
+    for (int track = 0; track < stepPattern::numTracks; ++track) {
+        cached.steps[track] = m_pattern->getWord(track, page);
+        for (int step = first; step < end; ++step) {
+            ofRectangle rect = stepRectangle(track, (float)(step - first));
 
             // Set color of rectangle based on its index
-            ofSetColor(setRectangleColor(i));
+            ofSetColor(setRectangleColor(step, false));
 
             // Draw the rectangle
-            ofDrawRectangle(item.rect);
+            ofDrawRectangle(rect);
 
-            // Draw a diagonal cross inside the rectangle if the flag is true
-            drawDiagonalCross(item);
+            // Draw a diagonal cross inside the rectangle if the step is on
+            if ((cached.steps[track] >> (step - first)) & 1) {
+                drawDiagonalCross(rect);
+            }
         }
     }
-    m_frameBuffer.end();  // End drawing to the framebuffer
-    m_guiChanged = false;  // Mark GUI as unchanged
+    cached.texture.end();  // End drawing to the texture
 }
 
 //--------------------------------------------------------------
 
-void sequencerGui::drawDiagonalCross(const m_rectangleWithFlag& item) {
-    // Draw diagonal cross if flag is true
-    if (item.flag) {
-        ofSetColor(0);  // Set the color for the cross (black)
+ofRectangle sequencerGui::stepRectangle(int track, float position) const {
+    return ofRectangle(position * m_cellWidth, track * rowHeight, m_cellWidth * cellFill, cellHeight);
+}
 
-        // Get the rectangle's position and size
-        float x = item.rect.getX();
-        float y = item.rect.getY();
-        float width = item.rect.getWidth();
-        float height = item.rect.getHeight();
+//--------------------------------------------------------------
 
-        ofSetLineWidth(3);  // Set line width for the cross
+bool sequencerGui::checkBox(const ofPoint& mouseClick, int& track, int& step) {
+    if (!m_pattern || m_numSteps <= 0) {
+        return false;  // Nothing to edit yet
+    }
 
-        // Draw diagonal lines
-        ofDrawLine(x, y, x + width, y + height);  // Diagonal from top-left to bottom-right
-        ofDrawLine(x, y + height, x + width, y);  // Diagonal from bottom-left to top-right
+    // Find the track and step under the click, and whether it is on a rectangle or between two
+    float row = (mouseClick.y - gridTop) / rowHeight;
+    float column = (mouseClick.x - gridLeft) / m_cellWidth;
+    if (row < 0 || row >= stepPattern::numTracks || column < 0 || mouseClick.x >= gridLeft + m_viewWidth) {
+        return false;
     }
+    track = (int)row;
+    float position = m_firstStep + column;
+    step = (int)std::floor(position);
+    bool onRectangle = (row - track) * rowHeight < cellHeight && position - step < cellFill;
+    return onRectangle && step < m_numSteps;
 }
 
 //--------------------------------------------------------------
 
-ofColor sequencerGui::setRectangleColor(int numberInVector) {
+void sequencerGui::drawDiagonalCross(const ofRectangle& rect) {
+    ofSetColor(0);  // Set the color for the cross (black)
+
+    // Get the rectangle's position and size
+    float x = rect.getX();
+    float y = rect.getY();
+    float width = rect.getWidth();
+    float height = rect.getHeight();
+
+    ofSetLineWidth(3);  // Set line width for the cross
+
+    // Draw diagonal lines
+    ofDrawLine(x, y, x + width, y + height);  // Diagonal from top-left to bottom-right
+    ofDrawLine(x, y + height, x + width, y);  // Diagonal from bottom-left to top-right
+}
+
+//--------------------------------------------------------------
+
+ofColor sequencerGui::setRectangleColor(int numberInVector, bool highlighted) {
     ofColor rectColor;
-    
+
     int addRed = 0;  // Variable to make color grey if not highlighted
-    
+
     // Add red if highlighted
-    if (numberInVector == m_highlightTick) {
+    if (highlighted) {
         addRed = 100;
     }
-    
+
     // Set color based on whether it’s a quarter note or a tuple
     if (numberInVector % m_tuplets == 0) {
         rectColor.set(155 + addRed, 155, 155);  // Lighter color for quarter notes
@@ -7,11 +7,22 @@
 /*
 The sequencerGui class is responsible for managing and rendering the graphical user
 interface for a sequencer. It includes functionality for setting up the GUI, handling
-interactions, and drawing both the GUI and any graphical elements. The class also utilizes
-a framebuffer (ofFbo) for optimizing rendering performance. Key features include the
+interactions, and drawing both the GUI and any graphical elements. Key features include the
 ability to highlight specific ticks, handle mouse interactions, and update the display
-based on internal states. The private members and methods provide additional
-functionalities for managing the state and appearance of GUI elements.
+based on internal states. The steps themselves are stored in a stepPattern owned by the
+metronome; the GUI only lays out and draws them. setup() and update() may be called from
+the audio thread (when a control interface changes the rhythm), so they only record what
+changed; the layout is rebuilt on the GUI thread when the grid is drawn.
+
+Patterns can be up to 1024 steps long, far wider than the window, so the grid is a view
+that scrolls and zooms over the pattern. Only the steps in view are drawn and hit-tested:
+a click is turned into a step by arithmetic rather than by searching rectangles, and
+guiManager sends the toggle to the metronome so a session trace records it. The steps
+are drawn in pages of 64 (one word of the pattern), each rendered into a texture that is
+kept until its steps, the rhythm or the zoom change. Textures are cached for at most
+maxCachedPages pages; the least recently drawn one is reused for a new page. The step
+under the playhead is drawn on top of the textures, so playing does not redraw any page.
+While following the playhead, the view jumps ahead a screen at a time to keep it in view.
 */
 
 // These directives are used to prevent multiple inclusions of the same header file, which
@@ -20,49 +31,101 @@ functionalities for managing the state and appearance of GUI elements.
 #define sequencerGui_h
 
 #include "ofMain.h"  // Includes the core OpenFrameworks classes and functions
+#include <array>     // For the cached page textures
+#include <atomic>    // For the state shared with the audio thread
+#include "stepPattern.h"  // The pattern the GUI edits
 
 // Class definition for sequencerGui
 class sequencerGui {
 public:
+    static constexpr int stepsPerPage = stepPattern::stepsPerWord; // Steps drawn into one texture
+    static constexpr int maxCachedPages = 8;     // Page textures kept at most
+    static constexpr float minCellWidth = 4.0f;  // Zoom range, in pixels per step
+    static constexpr float maxCellWidth = 32.0f;
+    static constexpr float defaultCellWidth = 18.0f;
+
     // Constructor
     sequencerGui();
-    
+
     // Destructor
     ~sequencerGui();
 
     // Member functions
+    void setPattern(stepPattern* pattern);        // Sets the pattern the GUI shows and edits
     void setup(int quarters, int _tuplets);       // Initializes the GUI with specified parameters
-    void setupFramebuffer();                      // Sets up the framebuffer for off-screen rendering
+    void setupFramebuffer();                      // Enables the page textures once there is a GL context
     void update(int _highlightTick);              // Updates the GUI state, potentially highlighting ticks
-    void checkBox(const ofPoint& mouseClick);    // Handles mouse click events for checkboxes
+    void patternChanged();                        // Redraws the steps after the pattern changed elsewhere (e.g. undo)
+    bool checkBox(const ofPoint& mouseClick, int& track, int& step); // Finds the step under a click; false if there is none
     void draw();                                 // Renders the GUI to the screen
-    void refreshFramebuffer();                   // Refreshes the framebuffer to ensure updates
-    bool isTickHighlighted(int _tick, int whichTrack); // Checks if a specific tick is highlighted
-    bool isFramebufferReady();                   // Checks if the framebuffer is ready for drawing
-    
+    bool needsRedraw() const;                    // Returns true if draw() would show something new
+    bool isFramebufferReady();                   // Checks if the page textures can be drawn
+
+    void scroll(float steps);                    // Scrolls the view by a number of steps and stops following the playhead
+    void zoom(float factor);                     // Zooms the view around its centre (factor > 1 zooms in)
+    void setFollowPlayhead(bool follow);         // Keeps the playhead in view while playing
+    bool isFollowingPlayhead() const;            // Returns true if the view follows the playhead
+    int getVisibleSteps() const;                 // Returns the number of steps that fit in the view
+
 private:
-    
-    // Define a struct to store rectangles with a flag
-    struct m_rectangleWithFlag {
-        ofRectangle rect;  // Rectangle representing a GUI element or region
-        bool flag;         // Boolean flag associated with the rectangle
+    // A page of steps rendered into a texture
+    struct pageTexture {
+        ofFbo texture;                  // Steps of the page, allocated when first used
+        int page = -1;                  // Page drawn, -1 if none
+        float cellWidth = 0.0f;         // Zoom the page was drawn at
+        int tuplets = 0;                // Rhythm the page was drawn for
+        int numSteps = 0;
+        std::array<uint64_t, stepPattern::numTracks> steps{}; // Steps drawn, one word per track
+        uint64_t lastDrawn = 0;         // Frame the texture was last drawn in
     };
-    
+
     // Function to set the color of a rectangle based on its index
-    ofColor setRectangleColor(int numberInVector);
-    
+    ofColor setRectangleColor(int numberInVector, bool highlighted);
+
     // Function to draw a diagonal cross inside a rectangle
-    void drawDiagonalCross(const m_rectangleWithFlag& item);
-    
-    // Vector of vectors to store rectangles with flags for different tracks
-    std::vector<m_rectangleWithFlag> m_beats[3];
-    
-    ofFbo m_frameBuffer;  // Framebuffer object for off-screen rendering and optimization
-    bool m_guiChanged = false;  // Flag to indicate if the GUI has been modified
-    
-    int m_highlightTick = -1;  // Tick to be highlighted, default is -1 (no highlight)
-    int m_tuplets;  // Number of tuplets used in the GUI
-    
+    void drawDiagonalCross(const ofRectangle& rect);
+
+    // Returns the rectangle of a step, relative to the first step of the view
+    ofRectangle stepRectangle(int track, float position) const;
+
+    // Returns the texture of a page, redrawn if the pattern, rhythm or zoom changed since
+    pageTexture& cachedPage(int page);
+
+    // Draws the steps of a page into a texture
+    void drawPage(pageTexture& cached, int page);
+
+    // Picks up the rhythm given to setup()
+    void layout();
+
+    // Keeps the view inside the pattern
+    void clampView();
+
+    // Returns the number of pixels of the window the view can take
+    static float windowViewWidth();
+
+    // Returns the first page in view and the one after the last
+    void pagesInView(int& first, int& end) const;
+
+    stepPattern* m_pattern = nullptr;  // Pattern shown and edited by the GUI
+
+    std::array<pageTexture, maxCachedPages> m_pages;  // Textures of the pages drawn most recently
+    uint64_t m_frame = 0;  // Frames drawn, for finding the least recently drawn page
+    bool m_texturesReady = false;  // True once textures can be allocated
+
+    float m_firstStep = 0.0f;  // Step at the left edge of the view (may be fractional)
+    float m_cellWidth = defaultCellWidth;  // Pixels per step
+    float m_viewWidth = 0.0f;  // Pixels of the view, from the window width
+    bool m_followPlayhead = true;  // Scroll along with the playhead
+
+    std::atomic<bool> m_guiChanged{false};  // Flag to indicate if the GUI has been modified
+    std::atomic<bool> m_layoutChanged{false};  // Flag to indicate that the rhythm has changed
+
+    std::atomic<int> m_highlightTick{-1};  // Tick to be highlighted, default is -1 (no highlight)
+    std::atomic<int> m_pendingQuarters{0};  // Quarters given to setup(), laid out on the GUI thread
+    std::atomic<int> m_pendingTuplets{1};  // Tuplets given to setup(), laid out on the GUI thread
+    int m_tuplets = 1;  // Number of tuplets used in the GUI
+    int m_numSteps = 0;  // Number of steps laid out
+
 };
 
 #endif /* sequencerGui_h */
@@ -15,6 +15,12 @@
 #include "musicPlayer.h"       // Includes the full definition of the MusicPlayer class
 #include "midiInstrument.h"    // Includes the full definition of the MidiInstrument class
 #include "sampleInstrument.h"  // Includes the full definition of the sampleInstrument class
+#include "synthInstrument.h"   // Includes the full definition of the synthInstrument class
+#include "midiClock.h"         // Includes the full definition of the midiClockInput class
+#include "consoleControl.h"    // Includes the full definition of the consoleControl class
+#include "oscControl.h"        // Includes the full definition of the oscControl class
+#include "instrumentLoader.h"  // Includes the full definition of the instrumentLoader class
+#include "audioRecorder.h"     // Includes the full definition of the audioRecorder class
 
 // Factory method to create audioManager
 std::unique_ptr<audioManager> factory::createAudioManager(int sampleRate, int bufferSize) {
@@ -70,3 +76,51 @@ std::unique_ptr<instrument> factory::createSampleInstrument() {
     // sampleInstrument is derived from instrument
     return std::make_unique<sampleInstrument>();
 }
+
+// Factory method to create a midiClockInput instance
+std::unique_ptr<midiClockInput> factory::createMidiClockInput(midiClockSlave& slave) {
+    // Creates and returns a unique pointer to a new midiClockInput object
+    // The input forwards every clock and transport message to the slave
+    return std::make_unique<midiClockInput>(slave);
+}
+
+// Factory method to create a consoleControl instance
+std::unique_ptr<consoleControl> factory::createConsoleControl() {
+    // Creates and returns a unique pointer to a new consoleControl object
+    return std::make_unique<consoleControl>();
+}
+
+// Factory method to create an oscControl instance
+std::unique_ptr<oscControl> factory::createOscControl(metronome* metronome) {
+    // Creates and returns a unique pointer to a new oscControl object
+    // The endpoint does not listen until start() is called with a port
+    return std::make_unique<oscControl>(metronome);
+}
+
+// Factory method to create a SampleInstrument instance with a kit
+std::unique_ptr<instrument> factory::createSampleInstrument(const std::vector<std::string>& files) {
+    // Creates and returns a unique pointer to a new sampleInstrument object
+    // The files are loaded and decoded before this returns
+    return std::make_unique<sampleInstrument>(files);
+}
+
+// Factory method to create a synthInstrument instance
+std::unique_ptr<instrument> factory::createSynthInstrument() {
+    // Creates and returns a unique pointer to a new synthInstrument object
+    // The synthesizer needs no files, so it is ready to play at once
+    return std::make_unique<synthInstrument>();
+}
+
+// Factory method to create an instrumentLoader instance
+std::unique_ptr<instrumentLoader> factory::createInstrumentLoader(musicPlayer* player) {
+    // Creates and returns a unique pointer to a new instrumentLoader object
+    // The loader does not run until start() is called
+    return std::make_unique<instrumentLoader>(player);
+}
+
+// Factory method to create an audioRecorder instance
+std::unique_ptr<audioRecorder> factory::createAudioRecorder() {
+    // Creates and returns a unique pointer to a new audioRecorder object
+    // Nothing is allocated until a recording starts
+    return std::make_unique<audioRecorder>();
+}
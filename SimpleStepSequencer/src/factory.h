@@ -20,6 +20,8 @@ easy management and modification of object construction across the application.
 #define factory_h
 
 #include <memory>  // For std::unique_ptr
+#include <string>  // For std::string
+#include <vector>  // For std::vector
 
 // Forward declarations
 // Declaring classes without including their headers to reduce compilation dependencies
@@ -36,11 +38,17 @@ class audioManager;
 class guiManager;
 class sequencerGui;
 class metronome;
+class audioRecorder;
 class customGui;
 class musicPlayer;
 class instrument;
 class midiInstrument;  // Note: Fixed class name from m_midiInstrument to midiInstrument
 class sampleInstrument;
+class midiClockInput;
+class midiClockSlave;
+class consoleControl;
+class oscControl;
+class instrumentLoader;
 
 class factory {
 public:
@@ -77,6 +85,34 @@ public:
     // Factory method to create a SampleInstrument instance
     // Returns a unique pointer to an instrument object that is specifically a sampleInstrument
     static std::unique_ptr<instrument> createSampleInstrument();
+
+    // Factory method to create a SampleInstrument instance with a kit of files in bin/data
+    // Loads and decodes the files, so call it off the audio thread
+    static std::unique_ptr<instrument> createSampleInstrument(const std::vector<std::string>& files);
+
+    // Factory method to create a synthInstrument instance
+    // Returns a unique pointer to an instrument object that is specifically a synthInstrument
+    static std::unique_ptr<instrument> createSynthInstrument();
+
+    // Factory method to create an instrumentLoader instance
+    // Returns a unique pointer to a loader that prepares instruments for the given music player
+    static std::unique_ptr<instrumentLoader> createInstrumentLoader(musicPlayer* player);
+
+    // Factory method to create an audioRecorder instance
+    // Returns a unique pointer to a recorder of the output and its stems
+    static std::unique_ptr<audioRecorder> createAudioRecorder();
+
+    // Factory method to create a midiClockInput instance
+    // Returns a unique pointer to a MIDI input that forwards incoming clock to the given slave
+    static std::unique_ptr<midiClockInput> createMidiClockInput(midiClockSlave& slave);
+
+    // Factory method to create a consoleControl instance
+    // Returns a unique pointer to a reader of text commands on standard input
+    static std::unique_ptr<consoleControl> createConsoleControl();
+
+    // Factory method to create an oscControl instance
+    // Returns a unique pointer to an OSC endpoint that sends commands to the given metronome
+    static std::unique_ptr<oscControl> createOscControl(metronome* metronome);
 };
 
 #endif /* factory_h */
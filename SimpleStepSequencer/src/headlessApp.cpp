@@ -0,0 +1,675 @@
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <sstream>
+#include "headlessApp.h"
+#include "factory.h"
+#include "rtSafety.h"
+#include "timelineTrace.h"
+
+//--------------------------------------------------------------
+headlessApp::headlessApp(audioManager::audioBackend backend, int oscPort, const realtimeSettings& realtime,
+                         int numOutputChannels, int numInputChannels, const std::string& inputFile,
+                         const std::string& traceFile)
+: m_backend(backend), m_oscPort(oscPort), m_realtime(realtime), m_numOutputChannels(numOutputChannels),
+  m_numInputChannels(numInputChannels), m_inputFile(inputFile), m_traceFile(traceFile) {
+}
+
+//--------------------------------------------------------------
+void headlessApp::setup(){
+    auto start = std::chrono::steady_clock::now();
+    
+    // Nothing is drawn, so the loop only needs to run often enough to pick up commands
+    ofSetFrameRate(30);
+    
+    // Create the audio engine first and only; there is no sequencerGui to link to
+    m_audioManager = factory::createAudioManager(m_sampleRate, m_bufferSize);
+    m_audioManager->setBackend(m_backend);
+    m_audioManager->setNumOutputChannels(m_numOutputChannels);
+    m_audioManager->setNumInputChannels(m_numInputChannels);
+    if (!m_inputFile.empty()) {
+        m_audioManager->setInputFile(m_inputFile); // Also sets the number of input channels
+    }
+    m_audioManager->setRealtimeSettings(m_realtime);
+    m_audioManager->setup(nullptr);
+    
+    // Without a customGui, the metronome gets its default settings here
+    m_audioManager->getMetronome()->setup(120, 4, 4);
+    
+    // Record the session from its initial settings on, so it can be replayed
+    if (!m_traceFile.empty()) {
+        m_audioManager->startTrace(m_traceFile);
+    }
+    
+    // Start listening for commands on standard input
+    m_control = factory::createConsoleControl();
+    m_control->start();
+    
+    // Optionally listen for OSC as well
+    if (m_oscPort > 0) {
+        m_oscControl = factory::createOscControl(m_audioManager->getMetronome());
+        m_oscControl->start(m_oscPort);
+    }
+    
+    double millis = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    ofLogNotice("headlessApp") << "Ready in " << millis << " ms, type \"help\" for commands";
+}
+
+//--------------------------------------------------------------
+void headlessApp::update(){
+    TIMELINE_SCOPE("update");
+    // Apply every command that arrived since the last iteration
+    std::string line;
+    while (m_control->poll(line)) {
+        handleCommand(line);
+        if (m_backend != audioManager::audioBackend::nullOffline) {
+            m_audioManager->getMetronome()->waitForCommands(); // Applied by the next buffer
+        }
+        m_audioManager->getMetronome()->commitEdits(); // Every command is an undo step of its own
+    }
+    
+    // Let the audio manager drive the latency auto-tune, if it is running
+    m_audioManager->update();
+}
+
+//--------------------------------------------------------------
+void headlessApp::exit(){
+    // Stop reading commands before the engine goes away
+    m_control->stop();
+    if (m_oscControl) {
+        m_oscControl->stop();
+    }
+    m_audioManager->exit();
+}
+
+//--------------------------------------------------------------
+bool headlessApp::sendControl(const engineCommand& command){
+    metronome* metronomePtr = m_audioManager->getMetronome();
+    if (metronomePtr->applyControl(command)) {
+        return true;
+    }
+    // Offline nothing empties the queue until the next render
+    if (m_backend != audioManager::audioBackend::nullOffline) {
+        metronomePtr->waitForCommands();
+        if (metronomePtr->applyControl(command)) {
+            return true;
+        }
+    }
+    ofLogWarning("headlessApp") << "Command not sent: the command queue is full";
+    return false;
+}
+
+//--------------------------------------------------------------
+bool headlessApp::waitForApplied(){
+    return m_backend != audioManager::audioBackend::nullOffline && m_audioManager->getMetronome()->waitForCommands();
+}
+
+//--------------------------------------------------------------
+void headlessApp::handleCommand(const std::string& line){
+    std::istringstream words(line);
+    std::string command;
+    words >> command;
+    
+    metronome* metronomePtr = m_audioManager->getMetronome();
+    
+    if (command.empty()) {
+        return;
+    } else if (command == "play" || command == "stop") {
+        m_running = command == "play";
+        engineCommand transport;
+        transport.kind = engineCommand::type::transport;
+        transport.first = m_running;
+        sendControl(transport);
+    } else if (command == "tempo") {
+        engineCommand tempo;
+        tempo.kind = engineCommand::type::tempo;
+        words >> tempo.value >> tempo.value2;  // tempo <bpm> <seconds> glides
+        sendControl(tempo);
+    } else if (command == "rhythm") {
+        engineCommand rhythm;
+        rhythm.kind = engineCommand::type::rhythm;
+        words >> rhythm.first >> rhythm.second;
+        sendControl(rhythm);
+    } else if (command == "step") {
+        int track = -1, step = -1, on = -1;
+        words >> track >> step >> on;
+        engineCommand set;
+        set.kind = engineCommand::type::step;
+        set.first = track;
+        set.second = step;
+        set.third = on < 0 ? !metronomePtr->getPattern()->isStepOn(track, step) : on != 0;  // No value given: toggle
+        set.fourth = -1;
+        sendControl(set);
+    } else if (command == "pattern") {
+        engineCommand select;
+        select.kind = engineCommand::type::selectPattern;
+        select.first = -1;
+        words >> select.first;
+        sendControl(select);
+    } else if (command == "route") {
+        int track = -1, voice = -1, channel = 1;
+        std::string target;
+        words >> track >> target >> voice >> channel;
+        metronome::destination destination = metronome::destination::midi;
+        if (target == "sampler") {
+            destination = metronome::destination::sampler;
+        } else if (target == "synth") {
+            destination = metronome::destination::synth;
+        }
+        if (voice < 0) {
+            voice = destination == metronome::destination::midi ? 60 + track : track; // Default voice
+        }
+        if (channel < 1 || channel > 16) {
+            channel = 1;
+        }
+        engineCommand route;
+        route.kind = engineCommand::type::route;
+        route.first = track;
+        route.second = static_cast<int32_t>(destination);
+        route.third = voice;
+        route.fourth = channel;
+        if (!sendControl(route)) {
+            return;
+        }
+        // Confirm what the engine plays once it has taken the change, or else what was sent
+        if (waitForApplied()) {
+            ofLogNotice("headlessApp") << "Track " << track << ": " << metronomePtr->describeRoute(track);
+        } else if (destination == metronome::destination::midi) {
+            ofLogNotice("headlessApp") << "Track " << track << ": MIDI note " << voice << " channel " << channel << " from the next buffer";
+        } else {
+            ofLogNotice("headlessApp") << "Track " << track << ": " << target << " voice " << voice << " from the next buffer";
+        }
+    } else if (command == "param") {
+        int track = -1, step = -1;
+        std::string name;
+        float value = 0.0f;
+        words >> track >> step >> name >> value;
+        const std::vector<std::string> names = {"tune", "decay", "tone", "noise"};
+        auto found = std::find(names.begin(), names.end(), name);
+        if (found == names.end()) {
+            ofLogNotice("headlessApp") << "Params: tune, decay, tone, noise (-1 to 1)";
+            return;
+        }
+        stepPattern* pattern = metronomePtr->getPattern();
+        int param = int(found - names.begin());
+        engineCommand set;
+        set.kind = engineCommand::type::stepParam;
+        set.first = track;
+        set.second = step;
+        set.third = param;
+        set.value = value;
+        if (!sendControl(set)) {
+            return;
+        }
+        if (waitForApplied()) {
+            ofLogNotice("headlessApp") << "Track " << track << " step " << step << " " << name << " "
+                                       << pattern->getStepParam(track, step, param);
+        } else {
+            ofLogNotice("headlessApp") << "Track " << track << " step " << step << " " << name << " "
+                                       << value << " from the next buffer";
+        }
+    } else if (command == "bus") {
+        int track = -1, bus = 0;
+        words >> track >> bus;
+        engineCommand route;
+        route.kind = engineCommand::type::bus;
+        route.first = track;
+        route.second = bus;
+        if (!sendControl(route)) {
+            return;
+        }
+        if (waitForApplied()) {
+            ofLogNotice("headlessApp") << "Track " << track << ": " << metronomePtr->describeRoute(track);
+        } else {
+            ofLogNotice("headlessApp") << "Track " << track << ": bus " << bus << " from the next buffer";
+        }
+    } else if (command == "busout") {
+        int bus = -1;
+        std::string channel;
+        words >> bus >> channel;
+        int first = channel == "off" || channel.empty() ? outputBuses::muted : ofToInt(channel);
+        engineCommand output;
+        output.kind = engineCommand::type::busOutput;
+        output.first = bus;
+        output.second = first;
+        sendControl(output);
+    } else if (command == "insert") {
+        int track = -1;
+        std::string what;
+        float value = 0, second = 0;
+        words >> track >> what >> value >> second;
+        engineCommand set;
+        set.kind = engineCommand::type::insert;
+        set.first = track;
+        set.value = value;
+        if (what == "gain") {
+            set.second = static_cast<int32_t>(trackInserts::stage::gain);           // insert <track> gain <dB>
+        } else if (what == "lowpass" || what == "highpass" || what == "bandpass") {
+            trackInserts::filterMode mode = what == "lowpass" ? trackInserts::filterMode::lowpass
+                                          : what == "highpass" ? trackInserts::filterMode::highpass
+                                                               : trackInserts::filterMode::bandpass;
+            set.second = static_cast<int32_t>(trackInserts::stage::filter);         // insert <track> lowpass <Hz> [<Q>]
+            set.third = static_cast<int32_t>(mode);
+            set.value2 = second > 0 ? second : 0.707f;
+        } else if (what == "filter") {
+            set.second = static_cast<int32_t>(trackInserts::stage::filter);         // insert <track> filter off
+            set.third = static_cast<int32_t>(trackInserts::filterMode::off);
+        } else if (what == "comp") {
+            set.second = static_cast<int32_t>(trackInserts::stage::dynamics);       // insert <track> comp <threshold dB> [<ratio>]
+            set.third = static_cast<int32_t>(trackInserts::dynamicsMode::compressor);
+            set.value2 = second > 0 ? second : 4.0f;
+        } else if (what == "transient") {
+            set.second = static_cast<int32_t>(trackInserts::stage::dynamics);       // insert <track> transient <-1..1>
+            set.third = static_cast<int32_t>(trackInserts::dynamicsMode::transient);
+        } else if (what == "dynamics") {
+            set.second = static_cast<int32_t>(trackInserts::stage::dynamics);       // insert <track> dynamics off
+            set.third = static_cast<int32_t>(trackInserts::dynamicsMode::off);
+        } else if (what == "drive") {
+            set.second = static_cast<int32_t>(trackInserts::stage::drive);          // insert <track> drive <dB>
+        } else if (what == "off") {
+            set.second = static_cast<int32_t>(trackInserts::stage::all);
+        } else {
+            set.second = -1; // Only shows the inserts
+        }
+        if (set.second >= 0 && !sendControl(set)) {
+            return;
+        }
+        if (set.second < 0 || waitForApplied()) {
+            ofLogNotice("headlessApp") << "Track " << track << " inserts: " << metronomePtr->getInserts()->describe(track);
+        } else {
+            ofLogNotice("headlessApp") << "Track " << track << " inserts: " << what << " from the next buffer";
+        }
+    } else if (command == "send") {
+        int track = -1, send = -1;
+        std::string level;
+        words >> track >> send >> level;
+        engineCommand set;
+        set.kind = engineCommand::type::sendLevel;
+        set.first = track;
+        set.second = send;
+        set.value = level == "off" ? 0.0f : std::pow(10.0f, ofToFloat(level) / 20.0f); // send <track> <send> <dB>|off
+        if (!sendControl(set)) {
+            return;
+        }
+        if (waitForApplied()) {
+            ofLogNotice("headlessApp") << "Send " << send << ": " << metronomePtr->getSends()->describe(send);
+        } else {
+            ofLogNotice("headlessApp") << "Send " << send << ": track " << track << (level == "off" ? " off" : " at " + level + " dB")
+                                       << " from the next buffer";
+        }
+    } else if (command == "return") {
+        int send = -1;
+        std::string what, value;
+        float level = 0;
+        words >> send >> what >> value >> level;
+        if (what == "ir") {
+            metronomePtr->loadImpulse(send, value);                              // return <send> ir <file.wav>
+        } else if (what == "hall") {
+            metronomePtr->makeHall(send, ofToFloat(value));                      // return <send> hall <seconds>
+        } else if (what == "bus") {
+            engineCommand set;
+            set.kind = engineCommand::type::sendReturn;
+            set.first = send;
+            set.second = ofToInt(value);
+            set.value = level;
+            if (!sendControl(set)) {                                             // return <send> bus <bus> [<dB>]
+                return;
+            }
+            if (!waitForApplied()) {
+                ofLogNotice("headlessApp") << "Send " << send << ": returns to bus " << value << " at " << level
+                                           << " dB from the next buffer";
+                return;
+            }
+        }
+        ofLogNotice("headlessApp") << "Send " << send << ": " << metronomePtr->getSends()->describe(send);
+    } else if (command == "record") {
+        std::string file, option;
+        words >> file >> option;
+        if (file == "stop" || file.empty()) {
+            metronomePtr->stopRecording();
+        } else {
+            metronomePtr->startRecording(file, option == "stems");
+        }
+    } else if (command == "steprec") {
+        std::string state;
+        words >> state;
+        metronomePtr->setStepRecording(state != "off");
+    } else if (command == "input") {
+        std::string what, value;
+        words >> what >> value;
+        if (what == "threshold") {
+            metronomePtr->setInputThreshold(ofToFloat(value));  // input threshold <level 0-1>
+        } else if (what == "latency") {
+            metronomePtr->setInputLatency(ofToFloat(value));    // input latency <ms>
+        } else {
+            metronomePtr->setInputTrack(ofToInt(what), value == "off" ? -1 : ofToInt(value)); // input <channel> <track>|off
+        }
+    } else if (command == "show") {
+        showPattern();
+    } else if (command == "render") {
+        float seconds = 0;
+        words >> seconds;
+        if (m_backend != audioManager::audioBackend::nullOffline) {
+            ofLogNotice("headlessApp") << "render needs --offline";
+        } else if (seconds > 0) {
+            int buffers = (int)std::ceil(seconds * m_sampleRate / m_bufferSize);
+            auto start = std::chrono::steady_clock::now();
+            m_audioManager->processOffline(buffers);
+            double millis = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            ofLogNotice("headlessApp") << "Rendered " << buffers << " buffers in " << millis << " ms";
+        }
+    } else if (command == "trace") {
+        std::string file;
+        words >> file;
+        if (file == "stop" || file.empty()) {
+            m_audioManager->stopTrace();  // trace stop
+        } else if (m_audioManager->startTrace(file)) {
+            ofLogNotice("headlessApp") << "Tracing into " << file;  // trace <file>
+        }
+    } else if (command == "replay") {
+        std::string file;
+        words >> file;
+        audioManager::replayResult result;
+        if (m_backend != audioManager::audioBackend::nullOffline) {
+            ofLogNotice("headlessApp") << "replay needs --offline";
+        } else if (m_audioManager->replayTrace(file, result)) {
+            m_sampleRate = m_audioManager->getStats().sampleRate;  // The trace's settings
+            m_bufferSize = m_audioManager->getStats().bufferSize;
+            ofLogNotice("headlessApp") << "Replayed " << result.commands << " commands, " << result.frames << " frames in "
+                                       << result.millis << " ms: " << result.matched << " of " << result.checkpoints
+                                       << " checkpoints match"
+                                       << (result.firstMismatch >= 0 ? ", first difference at frame " + ofToString(result.firstMismatch) : "");
+        }
+    } else if (command == "timeline") {
+        std::string file;
+        words >> file;
+        timelineTrace::instance().write(file.empty() ? "timeline.json" : file);  // TIMELINE_TRACE builds
+    } else if (command == "kit") {
+        std::vector<std::string> files;
+        std::string file;
+        while (words >> file) {
+            files.push_back(file);
+        }
+        if (!files.empty()) {
+            metronomePtr->loadKit(files);  // kit <hihat.wav> <snare.wav> <kick.wav>
+        }
+    } else if (command == "swap") {
+        std::string point;
+        words >> point;
+        metronomePtr->setSwapPoint(point == "step" ? metronome::swapPoint::step : metronome::swapPoint::bar);
+    } else if (command == "clock") {
+        std::string mode;
+        words >> mode;
+        if (mode == "master") {
+            metronomePtr->setClockMode(metronome::clockMode::master);
+        } else if (mode == "slave") {
+            metronomePtr->setClockMode(metronome::clockMode::slave);
+        } else if (mode == "loopback") {
+            // A master sent straight into a slave for 20 simulated seconds, with up to
+            // <jitter ms> of random delay per message; the clock mode stays as it is
+            double jitterMs = 0.0, bpm = 120.0;
+            if (!(words >> jitterMs)) {
+                jitterMs = 0.0;
+            } else if (!(words >> bpm)) {
+                bpm = 120.0;
+            }
+            int sampleRate = m_audioManager->getStats().sampleRate;
+            midiLoopbackTransport::report report = midiLoopbackTransport::measure(sampleRate, bpm, jitterMs, 20.0);
+            ofLogNotice("headlessApp") << "Clock loopback at " << bpm << " BPM with up to " << jitterMs << " ms jitter: "
+                                       << (report.locked ? "locked in " + ofToString(report.lockTimeSeconds, 3) + " s" : "not locked")
+                                       << ", measured jitter " << ofToString(report.jitterMs, 3) << " ms, phase error "
+                                       << ofToString(report.phaseErrorMs, 3) << " ms RMS (" << ofToString(report.worstPhaseErrorMs, 3)
+                                       << " ms worst), tempo " << ofToString(report.tempo, 3);
+        } else {
+            metronomePtr->setClockMode(metronome::clockMode::internal);
+        }
+    } else if (command == "audio") {
+        int sampleRate = 0, bufferSize = 0, channels = 2;
+        words >> sampleRate >> bufferSize >> channels;
+        m_audioManager->reconfigure(sampleRate, bufferSize, channels);
+    } else if (command == "tune") {
+        m_audioManager->startLatencyTuning();
+    } else if (command == "stats") {
+        audioManager::audioStats stats = m_audioManager->getStats();
+        ofLogNotice("headlessApp") << stats.sampleRate << " Hz, " << stats.bufferSize << " frames, "
+                                   << stats.numOutputChannels << " channels, " << stats.callbacks << " callbacks, "
+                                   << stats.deadlineMisses << " missed deadlines, peak "
+                                   << stats.peakCallbackMicros << " us (" << stats.peakLoad * 100.0 << "% load)"
+                                   << (stats.tuning ? ", tuning" : "");
+        if (m_realtime.enabled) {
+            const tuningReport& hardening = stats.hardening;
+            ofLogNotice("headlessApp") << "Real-time: priority " << threadTuning::toString(hardening.priority)
+                                       << ", memory lock " << threadTuning::toString(hardening.memoryLock)
+                                       << ", audio pinning " << threadTuning::toString(hardening.audioPinning)
+                                       << ", worker pinning " << threadTuning::toString(hardening.workerPinning)
+                                       << ", denormals " << threadTuning::toString(hardening.denormals)
+                                       << (hardening.message.empty() ? "" : " (" + hardening.message + ")");
+        }
+        audioRecorder::stats recording = metronomePtr->getRecordingStats();
+        if (recording.recording) {
+            ofLogNotice("headlessApp") << "Recording " << recording.numFiles << " files: " << recording.framesRecorded
+                                       << " frames, " << recording.overruns << " overruns (" << recording.droppedFrames
+                                       << " frames dropped), peak ring fill " << recording.peakFill * 100.0 << "%, "
+                                       << recording.bytesWritten / (1024 * 1024) << " MB written, "
+                                       << recording.writeErrors << " write errors";
+        }
+        sendEffects::stats sends = metronomePtr->getSends()->getStats();
+        ofLogNotice("headlessApp") << "Sends: " << sends.lateBlocks << " late reverb blocks, worker load "
+                                   << sends.workerLoad * 100.0 << "%";
+        metronome::inputStats input = metronomePtr->getInputStats();
+        if (input.onsets > 0 || metronomePtr->isStepRecording()) {
+            ofLogNotice("headlessApp") << "Input: " << input.onsets << " hits, " << input.recorded << " recorded"
+                                       << (metronomePtr->isStepRecording() ? " (step recording)" : "")
+                                       << (input.lastStep < 0 ? "" : ", last on track " + ofToString(input.lastTrack)
+                                           + " step " + ofToString(input.lastStep) + " "
+                                           + ofToString(input.lastMicro) + "/" + ofToString(stepPattern::microResolution));
+        }
+#if defined(RT_SAFETY_CHECKS)
+        ofLogNotice("headlessApp") << rtSafety::getViolations() << " real-time violations so far";
+#endif
+        if (m_oscControl) {
+            oscControl::stats osc = m_oscControl->getStats();
+            ofLogNotice("headlessApp") << "OSC: " << osc.packets << " packets, " << osc.bundles << " bundles, "
+                                       << osc.messages << " messages, " << osc.dropped << " dropped, "
+                                       << osc.malformed << " malformed";
+        }
+    } else if (command == "gen") {
+        generate(words);
+    } else if (command == "selftest") {
+        selfTest(words);
+    } else if (command == "undo" || command == "redo") {
+        bool done = command == "undo" ? metronomePtr->undo() : metronomePtr->redo();
+        if (!done) {
+            ofLogNotice("headlessApp") << "Nothing to " << command;
+        } else {
+            showPattern();
+        }
+    } else if (command == "history") {
+        float megabytes = 0.0f;
+        if (words >> megabytes && megabytes > 0.0f) {
+            metronomePtr->setHistoryBudget(size_t(megabytes * 1024 * 1024));
+        }
+        patternHistory::stats history = metronomePtr->getHistoryStats();
+        ofLogNotice("headlessApp") << "History: " << history.undoable << " undo, " << history.redoable << " redo, "
+                                   << history.bytes / 1024 << " of " << history.budget / 1024 << " KB, "
+                                   << history.dropped << " dropped";
+    } else if (command == "quit") {
+        ofExit(m_failedTests > 0 ? 1 : 0); // A failed self-test fails the run, e.g. in CI
+    } else {
+        ofLogNotice("headlessApp") << "Commands: play | stop | tempo <bpm> [<ramp seconds>] | rhythm <beats> <tuplets> | "
+                                   << "step <track> <step> [0|1] | param <track> <step> tune|decay|tone|noise <value> | pattern <slot> | "
+                                   << "gen <tracks>|seed [euclid <hits> <length> [<rotation>] | random <density> | fill <density> | mutate <amount> | rotate <steps> | clear | <seed>] | "
+                                   << "route <track> midi|sampler|synth [<voice>] [<channel>] | bus <track> <bus> | busout <bus> <channel>|off | "
+                                   << "insert <track> [gain <dB> | lowpass|highpass|bandpass <Hz> [<Q>] | filter off | comp <threshold dB> [<ratio>] | "
+                                   << "transient <amount> | dynamics off | drive <dB> | off] | "
+                                   << "send <track> <send> <dB>|off | return <send> [ir <file> | hall <seconds> | bus <bus> [<dB>]] | record <file> [stems] | record stop | trace <file> | trace stop | replay <file> | timeline [<file>] | selftest clock [<hours>] [<bpm>] | selftest dispatch [<buffers> <bufferSize> [<hits>]] | "
+                                   << "steprec on|off | input <channel> <track>|off | input threshold <level> | input latency <ms> | show | undo | redo | history [<MB>] | render <seconds> | kit <file>... | swap step|bar | clock internal|master|slave | clock loopback [<jitter ms>] [<bpm>] | "
+                                   << "audio <sampleRate> <bufferSize> [<channels>] | tune | stats | quit";
+    }
+}
+
+//--------------------------------------------------------------
+void headlessApp::generate(std::istringstream& words){
+    std::string tracks, kind;
+    words >> tracks;
+    if (tracks == "seed") {
+        uint64_t seed = 1;
+        words >> seed;
+        m_generator.setSeed(seed);
+        return;
+    }
+    words >> kind;
+    
+    // Tracks: "all", one track, a list ("0,2") or a range ("0-2")
+    uint32_t trackMask = 0;
+    if (tracks == "all") {
+        trackMask = (uint32_t(1) << stepPattern::numTracks) - 1;
+    } else {
+        std::istringstream list(tracks);
+        std::string item;
+        while (std::getline(list, item, ',')) {
+            size_t dash = item.find('-', 1);
+            int first = ofToInt(item.substr(0, dash));
+            int last = dash == std::string::npos ? first : ofToInt(item.substr(dash + 1));
+            for (int track = std::max(first, 0); track <= std::min(last, stepPattern::numTracks - 1); track++) {
+                trackMask |= uint32_t(1) << track;
+            }
+        }
+    }
+    
+    metronome* metronomePtr = m_audioManager->getMetronome();
+    stepPattern* pattern = metronomePtr->getPattern();
+    int numSteps = pattern->getNumSteps();
+    
+    // Arguments: euclid <hits> <length> [<rotation>], or one number for the others
+    float amount = 0.0f;
+    int hits = 0, length = numSteps, rotation = 0;
+    if (kind == "euclid") {
+        words >> hits;
+        if (!(words >> length)) {
+            length = numSteps; // Spread over the whole pattern
+        }
+        if (!(words >> rotation)) {
+            rotation = 0;
+        }
+    } else {
+        words >> amount;
+    }
+    bool known = kind == "euclid" || kind == "random" || kind == "fill" || kind == "mutate"
+                 || kind == "rotate" || kind == "clear";
+    if (!known || trackMask == 0) {
+        ofLogNotice("headlessApp") << "Usage: gen <tracks> euclid <hits> <length> [<rotation>] | random <density> | "
+                                   << "fill <density> | mutate <amount> | rotate <steps> | clear; gen seed <seed>";
+        return;
+    }
+    
+    std::array<stepPattern::trackWords, stepPattern::numTracks> steps{};
+    for (int track = 0; track < stepPattern::numTracks; track++) {
+        if (!((trackMask >> track) & 1)) {
+            continue;
+        }
+        for (int word = 0; word < stepPattern::wordsPerTrack; word++) {
+            steps[track][word] = pattern->getWord(track, word); // Fill, mutate and rotate start from the steps there are
+        }
+        if (kind == "euclid") {
+            patternGenerator::euclid(steps[track], numSteps, hits, length, rotation);
+        } else if (kind == "random") {
+            m_generator.random(steps[track], numSteps, amount);
+        } else if (kind == "fill") {
+            m_generator.fill(steps[track], numSteps, amount);
+        } else if (kind == "mutate") {
+            m_generator.mutate(steps[track], numSteps, amount);
+        } else if (kind == "rotate") {
+            patternGenerator::rotate(steps[track], numSteps, (int)amount);
+        } else {
+            steps[track].fill(0);
+        }
+    }
+    if (!metronomePtr->publishSteps(steps, trackMask)) {
+        ofLogWarning("headlessApp") << "Command queue full, nothing generated";
+    }
+}
+
+//--------------------------------------------------------------
+void headlessApp::selfTest(std::istringstream& words){
+    std::string test;
+    words >> test;
+    if (test == "clock") {
+        // The clock must not drift by a single frame over a day of playing
+        double hours = 24.0;
+        int bpm = 120;
+        if (!(words >> hours)) {
+            hours = 24.0;
+        } else if (!(words >> bpm)) {
+            bpm = 120;
+        }
+        int sampleRate = m_audioManager->getStats().sampleRate;
+        
+        // The integer tempo is checked exactly; a tempo between two integers and both ramp
+        // shapes, gliding over the first half of the run, against the closed-form position
+        double rampSeconds = hours * 1800.0;
+        struct clockCase {
+            std::string name;
+            double startBpm;
+            double targetBpm;
+            double rampSeconds;
+            tempoClock::rampShape shape;
+            bool exact;             // Compared in integers (integer tempo only)
+        };
+        const clockCase cases[] = {
+            {ofToString(bpm) + " BPM", double(bpm), double(bpm), 0.0, tempoClock::rampShape::linear, true},
+            {ofToString(bpm + 1.0 / 3.0, 3) + " BPM", bpm + 1.0 / 3.0, bpm + 1.0 / 3.0, 0.0, tempoClock::rampShape::linear, false},
+            {"linear ramp " + ofToString(bpm) + " to " + ofToString(bpm * 1.5) + " BPM", double(bpm), bpm * 1.5, rampSeconds, tempoClock::rampShape::linear, false},
+            {"exponential ramp " + ofToString(bpm) + " to " + ofToString(bpm * 0.75) + " BPM", double(bpm), bpm * 0.75, rampSeconds, tempoClock::rampShape::exponential, false},
+        };
+        for (const clockCase& check : cases) {
+            auto start = std::chrono::steady_clock::now();
+            tempoClock::driftReport report = check.exact
+                ? tempoClock::measureDrift(sampleRate, bpm, 4, hours)
+                : tempoClock::measureRamp(sampleRate, check.startBpm, check.targetBpm, check.rampSeconds, check.shape, 4, hours);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            bool passed = report.frames > 0 && report.worstError == 0 && report.ticks == report.expectedTicks;
+            if (!passed) {
+                m_failedTests++; // Makes quit return a non-zero exit status
+            }
+            ofLogNotice("headlessApp") << "Clock drift over " << hours << " h at " << check.name << ", " << sampleRate << " Hz: "
+                                       << report.ticks << " of " << report.expectedTicks << " ticks, worst error "
+                                       << report.worstError << " frames (" << seconds << " s): " << (passed ? "passed" : "FAILED");
+        }
+    } else if (test == "dispatch") {
+        // The instruments called by their exact type against the instrument interface
+        int buffers = 20000;
+        int bufferSize = 256;
+        int hits = 8;
+        if (words >> buffers && words >> bufferSize) {
+            words >> hits;
+        }
+        for (int hitsPerBuffer : {hits, 0}) {
+            musicPlayer::dispatchReport report = musicPlayer::measureDispatch(buffers, bufferSize, hitsPerBuffer);
+            ofLogNotice("headlessApp") << "Dispatch over " << buffers << " buffers of " << bufferSize << " frames, "
+                                       << hitsPerBuffer << " hits each: unique_ptr<instrument> " << report.virtualMicros
+                                       << " us, instrumentVariant " << report.variantMicros << " us per buffer"
+                                       << " (this build uses " << (report.staticBuild ? "instrumentVariant" : "unique_ptr<instrument>") << ")";
+        }
+    } else {
+        ofLogNotice("headlessApp") << "Usage: selftest clock [<hours>] [<bpm>] | selftest dispatch [<buffers> <bufferSize> [<hits>]]";
+    }
+}
+
+//--------------------------------------------------------------
+void headlessApp::showPattern(){
+    stepPattern* pattern = m_audioManager->getMetronome()->getPattern();
+    for (int track = 0; track < stepPattern::numTracks; track++) {
+        std::string steps, offsets;
+        for (int step = 0; step < pattern->getNumSteps(); step++) {
+            bool on = pattern->isStepOn(track, step);
+            steps += on ? 'x' : '.';
+            int micro = pattern->getMicroTiming(track, step);
+            if (on && micro != 0) {
+                offsets += " " + ofToString(step) + (micro > 0 ? ":+" : ":") + ofToString(micro);
+            }
+        }
+        ofLogNotice("headlessApp") << "Track " << track << " " << steps
+                                   << (offsets.empty() ? "" : "  off grid (1/" + ofToString(stepPattern::microResolution) + " step):" + offsets);
+    }
+}
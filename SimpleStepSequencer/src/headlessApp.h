@@ -0,0 +1,82 @@
+/*
+The headlessApp class is the application class used when the sequencer runs without a
+window (started with --headless). It creates only the audio side of the app: the
+audioManager, the metronome it owns and the instruments. There is no GUI, no OpenGL context
+and no vertical sync. The sequencer is driven by text commands on standard input through
+consoleControl; type "help" for the list of commands. With --osc-port it can also be driven
+through OSC (see oscControl).
+
+With --offline nothing is processed until a "render" command, which runs the engine as
+fast as it can. Together with --input-file this records a WAV file of hits into the pattern
+(step recording) deterministically, e.g. to test the onset detection and quantization.
+"replay" plays a session trace recorded with --trace or "trace" again this way and checks
+that it sounds the same (see sessionTrace).
+*/
+
+#pragma once  // Ensures the file is included only once during compilation, preventing redefinition errors.
+
+#include "ofMain.h"          // Includes core openFrameworks functionality.
+#include "audioManager.h"    // Includes the header for the audioManager class.
+#include "consoleControl.h"  // Includes the header for the consoleControl class.
+#include "oscControl.h"      // Includes the header for the oscControl class.
+#include "patternGenerator.h" // Includes the header for the patternGenerator class.
+
+class headlessApp : public ofBaseApp {
+public:
+    // Constructor; backend selects the sound card or a device-less backend, a non-zero
+    // oscPort opens the OSC endpoint on that port, realtime selects the real-time hardening,
+    // numOutputChannels the width of the output and numInputChannels that of the live input.
+    // A non-empty inputFile is played as the input of the device-less backends, and a
+    // non-empty traceFile records a session trace of the whole run.
+    headlessApp(audioManager::audioBackend backend, int oscPort = 0, const realtimeSettings& realtime = realtimeSettings(),
+                int numOutputChannels = 2, int numInputChannels = 0, const std::string& inputFile = "",
+                const std::string& traceFile = "");
+
+    // Called once when the application starts. Creates the audio engine and the control interface.
+    void setup() override;
+
+    // Called every loop iteration. Applies received commands and drives the latency auto-tune.
+    void update() override;
+
+    // Called when the application is about to exit. Used for cleanup tasks.
+    void exit() override;
+
+private:
+    // Interprets one command line
+    void handleCommand(const std::string& line);
+
+    // Sends a command to the audio thread; when the queue is full, waits for a buffer to
+    // empty it and tries once more. Logs and returns false if the command was not sent
+    bool sendControl(const engineCommand& command);
+
+    // Waits until the audio thread has applied the commands sent so far; returns false if it
+    // has not, e.g. offline, where nothing is applied until the next render
+    bool waitForApplied();
+
+    // Prints the steps of every track, with the micro-timing of steps off the grid
+    void showPattern();
+
+    // Runs a generator over some tracks and publishes the result for the next bar
+    void generate(std::istringstream& words);
+
+    // Runs one of the engine's self-checks and prints whether it passed
+    void selfTest(std::istringstream& words);
+
+    // Unique pointers to the audio engine and the control interface.
+    std::unique_ptr<audioManager> m_audioManager;
+    std::unique_ptr<consoleControl> m_control;
+    std::unique_ptr<oscControl> m_oscControl;
+
+    audioManager::audioBackend m_backend; // Sound card or device-less backend
+    int m_oscPort;              // UDP port for OSC, 0 = no OSC
+    realtimeSettings m_realtime; // Real-time hardening of the audio thread
+    int m_numOutputChannels;    // Output channels; every pair is an output bus
+    int m_numInputChannels;     // Input channels; hits on them can be step recorded
+    std::string m_inputFile;    // Input of the device-less backends, if not empty
+    std::string m_traceFile;    // Session trace recorded from the start, if not empty
+    int m_sampleRate = 44100;   // The sample rate for the audio processing.
+    int m_bufferSize = 512;     // The size of the audio buffer.
+    bool m_running = false;     // Transport state as last commanded
+    int m_failedTests = 0;      // Self-tests that failed; quit then exits with status 1
+    patternGenerator m_generator; // Writes the steps of the gen command
+};
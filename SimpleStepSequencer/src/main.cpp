@@ -5,19 +5,80 @@ main loop where application logic is updated and graphics are rendered, and hand
 processing and resource management.
 */
 
+#include <cstdlib>   // For std::atoi, used to read the command line options.
+#include <cstring>   // For std::strcmp, used to read the command line options.
 #include "ofMain.h"  // Includes the core openFrameworks header, which provides essential framework functionality.
 #include "ofApp.h"   // Includes the header file for your main application class, ofApp.
+#include "headlessApp.h"   // Includes the header file for the application class used without a window.
+#include "ofAppNoWindow.h" // Includes the window stand-in that runs the main loop without a display.
+#include "threadTuning.h"  // Includes the real-time hardening settings.
+#include "rtSafety.h"      // Includes the real-time safety checker (RT_SAFETY_CHECKS builds).
+#include "startupTrace.h"  // Includes the startup timing.
+#include "timelineTrace.h" // Includes the timeline of the threads (TIMELINE_TRACE builds).
 
 //========================================================================
-int main( ){
-     
+int main(int argc, char* argv[]){
+
+    // Startup is timed from here to the first audio callback and the first frame
+    startupTrace::instance().begin();
+    TIMELINE_THREAD("main");
+
+    // Read the command line options:
+    //   --headless    run only the audio engine, controlled through standard input
+    //   --null-audio  (with --headless) run without a sound card, e.g. for testing
+    //   --offline     (with --headless) run without a sound card; audio is only processed by "render"
+    //   --osc-port n  listen for OSC control messages on UDP port n of 127.0.0.1
+    //   --realtime    harden the audio thread: real-time priority, locked memory, FTZ/DAZ
+    //   --audio-cores 2,3   (with --realtime) pin the audio thread to these cores
+    //   --worker-cores 0,1  (with --realtime) pin the worker threads to these cores
+    //   --channels n  open n output channels; every channel pair is an output bus for stems
+    //   --inputs n    open n input channels; hits on them can be recorded into the pattern
+    //   --input-file f.wav  (with --null-audio or --offline) play a WAV file as the input
+    //   --trace f.trace  record a session trace of the run, to replay it with "replay"
+    bool headless = false;
+    bool nullAudio = false;
+    bool offline = false;
+    int oscPort = 0;
+    realtimeSettings realtime;
+    int numOutputChannels = 2;
+    int numInputChannels = 0;
+    std::string inputFile;
+    std::string traceFile;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--headless") == 0) headless = true;
+        if (std::strcmp(argv[i], "--null-audio") == 0) nullAudio = true;
+        if (std::strcmp(argv[i], "--osc-port") == 0 && i + 1 < argc) oscPort = std::atoi(argv[++i]);
+        if (std::strcmp(argv[i], "--realtime") == 0) realtime.enabled = true;
+        if (std::strcmp(argv[i], "--audio-cores") == 0 && i + 1 < argc) realtime.audioCores = threadTuning::parseCores(argv[++i]);
+        if (std::strcmp(argv[i], "--worker-cores") == 0 && i + 1 < argc) realtime.workerCores = threadTuning::parseCores(argv[++i]);
+        if (std::strcmp(argv[i], "--channels") == 0 && i + 1 < argc) numOutputChannels = std::atoi(argv[++i]);
+        if (std::strcmp(argv[i], "--offline") == 0) offline = true;
+        if (std::strcmp(argv[i], "--inputs") == 0 && i + 1 < argc) numInputChannels = std::atoi(argv[++i]);
+        if (std::strcmp(argv[i], "--input-file") == 0 && i + 1 < argc) inputFile = argv[++i];
+        if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) traceFile = argv[++i];
+    }
+
+    if (headless) {
+        // ofAppNoWindow runs the main loop without creating a window or an OpenGL context,
+        // so nothing waits for vertical sync or needs a GPU.
+        ofSetupOpenGL(std::make_shared<ofAppNoWindow>(), 0, 0, OF_WINDOW);
+        audioManager::audioBackend backend = offline ? audioManager::audioBackend::nullOffline
+                                           : nullAudio ? audioManager::audioBackend::nullRealtime
+                                           : audioManager::audioBackend::soundStream;
+        int status = ofRunApp(std::make_shared<headlessApp>(backend, oscPort, realtime, numOutputChannels,
+                                                            numInputChannels, inputFile, traceFile));
+
+        // In RT_SAFETY_CHECKS builds, real-time violations fail the run, e.g. in CI
+        return rtSafety::report() > 0 ? 1 : status;
+    }
+
     // Use ofGLFWWindowSettings for more options like multi-monitor fullscreen
     // ofGLFWWindowSettings allows configuration of window properties like size, mode, and more advanced settings.
     ofGLWindowSettings settings;
-     
+
     // Set the window size to 1200x768 pixels. This defines the resolution of the window when created.
     settings.setSize(1200, 768);
-     
+
     // Set the window mode to OF_WINDOW, which creates a windowed application.
     // You can switch this to OF_FULLSCREEN to create a fullscreen application.
     settings.windowMode = OF_WINDOW;
@@ -28,9 +89,12 @@ int main( ){
 
     // Start the application, linking the window with the ofApp instance.
     // ofRunApp takes the window to run the application in, and the instance of your main application class.
-    ofRunApp(window, make_shared<ofApp>());
+    ofRunApp(window, make_shared<ofApp>(oscPort, realtime, numOutputChannels, numInputChannels, traceFile));
 
     // Start the main event loop, which continuously handles events, updates, and drawing.
     // The loop runs until the application is closed.
     ofRunMainLoop();
+
+    // In RT_SAFETY_CHECKS builds, list what the audio thread should not have called
+    return rtSafety::report() > 0 ? 1 : 0;
 }
@@ -1,7 +1,18 @@
 #include "ofApp.h"
 
+//--------------------------------------------------------------
+ofApp::ofApp(int oscPort, const realtimeSettings& realtime, int numOutputChannels, int numInputChannels,
+             const std::string& traceFile)
+: m_oscPort(oscPort), m_realtime(realtime), m_numOutputChannels(numOutputChannels), m_numInputChannels(numInputChannels),
+  m_traceFile(traceFile) {
+}
+
 //--------------------------------------------------------------
 void ofApp::setup(){
+    // The startup report waits for the first frame as well as the first audio callback
+    startupTrace::instance().setExpectsFrame(true);
+    startupTrace::phase phase("app setup");
+
     // Set vertical synchronization to ensure the drawing is synchronized with the display's refresh rate
     ofSetVerticalSync(true);
     
@@ -23,36 +34,62 @@ void ofApp::setup(){
     // Initialize the Audio manager
     // This method likely sets up audio processing and any audio-related configurations
     // Pass the sequencerGui instance to AudioManager to establish a link between the GUI and audio processing
+    m_audioManager->setNumOutputChannels(m_numOutputChannels);
+    m_audioManager->setNumInputChannels(m_numInputChannels);
+    m_audioManager->setRealtimeSettings(m_realtime);
     m_audioManager->setup(m_guiManager->getSequencerGui());
 
     // Set the metronome pointer in the GUI manager to ensure that the GUI can interact with the metronome
     // Retrieve the metronome instance from the AudioManager and pass it to the GUI manager
-    m_guiManager->setMetronome(m_audioManager->getMetronome());
+    {
+        startupTrace::phase panels("gui panels");
+        m_guiManager->setMetronome(m_audioManager->getMetronome());
+    }
+    
+    // Record the session from its initial settings on, so it can be replayed
+    if (!m_traceFile.empty()) {
+        m_audioManager->startTrace(m_traceFile);
+    }
+    
+    // Optionally let other programs control the sequencer through OSC
+    if (m_oscPort > 0) {
+        m_oscControl = factory::createOscControl(m_audioManager->getMetronome());
+        m_oscControl->start(m_oscPort);
+    }
 }
 
 //--------------------------------------------------------------
 void ofApp::exit(){
     // Clean up resources and perform any necessary shutdown operations
     // Call the exit methods for both AudioManager and GUIManager to ensure a proper cleanup
+    if (m_oscControl) {
+        m_oscControl->stop();  // Stop sending commands before the engine goes away
+    }
     m_audioManager->exit();
     m_guiManager->exit();
 }
 
 //--------------------------------------------------------------
 void ofApp::update(){
+    TIMELINE_SCOPE("update");
     // Update the sound system to handle any changes or processing
     // This might include updating audio playback, processing, or other related tasks
     ofSoundUpdate();
     
+    // Let the audio manager drive the latency auto-tune, if it is running
+    m_audioManager->update();
+    
     // Update the GUI manager, which may involve processing user input, refreshing the display, etc.
     m_guiManager->update();
 }
 
 //--------------------------------------------------------------
 void ofApp::draw(){
+    TIMELINE_SCOPE("frame");
     // Draw the GUI elements to the screen
     // This method is responsible for rendering the GUI components managed by guiManager
     m_guiManager->draw();
+    startupTrace::instance().markFirstFrame();
 }
 
 //--------------------------------------------------------------
@@ -63,6 +100,46 @@ void ofApp::audioOut(ofSoundBuffer &buffer){
     m_audioManager->processAudio(buffer);
 }
 
+//--------------------------------------------------------------
+void ofApp::keyPressed(int key){
+    // 't' starts searching for the smallest stable audio buffer size
+    if (key == 't') {
+        m_audioManager->startLatencyTuning();
+    }
+    
+    // 'r' starts and stops recording the output and the stems to bin/data
+    if (key == 'r') {
+        metronome* metronomePtr = m_audioManager->getMetronome();
+        if (metronomePtr->getRecordingStats().recording) {
+            metronomePtr->stopRecording();
+        } else {
+            metronomePtr->startRecording("recording.wav", true);
+        }
+    }
+    
+    // 'z' undoes the latest pattern edit and 'y' redoes it
+    if (key == 'z') {
+        m_audioManager->getMetronome()->undo();
+    }
+    if (key == 'y') {
+        m_audioManager->getMetronome()->redo();
+    }
+    
+    // Arrows, '+', '-' and 'f' scroll, zoom and follow the step grid
+    m_guiManager->keyPressed(key);
+    
+    // 'i' starts and stops recording hits on the live input into the pattern
+    if (key == 'i') {
+        metronome* metronomePtr = m_audioManager->getMetronome();
+        metronomePtr->setStepRecording(!metronomePtr->isStepRecording());
+    }
+    
+    // 'l' saves the timeline of the last seconds to bin/data (TIMELINE_TRACE builds)
+    if (key == 'l') {
+        timelineTrace::instance().write("timeline.json");
+    }
+}
+
 //--------------------------------------------------------------
 void ofApp::mousePressed(int x, int y, int button){
     // Handle mouse press events
@@ -70,3 +147,20 @@ void ofApp::mousePressed(int x, int y, int button){
     // This allows the GUI manager to respond to user interactions with the GUI elements
     m_guiManager->mousePressed(x, y);
 }
+
+//--------------------------------------------------------------
+void ofApp::mouseDragged(int x, int y, int button){
+    // The panels follow the mouse while it is dragged, so the window has to be redrawn
+    m_guiManager->requestRedraw();
+}
+
+//--------------------------------------------------------------
+void ofApp::mouseReleased(int x, int y, int button){
+    m_guiManager->requestRedraw();
+}
+
+//--------------------------------------------------------------
+void ofApp::mouseScrolled(int x, int y, float scrollX, float scrollY){
+    // Scrolling moves the step grid along the pattern
+    m_guiManager->mouseScrolled(scrollX, scrollY);
+}
@@ -11,11 +11,21 @@ entry point for defining and controlling the application's behavior.
 #include "ofMain.h"        // Includes core openFrameworks functionality.
 #include "audioManager.h"  // Includes the header for the audioManager class.
 #include "guiManager.h"    // Includes the header for the guiManager class.
+#include "oscControl.h"    // Includes the header for the oscControl class.
+#include "startupTrace.h"  // Includes the startup timing.
+#include "timelineTrace.h" // Includes the timeline of the threads (TIMELINE_TRACE builds).
 
 // The ofApp class inherits from ofBaseApp, which provides basic app lifecycle methods
 // like setup, update, draw, etc. This is the main application class that controls the app's behavior.
 class ofApp : public ofBaseApp {
 public:
+    // Constructor; a non-zero oscPort opens the OSC endpoint on that port, realtime selects
+    // the real-time hardening of the audio thread, numOutputChannels the output width and
+    // numInputChannels the width of the live input. A non-empty traceFile records a session
+    // trace of the whole run.
+    ofApp(int oscPort = 0, const realtimeSettings& realtime = realtimeSettings(), int numOutputChannels = 2,
+          int numInputChannels = 0, const std::string& traceFile = "");
+
     // Called once when the application starts. Used to initialize the app.
     void setup() override;
 
@@ -28,9 +38,19 @@ public:
     // Called when the application is about to exit. Used for cleanup tasks.
     void exit() override;
 
+    // Called when a key is pressed. Used for keyboard shortcuts.
+    void keyPressed(int key) override;
+
     // Called when the mouse is pressed. Used to handle mouse press events.
     void mousePressed(int x, int y, int button) override;
 
+    // Called when the mouse is dragged or released. Used to redraw the panels being dragged.
+    void mouseDragged(int x, int y, int button) override;
+    void mouseReleased(int x, int y, int button) override;
+
+    // Called when the mouse wheel or trackpad scrolls. Used to scroll the step grid.
+    void mouseScrolled(int x, int y, float scrollX, float scrollY) override;
+
     // Called periodically by the sound stream to fill the sound buffer.
     // This is where audio processing occurs.
     void audioOut(ofSoundBuffer & buffer) override;
@@ -41,6 +61,22 @@ private:
     std::unique_ptr<audioManager> m_audioManager;
     std::unique_ptr<guiManager> m_guiManager;
 
+    // Optional OSC endpoint, and the UDP port it listens on (0 = no OSC)
+    std::unique_ptr<oscControl> m_oscControl;
+    int m_oscPort;
+
+    // Real-time hardening of the audio thread
+    realtimeSettings m_realtime;
+
+    // The number of output channels; every channel pair is an output bus
+    int m_numOutputChannels;
+
+    // The number of input channels; hits on them can be step recorded
+    int m_numInputChannels;
+
+    // Session trace recorded from the start, if not empty
+    std::string m_traceFile;
+
     // The sample rate for the audio processing. Defines the number of samples per second.
     int m_sampleRate = 44100;
 